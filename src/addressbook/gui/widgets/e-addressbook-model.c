@@ -43,6 +43,7 @@ struct _EAddressbookModelPrivate {
 
 	/* Query Results */
 	GPtrArray *contacts;
+	GHashTable *contacts_index; /* const gchar *uid ~> index + 1 into 'contacts' */
 
 	/* Signal Handler IDs */
 	gulong create_contact_id;
@@ -89,10 +90,44 @@ free_data (EAddressbookModel *model)
 	GPtrArray *array;
 
 	array = model->priv->contacts;
+	g_hash_table_remove_all (model->priv->contacts_index);
 	g_ptr_array_foreach (array, (GFunc) g_object_unref, NULL);
 	g_ptr_array_set_size (array, 0);
 }
 
+/* The keys are owned by the contacts, thus the contact's UID
+ * is to be removed from the index before the contact is freed. */
+static void
+contacts_index_set (EAddressbookModel *model,
+                    EContact *contact,
+                    guint index)
+{
+	const gchar *uid;
+
+	uid = e_contact_get_const (contact, E_CONTACT_UID);
+	if (uid) {
+		/* Replace also the key, the previous one can belong
+		 * to a contact which is going to be freed. */
+		g_hash_table_replace (model->priv->contacts_index, (gpointer) uid, GUINT_TO_POINTER (index + 1));
+	}
+}
+
+static gint
+contacts_index_lookup (EAddressbookModel *model,
+                       const gchar *uid)
+{
+	gpointer value;
+
+	if (!uid)
+		return -1;
+
+	value = g_hash_table_lookup (model->priv->contacts_index, uid);
+	if (!value)
+		return -1;
+
+	return GPOINTER_TO_INT (value) - 1;
+}
+
 static void
 remove_book_view (EAddressbookModel *model)
 {
@@ -186,6 +221,7 @@ view_create_contact_cb (EBookClientView *client_view,
 	while (contact_list != NULL) {
 		EContact *contact = contact_list->data;
 
+		contacts_index_set (model, contact, array->len);
 		g_ptr_array_add (array, g_object_ref (contact));
 		contact_list = contact_list->next;
 	}
@@ -209,51 +245,58 @@ view_remove_contact_cb (EBookClientView *client_view,
                         const GSList *ids,
                         EAddressbookModel *model)
 {
-	/* XXX we should keep a hash around instead of this O(n*m) loop */
 	const GSList *iter;
 	GArray *indices;
 	GPtrArray *array;
-	gint ii;
+	guint ii, jj;
 
 	array = model->priv->contacts;
 	indices = g_array_new (FALSE, FALSE, sizeof (gint));
 
 	for (iter = ids; iter != NULL; iter = iter->next) {
 		const gchar *target_uid = iter->data;
+		EContact *contact;
+		gint index;
 
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *contact;
-			const gchar *uid;
+		index = contacts_index_lookup (model, target_uid);
+		if (index < 0)
+			continue;
 
-			contact = array->pdata[ii];
-			/* check if already removed */
-			if (!contact)
-				continue;
+		contact = array->pdata[index];
 
-			uid = e_contact_get_const (contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
+		g_hash_table_remove (model->priv->contacts_index, target_uid);
+		g_object_unref (contact);
+		g_array_append_val (indices, index);
+		array->pdata[index] = NULL;
+	}
 
-			if (strcmp (uid, target_uid) == 0) {
-				g_object_unref (contact);
-				g_array_append_val (indices, ii);
-				array->pdata[ii] = NULL;
-				break;
-			}
-		}
+	if (indices->len == 0) {
+		g_array_free (indices, TRUE);
+		return;
 	}
 
-	/* Sort the 'indices' array in descending order, since
-	 * g_ptr_array_remove_index() shifts subsequent elements
-	 * down one position to fill the gap. */
+	/* Sort the 'indices' array in descending order; the listeners
+	 * expect it that way, to be able to remove the rows one by one. */
 	g_array_sort (indices, sort_descending);
 
-	for (ii = 0; ii < indices->len; ii++) {
-		gint index;
+	/* Compact the array in one pass, starting at the first removed
+	 * contact, and update the index of the moved contacts. */
+	for (ii = jj = g_array_index (indices, gint, indices->len - 1); ii < array->len; ii++) {
+		EContact *contact = array->pdata[ii];
+
+		if (!contact)
+			continue;
 
-		index = g_array_index (indices, gint, ii);
-		g_ptr_array_remove_index (array, index);
+		if (ii != jj) {
+			array->pdata[jj] = contact;
+			contacts_index_set (model, contact, jj);
+		}
+
+		jj++;
 	}
 
+	g_ptr_array_set_size (array, jj);
+
 	g_signal_emit (model, signals[CONTACTS_REMOVED], 0, indices);
 	g_array_free (indices, TRUE);
 
@@ -272,37 +315,29 @@ view_modify_contact_cb (EBookClientView *client_view,
 	while (contact_list != NULL) {
 		EContact *new_contact = contact_list->data;
 		const gchar *target_uid;
-		gint ii;
+		gint index;
 
 		target_uid = e_contact_get_const (new_contact, E_CONTACT_UID);
 		g_warn_if_fail (target_uid != NULL);
 
-		/* skip contacts without UID */
-		if (!target_uid) {
+		index = contacts_index_lookup (model, target_uid);
+
+		/* skip contacts without UID or not in the model */
+		if (index < 0) {
 			contact_list = contact_list->next;
 			continue;
 		}
 
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *old_contact;
-			const gchar *uid;
-
-			old_contact = array->pdata[ii];
-			g_return_if_fail (old_contact != NULL);
-
-			uid = e_contact_get_const (old_contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
-
-			if (strcmp (uid, target_uid) != 0)
-				continue;
+		new_contact = e_contact_duplicate (new_contact);
 
-			g_object_unref (old_contact);
-			array->pdata[ii] = e_contact_duplicate (new_contact);
+		/* Index the new contact first, the key
+		 * is owned by the old contact. */
+		contacts_index_set (model, new_contact, index);
+		g_object_unref (array->pdata[index]);
+		array->pdata[index] = new_contact;
 
-			g_signal_emit (
-				model, signals[CONTACT_CHANGED], 0, ii);
-			break;
-		}
+		g_signal_emit (
+			model, signals[CONTACT_CHANGED], 0, index);
 
 		contact_list = contact_list->next;
 	}
@@ -577,6 +612,7 @@ addressbook_model_finalize (GObject *object)
 	priv = E_ADDRESSBOOK_MODEL_GET_PRIVATE (object);
 
 	g_ptr_array_free (priv->contacts, TRUE);
+	g_hash_table_destroy (priv->contacts_index);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_addressbook_model_parent_class)->finalize (object);
@@ -768,6 +804,7 @@ e_addressbook_model_init (EAddressbookModel *model)
 {
 	model->priv = E_ADDRESSBOOK_MODEL_GET_PRIVATE (model);
 	model->priv->contacts = g_ptr_array_new ();
+	model->priv->contacts_index = g_hash_table_new (g_str_hash, g_str_equal);
 	model->priv->first_get_view = TRUE;
 }
 
@@ -874,6 +911,12 @@ e_addressbook_model_find (EAddressbookModel *model,
 	g_return_val_if_fail (E_IS_CONTACT (contact), -1);
 
 	array = model->priv->contacts;
+
+	ii = contacts_index_lookup (model, e_contact_get_const (contact, E_CONTACT_UID));
+	if (ii >= 0 && array->pdata[ii] == contact)
+		return ii;
+
+	/* Contacts without UID, or with a UID shared by more contacts */
 	for (ii = 0; ii < array->len; ii++) {
 		EContact *candidate = array->pdata[ii];
 
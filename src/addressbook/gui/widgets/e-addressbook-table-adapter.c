@@ -38,6 +38,10 @@
 	(G_TYPE_INSTANCE_GET_PRIVATE \
 	((obj), E_TYPE_ADDRESSBOOK_TABLE_ADAPTER, EAddressbookTableAdapterPrivate))
 
+/* Up to how many ranges of removed contacts are notified
+ * as separate deletions, instead of a change of the whole model */
+#define MAX_REMOVED_RUNS 32
+
 struct _EAddressbookTableAdapterPrivate {
 	EAddressbookModel *model;
 
@@ -405,18 +409,42 @@ remove_contacts (EAddressbookModel *model,
                 EAddressbookTableAdapter *adapter)
 {
 	GArray *indices = (GArray *) data;
-	gint count = indices->len;
+	guint ii, n_runs = 0;
 
 	/* clear whole cache */
 	g_hash_table_remove_all (adapter->priv->emails);
 
-	e_table_model_pre_change (E_TABLE_MODEL (adapter));
-	if (count == 1)
+	/* The 'indices' are sorted in descending order, count
+	 * the runs of consecutive rows among them */
+	for (ii = 0; ii < indices->len; ii++) {
+		if (ii == 0 || g_array_index (indices, gint, ii - 1) != g_array_index (indices, gint, ii) + 1)
+			n_runs++;
+	}
+
+	/* Too many scattered rows are cheaper to be reloaded at once */
+	if (n_runs > MAX_REMOVED_RUNS) {
+		e_table_model_pre_change (E_TABLE_MODEL (adapter));
+		e_table_model_changed (E_TABLE_MODEL (adapter));
+		return;
+	}
+
+	/* Delete the runs from the end, thus the rows
+	 * of the following runs keep their position. */
+	for (ii = 0; ii < indices->len;) {
+		gint last = g_array_index (indices, gint, ii);
+		gint count = 1;
+
+		while (ii + count < indices->len &&
+		       g_array_index (indices, gint, ii + count) == last - count)
+			count++;
+
+		e_table_model_pre_change (E_TABLE_MODEL (adapter));
 		e_table_model_rows_deleted (
 			E_TABLE_MODEL (adapter),
-			g_array_index (indices, gint, 0), 1);
-	else
-		e_table_model_changed (E_TABLE_MODEL (adapter));
+			last - count + 1, count);
+
+		ii += count;
+	}
 }
 
 static void
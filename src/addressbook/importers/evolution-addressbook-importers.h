@@ -18,6 +18,8 @@
  */
 
 #include <gtk/gtk.h>
+#include <libebook/libebook.h>
+#include <e-util/e-util.h>
 
 struct _EImportImporter *evolution_ldif_importer_peek (void);
 struct _EImportImporter *evolution_vcard_importer_peek (void);
@@ -27,3 +29,26 @@ struct _EImportImporter *evolution_csv_evolution_importer_peek (void);
 
 /* private utility function for importers only */
 GtkWidget *evolution_contact_importer_get_preview_widget (const GSList *contacts);
+
+/* How many contacts are added into the book at once */
+#define EVOLUTION_CONTACT_IMPORTER_BATCH_SIZE 100
+
+typedef struct _EvolutionContactImporterBatch EvolutionContactImporterBatch;
+
+/* Called in a dedicated thread; returns the next contact to import,
+ * or NULL when there are no more. The *out_percent is the progress. */
+typedef EContact *(* EvolutionContactImporterNextFunc) (EvolutionContactImporterBatch *batch,
+							gpointer user_data,
+							gint *out_percent,
+							GCancellable *cancellable);
+
+void evolution_contact_importer_run (EImport *import,
+				     EImportTarget *target,
+				     EBookClient *book_client,
+				     guint batch_size,
+				     EvolutionContactImporterNextFunc next_func,
+				     gpointer user_data,
+				     GDestroyNotify user_data_free,
+				     GCancellable *cancellable);
+void evolution_contact_importer_flush (EvolutionContactImporterBatch *batch,
+				       GCancellable *cancellable);
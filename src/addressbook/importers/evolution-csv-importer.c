@@ -53,9 +53,8 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
+	GCancellable *cancellable;
 
-	gint state;
 	FILE *file;
 	gulong size;
 	gint count;
@@ -65,14 +64,11 @@ typedef struct {
 	GHashTable *fields_map;
 
 	EBookClient *book_client;
-	GSList *contacts;
 } CSVImporter;
 
 static gint importer;
 static gchar delimiter;
 
-static void csv_import_done (CSVImporter *gci);
-
 typedef struct {
 	const gchar *csv_attribute;
 	EContactField contact_field;
@@ -767,36 +763,21 @@ getNextCSVEntry (CSVImporter *gci,
 	return contact;
 }
 
-static gboolean
-csv_import_contacts (gpointer d)
+static EContact *
+csv_import_next_contact (EvolutionContactImporterBatch *batch,
+                         gpointer user_data,
+                         gint *out_percent,
+                         GCancellable *cancellable)
 {
-	CSVImporter *gci = d;
-	EContact *contact = NULL;
+	CSVImporter *gci = user_data;
+	EContact *contact;
 
-	while ((contact = getNextCSVEntry (gci, gci->file))) {
-		gchar *uid = NULL;
+	contact = getNextCSVEntry (gci, gci->file);
 
-		e_book_client_add_contact_sync (
-			gci->book_client, contact, E_BOOK_OPERATION_FLAG_NONE, &uid, NULL, NULL);
-		if (uid != NULL) {
-			e_contact_set (contact, E_CONTACT_UID, uid);
-			g_free (uid);
-		}
-		gci->contacts = g_slist_prepend (gci->contacts, contact);
-	}
-	if (contact == NULL) {
-		gci->state = 1;
-	}
-	if (gci->state == 1) {
-		csv_import_done (gci);
-		return FALSE;
-	}
-	else {
-		e_import_status (
-			gci->import, gci->target, _("Importing…"),
-			ftell (gci->file) * 100 / gci->size);
-		return TRUE;
-	}
+	if (contact && gci->size > 0)
+		*out_percent = ftell (gci->file) * 100 / gci->size;
+
+	return contact;
 }
 
 static void
@@ -911,20 +892,19 @@ csv_supported (EImport *ei,
 }
 
 static void
-csv_import_done (CSVImporter *gci)
+csv_importer_free (gpointer ptr)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	CSVImporter *gci = ptr;
+
+	g_datalist_remove_data (&gci->target->data, "csv-data");
 
 	fclose (gci->file);
-	g_object_unref (gci->book_client);
-	g_slist_foreach (gci->contacts, (GFunc) g_object_unref, NULL);
-	g_slist_free (gci->contacts);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
 
 	if (gci->fields_map)
 		g_hash_table_destroy (gci->fields_map);
 
-	e_import_complete (gci->import, gci->target, NULL);
 	g_object_unref (gci->import);
 
 	g_free (gci);
@@ -937,16 +917,29 @@ book_client_connect_cb (GObject *source_object,
 {
 	CSVImporter *gci = user_data;
 	EClient *client;
+	GError *error = NULL;
 
-	client = e_book_client_connect_finish (result, NULL);
+	client = e_book_client_connect_finish (result, &error);
 
 	if (client == NULL) {
-		csv_import_done (gci);
+		EImport *import = g_object_ref (gci->import);
+		EImportTarget *target = gci->target;
+
+		csv_importer_free (gci);
+
+		e_import_complete (import, target, error);
+		g_object_unref (import);
+		g_clear_error (&error);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
-	gci->idle_id = g_idle_add (csv_import_contacts, gci);
+
+	evolution_contact_importer_run (
+		gci->import, gci->target, gci->book_client,
+		EVOLUTION_CONTACT_IMPORTER_BATCH_SIZE,
+		csv_import_next_contact, gci, csv_importer_free,
+		gci->cancellable);
 }
 
 static void
@@ -986,6 +979,7 @@ csv_import (EImport *ei,
 	g_datalist_set_data (&target->data, "csv-data", gci);
 	gci->import = g_object_ref (ei);
 	gci->target = target;
+	gci->cancellable = g_cancellable_new ();
 	gci->file = file;
 	gci->fields_map = NULL;
 	gci->count = 0;
@@ -1037,7 +1031,7 @@ csv_cancel (EImport *ei,
 	CSVImporter *gci = g_datalist_get_data (&target->data, "csv-data");
 
 	if (gci)
-		gci->state = 1;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
@@ -49,11 +49,11 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
+	GCancellable *cancellable;
 
 	GHashTable *dn_contact_hash;
 
-	gint state;		/* 0 - initial scan, 1 - list cards, 2 - cancelled/complete */
+	gint state;		/* 0 - initial scan, 1 - list cards */
 	FILE *file;
 	gulong size;
 
@@ -64,8 +64,6 @@ typedef struct {
 	GSList *list_iterator;
 } LDIFImporter;
 
-static void ldif_import_done (LDIFImporter *gci);
-
 static struct {
 	const gchar *ldif_attribute;
 	EContactField contact_field;
@@ -481,73 +479,54 @@ add_to_notes (EContact *contact,
 	g_free (new_text);
 }
 
-static gboolean
-ldif_import_contacts (gpointer d)
+static EContact *
+ldif_import_next_contact (EvolutionContactImporterBatch *batch,
+                          gpointer user_data,
+                          gint *out_percent,
+                          GCancellable *cancellable)
 {
-	LDIFImporter *gci = d;
+	LDIFImporter *gci = user_data;
 	EContact *contact;
-	GSList *iter;
-	gint count = 0;
 
 	/* We process all normal cards immediately and keep the list
 	 * ones till the end */
 
 	if (gci->state == 0) {
-		while (count < 50 && (contact = getNextLDIFEntry (
-			gci->dn_contact_hash, gci->file))) {
+		while (contact = getNextLDIFEntry (gci->dn_contact_hash, gci->file), contact) {
+			if (gci->size > 0)
+				*out_percent = ftell (gci->file) * 100 / gci->size;
+
 			if (e_contact_get (contact, E_CONTACT_IS_LIST)) {
 				gci->list_contacts = g_slist_prepend (
 					gci->list_contacts, contact);
 			} else {
-				gchar *uid = NULL;
-
 				add_to_notes (contact, E_CONTACT_OFFICE);
 				add_to_notes (contact, E_CONTACT_SPOUSE);
 				add_to_notes (contact, E_CONTACT_BLOG_URL);
 
-				e_book_client_add_contact_sync (
-					gci->book_client,
-					contact, E_BOOK_OPERATION_FLAG_NONE, &uid, NULL, NULL);
-				if (uid != NULL) {
-					e_contact_set (contact, E_CONTACT_UID, uid);
-					g_free (uid);
-				}
 				gci->contacts = g_slist_prepend (gci->contacts, contact);
+
+				return g_object_ref (contact);
 			}
-			count++;
-		}
-		if (contact == NULL) {
-			gci->state = 1;
-			gci->list_iterator = gci->list_contacts;
-		}
-	}
-	if (gci->state == 1) {
-		for (iter = gci->list_iterator; count < 50 && iter; iter = iter->next) {
-			gchar *uid = NULL;
-
-			contact = iter->data;
-			resolve_list_card (gci, contact);
-			e_book_client_add_contact_sync (
-				gci->book_client, contact, E_BOOK_OPERATION_FLAG_NONE, &uid, NULL, NULL);
-			if (uid != NULL) {
-				e_contact_set (contact, E_CONTACT_UID, uid);
-				g_free (uid);
-			}
-			count++;
 		}
-		gci->list_iterator = iter;
-		if (iter == NULL)
-			gci->state = 2;
+
+		/* The lists reference the contacts by their UID */
+		evolution_contact_importer_flush (batch, cancellable);
+
+		gci->state = 1;
+		gci->list_iterator = gci->list_contacts;
 	}
-	if (gci->state == 2) {
-		ldif_import_done (gci);
-		return FALSE;
-	} else {
-		e_import_status (
-			gci->import, gci->target, _("Importing…"),
-			ftell (gci->file) * 100 / gci->size);
-		return TRUE;
+
+	if (gci->list_iterator) {
+		contact = gci->list_iterator->data;
+		gci->list_iterator = gci->list_iterator->next;
+
+		resolve_list_card (gci, contact);
+
+		return g_object_ref (contact);
 	}
+
+	return NULL;
 }
 
 static void
@@ -655,20 +634,21 @@ ldif_supported (EImport *ei,
 }
 
 static void
-ldif_import_done (LDIFImporter *gci)
+ldif_importer_free (gpointer ptr)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	LDIFImporter *gci = ptr;
+
+	g_datalist_remove_data (&gci->target->data, "ldif-data");
 
 	fclose (gci->file);
-	g_object_unref (gci->book_client);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
 	g_slist_foreach (gci->contacts, (GFunc) g_object_unref, NULL);
 	g_slist_foreach (gci->list_contacts, (GFunc) g_object_unref, NULL);
 	g_slist_free (gci->contacts);
 	g_slist_free (gci->list_contacts);
 	g_hash_table_destroy (gci->dn_contact_hash);
 
-	e_import_complete (gci->import, gci->target, NULL);
 	g_object_unref (gci->import);
 
 	g_free (gci);
@@ -681,16 +661,29 @@ book_client_connect_cb (GObject *source_object,
 {
 	LDIFImporter *gci = user_data;
 	EClient *client;
+	GError *error = NULL;
 
-	client = e_book_client_connect_finish (result, NULL);
+	client = e_book_client_connect_finish (result, &error);
 
 	if (client == NULL) {
-		ldif_import_done (gci);
+		EImport *import = g_object_ref (gci->import);
+		EImportTarget *target = gci->target;
+
+		ldif_importer_free (gci);
+
+		e_import_complete (import, target, error);
+		g_object_unref (import);
+		g_clear_error (&error);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
-	gci->idle_id = g_idle_add (ldif_import_contacts, gci);
+
+	evolution_contact_importer_run (
+		gci->import, gci->target, gci->book_client,
+		EVOLUTION_CONTACT_IMPORTER_BATCH_SIZE,
+		ldif_import_next_contact, gci, ldif_importer_free,
+		gci->cancellable);
 }
 
 static void
@@ -725,6 +718,7 @@ ldif_import (EImport *ei,
 	g_datalist_set_data (&target->data, "ldif-data", gci);
 	gci->import = g_object_ref (ei);
 	gci->target = target;
+	gci->cancellable = g_cancellable_new ();
 	gci->file = file;
 	fseek (file, 0, SEEK_END);
 	gci->size = ftell (file);
@@ -747,7 +741,7 @@ ldif_cancel (EImport *ei,
 	LDIFImporter *gci = g_datalist_get_data (&target->data, "ldif-data");
 
 	if (gci)
-		gci->state = 2;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
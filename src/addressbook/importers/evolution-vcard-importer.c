@@ -53,32 +53,24 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
-
-	gint state;		/* 0 - importing, 1 - cancelled/complete */
-	gint total;
-	gint count;
-
-	ESource *primary;
-
-	GSList *contactlist;
-	GSList *iterator;
+	GCancellable *cancellable;
 	EBookClient *book_client;
 
-	/* when opening book */
+	/* read in vcard_import(), parsed in a dedicated thread */
 	gchar *contents;
 	VCardEncoding encoding;
+	gboolean contents_prepared;
+	const gchar *pos;
+	gsize length;
 } VCardImporter;
 
-static void vcard_import_done (VCardImporter *gci);
+static gchar *utf16_to_utf8 (gunichar2 *utf16);
 
 static void
-vcard_import_contact (VCardImporter *gci,
-                      EContact *contact)
+vcard_prepare_contact (EContact *contact)
 {
 	EContactPhoto *photo;
 	GList *attrs, *attr;
-	gchar *uid = NULL;
 
 	/* Apple's addressbook.app exports PHOTO's without a TYPE
 	 * param, so let's figure out the format here if there's a
@@ -211,43 +203,73 @@ vcard_import_contact (VCardImporter *gci,
 								"OTHER");
 		}
 	}
+}
+
+static void
+vcard_prepare_contents (VCardImporter *gci)
+{
+	gchar *from, *to;
+
+	if (gci->encoding == VCARD_ENCODING_UTF16) {
+		gchar *tmp;
 
-	/* FIXME Error checking */
-	e_book_client_add_contact_sync (
-		gci->book_client, contact, E_BOOK_OPERATION_FLAG_NONE, &uid, NULL, NULL);
-	if (uid != NULL) {
-		e_contact_set (contact, E_CONTACT_UID, uid);
-		g_free (uid);
+		gunichar2 *contents_utf16 = (gunichar2 *) gci->contents;
+		tmp = utf16_to_utf8 (contents_utf16);
+		g_free (gci->contents);
+		gci->contents = tmp;
+
+	} else if (gci->encoding == VCARD_ENCODING_LOCALE) {
+		gchar *tmp;
+		tmp = g_locale_to_utf8 (gci->contents, -1, NULL, NULL, NULL);
+		g_free (gci->contents);
+		gci->contents = tmp;
+	}
+
+	gci->contents_prepared = TRUE;
+
+	if (!gci->contents)
+		return;
+
+	/* The same as eab_contact_list_from_string() does, only in place */
+	for (from = gci->contents, to = gci->contents; *from; from++) {
+		if (*from != '\r')
+			*to++ = *from;
+	}
+
+	*to = '\0';
+
+	gci->pos = gci->contents;
+	gci->length = to - gci->contents;
+
+	if (!strncmp (gci->pos, "Book: ", 6)) {
+		gci->pos = strchr (gci->pos, '\n');
+		if (gci->pos)
+			gci->pos++;
 	}
 }
 
-static gboolean
-vcard_import_contacts (gpointer data)
+static EContact *
+vcard_import_next_contact (EvolutionContactImporterBatch *batch,
+                           gpointer user_data,
+                           gint *out_percent,
+                           GCancellable *cancellable)
 {
-	VCardImporter *gci = data;
-	gint count = 0;
-	GSList *iterator = gci->iterator;
-
-	if (gci->state == 0) {
-		while (count < 50 && iterator) {
-			vcard_import_contact (gci, iterator->data);
-			count++;
-			iterator = iterator->next;
-		}
-		gci->count += count;
-		gci->iterator = iterator;
-		if (iterator == NULL)
-			gci->state = 1;
-	}
-	if (gci->state == 1) {
-		vcard_import_done (gci);
-		return FALSE;
-	} else {
-		e_import_status (
-			gci->import, gci->target, _("Importing…"),
-			gci->count * 100 / gci->total);
-		return TRUE;
+	VCardImporter *gci = user_data;
+	EContact *contact;
+
+	if (!gci->contents_prepared)
+		vcard_prepare_contents (gci);
+
+	contact = eab_contact_list_next_from_string (&gci->pos);
+
+	if (contact) {
+		vcard_prepare_contact (contact);
+
+		if (gci->length > 0 && gci->pos)
+			*out_percent = (gci->pos - gci->contents) * 100 / gci->length;
 	}
+
+	return contact;
 }
 
 #define BOM (gunichar2)0xFEFF
@@ -452,16 +474,15 @@ vcard_supported (EImport *ei,
 }
 
 static void
-vcard_import_done (VCardImporter *gci)
+vcard_importer_free (gpointer ptr)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	VCardImporter *gci = ptr;
 
-	g_free (gci->contents);
-	g_object_unref (gci->book_client);
-	g_slist_free_full (gci->contactlist, (GDestroyNotify) g_object_unref);
+	g_datalist_remove_data (&gci->target->data, "vcard-data");
 
-	e_import_complete (gci->import, gci->target, NULL);
+	g_free (gci->contents);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
 	g_object_unref (gci->import);
 	g_free (gci);
 }
@@ -473,41 +494,29 @@ book_client_connect_cb (GObject *source_object,
 {
 	VCardImporter *gci = user_data;
 	EClient *client;
+	GError *error = NULL;
 
-	client = e_book_client_connect_finish (result, NULL);
+	client = e_book_client_connect_finish (result, &error);
 
 	if (client == NULL) {
-		vcard_import_done (gci);
+		EImport *import = g_object_ref (gci->import);
+		EImportTarget *target = gci->target;
+
+		vcard_importer_free (gci);
+
+		e_import_complete (import, target, error);
+		g_object_unref (import);
+		g_clear_error (&error);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
 
-	if (gci->encoding == VCARD_ENCODING_UTF16) {
-		gchar *tmp;
-
-		gunichar2 *contents_utf16 = (gunichar2 *) gci->contents;
-		tmp = utf16_to_utf8 (contents_utf16);
-		g_free (gci->contents);
-		gci->contents = tmp;
-
-	} else if (gci->encoding == VCARD_ENCODING_LOCALE) {
-		gchar *tmp;
-		tmp = g_locale_to_utf8 (gci->contents, -1, NULL, NULL, NULL);
-		g_free (gci->contents);
-		gci->contents = tmp;
-	}
-
-	gci->contactlist = eab_contact_list_from_string (gci->contents);
-	g_free (gci->contents);
-	gci->contents = NULL;
-	gci->iterator = gci->contactlist;
-	gci->total = g_slist_length (gci->contactlist);
-
-	if (gci->iterator)
-		gci->idle_id = g_idle_add (vcard_import_contacts, gci);
-	else
-		vcard_import_done (gci);
+	evolution_contact_importer_run (
+		gci->import, gci->target, gci->book_client,
+		EVOLUTION_CONTACT_IMPORTER_BATCH_SIZE,
+		vcard_import_next_contact, gci, vcard_importer_free,
+		gci->cancellable);
 }
 
 static void
@@ -553,6 +562,7 @@ vcard_import (EImport *ei,
 	g_datalist_set_data (&target->data, "vcard-data", gci);
 	gci->import = g_object_ref (ei);
 	gci->target = target;
+	gci->cancellable = g_cancellable_new ();
 	gci->encoding = encoding;
 	gci->contents = contents;
 
@@ -569,7 +579,7 @@ vcard_cancel (EImport *ei,
 	VCardImporter *gci = g_datalist_get_data (&target->data, "vcard-data");
 
 	if (gci)
-		gci->state = 1;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
@@ -994,3 +1004,248 @@ evolution_contact_importer_get_preview_widget (const GSList *contacts)
 
 	return preview;
 }
+
+struct _EvolutionContactImporterBatch {
+	EImport *import;
+	EImportTarget *target;
+	EBookClient *book_client;
+	guint batch_size;
+
+	EvolutionContactImporterNextFunc next_func;
+	gpointer user_data;
+	GDestroyNotify user_data_free;
+
+	GSList *pending; /* EContact *, in reverse order */
+	guint n_pending;
+
+	GMutex lock;
+	gint percent;
+	guint status_id;
+};
+
+static void
+contact_importer_batch_free (gpointer ptr)
+{
+	EvolutionContactImporterBatch *batch = ptr;
+
+	if (batch) {
+		if (batch->status_id)
+			g_source_remove (batch->status_id);
+
+		if (batch->user_data_free)
+			batch->user_data_free (batch->user_data);
+
+		g_slist_free_full (batch->pending, g_object_unref);
+		g_clear_object (&batch->book_client);
+		g_clear_object (&batch->import);
+		g_mutex_clear (&batch->lock);
+		g_slice_free (EvolutionContactImporterBatch, batch);
+	}
+}
+
+static gboolean
+contact_importer_batch_status_cb (gpointer user_data)
+{
+	EvolutionContactImporterBatch *batch = user_data;
+	gint percent;
+
+	g_mutex_lock (&batch->lock);
+	percent = batch->percent;
+	batch->status_id = 0;
+	g_mutex_unlock (&batch->lock);
+
+	e_import_status (batch->import, batch->target, _("Importing…"), percent);
+
+	return FALSE;
+}
+
+/**
+ * evolution_contact_importer_flush:
+ * @batch: an #EvolutionContactImporterBatch
+ * @cancellable: optional #GCancellable object, or %NULL
+ *
+ * Adds all the contacts returned by the next function so far into the book,
+ * which sets their UID. It's done automatically when the batch is full,
+ * but the next function can call it, when it needs the UID of any contact
+ * it had returned.
+ *
+ * This can be called only from the next function of the @batch.
+ **/
+void
+evolution_contact_importer_flush (EvolutionContactImporterBatch *batch,
+                                  GCancellable *cancellable)
+{
+	GSList *contacts, *uids = NULL, *link, *uid_link;
+
+	g_return_if_fail (batch != NULL);
+
+	if (!batch->pending)
+		return;
+
+	contacts = g_slist_reverse (batch->pending);
+	batch->pending = NULL;
+	batch->n_pending = 0;
+
+	/* Know the UIDs in advance, thus the contacts stored
+	 * before a failure can be recognized below. */
+	for (link = contacts; link; link = g_slist_next (link)) {
+		const gchar *uid = e_contact_get_const (link->data, E_CONTACT_UID);
+
+		if (!uid || !*uid) {
+			gchar *new_uid = e_util_generate_uid ();
+
+			e_contact_set (link->data, E_CONTACT_UID, new_uid);
+			g_free (new_uid);
+		}
+	}
+
+	if (e_book_client_add_contacts_sync (batch->book_client, contacts,
+		E_BOOK_OPERATION_FLAG_NONE, &uids, cancellable, NULL)) {
+		for (link = contacts, uid_link = uids; link && uid_link; link = g_slist_next (link), uid_link = g_slist_next (uid_link)) {
+			e_contact_set (link->data, E_CONTACT_UID, uid_link->data);
+		}
+	} else if (!g_cancellable_is_cancelled (cancellable)) {
+		/* A single broken contact fails the whole batch;
+		 * add them one by one and skip the broken ones. The book
+		 * could store some of them before it failed, those are
+		 * not added again. */
+		for (link = contacts; link && !g_cancellable_is_cancelled (cancellable); link = g_slist_next (link)) {
+			EContact *stored = NULL;
+			gchar *uid = NULL;
+
+			if (e_book_client_get_contact_sync (batch->book_client,
+				e_contact_get_const (link->data, E_CONTACT_UID), &stored, cancellable, NULL)) {
+				g_clear_object (&stored);
+				continue;
+			}
+
+			e_book_client_add_contact_sync (
+				batch->book_client, link->data, E_BOOK_OPERATION_FLAG_NONE, &uid, cancellable, NULL);
+			if (uid != NULL) {
+				e_contact_set (link->data, E_CONTACT_UID, uid);
+				g_free (uid);
+			}
+		}
+	}
+
+	g_slist_free_full (uids, g_free);
+	g_slist_free_full (contacts, g_object_unref);
+}
+
+static void
+contact_importer_batch_thread (GTask *task,
+                               gpointer source_object,
+                               gpointer task_data,
+                               GCancellable *cancellable)
+{
+	EvolutionContactImporterBatch *batch = task_data;
+	EContact *contact;
+	gint percent = 0;
+
+	while (!g_cancellable_is_cancelled (cancellable) &&
+	       (contact = batch->next_func (batch, batch->user_data, &percent, cancellable)) != NULL) {
+		batch->pending = g_slist_prepend (batch->pending, contact);
+		batch->n_pending++;
+
+		if (batch->n_pending >= batch->batch_size)
+			evolution_contact_importer_flush (batch, cancellable);
+
+		g_mutex_lock (&batch->lock);
+		if (batch->percent != percent) {
+			batch->percent = percent;
+
+			/* Only the progress goes to the main loop */
+			if (!batch->status_id)
+				batch->status_id = g_idle_add (contact_importer_batch_status_cb, batch);
+		}
+		g_mutex_unlock (&batch->lock);
+	}
+
+	if (!g_cancellable_is_cancelled (cancellable))
+		evolution_contact_importer_flush (batch, cancellable);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+contact_importer_batch_done_cb (GObject *source_object,
+                                GAsyncResult *result,
+                                gpointer user_data)
+{
+	EvolutionContactImporterBatch *batch;
+	EImport *import;
+	EImportTarget *target;
+
+	batch = g_task_get_task_data (G_TASK (result));
+	import = batch->import;
+	target = batch->target;
+
+	g_task_propagate_boolean (G_TASK (result), NULL);
+
+	if (batch->status_id) {
+		g_source_remove (batch->status_id);
+		batch->status_id = 0;
+	}
+
+	if (batch->user_data_free) {
+		batch->user_data_free (batch->user_data);
+		batch->user_data_free = NULL;
+	}
+
+	e_import_complete (import, target, NULL);
+}
+
+/**
+ * evolution_contact_importer_run:
+ * @import: an #EImport
+ * @target: an #EImportTarget
+ * @book_client: an #EBookClient to import the contacts into
+ * @batch_size: how many contacts to add at once
+ * @next_func: an #EvolutionContactImporterNextFunc providing the contacts
+ * @user_data: user data for @next_func
+ * @user_data_free: (nullable): a function to free @user_data, or %NULL
+ * @cancellable: optional #GCancellable object, or %NULL
+ *
+ * Imports the contacts returned by @next_func into @book_client. Both
+ * the @next_func and adding the contacts, in batches of @batch_size, run
+ * in a dedicated thread; the main loop only receives the progress. Once
+ * done, the @user_data is freed and e_import_complete() is called on
+ * the @import.
+ **/
+void
+evolution_contact_importer_run (EImport *import,
+                                EImportTarget *target,
+                                EBookClient *book_client,
+                                guint batch_size,
+                                EvolutionContactImporterNextFunc next_func,
+                                gpointer user_data,
+                                GDestroyNotify user_data_free,
+                                GCancellable *cancellable)
+{
+	EvolutionContactImporterBatch *batch;
+	GTask *task;
+
+	g_return_if_fail (E_IS_IMPORT (import));
+	g_return_if_fail (target != NULL);
+	g_return_if_fail (E_IS_BOOK_CLIENT (book_client));
+	g_return_if_fail (next_func != NULL);
+
+	batch = g_slice_new0 (EvolutionContactImporterBatch);
+	batch->import = g_object_ref (import);
+	batch->target = target;
+	batch->book_client = g_object_ref (book_client);
+	batch->batch_size = MAX (batch_size, 1);
+	batch->next_func = next_func;
+	batch->user_data = user_data;
+	batch->user_data_free = user_data_free;
+	g_mutex_init (&batch->lock);
+
+	task = g_task_new (NULL, cancellable, contact_importer_batch_done_cb, NULL);
+	g_task_set_source_tag (task, evolution_contact_importer_run);
+	g_task_set_task_data (task, batch, contact_importer_batch_free);
+	g_task_set_check_cancellable (task, FALSE);
+
+	g_task_run_in_thread (task, contact_importer_batch_thread);
+
+	g_object_unref (task);
+}
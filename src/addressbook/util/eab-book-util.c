@@ -294,19 +294,64 @@ eab_strstrcase (const gchar *haystack,
 	g_return_val_if_fail (needle != NULL, NULL);
 
 	len = strlen (needle);
-	if (len > strlen (haystack))
-		return NULL;
-
 	if (len == 0)
 		return (gchar *) haystack;
 
-	for (ptr = haystack; *(ptr + len - 1) != '\0'; ptr++)
+	/* Do not strlen() the haystack, it can be a huge file with
+	 * many vCards, which is searched from each of them again. */
+	for (ptr = haystack; *ptr != '\0'; ptr++)
 		if (!g_ascii_strncasecmp (ptr, needle, len))
 			return (gchar *) ptr;
 
 	return NULL;
 }
 
+/* Parses the next vCard from *pstr, which should not contain any '\r',
+ * and moves *pstr behind it. Returns %NULL when there is none left. */
+EContact *
+eab_contact_list_next_from_string (const gchar **pstr)
+{
+	const gchar *p, *q;
+	gchar *card_str;
+	EContact *contact;
+
+	g_return_val_if_fail (pstr != NULL, NULL);
+
+	if (!*pstr)
+		return NULL;
+
+	p = eab_strstrcase (*pstr, "BEGIN:VCARD");
+	if (!p) {
+		*pstr = NULL;
+		return NULL;
+	}
+
+	for (q = eab_strstrcase (p, "END:VCARD"); q; q = eab_strstrcase (q, "END:VCARD")) {
+		const gchar *temp;
+
+		q += 9;
+		temp = q;
+		if (*temp)
+			temp += strspn (temp, "\r\n\t ");
+
+		if (*temp == '\0' || !g_ascii_strncasecmp (temp, "BEGIN:VCARD", 11))
+			break;  /* Found the outer END:VCARD */
+	}
+
+	if (!q) {
+		*pstr = NULL;
+		return NULL;
+	}
+
+	card_str = g_strndup (p, q - p);
+	contact = e_contact_new_from_vcard (card_str);
+	g_free (card_str);
+
+	*pstr = q;
+
+	return contact;
+}
+
 GSList *
 eab_contact_list_from_string (const gchar *str)
 {
@@ -314,7 +359,8 @@ eab_contact_list_from_string (const gchar *str)
 	GString *gstr = g_string_new (NULL);
 	gchar *str_stripped;
 	gchar *p = (gchar *) str;
-	gchar *q;
+	const gchar *pos;
+	EContact *contact;
 
 	if (!p)
 		return NULL;
@@ -334,7 +380,7 @@ eab_contact_list_from_string (const gchar *str)
 		p++;
 	}
 
-	p = str_stripped = g_string_free (gstr, FALSE);
+	str_stripped = g_string_free (gstr, FALSE);
 
 	/* Note: The vCard standard says
 	 *
@@ -347,31 +393,10 @@ eab_contact_list_from_string (const gchar *str)
 	 * parsed. Arguably, contact list parsing should all be in libebook's e-vcard.c,
 	 * where we can do proper parsing and validation without code duplication. */
 
-	for (p = eab_strstrcase (p, "BEGIN:VCARD"); p; p = eab_strstrcase (q, "\nBEGIN:VCARD")) {
-		gchar *card_str;
+	pos = str_stripped;
 
-		if (*p == '\n')
-			p++;
-
-		for (q = eab_strstrcase (p, "END:VCARD"); q; q = eab_strstrcase (q, "END:VCARD")) {
-			gchar *temp;
-
-			q += 9;
-			temp = q;
-			if (*temp)
-				temp += strspn (temp, "\r\n\t ");
-
-			if (*temp == '\0' || !g_ascii_strncasecmp (temp, "BEGIN:VCARD", 11))
-				break;  /* Found the outer END:VCARD */
-		}
-
-		if (!q)
-			break;
-
-		card_str = g_strndup (p, q - p);
-		contacts = g_slist_prepend (contacts, e_contact_new_from_vcard (card_str));
-		g_free (card_str);
-	}
+	while (contact = eab_contact_list_next_from_string (&pos), contact != NULL)
+		contacts = g_slist_prepend (contacts, contact);
 
 	g_free (str_stripped);
 
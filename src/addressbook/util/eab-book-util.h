@@ -58,6 +58,8 @@ void		eab_sip_index_to_type 		(gint index,
 						 const gchar **type_1);
 
 GSList *	eab_contact_list_from_string	(const gchar *str);
+EContact *	eab_contact_list_next_from_string
+						(const gchar **pstr);
 gchar *		eab_contact_list_to_string	(const GSList *contacts);
 
 gboolean	eab_source_and_contact_list_from_string
@@ -1829,3 +1829,143 @@ cal_comp_util_maybe_ensure_allday_timezone_properties (ECalClient *client,
 	ensure_allday_timezone_property (icomp, zone, I_CAL_DTSTART_PROPERTY, i_cal_component_get_dtstart, i_cal_component_set_dtstart);
 	ensure_allday_timezone_property (icomp, zone, I_CAL_DTEND_PROPERTY, i_cal_component_get_dtend, i_cal_component_set_dtend);
 }
+
+static void
+cal_comp_util_collect_tzid_cb (ICalParameter *param,
+                               gpointer user_data)
+{
+	GPtrArray *tzids = user_data;
+	const gchar *tzid;
+	guint ii;
+
+	tzid = i_cal_parameter_get_tzid (param);
+	if (!tzid || !*tzid)
+		return;
+
+	/* There are usually only a few distinct time zones */
+	for (ii = 0; ii < tzids->len; ii++) {
+		if (g_strcmp0 (g_ptr_array_index (tzids, ii), tzid) == 0)
+			return;
+	}
+
+	g_ptr_array_add (tzids, g_strdup (tzid));
+}
+
+static gboolean
+cal_comp_util_write_component (GOutputStream *stream,
+                               ICalComponent *icomp,
+                               GCancellable *cancellable,
+                               GError **error)
+{
+	gchar *str;
+	gboolean success;
+
+	str = i_cal_component_as_ical_string (icomp);
+	success = !str || g_output_stream_write_all (stream, str, strlen (str), NULL, cancellable, error);
+	g_free (str);
+
+	return success;
+}
+
+/**
+ * cal_comp_util_write_vcalendar_sync:
+ * @client: an #ECalClient the @icomps belong to
+ * @icomps: (element-type ICalComponent): components to write
+ * @stream: a #GOutputStream to write to
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes a VCALENDAR with the @icomps into the @stream, preceded by
+ * the VTIMEZONE components they reference. Unlike adding the @icomps into
+ * a toplevel component and writing it as a single string, the components
+ * are serialized one by one, thus it does not require memory proportional
+ * to the size of the whole calendar.
+ *
+ * Returns: whether succeeded
+ *
+ * Since: 3.38
+ **/
+gboolean
+cal_comp_util_write_vcalendar_sync (ECalClient *client,
+                                    GSList *icomps,
+                                    GOutputStream *stream,
+                                    GCancellable *cancellable,
+                                    GError **error)
+{
+	ICalComponent *vcalendar;
+	GOutputStream *buffered;
+	GPtrArray *tzids;
+	GSList *link;
+	gchar *str, *end;
+	gboolean success;
+	guint ii;
+
+	g_return_val_if_fail (E_IS_CAL_CLIENT (client), FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+
+	buffered = g_buffered_output_stream_new (stream);
+	g_filter_output_stream_set_close_base_stream (G_FILTER_OUTPUT_STREAM (buffered), FALSE);
+
+	/* Write the VCALENDAR header only, the components follow */
+	vcalendar = e_cal_util_new_top_level ();
+	str = i_cal_component_as_ical_string (vcalendar);
+	g_object_unref (vcalendar);
+
+	if (!str)
+		str = g_strdup ("BEGIN:VCALENDAR\r\n");
+
+	end = strstr (str, "END:VCALENDAR");
+	if (end)
+		*end = '\0';
+
+	success = g_output_stream_write_all (buffered, str, strlen (str), NULL, cancellable, error);
+
+	g_free (str);
+
+	tzids = g_ptr_array_new_with_free_func (g_free);
+
+	for (link = icomps; link; link = g_slist_next (link))
+		i_cal_component_foreach_tzid (link->data, cal_comp_util_collect_tzid_cb, tzids);
+
+	for (ii = 0; success && ii < tzids->len; ii++) {
+		const gchar *tzid = g_ptr_array_index (tzids, ii);
+		ICalTimezone *zone = NULL;
+		ICalComponent *vtimezone;
+		GError *local_error = NULL;
+
+		if (!e_cal_client_get_timezone_sync (client, tzid, &zone, cancellable, &local_error) || !zone) {
+			if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+				g_propagate_error (error, local_error);
+				success = FALSE;
+				break;
+			}
+
+			g_warning (
+				"Could not get the timezone information for %s: %s",
+				tzid, local_error ? local_error->message : "Unknown error");
+			g_clear_error (&local_error);
+			continue;
+		}
+
+		vtimezone = i_cal_timezone_get_component (zone);
+		if (vtimezone) {
+			success = cal_comp_util_write_component (buffered, vtimezone, cancellable, error);
+			g_object_unref (vtimezone);
+		}
+	}
+
+	g_ptr_array_unref (tzids);
+
+	for (link = icomps; success && link; link = g_slist_next (link))
+		success = cal_comp_util_write_component (buffered, link->data, cancellable, error);
+
+	if (success)
+		success = g_output_stream_write_all (buffered, "END:VCALENDAR\r\n", 15, NULL, cancellable, error);
+
+	if (success)
+		success = g_output_stream_flush (buffered, cancellable, error);
+
+	g_object_unref (buffered);
+
+	return success;
+}
@@ -172,4 +172,10 @@ void		cal_comp_util_maybe_ensure_allday_timezone_properties
 						(ECalClient *client,
 						 ICalComponent *icomp,
 						 ICalTimezone *zone);
+gboolean	cal_comp_util_write_vcalendar_sync
+						(ECalClient *client,
+						 GSList *icomps, /* ICalComponent * */
+						 GOutputStream *stream,
+						 GCancellable *cancellable,
+						 GError **error);
 #endif
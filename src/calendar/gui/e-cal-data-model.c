@@ -18,6 +18,8 @@
 
 #include "evolution-config.h"
 
+#include <string.h>
+
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 
@@ -27,11 +29,20 @@
 #define LOCK_PROPS() g_rec_mutex_lock (&data_model->priv->props_lock)
 #define UNLOCK_PROPS() g_rec_mutex_unlock (&data_model->priv->props_lock)
 
+/* How many recurring components one expand job processes; results
+   are delivered to the subscribers after each such shard. */
+#define EXPAND_SHARD_SIZE 32
+
+/* The cached expansion is extended with newly exposed intervals only up
+   to this many times the width of the current range, then it is reset. */
+#define EXPAND_CACHE_MAX_SPAN 4
+
 struct _ECalDataModelPrivate {
 	GThread *main_thread;
 	ECalDataModelSubmitThreadJobFunc submit_thread_job_func;
 	GWeakRef *submit_thread_job_responder;
 	GThreadPool *thread_pool;
+	GThreadPool *expand_pool; /* expands recurrences of ExpandShardData */
 
 	GRecMutex props_lock;	/* to guard all the below members */
 
@@ -73,6 +84,13 @@ typedef struct _ComponentData {
 	time_t instance_start;
 	time_t instance_end;
 	gboolean is_detached;
+
+	/* Set only while the data is stored in ViewData::components
+	   or ViewData::lost_components */
+	const ECalComponentId *id; /* borrowed, the hash table key */
+	ETimeIndex *index;
+	ETimeIndexItem *index_item;
+	gboolean is_lost;
 } ComponentData;
 
 typedef struct _ViewData {
@@ -90,14 +108,27 @@ typedef struct _ViewData {
 
 	GHashTable *components; /* ECalComponentId ~> ComponentData */
 	GHashTable *lost_components; /* ECalComponentId ~> ComponentData; when re-running view, valid till 'complete' is received */
+	ETimeIndex *components_index; /* ComponentData from both 'components' and 'lost_components', by instance time */
 	gboolean received_complete;
 	GSList *to_expand_recurrences; /* ICalComponent */
 	GSList *expanded_recurrences; /* ComponentData */
 	gint pending_expand_recurrences; /* how many is waiting to be processed */
 
+	GMutex expand_cache_lock;
+	GHashTable *expand_cache; /* gchar *key ~> ExpandCacheData */
+	guint expand_cache_generation; /* increments with each view re-run */
+	guint expand_cache_stamp; /* increments when entries are dropped for a change */
+
 	GCancellable *cancellable;
 } ViewData;
 
+typedef struct _ExpandCacheData {
+	time_t range_start; /* the interval the instances were generated for */
+	time_t range_end;
+	GPtrArray *instances; /* ComponentData, never given out */
+	guint generation;
+} ExpandCacheData;
+
 typedef struct _SubscriberData {
 	ECalDataModelSubscriber *subscriber;
 	time_t range_start;
@@ -129,6 +160,8 @@ component_data_free (gpointer ptr)
 	ComponentData *comp_data = ptr;
 
 	if (comp_data) {
+		if (comp_data->index_item)
+			e_time_index_remove (comp_data->index, comp_data->index_item);
 		g_object_unref (comp_data->component);
 		g_free (comp_data);
 	}
@@ -200,6 +233,65 @@ component_data_equal (ComponentData *comp_data1,
 	return equal;
 }
 
+static void
+expand_cache_data_free (gpointer ptr)
+{
+	ExpandCacheData *cache_data = ptr;
+
+	if (cache_data) {
+		g_ptr_array_unref (cache_data->instances);
+		g_slice_free (ExpandCacheData, cache_data);
+	}
+}
+
+static gboolean
+expand_cache_data_is_expired_cb (gpointer key,
+				 gpointer value,
+				 gpointer user_data)
+{
+	ExpandCacheData *cache_data = value;
+	guint generation = GPOINTER_TO_UINT (user_data);
+
+	return cache_data->generation + 1 < generation;
+}
+
+static gboolean
+expand_cache_data_has_uid_cb (gpointer key,
+			      gpointer value,
+			      gpointer user_data)
+{
+	GHashTable *uids = user_data;
+	const gchar *cache_key = key, *eol;
+	gboolean has_uid;
+	gchar *uid;
+
+	/* The key begins with the UID, see cal_data_model_dup_expand_cache_key() */
+	eol = strchr (cache_key, '\n');
+	if (!eol)
+		return FALSE;
+
+	uid = g_strndup (cache_key, eol - cache_key);
+	has_uid = g_hash_table_contains (uids, uid);
+	g_free (uid);
+
+	return has_uid;
+}
+
+/* The expansion depends also on the detached instances, which are not part
+   of the cache key, thus any change of a component drops all of its UID */
+static void
+view_data_expand_cache_remove_uids (ViewData *view_data,
+				    GHashTable *uids)
+{
+	if (!g_hash_table_size (uids))
+		return;
+
+	g_mutex_lock (&view_data->expand_cache_lock);
+	view_data->expand_cache_stamp++;
+	g_hash_table_foreach_remove (view_data->expand_cache, expand_cache_data_has_uid_cb, uids);
+	g_mutex_unlock (&view_data->expand_cache_lock);
+}
+
 static ViewData *
 view_data_new (ECalClient *client)
 {
@@ -215,6 +307,10 @@ view_data_new (ECalClient *client)
 	view_data->components = g_hash_table_new_full (
 		e_cal_component_id_hash, e_cal_component_id_equal,
 		e_cal_component_id_free, component_data_free);
+	view_data->components_index = e_time_index_new ();
+	g_mutex_init (&view_data->expand_cache_lock);
+	view_data->expand_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+		g_free, expand_cache_data_free);
 
 	return view_data;
 }
@@ -266,8 +362,11 @@ view_data_unref (gpointer ptr)
 			g_hash_table_destroy (view_data->components);
 			if (view_data->lost_components)
 				g_hash_table_destroy (view_data->lost_components);
+			e_time_index_free (view_data->components_index);
 			g_slist_free_full (view_data->to_expand_recurrences, g_object_unref);
 			g_slist_free_full (view_data->expanded_recurrences, component_data_free);
+			g_hash_table_destroy (view_data->expand_cache);
+			g_mutex_clear (&view_data->expand_cache_lock);
 			g_rec_mutex_clear (&view_data->lock);
 			g_free (view_data);
 		}
@@ -870,8 +969,14 @@ cal_data_model_process_added_component (ECalDataModel *data_model,
 
 	/* Note: old_comp_data is freed or NULL now */
 
-	/* 'id' is stolen by view_data->components */
-	g_hash_table_insert (view_data->components, id, comp_data);
+	/* 'id' is stolen by view_data->components; replace the key too,
+	   thus it stays valid as long as the comp_data is stored there */
+	g_hash_table_replace (view_data->components, id, comp_data);
+
+	comp_data->id = id;
+	comp_data->index = view_data->components_index;
+	comp_data->index_item = e_time_index_add (comp_data->index,
+		comp_data->instance_start, comp_data->instance_end, comp_data);
 
 	if (!comp_data_equal) {
 		if (!old_comp_data) {
@@ -982,6 +1087,7 @@ cal_data_model_gather_components (gpointer key,
 typedef struct _NotifyRecurrencesData {
 	ECalDataModel *data_model;
 	ECalClient *client;
+	gboolean is_last; /* the last notification of one expand job */
 } NotifyRecurrencesData;
 
 static gboolean
@@ -1059,7 +1165,8 @@ cal_data_model_notify_recurrences_cb (gpointer user_data)
 			g_hash_table_remove_all (known_instances);
 		}
 
-		if (g_atomic_int_dec_and_test (&view_data->pending_expand_recurrences) &&
+		if (notif_data->is_last &&
+		    g_atomic_int_dec_and_test (&view_data->pending_expand_recurrences) &&
 		    view_data->is_used && view_data->lost_components && view_data->received_complete) {
 			cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
 			g_hash_table_destroy (view_data->lost_components);
@@ -1085,11 +1192,26 @@ cal_data_model_notify_recurrences_cb (gpointer user_data)
 	return FALSE;
 }
 
+static void
+cal_data_model_schedule_notify_recurrences (ECalDataModel *data_model,
+					    ECalClient *client,
+					    gboolean is_last)
+{
+	NotifyRecurrencesData *notif_data;
+
+	notif_data = g_slice_new0 (NotifyRecurrencesData);
+	notif_data->data_model = g_object_ref (data_model);
+	notif_data->client = g_object_ref (client);
+	notif_data->is_last = is_last;
+
+	g_timeout_add (1, cal_data_model_notify_recurrences_cb, notif_data);
+}
+
 typedef struct
 {
 	ECalClient *client;
 	ICalTimezone *zone;
-	GSList **pexpanded_recurrences;
+	GPtrArray *instances; /* ComponentData */
 	gboolean skip_cancelled;
 } GenerateInstancesData;
 
@@ -1157,21 +1279,261 @@ cal_data_model_instance_generated (ICalComponent *icomp,
 		end_tt--;
 
 	comp_data = component_data_new (comp_copy, start_tt, end_tt, FALSE);
-	*gid->pexpanded_recurrences = g_slist_prepend (*gid->pexpanded_recurrences, comp_data);
+	g_ptr_array_add (gid->instances, comp_data);
 
 	g_object_unref (comp_copy);
 
 	return TRUE;
 }
 
+typedef struct _ExpandRecurrencesData {
+	ECalDataModel *data_model;
+	ECalClient *client;
+	ViewData *view_data;
+	ICalTimezone *zone;
+	time_t range_start;
+	time_t range_end;
+	gboolean skip_cancelled;
+
+	GMutex lock;
+	GCond cond;
+	guint n_pending_shards;
+} ExpandRecurrencesData;
+
+typedef struct _ExpandShardData {
+	ExpandRecurrencesData *erd;
+	GSList *icomps; /* ICalComponent */
+} ExpandShardData;
+
+static gchar *
+cal_data_model_dup_expand_cache_key (ICalComponent *icomp,
+				     ICalTimezone *zone,
+				     gboolean skip_cancelled)
+{
+	gchar *as_str, *checksum, *key;
+
+	/* Any change of the component changes its string, thus its checksum */
+	as_str = i_cal_component_as_ical_string (icomp);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, as_str, -1);
+
+	key = g_strdup_printf ("%s\n%s\n%d\n%s",
+		i_cal_component_get_uid (icomp),
+		zone ? i_cal_timezone_get_tzid (zone) : "",
+		skip_cancelled ? 1 : 0,
+		checksum);
+
+	g_free (checksum);
+	g_free (as_str);
+
+	return key;
+}
+
+static void
+cal_data_model_generate_instances (ExpandRecurrencesData *erd,
+				   ICalComponent *icomp,
+				   time_t range_start,
+				   time_t range_end,
+				   GPtrArray *instances,
+				   time_t known_start,
+				   time_t known_end,
+				   guint n_known)
+{
+	GenerateInstancesData gid;
+	guint ii, jj, n_before;
+
+	gid.client = erd->client;
+	gid.zone = erd->zone;
+	gid.instances = instances;
+	gid.skip_cancelled = erd->skip_cancelled;
+
+	n_before = instances->len;
+
+	e_cal_client_generate_instances_for_object_sync (erd->client, icomp, range_start, range_end, NULL,
+		cal_data_model_instance_generated, &gid);
+
+	/* The instances crossing the boundary of the already known interval
+	   are generated twice; those are the first 'n_known' in the array */
+	for (ii = n_before; ii < instances->len; ii++) {
+		ComponentData *comp_data = g_ptr_array_index (instances, ii);
+
+		if (comp_data->instance_start > known_end || comp_data->instance_end < known_start)
+			continue;
+
+		for (jj = 0; jj < n_known; jj++) {
+			ComponentData *known = g_ptr_array_index (instances, jj);
+
+			if (known->instance_start == comp_data->instance_start) {
+				g_ptr_array_remove_index_fast (instances, ii);
+				ii--;
+				break;
+			}
+		}
+	}
+}
+
+static void
+cal_data_model_expand_one (ExpandRecurrencesData *erd,
+			   ICalComponent *icomp,
+			   GPtrArray *expanded)
+{
+	ViewData *view_data = erd->view_data;
+	ExpandCacheData *cache_data;
+	GPtrArray *instances;
+	time_t covered_start, covered_end;
+	gboolean have_cached = FALSE;
+	gchar *key;
+	guint ii, stamp;
+
+	key = cal_data_model_dup_expand_cache_key (icomp, erd->zone, erd->skip_cancelled);
+	instances = g_ptr_array_new_with_free_func (component_data_free);
+
+	g_mutex_lock (&view_data->expand_cache_lock);
+
+	stamp = view_data->expand_cache_stamp;
+
+	/* Reuse the cached instances only when the intervals overlap,
+	   otherwise the covered interval would have a hole */
+	cache_data = g_hash_table_lookup (view_data->expand_cache, key);
+	if (cache_data &&
+	    cache_data->range_start <= erd->range_end &&
+	    cache_data->range_end >= erd->range_start) {
+		covered_start = cache_data->range_start;
+		covered_end = cache_data->range_end;
+		have_cached = TRUE;
+
+		for (ii = 0; ii < cache_data->instances->len; ii++) {
+			ComponentData *comp_data = g_ptr_array_index (cache_data->instances, ii);
+
+			g_ptr_array_add (instances, component_data_new (comp_data->component,
+				comp_data->instance_start, comp_data->instance_end, FALSE));
+		}
+	}
+
+	g_mutex_unlock (&view_data->expand_cache_lock);
+
+	if (have_cached) {
+		guint n_known = instances->len;
+
+		/* Expand only the newly exposed intervals */
+		if (erd->range_start < covered_start)
+			cal_data_model_generate_instances (erd, icomp, erd->range_start, covered_start,
+				instances, covered_start, covered_end, n_known);
+
+		if (erd->range_end > covered_end)
+			cal_data_model_generate_instances (erd, icomp, covered_end, erd->range_end,
+				instances, covered_start, covered_end, n_known);
+
+		covered_start = MIN (covered_start, erd->range_start);
+		covered_end = MAX (covered_end, erd->range_end);
+
+		/* Do not let the cache grow without limits when moving
+		   the range in one direction for a long time */
+		if (covered_end - covered_start > EXPAND_CACHE_MAX_SPAN * (erd->range_end - erd->range_start)) {
+			for (ii = 0; ii < instances->len; ii++) {
+				ComponentData *comp_data = g_ptr_array_index (instances, ii);
+
+				if (comp_data->instance_start > erd->range_end ||
+				    comp_data->instance_end < erd->range_start) {
+					g_ptr_array_remove_index_fast (instances, ii);
+					ii--;
+				}
+			}
+
+			covered_start = erd->range_start;
+			covered_end = erd->range_end;
+		}
+	} else {
+		cal_data_model_generate_instances (erd, icomp, erd->range_start, erd->range_end,
+			instances, 0, 0, 0);
+
+		covered_start = erd->range_start;
+		covered_end = erd->range_end;
+	}
+
+	/* The cached components are never given out, they are cloned */
+	for (ii = 0; ii < instances->len; ii++) {
+		ComponentData *comp_data = g_ptr_array_index (instances, ii);
+		ECalComponent *comp;
+
+		if (comp_data->instance_start > erd->range_end ||
+		    comp_data->instance_end < erd->range_start)
+			continue;
+
+		comp = e_cal_component_clone (comp_data->component);
+		g_ptr_array_add (expanded, component_data_new (comp,
+			comp_data->instance_start, comp_data->instance_end, FALSE));
+		g_object_unref (comp);
+	}
+
+	cache_data = g_slice_new0 (ExpandCacheData);
+	cache_data->range_start = covered_start;
+	cache_data->range_end = covered_end;
+	cache_data->instances = instances;
+
+	g_mutex_lock (&view_data->expand_cache_lock);
+	if (stamp == view_data->expand_cache_stamp) {
+		cache_data->generation = view_data->expand_cache_generation;
+		/* Takes the 'key' */
+		g_hash_table_replace (view_data->expand_cache, key, cache_data);
+	} else {
+		/* A component changed meanwhile, the instances can be stale */
+		expand_cache_data_free (cache_data);
+		g_free (key);
+	}
+	g_mutex_unlock (&view_data->expand_cache_lock);
+}
+
+static void
+cal_data_model_expand_shard_func (gpointer data,
+				  gpointer user_data)
+{
+	ExpandShardData *shard = data;
+	ExpandRecurrencesData *erd;
+	ViewData *view_data;
+	GPtrArray *expanded;
+	GSList *link;
+	guint ii;
+
+	g_return_if_fail (shard != NULL);
+
+	erd = shard->erd;
+	view_data = erd->view_data;
+	expanded = g_ptr_array_new ();
+
+	for (link = shard->icomps; link && view_data->is_used; link = g_slist_next (link)) {
+		ICalComponent *icomp = link->data;
+
+		if (icomp)
+			cal_data_model_expand_one (erd, icomp, expanded);
+	}
+
+	/* Deliver what this shard expanded, thus the view fills progressively */
+	view_data_lock (view_data);
+	for (ii = 0; ii < expanded->len; ii++) {
+		view_data->expanded_recurrences = g_slist_prepend (view_data->expanded_recurrences,
+			g_ptr_array_index (expanded, ii));
+	}
+	if (expanded->len > 0 && view_data->is_used)
+		cal_data_model_schedule_notify_recurrences (erd->data_model, erd->client, FALSE);
+	view_data_unlock (view_data);
+
+	g_ptr_array_free (expanded, TRUE);
+	g_slist_free_full (shard->icomps, g_object_unref);
+	g_slice_free (ExpandShardData, shard);
+
+	g_mutex_lock (&erd->lock);
+	erd->n_pending_shards--;
+	g_cond_signal (&erd->cond);
+	g_mutex_unlock (&erd->lock);
+}
+
 static void
 cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 					  gpointer user_data)
 {
 	ECalClient *client = user_data;
-	GSList *to_expand_recurrences, *link;
-	GSList *expanded_recurrences = NULL;
-	time_t range_start, range_end;
+	ExpandRecurrencesData erd = { 0, };
+	GSList *to_expand_recurrences;
 	ViewData *view_data;
 
 	g_return_if_fail (E_IS_CAL_DATA_MODEL (data_model));
@@ -1182,12 +1544,15 @@ cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 	if (view_data)
 		view_data_ref (view_data);
 
-	range_start = data_model->priv->range_start;
-	range_end = data_model->priv->range_end;
+	erd.range_start = data_model->priv->range_start;
+	erd.range_end = data_model->priv->range_end;
+	erd.zone = g_object_ref (data_model->priv->zone);
+	erd.skip_cancelled = data_model->priv->skip_cancelled;
 
 	UNLOCK_PROPS ();
 
 	if (!view_data) {
+		g_object_unref (erd.zone);
 		g_object_unref (client);
 		return;
 	}
@@ -1197,6 +1562,7 @@ cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 	if (!view_data->is_used) {
 		view_data_unlock (view_data);
 		view_data_unref (view_data);
+		g_object_unref (erd.zone);
 		g_object_unref (client);
 		return;
 	}
@@ -1206,41 +1572,53 @@ cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 
 	view_data_unlock (view_data);
 
-	for (link = to_expand_recurrences; link && view_data->is_used; link = g_slist_next (link)) {
-		ICalComponent *icomp = link->data;
-		GenerateInstancesData gid;
+	erd.data_model = data_model;
+	erd.client = client;
+	erd.view_data = view_data;
+	g_mutex_init (&erd.lock);
+	g_cond_init (&erd.cond);
 
-		if (!icomp)
-			continue;
+	/* Split the components into shards for the expand pool; this thread
+	   only waits for them, the pool limits how many run in parallel */
+	while (to_expand_recurrences) {
+		ExpandShardData *shard;
+		GSList *last;
 
-		gid.client = client;
-		gid.pexpanded_recurrences = &expanded_recurrences;
-		gid.zone = g_object_ref (data_model->priv->zone);
-		gid.skip_cancelled = data_model->priv->skip_cancelled;
+		last = g_slist_nth (to_expand_recurrences, EXPAND_SHARD_SIZE - 1);
 
-		e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end, NULL,
-			cal_data_model_instance_generated, &gid);
+		shard = g_slice_new0 (ExpandShardData);
+		shard->erd = &erd;
+		shard->icomps = to_expand_recurrences;
 
-		g_clear_object (&gid.zone);
-	}
+		if (last) {
+			to_expand_recurrences = last->next;
+			last->next = NULL;
+		} else {
+			to_expand_recurrences = NULL;
+		}
 
-	g_slist_free_full (to_expand_recurrences, g_object_unref);
+		g_mutex_lock (&erd.lock);
+		erd.n_pending_shards++;
+		g_mutex_unlock (&erd.lock);
 
-	view_data_lock (view_data);
-	if (expanded_recurrences)
-		view_data->expanded_recurrences = g_slist_concat (view_data->expanded_recurrences, expanded_recurrences);
-	if (view_data->is_used) {
-		NotifyRecurrencesData *notif_data;
+		g_thread_pool_push (data_model->priv->expand_pool, shard, NULL);
+	}
 
-		notif_data = g_slice_new0 (NotifyRecurrencesData);
-		notif_data->data_model = g_object_ref (data_model);
-		notif_data->client = g_object_ref (client);
+	g_mutex_lock (&erd.lock);
+	while (erd.n_pending_shards > 0)
+		g_cond_wait (&erd.cond, &erd.lock);
+	g_mutex_unlock (&erd.lock);
 
-		g_timeout_add (1, cal_data_model_notify_recurrences_cb, notif_data);
-	}
+	g_mutex_clear (&erd.lock);
+	g_cond_clear (&erd.cond);
 
+	view_data_lock (view_data);
+	if (view_data->is_used)
+		cal_data_model_schedule_notify_recurrences (data_model, client, TRUE);
 	view_data_unlock (view_data);
+
 	view_data_unref (view_data);
+	g_object_unref (erd.zone);
 	g_object_unref (client);
 }
 
@@ -1281,6 +1659,19 @@ cal_data_model_process_modified_or_added_objects (ECalClientView *view,
 	if (view_data->is_used) {
 		const GSList *link;
 		GSList *to_expand_recurrences = NULL;
+		GHashTable *changed_uids;
+
+		changed_uids = g_hash_table_new (g_str_hash, g_str_equal);
+
+		for (link = objects; link; link = g_slist_next (link)) {
+			ICalComponent *icomp = link->data;
+
+			if (icomp && i_cal_component_get_uid (icomp))
+				g_hash_table_add (changed_uids, (gpointer) i_cal_component_get_uid (icomp));
+		}
+
+		view_data_expand_cache_remove_uids (view_data, changed_uids);
+		g_hash_table_destroy (changed_uids);
 
 		if (!is_add) {
 			/* Received a modify before the view was claimed as being complete,
@@ -1419,6 +1810,16 @@ cal_data_model_view_objects_removed (ECalClientView *view,
 
 		gathered_uids = g_hash_table_new (g_str_hash, g_str_equal);
 
+		for (link = uids; link; link = g_slist_next (link)) {
+			const ECalComponentId *id = link->data;
+
+			if (id)
+				g_hash_table_add (gathered_uids, (gpointer) e_cal_component_id_get_uid (id));
+		}
+
+		view_data_expand_cache_remove_uids (view_data, gathered_uids);
+		g_hash_table_remove_all (gathered_uids);
+
 		for (link = uids; link; link = g_slist_next (link)) {
 			const ECalComponentId *id = link->data;
 
@@ -1665,6 +2066,17 @@ cal_data_model_notify_remove_components_cb (gpointer key,
 		cal_data_model_remove_one_view_component_cb, id);
 }
 
+static void
+cal_data_model_mark_lost_cb (gpointer key,
+			     gpointer value,
+			     gpointer user_data)
+{
+	ComponentData *comp_data = value;
+
+	if (comp_data)
+		comp_data->is_lost = TRUE;
+}
+
 static void
 cal_data_model_update_client_view (ECalDataModel *data_model,
 				   ECalClient *client)
@@ -1733,6 +2145,14 @@ cal_data_model_update_client_view (ECalDataModel *data_model,
 		}
 
 		view_data->lost_components = view_data->components;
+		g_hash_table_foreach (view_data->lost_components, cal_data_model_mark_lost_cb, NULL);
+
+		/* Drop the cached expansions not used during the previous run */
+		g_mutex_lock (&view_data->expand_cache_lock);
+		view_data->expand_cache_generation++;
+		g_hash_table_foreach_remove (view_data->expand_cache, expand_cache_data_is_expired_cb,
+			GUINT_TO_POINTER (view_data->expand_cache_generation));
+		g_mutex_unlock (&view_data->expand_cache_lock);
 		view_data->components = g_hash_table_new_full (
 			(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
 			(GDestroyNotify) e_cal_component_id_free, component_data_free);
@@ -2048,6 +2468,7 @@ cal_data_model_finalize (GObject *object)
 	ECalDataModel *data_model = E_CAL_DATA_MODEL (object);
 
 	g_thread_pool_free (data_model->priv->thread_pool, TRUE, FALSE);
+	g_thread_pool_free (data_model->priv->expand_pool, TRUE, FALSE);
 	g_hash_table_destroy (data_model->priv->clients);
 	g_hash_table_destroy (data_model->priv->views);
 	g_slist_free_full (data_model->priv->subscribers, subscriber_data_free);
@@ -2124,6 +2545,8 @@ e_cal_data_model_init (ECalDataModel *data_model)
 	data_model->priv->main_thread = g_thread_self ();
 	data_model->priv->thread_pool = g_thread_pool_new (
 		cal_data_model_internal_thread_job_func, data_model, 5, FALSE, NULL);
+	data_model->priv->expand_pool = g_thread_pool_new (
+		cal_data_model_expand_shard_func, NULL, CLAMP (g_get_num_processors (), 1, 8), FALSE, NULL);
 
 	data_model->priv->clients = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
 	data_model->priv->views = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, view_data_unref);
@@ -2697,6 +3120,30 @@ e_cal_data_model_get_components (ECalDataModel *data_model,
 	return g_slist_reverse (components);
 }
 
+typedef struct _ForeachIndexedData {
+	ECalDataModel *data_model;
+	ViewData *view_data;
+	ECalDataModelForeachFunc func;
+	gpointer user_data;
+	gboolean include_lost_components;
+} ForeachIndexedData;
+
+static gboolean
+cal_data_model_foreach_indexed_cb (time_t start,
+				   time_t end,
+				   gpointer data,
+				   gpointer user_data)
+{
+	ComponentData *comp_data = data;
+	ForeachIndexedData *fid = user_data;
+
+	if (comp_data->is_lost && !fid->include_lost_components)
+		return TRUE;
+
+	return fid->func (fid->data_model, fid->view_data->client, comp_data->id, comp_data->component,
+		comp_data->instance_start, comp_data->instance_end, fid->user_data);
+}
+
 static gboolean
 cal_data_model_foreach_component (ECalDataModel *data_model,
 				  time_t in_range_start,
@@ -2707,15 +3154,18 @@ cal_data_model_foreach_component (ECalDataModel *data_model,
 {
 	GHashTableIter viter;
 	gpointer key, value;
+	gboolean all_components;
 	gboolean checked_all = TRUE;
 
 	g_return_val_if_fail (E_IS_CAL_DATA_MODEL (data_model), FALSE);
 	g_return_val_if_fail (func != NULL, FALSE);
 
+	all_components = in_range_start == in_range_end && in_range_start == (time_t) 0;
+
 	LOCK_PROPS ();
 
 	/* Is the given time range in the currently used time range? */
-	if (!(in_range_start == in_range_end && in_range_start == (time_t) 0) &&
+	if (!all_components &&
 	    (in_range_start >= data_model->priv->range_end ||
 	    in_range_end <= data_model->priv->range_start)) {
 		UNLOCK_PROPS ();
@@ -2732,6 +3182,24 @@ cal_data_model_foreach_component (ECalDataModel *data_model,
 
 		view_data_lock (view_data);
 
+		if (!all_components) {
+			ForeachIndexedData fid;
+
+			/* The index covers both 'components' and 'lost_components',
+			   thus only the instances from the range are visited */
+			fid.data_model = data_model;
+			fid.view_data = view_data;
+			fid.func = func;
+			fid.user_data = user_data;
+			fid.include_lost_components = include_lost_components;
+
+			checked_all = e_time_index_foreach (view_data->components_index,
+				in_range_start, in_range_end, cal_data_model_foreach_indexed_cb, &fid);
+
+			view_data_unlock (view_data);
+			continue;
+		}
+
 		g_hash_table_iter_init (&citer, view_data->components);
 		while (checked_all && g_hash_table_iter_next (&citer, &key, &value)) {
 			ECalComponentId *id = key;
@@ -2740,13 +3208,9 @@ cal_data_model_foreach_component (ECalDataModel *data_model,
 			if (!comp_data)
 				continue;
 
-			if ((in_range_start == in_range_end && in_range_start == (time_t) 0) ||
-			    (comp_data->instance_start < in_range_end && comp_data->instance_end > in_range_start) ||
-			    (comp_data->instance_start == comp_data->instance_end && comp_data->instance_end == in_range_start)) {
-				if (!func (data_model, view_data->client, id, comp_data->component,
-					   comp_data->instance_start, comp_data->instance_end, user_data))
-					checked_all = FALSE;
-			}
+			if (!func (data_model, view_data->client, id, comp_data->component,
+				   comp_data->instance_start, comp_data->instance_end, user_data))
+				checked_all = FALSE;
 		}
 
 		if (include_lost_components && view_data->lost_components) {
@@ -2758,13 +3222,9 @@ cal_data_model_foreach_component (ECalDataModel *data_model,
 				if (!comp_data)
 					continue;
 
-				if ((in_range_start == in_range_end && in_range_start == (time_t) 0) ||
-				    (comp_data->instance_start < in_range_end && comp_data->instance_end > in_range_start) ||
-				    (comp_data->instance_start == comp_data->instance_end && comp_data->instance_end == in_range_start)) {
-					if (!func (data_model, view_data->client, id, comp_data->component,
-						   comp_data->instance_start, comp_data->instance_end, user_data))
-						checked_all = FALSE;
-				}
+				if (!func (data_model, view_data->client, id, comp_data->component,
+					   comp_data->instance_start, comp_data->instance_end, user_data))
+					checked_all = FALSE;
 			}
 		}
 
@@ -65,6 +65,24 @@ struct _ECalModelPrivate {
 	/* Array for storing the objects. Each element is of type ECalModelComponent */
 	GPtrArray *objects;
 
+	/* Index of the 'objects', to find components by their ID without
+	 * scanning the whole array. The 'objects_index' is
+	 * ECalModelComponent * ~> ComponentIndexData *, the 'objects_by_uid'
+	 * is gchar *uid ~> GSList { ECalModelComponent * }. The row numbers
+	 * in the 'objects_index' below the 'objects_index_rows_valid' are
+	 * up to date, the rest is renumbered on demand, thus removing
+	 * a row does not need to touch all the following ones. The index
+	 * is rebuilt whenever the 'objects' changed behind its back,
+	 * like when the length differs from 'objects_index_n_rows'. */
+	GHashTable *objects_index;
+	GHashTable *objects_by_uid;
+	guint objects_index_rows_valid;
+	guint objects_index_n_rows;
+
+	/* Rows added while frozen, not announced to the views yet */
+	gint freeze_count;
+	gint pending_rows_from;
+
 	ICalComponentKind kind;
 	ICalTimezone *zone;
 
@@ -129,7 +147,14 @@ typedef struct {
 	GList *uids;
 } AssignedColorData;
 
+typedef struct {
+	ECalModelComponent *comp_data; /* reffed */
+	gchar *uid;
+	guint row;
+} ComponentIndexData;
+
 static const gchar *cal_model_get_color_for_component (ECalModel *model, ECalModelComponent *comp_data);
+static void cal_model_objects_index_clear (ECalModel *model);
 
 enum {
 	PROP_0,
@@ -1160,6 +1185,10 @@ cal_model_finalize (GObject *object)
 
 	g_free (priv->default_category);
 
+	cal_model_objects_index_clear (E_CAL_MODEL (object));
+	g_hash_table_destroy (priv->objects_by_uid);
+	g_hash_table_destroy (priv->objects_index);
+
 	for (ii = 0; ii < priv->objects->len; ii++) {
 		ECalModelComponent *comp_data;
 
@@ -1885,42 +1914,249 @@ cal_model_value_to_string (ETableModel *etm,
 	return g_strdup ("");
 }
 
-static gint
-e_cal_model_get_component_index (ECalModel *model,
-				 ECalClient *client,
-				 const ECalComponentId *id)
+static void
+component_index_data_free (gpointer ptr)
 {
-	gint ii;
+	ComponentIndexData *cid = ptr;
+
+	if (cid) {
+		g_object_unref (cid->comp_data);
+		g_free (cid->uid);
+		g_free (cid);
+	}
+}
+
+static void
+cal_model_objects_index_clear (ECalModel *model)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, model->priv->objects_by_uid);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		g_slist_free (value);
+	}
+
+	g_hash_table_remove_all (model->priv->objects_by_uid);
+	g_hash_table_remove_all (model->priv->objects_index);
+
+	model->priv->objects_index_rows_valid = 0;
+	model->priv->objects_index_n_rows = 0;
+}
+
+static void
+cal_model_objects_index_add (ECalModel *model,
+			     ECalModelComponent *comp_data,
+			     guint row)
+{
+	ComponentIndexData *cid;
+	const gchar *uid;
+	GSList *comps;
+
+	/* Appending to an up to date index keeps it up to date */
+	if (model->priv->objects_index_rows_valid == row)
+		model->priv->objects_index_rows_valid = row + 1;
+
+	cid = g_hash_table_lookup (model->priv->objects_index, comp_data);
+	if (cid) {
+		cid->row = row;
+		return;
+	}
+
+	uid = comp_data->icalcomp ? i_cal_component_get_uid (comp_data->icalcomp) : NULL;
+
+	cid = g_new0 (ComponentIndexData, 1);
+	cid->comp_data = g_object_ref (comp_data);
+	cid->uid = (uid && *uid) ? g_strdup (uid) : NULL;
+	cid->row = row;
+
+	g_hash_table_insert (model->priv->objects_index, comp_data, cid);
+
+	/* Components without UID are never found by ID */
+	if (!cid->uid)
+		return;
+
+	comps = g_hash_table_lookup (model->priv->objects_by_uid, cid->uid);
+	if (comps)
+		comps = g_slist_append (comps, comp_data);
+	else
+		g_hash_table_insert (model->priv->objects_by_uid, g_strdup (cid->uid), g_slist_prepend (NULL, comp_data));
+}
+
+/* Call after the comp_data had been removed from the 'objects' at the row */
+static void
+cal_model_objects_index_remove (ECalModel *model,
+				ECalModelComponent *comp_data,
+				guint row)
+{
+	ComponentIndexData *cid;
+
+	cid = g_hash_table_lookup (model->priv->objects_index, comp_data);
+	if (!cid)
+		return;
+
+	if (cid->uid) {
+		gpointer orig_key = NULL, orig_value = NULL;
+
+		if (g_hash_table_lookup_extended (model->priv->objects_by_uid, cid->uid, &orig_key, &orig_value)) {
+			GSList *comps;
+
+			comps = g_slist_remove (orig_value, comp_data);
+
+			if (!comps) {
+				g_hash_table_remove (model->priv->objects_by_uid, orig_key);
+			} else if (comps != orig_value) {
+				/* The head changed; re-add it under the same key */
+				g_hash_table_steal (model->priv->objects_by_uid, orig_key);
+				g_hash_table_insert (model->priv->objects_by_uid, orig_key, comps);
+			}
+		}
+	}
+
+	g_hash_table_remove (model->priv->objects_index, comp_data);
+
+	model->priv->objects_index_rows_valid = MIN (model->priv->objects_index_rows_valid, row);
+}
+
+static void
+cal_model_objects_index_rebuild (ECalModel *model)
+{
+	guint ii;
+
+	cal_model_objects_index_clear (model);
 
 	for (ii = 0; ii < model->priv->objects->len; ii++) {
 		ECalModelComponent *comp_data = g_ptr_array_index (model->priv->objects, ii);
 
-		if (comp_data) {
-			const gchar *uid;
-			gchar *rid;
-			gboolean has_rid = e_cal_component_id_get_rid (id) != NULL;
+		if (comp_data)
+			cal_model_objects_index_add (model, comp_data, ii);
+	}
 
-			uid = i_cal_component_get_uid (comp_data->icalcomp);
-			rid = e_cal_util_component_get_recurid_as_string (comp_data->icalcomp);
+	model->priv->objects_index_rows_valid = model->priv->objects->len;
+	model->priv->objects_index_n_rows = model->priv->objects->len;
+}
 
-			if (uid && *uid) {
-				if ((!client || comp_data->client == client) && strcmp (uid, e_cal_component_id_get_uid (id)) == 0) {
-					if (has_rid) {
-						if (!(rid && *rid && strcmp (rid, e_cal_component_id_get_rid (id)) == 0)) {
-							g_free (rid);
-							continue;
-						}
-					}
-					g_free (rid);
-					return ii;
-				}
+static void
+cal_model_objects_index_renumber (ECalModel *model)
+{
+	guint ii;
+
+	for (ii = model->priv->objects_index_rows_valid; ii < model->priv->objects->len; ii++) {
+		ECalModelComponent *comp_data = g_ptr_array_index (model->priv->objects, ii);
+
+		if (comp_data)
+			cal_model_objects_index_add (model, comp_data, ii);
+	}
+
+	model->priv->objects_index_rows_valid = model->priv->objects->len;
+}
+
+/* Returns the component with the lowest row, which matches the client
+ * (if not NULL) and the id; the RID is compared only when the id has it. */
+static ECalModelComponent *
+cal_model_objects_index_lookup (ECalModel *model,
+				ECalClient *client,
+				const ECalComponentId *id,
+				gint *out_index)
+{
+	ECalModelComponent *found = NULL;
+	const gchar *uid, *rid;
+	gboolean rebuilt = FALSE;
+	guint found_row = 0;
+	GSList *link;
+
+	if (out_index)
+		*out_index = -1;
+
+	uid = e_cal_component_id_get_uid (id);
+	rid = e_cal_component_id_get_rid (id);
+
+	if (!uid || !*uid)
+		return NULL;
+
+ again:
+	/* Some callers modify the array returned by e_cal_model_get_object_array() */
+	if (model->priv->objects->len != model->priv->objects_index_n_rows) {
+		cal_model_objects_index_rebuild (model);
+		rebuilt = TRUE;
+	} else if (model->priv->objects_index_rows_valid < model->priv->objects->len) {
+		cal_model_objects_index_renumber (model);
+	}
+
+	for (link = g_hash_table_lookup (model->priv->objects_by_uid, uid); link; link = g_slist_next (link)) {
+		ECalModelComponent *comp_data = link->data;
+		ComponentIndexData *cid;
+
+		cid = g_hash_table_lookup (model->priv->objects_index, comp_data);
+
+		if (cid->row >= model->priv->objects->len ||
+		    g_ptr_array_index (model->priv->objects, cid->row) != comp_data ||
+		    g_strcmp0 (i_cal_component_get_uid (comp_data->icalcomp), uid) != 0) {
+			if (!rebuilt) {
+				cal_model_objects_index_rebuild (model);
+				rebuilt = TRUE;
+				found = NULL;
+
+				goto again;
 			}
 
-			g_free (rid);
+			continue;
 		}
+
+		if ((client && comp_data->client != client) ||
+		    (found && cid->row > found_row))
+			continue;
+
+		if (rid) {
+			gchar *comp_rid;
+			gboolean matches;
+
+			comp_rid = e_cal_util_component_get_recurid_as_string (comp_data->icalcomp);
+			matches = comp_rid && *comp_rid && strcmp (comp_rid, rid) == 0;
+			g_free (comp_rid);
+
+			if (!matches)
+				continue;
+		}
+
+		found = comp_data;
+		found_row = cid->row;
 	}
 
-	return -1;
+	if (found && out_index)
+		*out_index = found_row;
+
+	return found;
+}
+
+static gint
+e_cal_model_get_component_index (ECalModel *model,
+				 ECalClient *client,
+				 const ECalComponentId *id)
+{
+	gint index = -1;
+
+	cal_model_objects_index_lookup (model, client, id, &index);
+
+	return index;
+}
+
+/* Announces rows added while frozen; call before any other
+ * change notification, thus the views know about those rows. */
+static void
+cal_model_flush_pending_rows (ECalModel *model)
+{
+	gint from = model->priv->pending_rows_from;
+
+	if (from < 0)
+		return;
+
+	model->priv->pending_rows_from = -1;
+
+	if (from < model->priv->objects->len)
+		e_table_model_rows_inserted (E_TABLE_MODEL (model), from, model->priv->objects->len - from);
+	else
+		e_table_model_no_change (E_TABLE_MODEL (model));
 }
 
 static void
@@ -1951,7 +2187,9 @@ cal_model_data_subscriber_component_added_or_modified (ECalDataModelSubscriber *
 	icomp = i_cal_component_clone (e_cal_component_get_icalcomponent (comp));
 
 	if (index < 0) {
-		e_table_model_pre_change (table_model);
+		/* When frozen, all the added rows are announced at once on thaw */
+		if (model->priv->pending_rows_from < 0)
+			e_table_model_pre_change (table_model);
 
 		comp_data = g_object_new (E_TYPE_CAL_MODEL_COMPONENT, NULL);
 		comp_data->is_new_component = FALSE;
@@ -1960,8 +2198,18 @@ cal_model_data_subscriber_component_added_or_modified (ECalDataModelSubscriber *
 		e_cal_model_set_instance_times (comp_data, model->priv->zone);
 		g_ptr_array_add (model->priv->objects, comp_data);
 
-		e_table_model_row_inserted (table_model, model->priv->objects->len - 1);
+		cal_model_objects_index_add (model, comp_data, model->priv->objects->len - 1);
+		model->priv->objects_index_n_rows++;
+
+		if (model->priv->freeze_count > 0) {
+			if (model->priv->pending_rows_from < 0)
+				model->priv->pending_rows_from = model->priv->objects->len - 1;
+		} else {
+			e_table_model_row_inserted (table_model, model->priv->objects->len - 1);
+		}
 	} else {
+		cal_model_flush_pending_rows (model);
+
 		e_table_model_pre_change (table_model);
 
 		comp_data = g_ptr_array_index (model->priv->objects, index);
@@ -2011,6 +2259,8 @@ e_cal_model_data_subscriber_component_removed (ECalDataModelSubscriber *subscrib
 	if (index < 0)
 		return;
 
+	cal_model_flush_pending_rows (model);
+
 	table_model = E_TABLE_MODEL (model);
 	e_table_model_pre_change (table_model);
 
@@ -2020,6 +2270,9 @@ e_cal_model_data_subscriber_component_removed (ECalDataModelSubscriber *subscrib
 		return;
 	}
 
+	cal_model_objects_index_remove (model, comp_data, index);
+	model->priv->objects_index_n_rows--;
+
 	link = g_slist_append (NULL, comp_data);
 	g_signal_emit (model, signals[COMPS_DELETED], 0, link);
 
@@ -2036,15 +2289,28 @@ e_cal_model_data_subscriber_freeze (ECalDataModelSubscriber *subscriber)
 
 	/* ETableModel *table_model = E_TABLE_MODEL (subscriber);
 	e_table_model_freeze (table_model); */
+
+	/* Only the added rows are collected, to be
+	 * announced with a single rows_inserted(). */
+	E_CAL_MODEL (subscriber)->priv->freeze_count++;
 }
 
 static void
 e_cal_model_data_subscriber_thaw (ECalDataModelSubscriber *subscriber)
 {
+	ECalModel *model = E_CAL_MODEL (subscriber);
+
 	/* No freeze/thaw, the ETableModel doesn't notify about changes when frozen */
 
 	/* ETableModel *table_model = E_TABLE_MODEL (subscriber);
 	e_table_model_thaw (table_model); */
+
+	g_return_if_fail (model->priv->freeze_count > 0);
+
+	model->priv->freeze_count--;
+
+	if (!model->priv->freeze_count)
+		cal_model_flush_pending_rows (model);
 }
 
 static void
@@ -2590,6 +2856,13 @@ e_cal_model_init (ECalModel *model)
 	model->priv->end = (time_t) -1;
 
 	model->priv->objects = g_ptr_array_new ();
+	model->priv->objects_index = g_hash_table_new_full (
+		g_direct_hash, g_direct_equal,
+		NULL, component_index_data_free);
+	model->priv->objects_by_uid = g_hash_table_new_full (
+		g_str_hash, g_str_equal,
+		g_free, NULL);
+	model->priv->pending_rows_from = -1;
 	model->priv->kind = I_CAL_NO_COMPONENT;
 
 	model->priv->use_24_hour_format = TRUE;
@@ -2826,6 +3099,8 @@ e_cal_model_set_timezone (ECalModel *model,
 	if (model->priv->zone == zone)
 		return;
 
+	cal_model_flush_pending_rows (model);
+
 	e_table_model_pre_change (E_TABLE_MODEL (model));
 	old_zone = model->priv->zone;
 	model->priv->zone = zone ? e_cal_util_copy_timezone (zone) : NULL;
@@ -2935,6 +3210,8 @@ e_cal_model_set_use_24_hour_format (ECalModel *model,
 	if (model->priv->use_24_hour_format == use_24_hour_format)
 		return;
 
+	cal_model_flush_pending_rows (model);
+
 	e_table_model_pre_change (E_TABLE_MODEL (model));
 	model->priv->use_24_hour_format = use_24_hour_format;
 
@@ -3590,45 +3867,6 @@ e_cal_model_set_default_source_uid (ECalModel *model,
 	g_object_notify (G_OBJECT (model), "default-source-uid");
 }
 
-static ECalModelComponent *
-search_by_id_and_client (ECalModelPrivate *priv,
-                         ECalClient *client,
-                         const ECalComponentId *id)
-{
-	gint i;
-
-	for (i = 0; i < priv->objects->len; i++) {
-		ECalModelComponent *comp_data = g_ptr_array_index (priv->objects, i);
-
-		if (comp_data) {
-			const gchar *uid;
-			gchar *rid;
-			gboolean has_rid = e_cal_component_id_get_rid (id) != NULL;
-
-			uid = i_cal_component_get_uid (comp_data->icalcomp);
-			rid = e_cal_util_component_get_recurid_as_string (comp_data->icalcomp);
-
-			if (uid && *uid) {
-				if ((!client || comp_data->client == client) &&
-				    !g_strcmp0 (e_cal_component_id_get_uid (id), uid)) {
-					if (has_rid) {
-						if (!(rid && *rid && !g_strcmp0 (e_cal_component_id_get_rid (id), rid))) {
-							g_free (rid);
-							continue;
-						}
-					}
-					g_free (rid);
-					return comp_data;
-				}
-			}
-
-			g_free (rid);
-		}
-	}
-
-	return NULL;
-}
-
 void
 e_cal_model_remove_all_objects (ECalModel *model)
 {
@@ -3637,6 +3875,8 @@ e_cal_model_remove_all_objects (ECalModel *model)
 	GSList *link;
 	gint index;
 
+	cal_model_flush_pending_rows (model);
+
 	table_model = E_TABLE_MODEL (model);
 	for (index = model->priv->objects->len - 1; index >= 0; index--) {
 		e_table_model_pre_change (table_model);
@@ -3647,6 +3887,9 @@ e_cal_model_remove_all_objects (ECalModel *model)
 			continue;
 		}
 
+		cal_model_objects_index_remove (model, comp_data, index);
+		model->priv->objects_index_n_rows--;
+
 		link = g_slist_append (NULL, comp_data);
 		g_signal_emit (model, signals[COMPS_DELETED], 0, link);
 
@@ -3940,13 +4183,9 @@ e_cal_model_get_component_for_client_and_uid (ECalModel *model,
 					      ECalClient *client,
 					      const ECalComponentId *id)
 {
-	ECalModelPrivate *priv;
-
 	g_return_val_if_fail (E_IS_CAL_MODEL (model), NULL);
 
-	priv = model->priv;
-
-	return search_by_id_and_client (priv, client, id);
+	return cal_model_objects_index_lookup (model, client, id, NULL);
 }
 
 /**
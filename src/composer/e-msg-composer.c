@@ -363,19 +363,72 @@ text_requires_quoted_printable (const gchar *text,
 	return FALSE;
 }
 
+/* Statistics of a UTF-8 text, gathered in a single pass */
+typedef struct _TextStats {
+	gsize n_8bit;		/* bytes above 127 */
+	gsize n_latin1_8bit;	/* characters U+0080 - U+00FF */
+	gboolean has_nul;
+	gboolean has_from_line;	/* a line starting with "From " */
+	gboolean is_latin1;	/* all characters are below U+0100 */
+	gboolean is_valid;	/* the text is valid UTF-8 */
+} TextStats;
+
+static void
+text_stats_scan (const guint8 *data,
+                 gsize len,
+                 TextStats *stats)
+{
+	const guint8 *p = data, *end = data + len;
+	const guint8 *line_start = data;
+
+	memset (stats, 0, sizeof (TextStats));
+	stats->is_latin1 = TRUE;
+	stats->is_valid = TRUE;
+
+	while (p < end) {
+		if (*p < 128) {
+			if (*p == '\n') {
+				line_start = p + 1;
+			} else if (*p == '\0') {
+				stats->has_nul = TRUE;
+			} else if (*p == 'F' && p == line_start && end - p >= 5 &&
+				   strncmp ((const gchar *) p, "From ", 5) == 0) {
+				stats->has_from_line = TRUE;
+			}
+
+			p++;
+		} else {
+			gunichar c;
+			gint n_bytes = g_utf8_skip[*p];
+
+			c = g_utf8_get_char_validated ((const gchar *) p, end - p);
+			if (c == (gunichar) -1 || c == (gunichar) -2) {
+				stats->is_valid = FALSE;
+				n_bytes = 1;
+			} else if (c < 256) {
+				stats->n_latin1_8bit++;
+			} else {
+				stats->is_latin1 = FALSE;
+			}
+
+			stats->n_8bit += n_bytes;
+			p += n_bytes;
+		}
+	}
+}
+
+/* Counts bytes above 127 in the text converted to 'charset',
+ * or returns FALSE when the text cannot be converted. */
 static gboolean
-best_encoding (GByteArray *buf,
-               const gchar *charset,
-	       CamelTransferEncoding *encoding)
+text_count_8bit_in_charset (GByteArray *buf,
+                            const gchar *charset,
+                            gsize *out_count)
 {
-	gchar *in, *out, outbuf[256], *ch;
+	gchar *in, *out, outbuf[4096], *ch;
 	gsize inlen, outlen;
-	gint status, count = 0;
+	gsize status, count = 0;
 	iconv_t cd;
 
-	if (!charset)
-		return FALSE;
-
 	cd = camel_iconv_open (charset, "utf-8");
 	if (cd == (iconv_t) -1)
 		return FALSE;
@@ -396,9 +449,46 @@ best_encoding (GByteArray *buf,
 	if (status == (gsize) -1 || status > 0)
 		return FALSE;
 
+	*out_count = count;
+
+	return TRUE;
+}
+
+static gboolean
+best_encoding (GByteArray *buf,
+               const TextStats *stats,
+               const gchar *charset,
+	       CamelTransferEncoding *encoding)
+{
+	const gchar *iconv_name;
+	gsize count;
+
+	if (!charset)
+		return FALSE;
+
+	/* The common charsets are decided from the statistics,
+	 * without converting the text. */
+	iconv_name = camel_iconv_charset_name (charset);
+
+	if (!g_ascii_strcasecmp (iconv_name, "US-ASCII") ||
+	    !g_ascii_strcasecmp (iconv_name, "ASCII")) {
+		if (stats->n_8bit > 0)
+			return FALSE;
+		count = 0;
+	} else if (!g_ascii_strcasecmp (iconv_name, "UTF-8")) {
+		if (!stats->is_valid)
+			return FALSE;
+		count = stats->n_8bit;
+	} else if (!g_ascii_strcasecmp (iconv_name, "ISO-8859-1")) {
+		if (!stats->is_valid || !stats->is_latin1)
+			return FALSE;
+		count = stats->n_latin1_8bit;
+	} else if (!text_count_8bit_in_charset (buf, charset, &count)) {
+		return FALSE;
+	}
+
 	if ((count == 0) && (buf->len < LINE_LEN) &&
-		!text_requires_quoted_printable (
-		(const gchar *) buf->data, buf->len))
+	    !stats->has_nul && !stats->has_from_line)
 		*encoding = CAMEL_TRANSFER_ENCODING_7BIT;
 	else if (count <= buf->len * 0.17)
 		*encoding = CAMEL_TRANSFER_ENCODING_QUOTEDPRINTABLE;
@@ -414,19 +504,22 @@ best_charset (GByteArray *buf,
               CamelTransferEncoding *encoding)
 {
 	const gchar *charset;
+	TextStats stats;
+
+	text_stats_scan (buf->data, buf->len, &stats);
 
 	/* First try US-ASCII */
-	if (best_encoding (buf, "US-ASCII", encoding) &&
+	if (best_encoding (buf, &stats, "US-ASCII", encoding) &&
 	    *encoding == CAMEL_TRANSFER_ENCODING_7BIT)
 		return NULL;
 
 	/* Next try the user-specified charset for this message */
-	if (best_encoding (buf, default_charset, encoding))
+	if (best_encoding (buf, &stats, default_charset, encoding))
 		return g_strdup (default_charset);
 
 	/* Now try the user's default charset from the mail config */
 	charset = e_composer_get_default_charset ();
-	if (best_encoding (buf, charset, encoding))
+	if (best_encoding (buf, &stats, charset, encoding))
 		return g_strdup (charset);
 
 	/* Try to find something that will work */
@@ -437,7 +530,7 @@ best_charset (GByteArray *buf,
 		return NULL;
 	}
 
-	if (!best_encoding (buf, charset, encoding))
+	if (!best_encoding (buf, &stats, charset, encoding))
 		*encoding = CAMEL_TRANSFER_ENCODING_BASE64;
 
 	return g_strdup (charset);
@@ -110,6 +110,34 @@ G_DEFINE_TYPE (ECellText, e_cell_text, E_TYPE_CELL)
 
 #define TEXT_PAD 4
 
+/* Upper bound of shaped layouts kept by one ECellTextView; enough
+ * for a few screens of a message list or a contact table. */
+#define LAYOUT_CACHE_SIZE 1024
+
+enum {
+	TEXT_ATTR_BOLD = 1 << 0,
+	TEXT_ATTR_STRIKEOUT = 1 << 1,
+	TEXT_ATTR_UNDERLINE = 1 << 2,
+	TEXT_ATTR_ITALIC = 1 << 3
+};
+
+/* A cached layout, looked up by the row, model column and width,
+ * and reused only while the text and the style it was built for
+ * still match. */
+typedef struct {
+	gint row;
+	gint model_col;
+	gint width;
+
+	gchar *text;
+	guint attrs;
+	guint strikeout_color;
+	GtkJustification justify;
+
+	PangoLayout *layout;
+	GList link;			/* in ECellTextView::layout_lru */
+} LayoutCacheEntry;
+
 typedef struct {
 	gpointer lines;			/* Text split into lines (private field) */
 	gint num_lines;			/* Number of lines of text */
@@ -133,6 +161,11 @@ typedef struct {
 	gint xofs, yofs;                 /* This gets added to the x
                                            and y for the cell text. */
 	gdouble ellipsis_width[2];      /* The width of the ellipsis. */
+
+	GHashTable *layout_cache;	/* LayoutCacheEntry ~> itself */
+	GQueue layout_lru;		/* most recently used first */
+	guint layout_cache_serial;	/* PangoContext serial of the cache */
+	gulong model_handler_ids[5];
 } ECellTextView;
 
 struct _CellEdit {
@@ -329,6 +362,120 @@ ect_cancel_edit (ECellTextView *text_view)
 	e_table_item_leave_edit_ (text_view->cell_view.e_table_item_view);
 }
 
+static guint
+layout_cache_entry_hash (gconstpointer ptr)
+{
+	const LayoutCacheEntry *entry = ptr;
+
+	return (guint) entry->row * 31 * 31 + (guint) entry->model_col * 31 + (guint) entry->width;
+}
+
+static gboolean
+layout_cache_entry_equal (gconstpointer ptr1,
+                          gconstpointer ptr2)
+{
+	const LayoutCacheEntry *entry1 = ptr1, *entry2 = ptr2;
+
+	return entry1->row == entry2->row &&
+		entry1->model_col == entry2->model_col &&
+		entry1->width == entry2->width;
+}
+
+static void
+layout_cache_entry_free (gpointer ptr)
+{
+	LayoutCacheEntry *entry = ptr;
+
+	if (entry) {
+		g_clear_object (&entry->layout);
+		g_free (entry->text);
+		g_free (entry);
+	}
+}
+
+static void
+layout_cache_clear (ECellTextView *text_view)
+{
+	if (!g_hash_table_size (text_view->layout_cache))
+		return;
+
+	/* The links are embedded in the entries, thus only forget them */
+	g_queue_init (&text_view->layout_lru);
+	g_hash_table_remove_all (text_view->layout_cache);
+}
+
+typedef struct {
+	ECellTextView *text_view;
+	gint row;
+} RemoveRowData;
+
+static gboolean
+layout_cache_remove_row_cb (gpointer key,
+                            gpointer value,
+                            gpointer user_data)
+{
+	LayoutCacheEntry *entry = value;
+	RemoveRowData *rrd = user_data;
+
+	if (entry->row != rrd->row)
+		return FALSE;
+
+	g_queue_unlink (&rrd->text_view->layout_lru, &entry->link);
+
+	return TRUE;
+}
+
+static void
+layout_cache_remove_row (ECellTextView *text_view,
+                         gint row)
+{
+	RemoveRowData rrd;
+
+	if (!g_hash_table_size (text_view->layout_cache))
+		return;
+
+	rrd.text_view = text_view;
+	rrd.row = row;
+
+	g_hash_table_foreach_remove (text_view->layout_cache, layout_cache_remove_row_cb, &rrd);
+}
+
+static void
+ect_model_changed_cb (ETableModel *table_model,
+                      ECellTextView *text_view)
+{
+	layout_cache_clear (text_view);
+}
+
+static void
+ect_model_row_changed_cb (ETableModel *table_model,
+                          gint row,
+                          ECellTextView *text_view)
+{
+	/* The style columns are read from the same row, thus drop all
+	 * of its columns, not only the changed one. */
+	layout_cache_remove_row (text_view, row);
+}
+
+static void
+ect_model_cell_changed_cb (ETableModel *table_model,
+                           gint col,
+                           gint row,
+                           ECellTextView *text_view)
+{
+	layout_cache_remove_row (text_view, row);
+}
+
+static void
+ect_model_rows_changed_cb (ETableModel *table_model,
+                           gint row,
+                           gint count,
+                           ECellTextView *text_view)
+{
+	/* The following rows moved, which invalidates their keys */
+	layout_cache_clear (text_view);
+}
+
 /*
  * ECell::new_view method
  */
@@ -351,6 +498,32 @@ ect_new_view (ECell *ecell,
 	text_view->xofs = 0.0;
 	text_view->yofs = 0.0;
 
+	text_view->layout_cache = g_hash_table_new_full (
+		layout_cache_entry_hash, layout_cache_entry_equal,
+		NULL, layout_cache_entry_free);
+	g_queue_init (&text_view->layout_lru);
+
+	/* The ETableItem can drop the model before it kills its views */
+	if (table_model) {
+		g_object_ref (table_model);
+
+		text_view->model_handler_ids[0] = g_signal_connect (
+			table_model, "model_changed",
+			G_CALLBACK (ect_model_changed_cb), text_view);
+		text_view->model_handler_ids[1] = g_signal_connect (
+			table_model, "model_row_changed",
+			G_CALLBACK (ect_model_row_changed_cb), text_view);
+		text_view->model_handler_ids[2] = g_signal_connect (
+			table_model, "model_cell_changed",
+			G_CALLBACK (ect_model_cell_changed_cb), text_view);
+		text_view->model_handler_ids[3] = g_signal_connect (
+			table_model, "model_rows_inserted",
+			G_CALLBACK (ect_model_rows_changed_cb), text_view);
+		text_view->model_handler_ids[4] = g_signal_connect (
+			table_model, "model_rows_deleted",
+			G_CALLBACK (ect_model_rows_changed_cb), text_view);
+	}
+
 	return (ECellView *) text_view;
 }
 
@@ -361,6 +534,7 @@ static void
 ect_kill_view (ECellView *ecv)
 {
 	ECellTextView *text_view = (ECellTextView *) ecv;
+	guint ii;
 
 	if (text_view->cell_view.kill_view_cb)
 	    (text_view->cell_view.kill_view_cb)(ecv, text_view->cell_view.kill_view_cb_data);
@@ -368,6 +542,15 @@ ect_kill_view (ECellView *ecv)
 	if (text_view->cell_view.kill_view_cb_data)
 	    g_list_free (text_view->cell_view.kill_view_cb_data);
 
+	if (text_view->cell_view.e_table_model) {
+		for (ii = 0; ii < G_N_ELEMENTS (text_view->model_handler_ids); ii++)
+			g_signal_handler_disconnect (text_view->cell_view.e_table_model, text_view->model_handler_ids[ii]);
+
+		g_object_unref (text_view->cell_view.e_table_model);
+	}
+
+	g_hash_table_destroy (text_view->layout_cache);
+
 	g_free (text_view);
 }
 
@@ -399,38 +582,59 @@ ect_unrealize (ECellView *ecv)
 
 	g_object_unref (text_view->i_cursor);
 
+	layout_cache_clear (text_view);
+
 	if (E_CELL_CLASS (e_cell_text_parent_class)->unrealize)
 		(* E_CELL_CLASS (e_cell_text_parent_class)->unrealize) (ecv);
 
 }
 
-static PangoAttrList *
-build_attr_list (ECellTextView *text_view,
-                 gint row,
-                 gint text_length)
+/* Reads the style columns of the @row into a TEXT_ATTR_* mask */
+static guint
+get_text_attrs (ECellTextView *text_view,
+                gint row,
+                guint *out_strikeout_color)
 {
-
 	ECellView *ecell_view = (ECellView *) text_view;
 	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
+	guint attrs = 0;
+
+	*out_strikeout_color = 0;
+
+	if (row < 0)
+		return 0;
+
+	if (ect->bold_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->bold_column, row))
+		attrs |= TEXT_ATTR_BOLD;
+	if (ect->strikeout_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_column, row))
+		attrs |= TEXT_ATTR_STRIKEOUT;
+	if (ect->underline_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->underline_column, row))
+		attrs |= TEXT_ATTR_UNDERLINE;
+	if (ect->italic_column >= 0 &&
+	    e_table_model_value_at (ecell_view->e_table_model, ect->italic_column, row))
+		attrs |= TEXT_ATTR_ITALIC;
+
+	if (ect->strikeout_color_column >= 0)
+		*out_strikeout_color = GPOINTER_TO_UINT (e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_color_column, row));
+
+	return attrs;
+}
+
+static PangoAttrList *
+attr_list_from_text_attrs (guint text_attrs,
+                           guint strikeout_color,
+                           gint text_length)
+{
 	PangoAttrList *attrs = pango_attr_list_new ();
 	gboolean bold, strikeout, underline, italic;
-	gint strikeout_color = 0;
-
-	bold = ect->bold_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->bold_column, row);
-	strikeout = ect->strikeout_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_column, row);
-	underline = ect->underline_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->underline_column, row);
-	italic = ect->italic_column >= 0 &&
-		row >= 0 &&
-		e_table_model_value_at (ecell_view->e_table_model, ect->italic_column, row);
 
-	if (ect->strikeout_color_column >= 0 && row >= 0)
-		strikeout_color = GPOINTER_TO_UINT (e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_color_column, row));
+	bold = (text_attrs & TEXT_ATTR_BOLD) != 0;
+	strikeout = (text_attrs & TEXT_ATTR_STRIKEOUT) != 0;
+	underline = (text_attrs & TEXT_ATTR_UNDERLINE) != 0;
+	italic = (text_attrs & TEXT_ATTR_ITALIC) != 0;
 
 	if (bold) {
 		PangoAttribute *attr = pango_attr_weight_new (PANGO_WEIGHT_BOLD);
@@ -475,6 +679,18 @@ build_attr_list (ECellTextView *text_view,
 	return attrs;
 }
 
+static PangoAttrList *
+build_attr_list (ECellTextView *text_view,
+                 gint row,
+                 gint text_length)
+{
+	guint text_attrs, strikeout_color;
+
+	text_attrs = get_text_attrs (text_view, row, &strikeout_color);
+
+	return attr_list_from_text_attrs (text_attrs, strikeout_color, text_length);
+}
+
 static PangoLayout *
 layout_with_preedit (ECellTextView *text_view,
                      gint row,
@@ -541,10 +757,11 @@ layout_with_preedit (ECellTextView *text_view,
 }
 
 static PangoLayout *
-build_layout (ECellTextView *text_view,
-              gint row,
-              const gchar *text,
-              gint width)
+build_layout_with_attrs (ECellTextView *text_view,
+                         const gchar *text,
+                         guint text_attrs,
+                         guint strikeout_color,
+                         gint width)
 {
 	ECellView *ecell_view = (ECellView *) text_view;
 	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
@@ -553,7 +770,7 @@ build_layout (ECellTextView *text_view,
 
 	layout = gtk_widget_create_pango_layout (GTK_WIDGET (((GnomeCanvasItem *) ecell_view->e_table_item_view)->canvas), text);
 
-	attrs = (PangoAttrList *) build_attr_list (text_view, row, text ? strlen (text) : 0);
+	attrs = attr_list_from_text_attrs (text_attrs, strikeout_color, text ? strlen (text) : 0);
 
 	pango_layout_set_attributes (layout, attrs);
 	pango_attr_list_unref (attrs);
@@ -609,6 +826,90 @@ build_layout (ECellTextView *text_view,
 	return layout;
 }
 
+static PangoLayout *
+build_layout (ECellTextView *text_view,
+              gint row,
+              const gchar *text,
+              gint width)
+{
+	guint text_attrs, strikeout_color;
+
+	text_attrs = get_text_attrs (text_view, row, &strikeout_color);
+
+	return build_layout_with_attrs (text_view, text, text_attrs, strikeout_color, width);
+}
+
+/* Returns a layout for the cell from the view's layout cache, building
+ * and storing it when the cell's text or style changed since it was
+ * cached. Shaping is the expensive part of drawing a cell, which makes
+ * scrolling and redraws of unchanged rows cheap. */
+static PangoLayout *
+cached_layout (ECellTextView *text_view,
+               gint model_col,
+               gint row,
+               const gchar *text,
+               gint width)
+{
+	ECellView *ecell_view = (ECellView *) text_view;
+	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
+	LayoutCacheEntry key, *entry;
+	PangoContext *pango_context;
+	guint text_attrs, strikeout_color, serial;
+
+	/* Font or resolution changes bump the serial */
+	pango_context = gtk_widget_get_pango_context (GTK_WIDGET (text_view->canvas));
+	serial = pango_context_get_serial (pango_context);
+	if (serial != text_view->layout_cache_serial) {
+		layout_cache_clear (text_view);
+		text_view->layout_cache_serial = serial;
+	}
+
+	text_attrs = get_text_attrs (text_view, row, &strikeout_color);
+
+	key.row = row;
+	key.model_col = model_col;
+	key.width = width;
+
+	entry = g_hash_table_lookup (text_view->layout_cache, &key);
+	if (entry) {
+		g_queue_unlink (&text_view->layout_lru, &entry->link);
+
+		if (entry->attrs != text_attrs ||
+		    entry->strikeout_color != strikeout_color ||
+		    entry->justify != ect->justify ||
+		    g_strcmp0 (entry->text, text) != 0) {
+			g_clear_object (&entry->layout);
+			g_free (entry->text);
+		}
+	} else {
+		if (g_hash_table_size (text_view->layout_cache) >= LAYOUT_CACHE_SIZE) {
+			GList *link = g_queue_pop_tail_link (&text_view->layout_lru);
+
+			g_hash_table_remove (text_view->layout_cache, link->data);
+		}
+
+		entry = g_new0 (LayoutCacheEntry, 1);
+		entry->row = row;
+		entry->model_col = model_col;
+		entry->width = width;
+		entry->link.data = entry;
+
+		g_hash_table_add (text_view->layout_cache, entry);
+	}
+
+	g_queue_push_head_link (&text_view->layout_lru, &entry->link);
+
+	if (!entry->layout) {
+		entry->text = g_strdup (text);
+		entry->attrs = text_attrs;
+		entry->strikeout_color = strikeout_color;
+		entry->justify = ect->justify;
+		entry->layout = build_layout_with_attrs (text_view, text, text_attrs, strikeout_color, width);
+	}
+
+	return g_object_ref (entry->layout);
+}
+
 static PangoLayout *
 generate_layout (ECellTextView *text_view,
                  gint model_col,
@@ -628,7 +929,14 @@ generate_layout (ECellTextView *text_view,
 
 	if (row >= 0) {
 		gchar *temp = e_cell_text_get_text (ect, ecell_view->e_table_model, model_col, row);
-		layout = build_layout (text_view, row, temp ? temp : "", width);
+
+		/* Layouts built while editing are laid out differently
+		 * and the edited one is changed in place, keep them out
+		 * of the cache. */
+		if (edit)
+			layout = build_layout (text_view, row, temp ? temp : "", width);
+		else
+			layout = cached_layout (text_view, model_col, row, temp ? temp : "", width);
 		e_cell_text_free_text (ect, ecell_view->e_table_model, model_col, temp);
 	} else
 		layout = build_layout (text_view, row, "Mumbo Jumbo", width);
@@ -100,13 +100,16 @@ typedef struct
 
 	EBookClientView *client_view;
 	GPtrArray *contacts;
+	GHashTable *contacts_index; /* gchar *uid ~> index + 1 into contacts */
 
 	EBookClientView *client_view_pending;
 	GPtrArray *contacts_pending;
+	GHashTable *contacts_pending_index; /* gchar *uid ~> index + 1 into contacts_pending */
 }
 ContactSource;
 
 static void free_contact_ptrarray (GPtrArray *contacts);
+static void free_contact_source_pending (ContactSource *source);
 static void clear_contact_source  (EContactStore *contact_store, ContactSource *source);
 static void stop_view             (EContactStore *contact_store, EBookClientView *view);
 
@@ -128,6 +131,7 @@ contact_store_dispose (GObject *object)
 
 		clear_contact_source (E_CONTACT_STORE (object), source);
 		free_contact_ptrarray (source->contacts);
+		g_hash_table_destroy (source->contacts_index);
 		g_object_unref (source->book_client);
 	}
 	g_array_set_size (priv->contact_sources, 0);
@@ -421,76 +425,114 @@ count_contacts (EContactStore *contact_store)
 	return count;
 }
 
-static gint
-find_contact_by_view_and_uid (EContactStore *contact_store,
-                              EBookClientView *find_view,
-                              const gchar *find_uid)
+static GHashTable *
+contact_index_new (void)
 {
-	GArray *array;
-	ContactSource *source;
-	GPtrArray *contacts;
-	gint source_index;
-	gint i;
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
 
-	g_return_val_if_fail (find_uid != NULL, -1);
+static void
+contact_index_set (GHashTable *contacts_index,
+                   EContact *contact,
+                   guint index)
+{
+	const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
 
-	source_index = find_contact_source_by_view (contact_store, find_view);
-	if (source_index < 0)
+	if (uid)
+		g_hash_table_replace (contacts_index, g_strdup (uid), GUINT_TO_POINTER (index + 1));
+}
+
+static gint
+contact_index_lookup (GHashTable *contacts_index,
+                      const gchar *uid)
+{
+	gpointer value;
+
+	if (!uid)
 		return -1;
 
-	array = contact_store->priv->contact_sources;
-	source = &g_array_index (array, ContactSource, source_index);
+	value = g_hash_table_lookup (contacts_index, uid);
 
-	if (find_view == source->client_view)
-		contacts = source->contacts;          /* Current view */
-	else
-		contacts = source->contacts_pending;  /* Pending view */
+	return value ? GPOINTER_TO_INT (value) - 1 : -1;
+}
 
-	for (i = 0; i < contacts->len; i++) {
-		EContact    *contact = g_ptr_array_index (contacts, i);
-		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+/* Forgets the UID of the contact at 'index', thus it is not found
+ * anymore; the contact itself is removed later by remove_contacts(). */
+static void
+forget_contact_at (GPtrArray *contacts,
+                   GHashTable *contacts_index,
+                   gint index)
+{
+	EContact *contact = g_ptr_array_index (contacts, index);
+	const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
 
-		if (uid && !strcmp (find_uid, uid))
-			return i;
-	}
+	if (contact_index_lookup (contacts_index, uid) == index)
+		g_hash_table_remove (contacts_index, uid);
+}
 
-	return -1;
+static gint
+sort_descending (gconstpointer ca,
+                 gconstpointer cb)
+{
+	gint a = *((gint *) ca);
+	gint b = *((gint *) cb);
+
+	return (a == b) ? 0 : (a < b) ? 1 : -1;
 }
 
-static GHashTable *
-get_contact_hash (EContactStore *contact_store,
-                  EBookClientView *find_view)
+/* Removes the contacts at 'indices', passed to forget_contact_at() before.
+ * The array is compacted and the moved contacts reindexed in one pass, from
+ * the lowest removed index up. With 'emit' set, the rows are then announced
+ * as deleted from the highest index down, thus each path is still valid
+ * when its signal is emitted. */
+static void
+remove_contacts (EContactStore *contact_store,
+                 GPtrArray *contacts,
+                 GHashTable *contacts_index,
+                 GArray *indices,
+                 gboolean emit,
+                 gint offset)
 {
-	GArray *array;
-	ContactSource *source;
-	GPtrArray *contacts;
-	gint source_index;
-	gint ii;
-	GHashTable *hash;
+	GPtrArray *removed;
+	guint ii, jj;
 
-	source_index = find_contact_source_by_view (contact_store, find_view);
-	if (source_index < 0)
-		return NULL;
+	if (indices->len == 0)
+		return;
 
-	array = contact_store->priv->contact_sources;
-	source = &g_array_index (array, ContactSource, source_index);
+	g_array_sort (indices, sort_descending);
+
+	removed = g_ptr_array_sized_new (indices->len);
 
-	if (find_view == source->client_view)
-		contacts = source->contacts;          /* Current view */
-	else
-		contacts = source->contacts_pending;  /* Pending view */
+	for (ii = 0; ii < indices->len; ii++) {
+		gint index = g_array_index (indices, gint, ii);
 
-	hash = g_hash_table_new (g_str_hash, g_str_equal);
+		g_ptr_array_add (removed, g_ptr_array_index (contacts, index));
+		contacts->pdata[index] = NULL;
+	}
 
-	for (ii = 0; ii < contacts->len; ii++) {
+	for (ii = jj = g_array_index (indices, gint, indices->len - 1); ii < contacts->len; ii++) {
 		EContact *contact = g_ptr_array_index (contacts, ii);
-		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
 
-		if (uid)
-			g_hash_table_insert (hash, (gpointer) uid, GINT_TO_POINTER (ii));
+		if (!contact)
+			continue;
+
+		if (ii != jj) {
+			contacts->pdata[jj] = contact;
+			contact_index_set (contacts_index, contact, jj);
+		}
+
+		jj++;
 	}
 
-	return hash;
+	g_ptr_array_set_size (contacts, jj);
+
+	if (emit) {
+		for (ii = 0; ii < indices->len; ii++)
+			row_deleted (contact_store, offset + g_array_index (indices, gint, ii));
+	}
+
+	g_ptr_array_foreach (removed, (GFunc) g_object_unref, NULL);
+	g_ptr_array_unref (removed);
 }
 
 static gint
@@ -506,13 +548,9 @@ find_contact_by_uid (EContactStore *contact_store,
 		ContactSource *source = &g_array_index (array, ContactSource, i);
 		gint           j;
 
-		for (j = 0; j < source->contacts->len; j++) {
-			EContact    *contact = g_ptr_array_index (source->contacts, j);
-			const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
-
-			if (!strcmp (find_uid, uid))
-				return get_contact_source_offset (contact_store, i) + j;
-		}
+		j = contact_index_lookup (source->contacts_index, find_uid);
+		if (j >= 0)
+			return get_contact_source_offset (contact_store, i) + j;
 	}
 
 	return -1;
@@ -604,10 +642,12 @@ view_contacts_added (EContactStore *contact_store,
 
 		if (client_view == source->client_view) {
 			/* Current view */
+			contact_index_set (source->contacts_index, contact, source->contacts->len);
 			g_ptr_array_add (source->contacts, contact);
 			row_inserted (contact_store, offset + source->contacts->len - 1);
 		} else {
 			/* Pending view */
+			contact_index_set (source->contacts_pending_index, contact, source->contacts_pending->len);
 			g_ptr_array_add (source->contacts_pending, contact);
 		}
 	}
@@ -619,6 +659,9 @@ view_contacts_removed (EContactStore *contact_store,
                        EBookClientView *client_view)
 {
 	ContactSource *source;
+	GPtrArray     *cached_contacts;
+	GHashTable    *cached_index;
+	GArray        *indices;
 	gint           offset;
 	const GSList  *l;
 
@@ -627,29 +670,35 @@ view_contacts_removed (EContactStore *contact_store,
 		return;
 	}
 
+	if (client_view == source->client_view) {
+		cached_contacts = source->contacts;
+		cached_index = source->contacts_index;
+	} else {
+		cached_contacts = source->contacts_pending;
+		cached_index = source->contacts_pending_index;
+	}
+
+	indices = g_array_new (FALSE, FALSE, sizeof (gint));
+
 	for (l = uids; l; l = g_slist_next (l)) {
 		const gchar *uid = l->data;
-		gint         n = find_contact_by_view_and_uid (contact_store, client_view, uid);
-		EContact    *contact;
+		gint         n = contact_index_lookup (cached_index, uid);
 
 		if (n < 0) {
 			g_warning ("EContactStore got 'contacts_removed' on unknown contact!");
 			continue;
 		}
 
-		if (client_view == source->client_view) {
-			/* Current view */
-			contact = g_ptr_array_index (source->contacts, n);
-			g_object_unref (contact);
-			g_ptr_array_remove_index (source->contacts, n);
-			row_deleted (contact_store, offset + n);
-		} else {
-			/* Pending view */
-			contact = g_ptr_array_index (source->contacts_pending, n);
-			g_object_unref (contact);
-			g_ptr_array_remove_index (source->contacts_pending, n);
-		}
+		forget_contact_at (cached_contacts, cached_index, n);
+		g_array_append_val (indices, n);
 	}
+
+	/* Emit changes for current view only */
+	remove_contacts (
+		contact_store, cached_contacts, cached_index, indices,
+		client_view == source->client_view, offset);
+
+	g_array_free (indices, TRUE);
 }
 
 static void
@@ -658,6 +707,7 @@ view_contacts_modified (EContactStore *contact_store,
                         EBookClientView *client_view)
 {
 	GPtrArray     *cached_contacts;
+	GHashTable    *cached_index;
 	ContactSource *source;
 	gint           offset;
 	const GSList  *l;
@@ -667,16 +717,19 @@ view_contacts_modified (EContactStore *contact_store,
 		return;
 	}
 
-	if (client_view == source->client_view)
+	if (client_view == source->client_view) {
 		cached_contacts = source->contacts;
-	else
+		cached_index = source->contacts_index;
+	} else {
 		cached_contacts = source->contacts_pending;
+		cached_index = source->contacts_pending_index;
+	}
 
 	for (l = contacts; l; l = g_slist_next (l)) {
 		EContact    *cached_contact;
 		EContact    *contact = l->data;
 		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
-		gint         n = find_contact_by_view_and_uid (contact_store, client_view, uid);
+		gint         n = contact_index_lookup (cached_index, uid);
 
 		if (n < 0) {
 			g_warning ("EContactStore got change notification on unknown contact!");
@@ -703,9 +756,9 @@ view_complete (EContactStore *contact_store,
                EBookClientView *client_view)
 {
 	ContactSource *source;
+	GArray        *indices;
 	gint           offset;
 	gint           i;
-	GHashTable *hash;
 
 	if (!find_contact_source_details_by_view (contact_store, client_view, &source, &offset)) {
 		g_warning ("EContactStore got 'complete' signal from unknown EBookClientView!");
@@ -726,29 +779,30 @@ view_complete (EContactStore *contact_store,
 	g_signal_emit (contact_store, signals[START_UPDATE], 0, client_view);
 
 	/* Deletions */
-	hash = get_contact_hash (contact_store, source->client_view_pending);
+	indices = g_array_new (FALSE, FALSE, sizeof (gint));
 	for (i = 0; i < source->contacts->len; i++) {
 		EContact    *old_contact = g_ptr_array_index (source->contacts, i);
 		const gchar *old_uid = e_contact_get_const (old_contact, E_CONTACT_UID);
 
-		if (!g_hash_table_contains (hash, old_uid)) {
+		if (contact_index_lookup (source->contacts_pending_index, old_uid) < 0) {
 			/* Contact is not in new view; removed */
-			g_object_unref (old_contact);
-			g_ptr_array_remove_index (source->contacts, i);
-			row_deleted (contact_store, offset + i);
-			i--;  /* Stay in place */
+			forget_contact_at (source->contacts, source->contacts_index, i);
+			g_array_append_val (indices, i);
 		}
 	}
-	g_hash_table_unref (hash);
+
+	remove_contacts (contact_store, source->contacts, source->contacts_index, indices, TRUE, offset);
+
+	g_array_free (indices, TRUE);
 
 	/* Insertions */
-	hash = get_contact_hash (contact_store, source->client_view);
 	for (i = 0; i < source->contacts_pending->len; i++) {
 		EContact    *new_contact = g_ptr_array_index (source->contacts_pending, i);
 		const gchar *new_uid = e_contact_get_const (new_contact, E_CONTACT_UID);
 
-		if (!g_hash_table_contains (hash, new_uid)) {
+		if (contact_index_lookup (source->contacts_index, new_uid) < 0) {
 			/* Contact is not in old view; inserted */
+			contact_index_set (source->contacts_index, new_contact, source->contacts->len);
 			g_ptr_array_add (source->contacts, new_contact);
 			row_inserted (contact_store, offset + source->contacts->len - 1);
 		} else {
@@ -756,7 +810,6 @@ view_complete (EContactStore *contact_store,
 			g_object_unref (new_contact);
 		}
 	}
-	g_hash_table_unref (hash);
 
 	g_signal_emit (contact_store, signals[STOP_UPDATE], 0, client_view);
 
@@ -769,6 +822,8 @@ view_complete (EContactStore *contact_store,
 	/* Free array of pending contacts (members have been either moved or unreffed) */
 	g_ptr_array_free (source->contacts_pending, TRUE);
 	source->contacts_pending = NULL;
+	g_hash_table_destroy (source->contacts_pending_index);
+	source->contacts_pending_index = NULL;
 }
 
 /* --------------------- *
@@ -847,6 +902,20 @@ free_contact_ptrarray (GPtrArray *contacts)
 	g_ptr_array_free (contacts, TRUE);
 }
 
+static void
+free_contact_source_pending (ContactSource *source)
+{
+	if (source->contacts_pending) {
+		free_contact_ptrarray (source->contacts_pending);
+		source->contacts_pending = NULL;
+	}
+
+	if (source->contacts_pending_index) {
+		g_hash_table_destroy (source->contacts_pending_index);
+		source->contacts_pending_index = NULL;
+	}
+}
+
 static void
 clear_contact_source (EContactStore *contact_store,
                       ContactSource *source)
@@ -880,6 +949,7 @@ clear_contact_source (EContactStore *contact_store,
 		}
 
 		gtk_tree_path_free (path);
+		g_hash_table_remove_all (source->contacts_index);
 		g_signal_emit (contact_store, signals[STOP_UPDATE], 0, source->client_view);
 	}
 
@@ -895,10 +965,9 @@ clear_contact_source (EContactStore *contact_store,
 	if (source->client_view_pending) {
 		stop_view (contact_store, source->client_view_pending);
 		g_object_unref (source->client_view_pending);
-		free_contact_ptrarray (source->contacts_pending);
+		free_contact_source_pending (source);
 
 		source->client_view_pending = NULL;
-		source->contacts_pending = NULL;
 	}
 }
 
@@ -931,16 +1000,16 @@ client_view_ready_cb (GObject *source_object,
 			if (source->client_view_pending) {
 				stop_view (contact_store, source->client_view_pending);
 				g_object_unref (source->client_view_pending);
-				free_contact_ptrarray (source->contacts_pending);
 			}
 
+			free_contact_source_pending (source);
+
 			source->client_view_pending = client_view;
 
 			if (source->client_view_pending) {
 				source->contacts_pending = g_ptr_array_new ();
+				source->contacts_pending_index = contact_index_new ();
 				start_view (contact_store, client_view);
-			} else {
-				source->contacts_pending = NULL;
 			}
 		} else {
 			source->client_view = client_view;
@@ -971,9 +1040,8 @@ query_contact_source (EContactStore *contact_store,
 		if (source->client_view_pending) {
 			stop_view (contact_store, source->client_view_pending);
 			g_object_unref (source->client_view_pending);
-			free_contact_ptrarray (source->contacts_pending);
+			free_contact_source_pending (source);
 			source->client_view_pending = NULL;
-			source->contacts_pending = NULL;
 		}
 	}
 
@@ -1125,6 +1193,7 @@ e_contact_store_add_client (EContactStore *contact_store,
 	memset (&source, 0, sizeof (ContactSource));
 	source.book_client = g_object_ref (book_client);
 	source.contacts = g_ptr_array_new ();
+	source.contacts_index = contact_index_new ();
 	g_array_append_val (array, source);
 
 	indexed_source = &g_array_index (array, ContactSource, array->len - 1);
@@ -1164,6 +1233,7 @@ e_contact_store_remove_client (EContactStore *contact_store,
 	source = &g_array_index (array, ContactSource, source_index);
 	clear_contact_source (contact_store, source);
 	free_contact_ptrarray (source->contacts);
+	g_hash_table_destroy (source->contacts_index);
 	g_object_unref (book_client);
 
 	g_array_remove_index (array, source_index);  /* Preserve order */
@@ -68,9 +68,54 @@ static gint special_chars[] = {
 #define is_trailing_garbage(c) (c > 127 || (special_chars[c] & 2))
 #define is_domain_name_char(c) (c < 128 && (special_chars[c] & 4))
 
+/* Characters e_text_to_html_full() cannot copy verbatim to the output,
+ * or can only depending on the flags; anything else (and any character
+ * with the flag-dependent bits masked out) is copied in runs.
+ *
+ *  1 = always: nul, control chars, line breaks and chars to be escaped
+ *  2 = space, with E_TEXT_TO_HTML_CONVERT_SPACES or _CONVERT_ALL_SPACES
+ *  4 = tab, with the above or E_TEXT_TO_HTML_CONVERT_NL
+ *  8 = '@', with E_TEXT_TO_HTML_CONVERT_ADDRESSES
+ * 16 = first letter of a URL prefix, with E_TEXT_TO_HTML_CONVERT_URLS
+ */
+#define TEXT_CHAR_SPECIAL	1
+#define TEXT_CHAR_SPACE		2
+#define TEXT_CHAR_TAB		4
+#define TEXT_CHAR_AT		8
+#define TEXT_CHAR_URL_START	16
+
+static const guchar text_chars[] = {
+	 1,  1,  1,  1,  1,  1,  1,  1,  1,  4,  1,  1,  1,  0,  1,  1,    /*  nul - 0x0f */
+	 1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,    /* 0x10 - 0x1f */
+	 2,  0,  1,  0,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,    /*   sp - /    */
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  0,  1,  0,    /*    0 - ?    */
+	 8,  0,  0, 16,  0,  0, 16,  0, 16,  0,  0,  0,  0, 16, 16,  0,    /*    @ - O    */
+	 0,  0,  0, 16, 16,  0,  0, 16,  0,  0,  0,  0,  0,  0,  0,  0,    /*    P - _    */
+	 0,  0,  0, 16,  0,  0, 16,  0, 16,  0,  0,  0,  0, 16, 16,  0,    /*    ` - o    */
+	 0,  0,  0, 16, 16,  0,  0, 16,  0,  0,  0,  0,  0,  0,  0,  0     /*    p - del  */
+};
+
 /* (http|https|ftp|nntp)://[^ "|/]+\.([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+ */
 /* www\.[A-Za-z0-9.-]+(/([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+)             */
 
+/* Every URL prefix recognized by e_text_to_html_full() has a ':' within
+ * its first seven characters, or is "www.", thus this is a cheap way to rule
+ * out most of the words starting with the same letters. */
+static gboolean
+can_start_url (const guchar *text)
+{
+	gint ii;
+
+	for (ii = 1; ii < 7 && text[ii]; ii++) {
+		if (ii >= 3 && text[ii] == ':')
+			return TRUE;
+		if (ii == 3 && text[ii] == '.')
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 static gchar *
 url_extract (const guchar **text,
              gboolean full_url,
@@ -246,6 +291,7 @@ e_text_to_html_full (const gchar *input,
 	gchar *out = NULL;
 	gint buffer_size = 0, col;
 	gboolean colored = FALSE, saw_citation = FALSE;
+	guchar stop_mask = TEXT_CHAR_SPECIAL;
 
 	/* Allocate a translation buffer.  */
 	buffer_size = strlen (input) * 2 + 5;
@@ -255,6 +301,15 @@ e_text_to_html_full (const gchar *input,
 	if (flags & E_TEXT_TO_HTML_PRE)
 		out += sprintf (out, "<PRE>");
 
+	if (flags & (E_TEXT_TO_HTML_CONVERT_SPACES | E_TEXT_TO_HTML_CONVERT_ALL_SPACES))
+		stop_mask |= TEXT_CHAR_SPACE | TEXT_CHAR_TAB;
+	if (flags & E_TEXT_TO_HTML_CONVERT_NL)
+		stop_mask |= TEXT_CHAR_TAB;
+	if (flags & E_TEXT_TO_HTML_CONVERT_ADDRESSES)
+		stop_mask |= TEXT_CHAR_AT;
+	if (flags & E_TEXT_TO_HTML_CONVERT_URLS)
+		stop_mask |= TEXT_CHAR_URL_START;
+
 	col = 0;
 
 	for (cur = linestart = (const guchar *) input; cur && *cur; cur = next) {
@@ -288,6 +343,23 @@ e_text_to_html_full (const gchar *input,
 			out += sprintf (out, "&gt; ");
 		}
 
+		/* Copy everything up to the next character which needs
+		 * a closer look in one go; it would be copied as is below. */
+		for (next = cur; *next < 128; next++) {
+			guchar what = text_chars[*next] & stop_mask;
+
+			if (what && (what != TEXT_CHAR_URL_START || can_start_url (next)))
+				break;
+		}
+
+		if (next > cur) {
+			out = check_size (&buffer, &buffer_size, out, next - cur);
+			memcpy (out, cur, next - cur);
+			out += next - cur;
+			col += next - cur;
+			continue;
+		}
+
 		u = g_utf8_get_char ((gchar *) cur);
 		if (g_unichar_isalpha (u) &&
 		    (flags & E_TEXT_TO_HTML_CONVERT_URLS)) {
@@ -67,9 +67,36 @@ struct _ENameSelectorEntryPrivate {
 
 	GHashTable *known_contacts; /* gchar * ~> 1 */
 
+	/* Completion index over the contact_store rows */
+	GPtrArray *completion_records; /* CompletionRecord *, one per row */
+	GArray *completion_index; /* CompletionIndexEntry, sorted by key */
+	gboolean completion_index_valid;
+	gchar *completion_cue; /* normalized cue of the last lookup */
+	guint completion_range_start;
+	guint completion_range_end;
+
 	gboolean block_entry_changed_signal;
 };
 
+/* Normalized values of one contact, which can be completed */
+typedef struct _CompletionKey {
+	gchar *key;
+	gint field_rank;
+	gint email_num;
+} CompletionKey;
+
+typedef struct _CompletionRecord {
+	CompletionKey *keys;
+	guint n_keys;
+} CompletionRecord;
+
+typedef struct _CompletionIndexEntry {
+	const gchar *key; /* owned by the CompletionRecord */
+	guint row;
+	gint field_rank;
+	gint email_num;
+} CompletionIndexEntry;
+
 enum {
 	PROP_0,
 	PROP_CLIENT_CACHE,
@@ -210,6 +237,7 @@ name_selector_entry_dispose (GObject *object)
 	}
 
 	if (priv->contact_store) {
+		g_signal_handlers_disconnect_by_data (priv->contact_store, object);
 		g_object_unref (priv->contact_store);
 		priv->contact_store = NULL;
 	}
@@ -219,6 +247,19 @@ name_selector_entry_dispose (GObject *object)
 		priv->known_contacts = NULL;
 	}
 
+	if (priv->completion_records) {
+		g_ptr_array_unref (priv->completion_records);
+		priv->completion_records = NULL;
+	}
+
+	if (priv->completion_index) {
+		g_array_unref (priv->completion_index);
+		priv->completion_index = NULL;
+	}
+
+	g_free (priv->completion_cue);
+	priv->completion_cue = NULL;
+
 	g_slist_foreach (priv->user_query_fields, (GFunc) g_free, NULL);
 	g_slist_free (priv->user_query_fields);
 	priv->user_query_fields = NULL;
@@ -890,23 +931,6 @@ get_entry_substring (ENameSelectorEntry *name_selector_entry,
 	return g_strndup (p0, p1 - p0);
 }
 
-static gint
-utf8_casefold_collate_len (const gchar *str1,
-                           const gchar *str2,
-                           gint len)
-{
-	gchar *s1 = g_utf8_casefold (str1, len);
-	gchar *s2 = g_utf8_casefold (str2, len);
-	gint rv;
-
-	rv = g_utf8_collate (s1, s2);
-
-	g_free (s1);
-	g_free (s2);
-
-	return rv;
-}
-
 static gchar *
 build_textrep_for_contact (EContact *contact,
                            EContactField cue_field,
@@ -955,81 +979,292 @@ build_textrep_for_contact (EContact *contact,
 	return textrep;
 }
 
-static gboolean
-contact_match_cue (ENameSelectorEntry *name_selector_entry,
-                   EContact *contact,
-                   const gchar *cue_str,
-                   EContactField *matched_field,
-                   gint *matched_field_rank,
-                   gint *matched_email_num)
+/* Sanitized, normalized and case-folded value, as stored in the completion index */
+static gchar *
+completion_normalize (const gchar *value,
+                      gboolean sanitize)
 {
-	EContactField  fields[] = { E_CONTACT_FULL_NAME, E_CONTACT_NICKNAME, E_CONTACT_FILE_AS,
-				    E_CONTACT_EMAIL };
-	gchar         *email;
-	gboolean       result = FALSE;
-	gint           cue_len;
-	gint           i;
+	gchar *sane, *normalized, *folded;
 
-	g_return_val_if_fail (contact, FALSE);
-	g_return_val_if_fail (cue_str, FALSE);
+	if (!value || !*value)
+		return NULL;
 
-	if (g_utf8_strlen (cue_str, -1) < name_selector_entry->priv->minimum_query_length)
-		return FALSE;
+	sane = sanitize ? sanitize_string (value) : NULL;
+	normalized = g_utf8_normalize (sane ? sane : value, -1, G_NORMALIZE_DEFAULT);
+	g_free (sane);
+
+	if (!normalized)
+		return NULL;
+
+	folded = g_utf8_casefold (normalized, -1);
+	g_free (normalized);
+
+	return folded;
+}
+
+static void
+completion_record_free (gpointer ptr)
+{
+	CompletionRecord *record = ptr;
+	guint ii;
+
+	/* NULL is stored for contacts which cannot be completed */
+	if (!record)
+		return;
+
+	for (ii = 0; ii < record->n_keys; ii++)
+		g_free (record->keys[ii].key);
 
-	cue_len = strlen (cue_str);
+	g_free (record->keys);
+	g_slice_free (CompletionRecord, record);
+}
+
+static CompletionRecord *
+completion_record_new (EContact *contact)
+{
+	EContactField fields[] = { E_CONTACT_FULL_NAME, E_CONTACT_NICKNAME, E_CONTACT_FILE_AS,
+				   E_CONTACT_EMAIL };
+	CompletionRecord *record;
+	GArray *keys;
+	gchar *email;
+	gint ii;
+
+	if (!contact)
+		return NULL;
 
 	/* Make sure contact has an email address */
 	email = e_contact_get (contact, E_CONTACT_EMAIL_1);
 	if (!email || !*email) {
 		g_free (email);
-		return FALSE;
+		return NULL;
 	}
 	g_free (email);
 
-	for (i = 0; i < G_N_ELEMENTS (fields) && result == FALSE; i++) {
-		gint   email_num;
-		gchar *value;
-		gchar *value_sane;
-		GList *emails = NULL, *ll = NULL;
+	keys = g_array_new (FALSE, FALSE, sizeof (CompletionKey));
 
-		/* Don't match e-mail addresses in contact lists */
-		if (e_contact_get (contact, E_CONTACT_IS_LIST) &&
-		    fields[i] == E_CONTACT_EMAIL)
-			continue;
+	for (ii = 0; ii < G_N_ELEMENTS (fields); ii++) {
+		GList *values, *link;
+		gint email_num;
+
+		if (fields[ii] == E_CONTACT_EMAIL) {
+			/* Don't match e-mail addresses in contact lists */
+			if (e_contact_get (contact, E_CONTACT_IS_LIST))
+				continue;
 
-		if (fields[i] == E_CONTACT_EMAIL) {
-			emails = e_contact_get (contact, fields[i]);
+			values = e_contact_get (contact, fields[ii]);
 		} else {
-			value = e_contact_get (contact, fields[i]);
+			gchar *value = e_contact_get (contact, fields[ii]);
+
 			if (!value)
 				continue;
-			emails = g_list_append (emails, value);
+
+			values = g_list_append (NULL, value);
+		}
+
+		for (link = values, email_num = 0; link; link = g_list_next (link), email_num++) {
+			CompletionKey key;
+
+			key.key = completion_normalize (link->data, TRUE);
+			if (!key.key)
+				continue;
+
+			key.field_rank = ii;
+			key.email_num = email_num;
+
+			g_array_append_val (keys, key);
 		}
 
-		for (ll = emails, email_num = 0; ll; ll = ll->next, email_num++) {
-			value = ll->data;
-			value_sane = sanitize_string (value);
+		g_list_free_full (values, g_free);
+	}
 
-			ENS_DEBUG (g_print ("Comparing '%s' to '%s'\n", value, cue_str));
+	record = g_slice_new (CompletionRecord);
+	record->n_keys = keys->len;
+	record->keys = (CompletionKey *) g_array_free (keys, FALSE);
 
-			if (!utf8_casefold_collate_len (value_sane, cue_str, cue_len)) {
-				if (matched_field)
-					*matched_field = fields[i];
-				if (matched_field_rank)
-					*matched_field_rank = i;
-				if (matched_email_num)
-					*matched_email_num = email_num;
+	return record;
+}
 
-				result = TRUE;
-				g_free (value_sane);
-				break;
-			}
-			g_free (value_sane);
+static void
+completion_index_invalidate (ENameSelectorEntry *name_selector_entry)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+
+	priv->completion_index_valid = FALSE;
+
+	g_free (priv->completion_cue);
+	priv->completion_cue = NULL;
+}
+
+static gint
+completion_index_entry_compare (gconstpointer ptr1,
+                                gconstpointer ptr2)
+{
+	const CompletionIndexEntry *entry1 = ptr1, *entry2 = ptr2;
+
+	return strcmp (entry1->key, entry2->key);
+}
+
+static void
+completion_index_ensure (ENameSelectorEntry *name_selector_entry)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+	guint row, ii;
+
+	if (priv->completion_index_valid)
+		return;
+
+	g_array_set_size (priv->completion_index, 0);
+
+	for (row = 0; row < priv->completion_records->len; row++) {
+		CompletionRecord *record = g_ptr_array_index (priv->completion_records, row);
+
+		if (!record)
+			continue;
+
+		for (ii = 0; ii < record->n_keys; ii++) {
+			CompletionIndexEntry entry;
+
+			entry.key = record->keys[ii].key;
+			entry.row = row;
+			entry.field_rank = record->keys[ii].field_rank;
+			entry.email_num = record->keys[ii].email_num;
+
+			g_array_append_val (priv->completion_index, entry);
 		}
-		g_list_free_full (emails, g_free);
 	}
 
-	return result;
+	g_array_sort (priv->completion_index, completion_index_entry_compare);
+
+	priv->completion_index_valid = TRUE;
+}
+
+/* Narrows the range of index entries, which start with the cue. The search
+ * continues from the range of the previous lookup when the cue only grew. */
+static void
+completion_index_lookup (ENameSelectorEntry *name_selector_entry,
+                         const gchar *cue,
+                         guint *out_start,
+                         guint *out_end)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+	CompletionIndexEntry *entries;
+	gsize cue_len = strlen (cue);
+	guint lo, hi, start, end;
+
+	completion_index_ensure (name_selector_entry);
+
+	if (priv->completion_cue && g_str_has_prefix (cue, priv->completion_cue)) {
+		lo = priv->completion_range_start;
+		end = priv->completion_range_end;
+	} else {
+		lo = 0;
+		end = priv->completion_index->len;
+	}
+
+	hi = end;
+
+	entries = (CompletionIndexEntry *) (gpointer) priv->completion_index->data;
+
+	/* First entry not sorting before the cue */
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (strcmp (entries[mid].key, cue) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	start = lo;
+	hi = end;
+
+	/* First entry past those starting with the cue */
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (strncmp (entries[mid].key, cue, cue_len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	g_free (priv->completion_cue);
+	priv->completion_cue = g_strdup (cue);
+	priv->completion_range_start = start;
+	priv->completion_range_end = lo;
+
+	*out_start = start;
+	*out_end = lo;
+}
+
+static void
+completion_records_row_inserted (ENameSelectorEntry *name_selector_entry,
+                                 GtkTreePath *path,
+                                 GtkTreeIter *iter,
+                                 EContactStore *contact_store)
+{
+	GPtrArray *records = name_selector_entry->priv->completion_records;
+	gint row = gtk_tree_path_get_indices (path)[0];
+
+	g_return_if_fail (row >= 0 && row <= records->len);
+
+	g_ptr_array_insert (records, row, completion_record_new (e_contact_store_get_contact (contact_store, iter)));
+	completion_index_invalidate (name_selector_entry);
+}
+
+static void
+completion_records_row_changed (ENameSelectorEntry *name_selector_entry,
+                                GtkTreePath *path,
+                                GtkTreeIter *iter,
+                                EContactStore *contact_store)
+{
+	GPtrArray *records = name_selector_entry->priv->completion_records;
+	gint row = gtk_tree_path_get_indices (path)[0];
+
+	g_return_if_fail (row >= 0 && row < records->len);
+
+	completion_record_free (records->pdata[row]);
+	records->pdata[row] = completion_record_new (e_contact_store_get_contact (contact_store, iter));
+	completion_index_invalidate (name_selector_entry);
+}
+
+static void
+completion_records_row_deleted (ENameSelectorEntry *name_selector_entry,
+                                GtkTreePath *path,
+                                EContactStore *contact_store)
+{
+	GPtrArray *records = name_selector_entry->priv->completion_records;
+	gint row = gtk_tree_path_get_indices (path)[0];
+
+	g_return_if_fail (row >= 0 && row < records->len);
+
+	g_ptr_array_remove_index (records, row);
+	completion_index_invalidate (name_selector_entry);
+}
+
+static void
+completion_records_fill (ENameSelectorEntry *name_selector_entry)
+{
+	ENameSelectorEntryPrivate *priv = name_selector_entry->priv;
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+
+	g_ptr_array_set_size (priv->completion_records, 0);
+	completion_index_invalidate (name_selector_entry);
+
+	if (!priv->contact_store)
+		return;
+
+	model = GTK_TREE_MODEL (priv->contact_store);
+
+	if (!gtk_tree_model_get_iter_first (model, &iter))
+		return;
+
+	do {
+		g_ptr_array_add (
+			priv->completion_records,
+			completion_record_new (e_contact_store_get_contact (priv->contact_store, &iter)));
+	} while (gtk_tree_model_iter_next (model, &iter));
 }
 
 static gboolean
@@ -1041,58 +1276,66 @@ find_existing_completion (ENameSelectorEntry *name_selector_entry,
                           gint *matched_email_num,
                           EBookClient **book_client)
 {
+	EContactField  fields[] = { E_CONTACT_FULL_NAME, E_CONTACT_NICKNAME, E_CONTACT_FILE_AS,
+				    E_CONTACT_EMAIL };
 	GtkTreeIter    iter;
-	EContact      *best_contact = NULL;
-	gint           best_field_rank = G_MAXINT;
-	EContactField  best_field = 0;
-	gint           best_email_num = -1;
-	EBookClient   *best_book_client = NULL;
+	const CompletionIndexEntry *best = NULL;
+	EContact      *best_contact;
+	EContactField  best_field;
+	gchar         *cue;
+	guint          start, end, ii;
 
 	g_return_val_if_fail (cue_str, FALSE);
 
 	if (!name_selector_entry->priv->contact_store)
 		return FALSE;
 
+	if (g_utf8_strlen (cue_str, -1) < name_selector_entry->priv->minimum_query_length)
+		return FALSE;
+
 	ENS_DEBUG (g_print ("Completing '%s'\n", cue_str));
 
-	if (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (name_selector_entry->priv->contact_store), &iter))
+	cue = completion_normalize (cue_str, FALSE);
+	if (!cue)
 		return FALSE;
 
-	do {
-		EContact      *current_contact;
-		gint           current_field_rank = best_field_rank;
-		gint           current_email_num = best_email_num;
-		EContactField  current_field = best_field;
-		gboolean       matches;
-
-		current_contact = e_contact_store_get_contact (name_selector_entry->priv->contact_store, &iter);
-		if (!current_contact)
-			continue;
+	completion_index_lookup (name_selector_entry, cue, &start, &end);
+	g_free (cue);
 
-		matches = contact_match_cue (name_selector_entry, current_contact, cue_str, &current_field, &current_field_rank, &current_email_num);
-		if (matches && current_field_rank < best_field_rank) {
-			best_contact = current_contact;
-			best_field_rank = current_field_rank;
-			best_field = current_field;
-			best_book_client = e_contact_store_get_client (name_selector_entry->priv->contact_store, &iter);
-			best_email_num = current_email_num;
-		}
+	/* The best field, then the first row and the first address */
+	for (ii = start; ii < end; ii++) {
+		const CompletionIndexEntry *entry;
+
+		entry = &g_array_index (name_selector_entry->priv->completion_index, CompletionIndexEntry, ii);
+
+		if (!best || entry->field_rank < best->field_rank ||
+		    (entry->field_rank == best->field_rank && (entry->row < best->row ||
+		    (entry->row == best->row && entry->email_num < best->email_num))))
+			best = entry;
+	}
 
-	} while (gtk_tree_model_iter_next (GTK_TREE_MODEL (name_selector_entry->priv->contact_store), &iter));
+	if (!best)
+		return FALSE;
 
+	if (!gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (name_selector_entry->priv->contact_store), &iter, NULL, best->row))
+		return FALSE;
+
+	best_contact = e_contact_store_get_contact (name_selector_entry->priv->contact_store, &iter);
 	if (!best_contact)
 		return FALSE;
 
+	best_field = fields[best->field_rank];
+
 	if (contact)
 		*contact = best_contact;
 	if (text)
-		*text = build_textrep_for_contact (best_contact, best_field, best_email_num);
+		*text = build_textrep_for_contact (best_contact, best_field, best->email_num);
 	if (matched_field)
 		*matched_field = best_field;
 	if (book_client)
-		*book_client = best_book_client;
+		*book_client = e_contact_store_get_client (name_selector_entry->priv->contact_store, &iter);
 	if (matched_email_num)
-		*matched_email_num = best_email_num;
+		*matched_email_num = best->email_num;
 	return TRUE;
 }
 
@@ -2417,6 +2660,17 @@ setup_contact_store (ENameSelectorEntry *name_selector_entry)
 			GTK_TREE_MODEL (
 			name_selector_entry->priv->email_generator));
 
+		/* Keep the completion index in sync with the store */
+		g_signal_connect_swapped (
+			name_selector_entry->priv->contact_store, "row-inserted",
+			G_CALLBACK (completion_records_row_inserted), name_selector_entry);
+		g_signal_connect_swapped (
+			name_selector_entry->priv->contact_store, "row-changed",
+			G_CALLBACK (completion_records_row_changed), name_selector_entry);
+		g_signal_connect_swapped (
+			name_selector_entry->priv->contact_store, "row-deleted",
+			G_CALLBACK (completion_records_row_deleted), name_selector_entry);
+
 		/* Set up callback for incoming matches */
 		g_signal_connect_swapped (
 			name_selector_entry->priv->contact_store, "row-inserted",
@@ -2426,6 +2680,8 @@ setup_contact_store (ENameSelectorEntry *name_selector_entry)
 
 		gtk_entry_completion_set_model (name_selector_entry->priv->entry_completion, NULL);
 	}
+
+	completion_records_fill (name_selector_entry);
 }
 
 static void
@@ -3430,6 +3686,8 @@ e_name_selector_entry_init (ENameSelectorEntry *name_selector_entry)
 	name_selector_entry->priv->show_address = FALSE;
 	name_selector_entry->priv->block_entry_changed_signal = FALSE;
 	name_selector_entry->priv->known_contacts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	name_selector_entry->priv->completion_records = g_ptr_array_new_with_free_func (completion_record_free);
+	name_selector_entry->priv->completion_index = g_array_new (FALSE, FALSE, sizeof (CompletionIndexEntry));
 
 	/* Edit signals */
 
@@ -3717,8 +3975,10 @@ e_name_selector_entry_set_contact_store (ENameSelectorEntry *name_selector_entry
 	if (contact_store == name_selector_entry->priv->contact_store)
 		return;
 
-	if (name_selector_entry->priv->contact_store)
+	if (name_selector_entry->priv->contact_store) {
+		g_signal_handlers_disconnect_by_data (name_selector_entry->priv->contact_store, name_selector_entry);
 		g_object_unref (name_selector_entry->priv->contact_store);
+	}
 	name_selector_entry->priv->contact_store = contact_store;
 	if (name_selector_entry->priv->contact_store)
 		g_object_ref (name_selector_entry->priv->contact_store);
@@ -24,12 +24,16 @@
  *
  * A limited internal cache is employed to speed up frequently searched
  * email addresses.  The exact caching semantics are private and subject
- * to change.
+ * to change.  The cache can be backed by a directory on disk, see
+ * e_photo_cache_set_cache_directory(), so that the photos survive
+ * a restart of the application.
  **/
 
 #include "e-photo-cache.h"
 
+#include <errno.h>
 #include <string.h>
+#include <glib/gstdio.h>
 #include <libebackend/libebackend.h>
 
 #include <e-util/e-data-capture.h>
@@ -42,11 +46,25 @@
  * priority photo source, after which we settle for what we have. */
 #define ASYNC_TIMEOUT_SECONDS 3.0
 
-/* How many email addresses we track at once, regardless of whether
- * the email address has a photo.  As new cache entries are added, we
- * discard the least recently accessed entries to keep the cache size
+/* How many email addresses we track at once by default, regardless of
+ * whether the email address has a photo.  As new cache entries are added,
+ * we discard the least recently accessed entries to keep the cache size
  * within the limit. */
-#define MAX_CACHE_SIZE 20
+#define DEFAULT_MAX_ENTRIES 256
+
+/* How long (in seconds) to remember that an email address has no photo,
+ * after which the photo sources are asked again. */
+#define NEGATIVE_TTL_SECONDS (60 * 60)
+
+/* How long (in seconds) to trust a photo stored in the cache directory. */
+#define DISK_TTL_SECONDS (7 * 24 * 60 * 60)
+
+/* How many files the cache directory can hold.  The oldest files are
+ * deleted above this count, when the directory is pruned. */
+#define DISK_MAX_FILES 4096
+
+/* The cache directory is pruned after this many stored files. */
+#define DISK_PRUNE_INTERVAL 256
 
 #define ERROR_IS_CANCELLED(error) \
 	(g_error_matches ((error), G_IO_ERROR, G_IO_ERROR_CANCELLED))
@@ -54,6 +72,8 @@
 typedef struct _AsyncContext AsyncContext;
 typedef struct _AsyncSubtask AsyncSubtask;
 typedef struct _DataCaptureClosure DataCaptureClosure;
+typedef struct _DiskJob DiskJob;
+typedef struct _DiskLoadData DiskLoadData;
 typedef struct _PhotoData PhotoData;
 
 struct _EPhotoCachePrivate {
@@ -61,9 +81,15 @@ struct _EPhotoCachePrivate {
 	GMainContext *main_context;
 
 	GHashTable *photo_ht;
-	GQueue photo_ht_keys;
+	GQueue photo_ht_lru; /* PhotoData::lru_link, most recent first */
+	guint max_entries;
+	gchar *cache_directory;
+	guint n_disk_stores;
 	GMutex photo_ht_lock;
 
+	/* Writes into the cache directory, one at a time, in order. */
+	GThreadPool *disk_pool;
+
 	GHashTable *sources_ht;
 	GMutex sources_ht_lock;
 };
@@ -75,6 +101,7 @@ struct _AsyncContext {
 	GQueue results;
 	GInputStream *stream;
 	GConverter *data_capture;
+	gchar *email_address;
 
 	GCancellable *cancellable;
 	gulong cancelled_handler_id;
@@ -95,15 +122,41 @@ struct _DataCaptureClosure {
 	gchar *email_address;
 };
 
+typedef enum {
+	DISK_JOB_STORE,
+	DISK_JOB_REMOVE,
+	DISK_JOB_PRUNE
+} DiskJobKind;
+
+struct _DiskJob {
+	DiskJobKind kind;
+	gchar *path; /* a file, or the directory for DISK_JOB_PRUNE */
+	GBytes *bytes;
+};
+
+struct _DiskLoadData {
+	gchar *key;
+	GBytes *bytes;
+	gint64 expires;
+	gboolean found;
+};
+
 struct _PhotoData {
 	volatile gint ref_count;
 	GMutex lock;
 	GBytes *bytes;
+
+	/* These are guarded by EPhotoCachePrivate::photo_ht_lock. */
+	gchar *key;
+	GList lru_link;
+	gint64 expires; /* monotonic time, 0 means never */
 };
 
 enum {
 	PROP_0,
-	PROP_CLIENT_CACHE
+	PROP_CACHE_DIRECTORY,
+	PROP_CLIENT_CACHE,
+	PROP_MAX_ENTRIES
 };
 
 /* Forward Declarations */
@@ -276,6 +329,17 @@ async_subtask_complete (AsyncSubtask *async_subtask)
 		}
 
 		async_subtask_unref (async_subtask);
+	} else {
+		GObject *photo_cache;
+
+		/* No photo source has a photo; remember it for a while. */
+		photo_cache = g_async_result_get_source_object (G_ASYNC_RESULT (simple));
+		if (photo_cache != NULL) {
+			e_photo_cache_add_photo (
+				E_PHOTO_CACHE (photo_cache),
+				async_context->email_address, NULL);
+			g_object_unref (photo_cache);
+		}
 	}
 
 	g_simple_async_result_complete_in_idle (simple);
@@ -298,6 +362,7 @@ async_context_cancelled_cb (GCancellable *cancellable,
 
 static AsyncContext *
 async_context_new (EDataCapture *data_capture,
+                   const gchar *email_address,
                    GCancellable *cancellable)
 {
 	AsyncContext *async_context;
@@ -313,6 +378,7 @@ async_context_new (EDataCapture *data_capture,
 		(GDestroyNotify) NULL);
 
 	async_context->data_capture = g_object_ref (data_capture);
+	async_context->email_address = g_strdup (email_address);
 
 	if (G_IS_CANCELLABLE (cancellable)) {
 		gulong handler_id;
@@ -349,6 +415,8 @@ async_context_free (AsyncContext *async_context)
 	g_clear_object (&async_context->data_capture);
 	g_clear_object (&async_context->cancellable);
 
+	g_free (async_context->email_address);
+
 	g_slice_free (AsyncContext, async_context);
 }
 
@@ -419,6 +487,7 @@ photo_data_new (GBytes *bytes)
 
 	photo_data = g_slice_new0 (PhotoData);
 	photo_data->ref_count = 1;
+	photo_data->lru_link.data = photo_data;
 	g_mutex_init (&photo_data->lock);
 
 	if (bytes != NULL)
@@ -427,17 +496,6 @@ photo_data_new (GBytes *bytes)
 	return photo_data;
 }
 
-static PhotoData *
-photo_data_ref (PhotoData *photo_data)
-{
-	g_return_val_if_fail (photo_data != NULL, NULL);
-	g_return_val_if_fail (photo_data->ref_count > 0, NULL);
-
-	g_atomic_int_inc (&photo_data->ref_count);
-
-	return photo_data;
-}
-
 static void
 photo_data_unref (PhotoData *photo_data)
 {
@@ -448,6 +506,7 @@ photo_data_unref (PhotoData *photo_data)
 		g_mutex_clear (&photo_data->lock);
 		if (photo_data->bytes != NULL)
 			g_bytes_unref (photo_data->bytes);
+		g_free (photo_data->key);
 		g_slice_free (PhotoData, photo_data);
 	}
 }
@@ -487,105 +546,141 @@ photo_data_set_bytes (PhotoData *photo_data,
 static gchar *
 photo_ht_normalize_key (const gchar *email_address)
 {
-	gchar *lowercase_email_address;
-	gchar *collation_key;
+	const gchar *ptr;
+	gchar *normalized;
+	gchar *key;
+
+	/* Most addresses are plain ASCII, which only needs lowercasing. */
+	for (ptr = email_address; *ptr; ptr++) {
+		if ((guchar) *ptr >= 0x80)
+			break;
+	}
 
-	lowercase_email_address = g_utf8_strdown (email_address, -1);
-	collation_key = g_utf8_collate_key (lowercase_email_address, -1);
-	g_free (lowercase_email_address);
+	if (!*ptr)
+		return g_ascii_strdown (email_address, -1);
 
-	return collation_key;
+	normalized = g_utf8_normalize (email_address, -1, G_NORMALIZE_DEFAULT_COMPOSE);
+	if (normalized == NULL)
+		return g_ascii_strdown (email_address, -1);
+
+	key = g_utf8_casefold (normalized, -1);
+	g_free (normalized);
+
+	return key;
 }
 
+/* Call with the photo_ht_lock held. */
 static void
-photo_ht_insert (EPhotoCache *photo_cache,
-                 const gchar *email_address,
-                 GBytes *bytes)
+photo_ht_evict_locked (EPhotoCache *photo_cache,
+                       PhotoData *photo_data)
+{
+	g_queue_unlink (&photo_cache->priv->photo_ht_lru, &photo_data->lru_link);
+
+	/* This drops the last reference, the key belongs to photo_data. */
+	g_hash_table_remove (photo_cache->priv->photo_ht, photo_data->key);
+}
+
+/* Call with the photo_ht_lock held. */
+static void
+photo_ht_trim_locked (EPhotoCache *photo_cache)
+{
+	GQueue *photo_ht_lru = &photo_cache->priv->photo_ht_lru;
+
+	while (photo_ht_lru->length > photo_cache->priv->max_entries)
+		photo_ht_evict_locked (photo_cache, g_queue_peek_tail (photo_ht_lru));
+}
+
+/* Call with the photo_ht_lock held.  Moves the entry to the head of the
+ * LRU queue, or drops it when it is an expired negative entry. */
+static PhotoData *
+photo_ht_touch_locked (EPhotoCache *photo_cache,
+                       const gchar *key)
 {
-	GHashTable *photo_ht;
-	GQueue *photo_ht_keys;
 	PhotoData *photo_data;
-	gchar *key;
 
-	g_return_if_fail (email_address != NULL);
+	photo_data = g_hash_table_lookup (photo_cache->priv->photo_ht, key);
 
-	photo_ht = photo_cache->priv->photo_ht;
-	photo_ht_keys = &photo_cache->priv->photo_ht_keys;
+	if (photo_data == NULL)
+		return NULL;
 
-	key = photo_ht_normalize_key (email_address);
+	if (photo_data->expires != 0 && photo_data->expires <= g_get_monotonic_time ()) {
+		photo_ht_evict_locked (photo_cache, photo_data);
+		return NULL;
+	}
+
+	g_queue_unlink (&photo_cache->priv->photo_ht_lru, &photo_data->lru_link);
+	g_queue_push_head_link (&photo_cache->priv->photo_ht_lru, &photo_data->lru_link);
+
+	return photo_data;
+}
+
+/* Returns whether the entry ends up without a photo, that is, whether
+ * a negative result should be remembered in the cache directory too. */
+static gboolean
+photo_ht_insert (EPhotoCache *photo_cache,
+                 const gchar *key,
+                 GBytes *bytes,
+                 gint64 expires)
+{
+	PhotoData *photo_data;
+	gboolean negative;
 
 	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
 
-	photo_data = g_hash_table_lookup (photo_ht, key);
+	photo_data = photo_ht_touch_locked (photo_cache, key);
 
 	if (photo_data != NULL) {
-		GList *link;
-
 		/* Replace the old photo data if we have new photo
 		 * data, otherwise leave the old photo data alone. */
-		if (bytes != NULL)
+		if (bytes != NULL) {
 			photo_data_set_bytes (photo_data, bytes);
-
-		/* Move the key to the head of the MRU queue. */
-		link = g_queue_find_custom (
-			photo_ht_keys, key,
-			(GCompareFunc) strcmp);
-		if (link != NULL) {
-			g_queue_unlink (photo_ht_keys, link);
-			g_queue_push_head_link (photo_ht_keys, link);
+			photo_data->expires = 0;
+		} else if (photo_data->expires != 0) {
+			photo_data->expires = expires;
 		}
 	} else {
 		photo_data = photo_data_new (bytes);
+		photo_data->key = g_strdup (key);
+		photo_data->expires = bytes != NULL ? 0 : expires;
 
 		g_hash_table_insert (
-			photo_ht, g_strdup (key),
-			photo_data_ref (photo_data));
+			photo_cache->priv->photo_ht,
+			photo_data->key, photo_data);
 
-		/* Push the key to the head of the MRU queue. */
-		g_queue_push_head (photo_ht_keys, g_strdup (key));
+		g_queue_push_head_link (
+			&photo_cache->priv->photo_ht_lru,
+			&photo_data->lru_link);
 
 		/* Trim the cache if necessary. */
-		while (g_queue_get_length (photo_ht_keys) > MAX_CACHE_SIZE) {
-			gchar *oldest_key;
-
-			oldest_key = g_queue_pop_tail (photo_ht_keys);
-			g_hash_table_remove (photo_ht, oldest_key);
-			g_free (oldest_key);
-		}
-
-		photo_data_unref (photo_data);
+		photo_ht_trim_locked (photo_cache);
 	}
 
+	negative = photo_data->expires != 0;
+
 	/* Hash table and queue sizes should be equal at all times. */
 	g_warn_if_fail (
-		g_hash_table_size (photo_ht) ==
-		g_queue_get_length (photo_ht_keys));
+		g_hash_table_size (photo_cache->priv->photo_ht) ==
+		photo_cache->priv->photo_ht_lru.length);
 
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
 
-	g_free (key);
+	return negative;
 }
 
 static gboolean
 photo_ht_lookup (EPhotoCache *photo_cache,
-                 const gchar *email_address,
+                 const gchar *key,
                  GInputStream **out_stream)
 {
-	GHashTable *photo_ht;
 	PhotoData *photo_data;
 	gboolean found = FALSE;
-	gchar *key;
 
-	g_return_val_if_fail (email_address != NULL, FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
 	g_return_val_if_fail (out_stream != NULL, FALSE);
 
-	photo_ht = photo_cache->priv->photo_ht;
-
-	key = photo_ht_normalize_key (email_address);
-
 	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
 
-	photo_data = g_hash_table_lookup (photo_ht, key);
+	photo_data = photo_ht_touch_locked (photo_cache, key);
 
 	if (photo_data != NULL) {
 		GBytes *bytes;
@@ -603,71 +698,319 @@ photo_ht_lookup (EPhotoCache *photo_cache,
 
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
 
-	g_free (key);
-
 	return found;
 }
 
 static gboolean
 photo_ht_remove (EPhotoCache *photo_cache,
-                 const gchar *email_address)
+                 const gchar *key)
 {
-	GHashTable *photo_ht;
-	GQueue *photo_ht_keys;
-	gchar *key;
+	PhotoData *photo_data;
 	gboolean removed = FALSE;
 
-	g_return_val_if_fail (email_address != NULL, FALSE);
-
-	photo_ht = photo_cache->priv->photo_ht;
-	photo_ht_keys = &photo_cache->priv->photo_ht_keys;
-
-	key = photo_ht_normalize_key (email_address);
+	g_return_val_if_fail (key != NULL, FALSE);
 
 	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
 
-	if (g_hash_table_remove (photo_ht, key)) {
-		GList *link;
+	photo_data = g_hash_table_lookup (photo_cache->priv->photo_ht, key);
 
-		link = g_queue_find_custom (
-			photo_ht_keys, key,
-			(GCompareFunc) strcmp);
-		if (link != NULL) {
-			g_free (link->data);
-			g_queue_delete_link (photo_ht_keys, link);
-			removed = TRUE;
-		}
+	if (photo_data != NULL) {
+		photo_ht_evict_locked (photo_cache, photo_data);
+		removed = TRUE;
 	}
 
 	/* Hash table and queue sizes should be equal at all times. */
 	g_warn_if_fail (
-		g_hash_table_size (photo_ht) ==
-		g_queue_get_length (photo_ht_keys));
+		g_hash_table_size (photo_cache->priv->photo_ht) ==
+		photo_cache->priv->photo_ht_lru.length);
 
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
 
-	g_free (key);
-
 	return removed;
 }
 
 static void
 photo_ht_remove_all (EPhotoCache *photo_cache)
 {
-	GHashTable *photo_ht;
-	GQueue *photo_ht_keys;
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	/* The links are embedded in the PhotoData, thus only unlink them. */
+	while (!g_queue_is_empty (&photo_cache->priv->photo_ht_lru))
+		g_queue_pop_head_link (&photo_cache->priv->photo_ht_lru);
+
+	g_hash_table_remove_all (photo_cache->priv->photo_ht);
 
-	photo_ht = photo_cache->priv->photo_ht;
-	photo_ht_keys = &photo_cache->priv->photo_ht_keys;
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+}
+
+/* Returns the file name in the cache directory for the normalized
+ * email address, or NULL when the cache directory is not set. */
+static gchar *
+photo_disk_dup_filename (EPhotoCache *photo_cache,
+                         const gchar *key)
+{
+	gchar *filename = NULL;
 
 	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
 
-	g_hash_table_remove_all (photo_ht);
+	if (photo_cache->priv->cache_directory != NULL) {
+		gchar *checksum;
 
-	while (!g_queue_is_empty (photo_ht_keys))
-		g_free (g_queue_pop_head (photo_ht_keys));
+		checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+		filename = g_build_filename (photo_cache->priv->cache_directory, checksum, NULL);
+		g_free (checksum);
+	}
 
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	return filename;
+}
+
+static void
+disk_job_free (gpointer ptr)
+{
+	DiskJob *job = ptr;
+
+	if (job) {
+		g_free (job->path);
+		if (job->bytes)
+			g_bytes_unref (job->bytes);
+		g_slice_free (DiskJob, job);
+	}
+}
+
+static void
+photo_disk_push_job (EPhotoCache *photo_cache,
+                     DiskJobKind kind,
+                     gchar *path, /* (transfer full) */
+                     GBytes *bytes)
+{
+	DiskJob *job;
+
+	job = g_slice_new0 (DiskJob);
+	job->kind = kind;
+	job->path = path;
+	job->bytes = bytes ? g_bytes_ref (bytes) : NULL;
+
+	g_thread_pool_push (photo_cache->priv->disk_pool, job, NULL);
+}
+
+typedef struct _PruneFile {
+	gchar *filename;
+	gint64 mtime;
+} PruneFile;
+
+static gint
+prune_file_compare_newest_first (gconstpointer ptr1,
+                                 gconstpointer ptr2)
+{
+	const PruneFile *file1 = ptr1, *file2 = ptr2;
+
+	if (file1->mtime == file2->mtime)
+		return 0;
+
+	return file1->mtime > file2->mtime ? -1 : 1;
+}
+
+/* Deletes the expired files and the oldest files above DISK_MAX_FILES. */
+static void
+photo_disk_prune (const gchar *directory)
+{
+	GDir *dir;
+	GArray *files;
+	const gchar *name;
+	gint64 now;
+	guint ii;
+
+	dir = g_dir_open (directory, 0, NULL);
+	if (dir == NULL)
+		return;
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	files = g_array_new (FALSE, FALSE, sizeof (PruneFile));
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		PruneFile file;
+		GStatBuf st;
+		gint64 age;
+
+		file.filename = g_build_filename (directory, name, NULL);
+
+		if (g_stat (file.filename, &st) != 0 || !S_ISREG (st.st_mode)) {
+			g_free (file.filename);
+			continue;
+		}
+
+		age = now - st.st_mtime;
+
+		if (age >= (st.st_size == 0 ? NEGATIVE_TTL_SECONDS : DISK_TTL_SECONDS)) {
+			g_unlink (file.filename);
+			g_free (file.filename);
+			continue;
+		}
+
+		file.mtime = st.st_mtime;
+		g_array_append_val (files, file);
+	}
+
+	g_dir_close (dir);
+
+	if (files->len > DISK_MAX_FILES)
+		g_array_sort (files, prune_file_compare_newest_first);
+
+	for (ii = 0; ii < files->len; ii++) {
+		PruneFile *file = &g_array_index (files, PruneFile, ii);
+
+		if (ii >= DISK_MAX_FILES)
+			g_unlink (file->filename);
+
+		g_free (file->filename);
+	}
+
+	g_array_free (files, TRUE);
+}
+
+/* Runs in the disk pool thread. An empty file stands
+ * for an email address without a photo. */
+static void
+photo_disk_job_thread (gpointer data,
+                       gpointer user_data)
+{
+	DiskJob *job = data;
+	GError *local_error = NULL;
+
+	switch (job->kind) {
+		case DISK_JOB_STORE: {
+			gconstpointer contents = "";
+			gsize size = 0;
+
+			if (job->bytes != NULL)
+				contents = g_bytes_get_data (job->bytes, &size);
+
+			if (!g_file_set_contents (job->path, contents, size, &local_error)) {
+				g_warning ("%s: Failed to store '%s': %s", G_STRFUNC, job->path, local_error->message);
+				g_clear_error (&local_error);
+			}
+			} break;
+
+		case DISK_JOB_REMOVE:
+			g_unlink (job->path);
+			break;
+
+		case DISK_JOB_PRUNE:
+			if (g_mkdir_with_parents (job->path, 0700) == -1)
+				g_warning ("%s: Failed to create '%s': %s", G_STRFUNC, job->path, g_strerror (errno));
+			else
+				photo_disk_prune (job->path);
+			break;
+	}
+
+	disk_job_free (job);
+}
+
+/* Stores the photo in the cache directory from a dedicated thread. */
+static void
+photo_disk_store (EPhotoCache *photo_cache,
+                  const gchar *key,
+                  GBytes *bytes)
+{
+	gchar *filename;
+	gchar *prune_directory = NULL;
+
+	filename = photo_disk_dup_filename (photo_cache, key);
+	if (filename == NULL)
+		return;
+
+	photo_disk_push_job (photo_cache, DISK_JOB_STORE, filename, bytes);
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	photo_cache->priv->n_disk_stores++;
+
+	if (photo_cache->priv->n_disk_stores >= DISK_PRUNE_INTERVAL) {
+		photo_cache->priv->n_disk_stores = 0;
+		prune_directory = g_strdup (photo_cache->priv->cache_directory);
+	}
+
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	if (prune_directory != NULL)
+		photo_disk_push_job (photo_cache, DISK_JOB_PRUNE, prune_directory, NULL);
+}
+
+/* Returns whether the cache directory knows the normalized email
+ * address; the 'out_bytes' is set to NULL when it has no photo. */
+static gboolean
+photo_disk_load (EPhotoCache *photo_cache,
+                 const gchar *key,
+                 GBytes **out_bytes,
+                 gint64 *out_expires)
+{
+	GStatBuf st;
+	gchar *filename;
+	gchar *contents = NULL;
+	gsize length = 0;
+	gint64 age;
+	gboolean found = FALSE;
+
+	filename = photo_disk_dup_filename (photo_cache, key);
+	if (filename == NULL)
+		return FALSE;
+
+	if (g_stat (filename, &st) != 0)
+		goto exit;
+
+	age = g_get_real_time () / G_USEC_PER_SEC - st.st_mtime;
+
+	if (st.st_size == 0) {
+		if (age >= NEGATIVE_TTL_SECONDS) {
+			g_unlink (filename);
+			goto exit;
+		}
+
+		*out_bytes = NULL;
+		*out_expires = g_get_monotonic_time () + (NEGATIVE_TTL_SECONDS - MAX (age, 0)) * G_USEC_PER_SEC;
+		found = TRUE;
+	} else if (age >= DISK_TTL_SECONDS) {
+		g_unlink (filename);
+	} else if (g_file_get_contents (filename, &contents, &length, NULL)) {
+		*out_bytes = g_bytes_new_take (contents, length);
+		*out_expires = 0;
+		found = TRUE;
+	}
+
+exit:
+	g_free (filename);
+
+	return found;
+}
+
+static void
+disk_load_data_free (gpointer ptr)
+{
+	DiskLoadData *dld = ptr;
+
+	if (dld) {
+		g_free (dld->key);
+		if (dld->bytes)
+			g_bytes_unref (dld->bytes);
+		g_slice_free (DiskLoadData, dld);
+	}
+}
+
+static void
+photo_cache_disk_load_thread (GTask *task,
+                              gpointer source_object,
+                              gpointer task_data,
+                              GCancellable *cancellable)
+{
+	DiskLoadData *dld = task_data;
+
+	dld->found = photo_disk_load (
+		E_PHOTO_CACHE (source_object), dld->key,
+		&dld->bytes, &dld->expires);
+
+	g_task_return_boolean (task, TRUE);
 }
 
 static void
@@ -721,11 +1064,23 @@ photo_cache_set_property (GObject *object,
                           GParamSpec *pspec)
 {
 	switch (property_id) {
+		case PROP_CACHE_DIRECTORY:
+			e_photo_cache_set_cache_directory (
+				E_PHOTO_CACHE (object),
+				g_value_get_string (value));
+			return;
+
 		case PROP_CLIENT_CACHE:
 			photo_cache_set_client_cache (
 				E_PHOTO_CACHE (object),
 				g_value_get_object (value));
 			return;
+
+		case PROP_MAX_ENTRIES:
+			e_photo_cache_set_max_entries (
+				E_PHOTO_CACHE (object),
+				g_value_get_uint (value));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -738,12 +1093,26 @@ photo_cache_get_property (GObject *object,
                           GParamSpec *pspec)
 {
 	switch (property_id) {
+		case PROP_CACHE_DIRECTORY:
+			g_value_take_string (
+				value,
+				e_photo_cache_dup_cache_directory (
+				E_PHOTO_CACHE (object)));
+			return;
+
 		case PROP_CLIENT_CACHE:
 			g_value_take_object (
 				value,
 				e_photo_cache_ref_client_cache (
 				E_PHOTO_CACHE (object)));
 			return;
+
+		case PROP_MAX_ENTRIES:
+			g_value_set_uint (
+				value,
+				e_photo_cache_get_max_entries (
+				E_PHOTO_CACHE (object)));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -771,10 +1140,14 @@ photo_cache_finalize (GObject *object)
 
 	priv = E_PHOTO_CACHE_GET_PRIVATE (object);
 
+	/* Finish the pending writes */
+	g_thread_pool_free (priv->disk_pool, FALSE, TRUE);
+
 	g_main_context_unref (priv->main_context);
 
 	g_hash_table_destroy (priv->photo_ht);
 	g_hash_table_destroy (priv->sources_ht);
+	g_free (priv->cache_directory);
 
 	g_mutex_clear (&priv->photo_ht_lock);
 	g_mutex_clear (&priv->sources_ht_lock);
@@ -806,6 +1179,26 @@ e_photo_cache_class_init (EPhotoCacheClass *class)
 	object_class->finalize = photo_cache_finalize;
 	object_class->constructed = photo_cache_constructed;
 
+	/**
+	 * EPhotoCache:cache-directory:
+	 *
+	 * Directory to store the found photos in, or %NULL to keep
+	 * them only in memory.
+	 *
+	 * Since: 3.38
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_CACHE_DIRECTORY,
+		g_param_spec_string (
+			"cache-directory",
+			"Cache Directory",
+			"Directory to store the found photos in",
+			NULL,
+			G_PARAM_READWRITE |
+			G_PARAM_EXPLICIT_NOTIFY |
+			G_PARAM_STATIC_STRINGS));
+
 	/**
 	 * EPhotoCache:client-cache:
 	 *
@@ -822,6 +1215,25 @@ e_photo_cache_class_init (EPhotoCacheClass *class)
 			G_PARAM_READWRITE |
 			G_PARAM_CONSTRUCT_ONLY |
 			G_PARAM_STATIC_STRINGS));
+
+	/**
+	 * EPhotoCache:max-entries:
+	 *
+	 * How many email addresses to keep in memory at once.
+	 *
+	 * Since: 3.38
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_MAX_ENTRIES,
+		g_param_spec_uint (
+			"max-entries",
+			"Max Entries",
+			"How many email addresses to keep in memory at once",
+			1, G_MAXUINT, DEFAULT_MAX_ENTRIES,
+			G_PARAM_READWRITE |
+			G_PARAM_EXPLICIT_NOTIFY |
+			G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -830,10 +1242,11 @@ e_photo_cache_init (EPhotoCache *photo_cache)
 	GHashTable *photo_ht;
 	GHashTable *sources_ht;
 
+	/* The keys are owned by the PhotoData. */
 	photo_ht = g_hash_table_new_full (
 		(GHashFunc) g_str_hash,
 		(GEqualFunc) g_str_equal,
-		(GDestroyNotify) g_free,
+		(GDestroyNotify) NULL,
 		(GDestroyNotify) photo_data_unref);
 
 	sources_ht = g_hash_table_new_full (
@@ -846,9 +1259,13 @@ e_photo_cache_init (EPhotoCache *photo_cache)
 	photo_cache->priv->main_context = g_main_context_ref_thread_default ();
 	photo_cache->priv->photo_ht = photo_ht;
 	photo_cache->priv->sources_ht = sources_ht;
+	photo_cache->priv->max_entries = DEFAULT_MAX_ENTRIES;
 
 	g_mutex_init (&photo_cache->priv->photo_ht_lock);
 	g_mutex_init (&photo_cache->priv->sources_ht_lock);
+
+	photo_cache->priv->disk_pool = g_thread_pool_new (
+		photo_disk_job_thread, NULL, 1, FALSE, NULL);
 }
 
 /**
@@ -888,6 +1305,130 @@ e_photo_cache_ref_client_cache (EPhotoCache *photo_cache)
 	return g_object_ref (photo_cache->priv->client_cache);
 }
 
+/**
+ * e_photo_cache_get_max_entries:
+ * @photo_cache: an #EPhotoCache
+ *
+ * Returns how many email addresses @photo_cache keeps in memory at once,
+ * regardless of whether the email address has a photo.
+ *
+ * Returns: the maximum number of cache entries
+ *
+ * Since: 3.38
+ **/
+guint
+e_photo_cache_get_max_entries (EPhotoCache *photo_cache)
+{
+	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), 0);
+
+	return photo_cache->priv->max_entries;
+}
+
+/**
+ * e_photo_cache_set_max_entries:
+ * @photo_cache: an #EPhotoCache
+ * @max_entries: the maximum number of cache entries
+ *
+ * Sets how many email addresses @photo_cache keeps in memory at once.
+ * The least recently used entries are discarded when the limit is reached.
+ *
+ * Since: 3.38
+ **/
+void
+e_photo_cache_set_max_entries (EPhotoCache *photo_cache,
+                               guint max_entries)
+{
+	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
+	g_return_if_fail (max_entries > 0);
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	if (photo_cache->priv->max_entries == max_entries) {
+		g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+		return;
+	}
+
+	photo_cache->priv->max_entries = max_entries;
+	photo_ht_trim_locked (photo_cache);
+
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	g_object_notify (G_OBJECT (photo_cache), "max-entries");
+}
+
+/**
+ * e_photo_cache_dup_cache_directory:
+ * @photo_cache: an #EPhotoCache
+ *
+ * Returns the directory @photo_cache stores the found photos in,
+ * or %NULL when the photos are kept only in memory.
+ *
+ * Free the returned string with g_free() when finished with it.
+ *
+ * Returns: (nullable): the cache directory, or %NULL
+ *
+ * Since: 3.38
+ **/
+gchar *
+e_photo_cache_dup_cache_directory (EPhotoCache *photo_cache)
+{
+	gchar *cache_directory;
+
+	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), NULL);
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+	cache_directory = g_strdup (photo_cache->priv->cache_directory);
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	return cache_directory;
+}
+
+/**
+ * e_photo_cache_set_cache_directory:
+ * @photo_cache: an #EPhotoCache
+ * @cache_directory: (nullable): a directory, or %NULL
+ *
+ * Sets a directory to store the found photos in, including the email
+ * addresses without a photo.  Photos from this directory are used before
+ * consulting available photo sources, thus they survive a restart.  Photos
+ * are refreshed from the photo sources after a week, missing photos after
+ * an hour.  Use %NULL to keep the photos only in memory.
+ *
+ * The directory is created if it does not exist.  The expired files are
+ * deleted from it, as are the oldest files when it holds too many.  The
+ * directory is read and written from a dedicated thread.
+ *
+ * Since: 3.38
+ **/
+void
+e_photo_cache_set_cache_directory (EPhotoCache *photo_cache,
+                                   const gchar *cache_directory)
+{
+	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
+
+	if (cache_directory != NULL && *cache_directory == '\0')
+		cache_directory = NULL;
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	if (g_strcmp0 (photo_cache->priv->cache_directory, cache_directory) == 0) {
+		g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+		return;
+	}
+
+	g_free (photo_cache->priv->cache_directory);
+	photo_cache->priv->cache_directory = g_strdup (cache_directory);
+	photo_cache->priv->n_disk_stores = 0;
+
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	/* Creates the directory and deletes the files left from before */
+	if (cache_directory != NULL)
+		photo_disk_push_job (photo_cache, DISK_JOB_PRUNE, g_strdup (cache_directory), NULL);
+
+	g_object_notify (G_OBJECT (photo_cache), "cache-directory");
+}
+
 /**
  * e_photo_cache_add_photo_source:
  * @photo_cache: an #EPhotoCache
@@ -1003,10 +1544,19 @@ e_photo_cache_add_photo (EPhotoCache *photo_cache,
                          const gchar *email_address,
                          GBytes *bytes)
 {
+	gchar *key;
+	gint64 expires;
+
 	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
 	g_return_if_fail (email_address != NULL);
 
-	photo_ht_insert (photo_cache, email_address, bytes);
+	key = photo_ht_normalize_key (email_address);
+	expires = g_get_monotonic_time () + NEGATIVE_TTL_SECONDS * G_USEC_PER_SEC;
+
+	if (photo_ht_insert (photo_cache, key, bytes, expires) || bytes != NULL)
+		photo_disk_store (photo_cache, key, bytes);
+
+	g_free (key);
 }
 
 /**
@@ -1015,17 +1565,32 @@ e_photo_cache_add_photo (EPhotoCache *photo_cache,
  * @email_address: an email address
  *
  * Removes the cache entry for @email_address, if such an entry exists.
+ * The file in the cache directory, if any, is deleted asynchronously.
  *
- * Returns: %TRUE if a cache entry was found and removed
+ * Returns: %TRUE if a cache entry was found in memory and removed
  **/
 gboolean
 e_photo_cache_remove_photo (EPhotoCache *photo_cache,
                             const gchar *email_address)
 {
+	gchar *key;
+	gchar *filename;
+	gboolean removed;
+
 	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), FALSE);
 	g_return_val_if_fail (email_address != NULL, FALSE);
 
-	return photo_ht_remove (photo_cache, email_address);
+	key = photo_ht_normalize_key (email_address);
+
+	removed = photo_ht_remove (photo_cache, key);
+
+	filename = photo_disk_dup_filename (photo_cache, key);
+	if (filename != NULL)
+		photo_disk_push_job (photo_cache, DISK_JOB_REMOVE, filename, NULL);
+
+	g_free (key);
+
+	return removed;
 }
 
 /**
@@ -1076,6 +1641,85 @@ e_photo_cache_get_photo_sync (EPhotoCache *photo_cache,
 	return success;
 }
 
+/* Asks all the photo sources for the photo of the email address
+ * of the 'simple', which completes once they all finished. */
+static void
+photo_cache_dispatch_subtasks (EPhotoCache *photo_cache,
+                               GSimpleAsyncResult *simple)
+{
+	AsyncContext *async_context;
+	GList *list, *link;
+
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	list = e_photo_cache_list_photo_sources (photo_cache);
+
+	if (list == NULL) {
+		g_simple_async_result_complete_in_idle (simple);
+		return;
+	}
+
+	g_mutex_lock (&async_context->lock);
+
+	/* Dispatch a subtask for each photo source. */
+	for (link = list; link != NULL; link = g_list_next (link)) {
+		EPhotoSource *photo_source;
+		AsyncSubtask *async_subtask;
+
+		photo_source = E_PHOTO_SOURCE (link->data);
+		async_subtask = async_subtask_new (photo_source, simple);
+
+		g_hash_table_add (
+			async_context->subtasks,
+			async_subtask_ref (async_subtask));
+
+		e_photo_source_get_photo (
+			photo_source, async_context->email_address,
+			async_subtask->cancellable,
+			photo_cache_async_subtask_done_cb,
+			async_subtask_ref (async_subtask));
+
+		async_subtask_unref (async_subtask);
+	}
+
+	g_mutex_unlock (&async_context->lock);
+
+	g_list_free_full (list, (GDestroyNotify) g_object_unref);
+
+	/* Check if we were cancelled while dispatching subtasks. */
+	if (g_cancellable_is_cancelled (async_context->cancellable))
+		async_context_cancel_subtasks (async_context);
+}
+
+static void
+photo_cache_disk_load_done_cb (GObject *source_object,
+                               GAsyncResult *result,
+                               gpointer user_data)
+{
+	EPhotoCache *photo_cache = E_PHOTO_CACHE (source_object);
+	GSimpleAsyncResult *simple = user_data;
+	AsyncContext *async_context;
+	DiskLoadData *dld;
+
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+	dld = g_task_get_task_data (G_TASK (result));
+
+	if (dld->found) {
+		photo_ht_insert (photo_cache, dld->key, dld->bytes, dld->expires);
+
+		if (dld->bytes != NULL)
+			async_context->stream = g_memory_input_stream_new_from_bytes (dld->bytes);
+
+		g_simple_async_result_complete (simple);
+	} else if (g_cancellable_is_cancelled (async_context->cancellable)) {
+		g_simple_async_result_complete (simple);
+	} else {
+		photo_cache_dispatch_subtasks (photo_cache, simple);
+	}
+
+	g_object_unref (simple);
+}
+
 /**
  * e_photo_cache_get_photo:
  * @photo_cache: an #EPhotoCache
@@ -1101,7 +1745,7 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 	AsyncContext *async_context;
 	EDataCapture *data_capture;
 	GInputStream *stream = NULL;
-	GList *list, *link;
+	gchar *key, *filename;
 
 	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
 	g_return_if_fail (email_address != NULL);
@@ -1116,7 +1760,7 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 		data_capture_closure_new (photo_cache, email_address),
 		(GClosureNotify) data_capture_closure_free, 0);
 
-	async_context = async_context_new (data_capture, cancellable);
+	async_context = async_context_new (data_capture, email_address, cancellable);
 
 	simple = g_simple_async_result_new (
 		G_OBJECT (photo_cache), callback,
@@ -1127,50 +1771,40 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 	g_simple_async_result_set_op_res_gpointer (
 		simple, async_context, (GDestroyNotify) async_context_free);
 
-	/* Check if we have this email address already cached. */
-	if (photo_ht_lookup (photo_cache, email_address, &stream)) {
-		async_context->stream = stream;  /* takes ownership */
-		g_simple_async_result_complete_in_idle (simple);
-		goto exit;
-	}
-
-	list = e_photo_cache_list_photo_sources (photo_cache);
+	key = photo_ht_normalize_key (email_address);
 
-	if (list == NULL) {
+	/* Check if we have this email address already cached in memory. */
+	if (photo_ht_lookup (photo_cache, key, &stream)) {
+		async_context->stream = stream;  /* takes ownership */
 		g_simple_async_result_complete_in_idle (simple);
+		g_free (key);
 		goto exit;
 	}
 
-	g_mutex_lock (&async_context->lock);
-
-	/* Dispatch a subtask for each photo source. */
-	for (link = list; link != NULL; link = g_list_next (link)) {
-		EPhotoSource *photo_source;
-		AsyncSubtask *async_subtask;
+	filename = photo_disk_dup_filename (photo_cache, key);
 
-		photo_source = E_PHOTO_SOURCE (link->data);
-		async_subtask = async_subtask_new (photo_source, simple);
+	if (filename != NULL) {
+		DiskLoadData *dld;
+		GTask *task;
 
-		g_hash_table_add (
-			async_context->subtasks,
-			async_subtask_ref (async_subtask));
+		/* Look into the cache directory in a thread, the photo
+		 * sources are asked afterwards, when it is not there. */
+		dld = g_slice_new0 (DiskLoadData);
+		dld->key = key;
 
-		e_photo_source_get_photo (
-			photo_source, email_address,
-			async_subtask->cancellable,
-			photo_cache_async_subtask_done_cb,
-			async_subtask_ref (async_subtask));
+		task = g_task_new (photo_cache, NULL, photo_cache_disk_load_done_cb, g_object_ref (simple));
+		g_task_set_source_tag (task, e_photo_cache_get_photo);
+		g_task_set_task_data (task, dld, disk_load_data_free);
+		g_task_run_in_thread (task, photo_cache_disk_load_thread);
+		g_object_unref (task);
 
-		async_subtask_unref (async_subtask);
+		g_free (filename);
+		goto exit;
 	}
 
-	g_mutex_unlock (&async_context->lock);
-
-	g_list_free_full (list, (GDestroyNotify) g_object_unref);
+	g_free (key);
 
-	/* Check if we were cancelled while dispatching subtasks. */
-	if (g_cancellable_is_cancelled (cancellable))
-		async_context_cancel_subtasks (async_context);
+	photo_cache_dispatch_subtasks (photo_cache, simple);
 
 exit:
 	g_object_unref (simple);
@@ -69,6 +69,14 @@ struct _EPhotoCacheClass {
 GType		e_photo_cache_get_type		(void) G_GNUC_CONST;
 EPhotoCache *	e_photo_cache_new		(EClientCache *client_cache);
 EClientCache *	e_photo_cache_ref_client_cache	(EPhotoCache *photo_cache);
+guint		e_photo_cache_get_max_entries	(EPhotoCache *photo_cache);
+void		e_photo_cache_set_max_entries	(EPhotoCache *photo_cache,
+						 guint max_entries);
+gchar *		e_photo_cache_dup_cache_directory
+						(EPhotoCache *photo_cache);
+void		e_photo_cache_set_cache_directory
+						(EPhotoCache *photo_cache,
+						 const gchar *cache_directory);
 void		e_photo_cache_add_photo_source	(EPhotoCache *photo_cache,
 						 EPhotoSource *photo_source);
 GList *		e_photo_cache_list_photo_sources
@@ -18,10 +18,12 @@
 #include "evolution-config.h"
 
 #include <sys/types.h>
+#include <stdio.h>
 #include <string.h>
 
 #include <glib/gi18n.h>
 
+#include <camel/camel.h>
 #include <libebackend/libebackend.h>
 
 #include "e-plugin.h"
@@ -358,30 +360,50 @@ ep_load_plugin (xmlNodePtr root,
 	return ep;
 }
 
-static gint
-ep_load (const gchar *filename,
-         gint load_level)
+static struct _plugin_doc *
+ep_parse (const gchar *filename)
 {
 	xmlDocPtr doc;
 	xmlNodePtr root;
-	EPlugin *ep = NULL;
 	struct _plugin_doc *pdoc;
 
 	doc = e_xml_parse_file (filename);
 	if (doc == NULL)
-		return -1;
+		return NULL;
 
 	root = xmlDocGetRootElement (doc);
 	if (strcmp ((gchar *) root->name, "e-plugin-list") != 0) {
 		g_warning ("No <e-plugin-list> root element: %s", filename);
 		xmlFreeDoc (doc);
-		return -1;
+		return NULL;
 	}
 
 	pdoc = g_malloc0 (sizeof (*pdoc));
 	pdoc->doc = doc;
 	pdoc->filename = g_strdup (filename);
 
+	return pdoc;
+}
+
+static void
+ep_plugin_doc_free (gpointer ptr)
+{
+	struct _plugin_doc *pdoc = ptr;
+
+	xmlFreeDoc (pdoc->doc);
+	g_free (pdoc->filename);
+	g_free (pdoc);
+}
+
+static void
+ep_load (struct _plugin_doc *pdoc,
+         gint load_level)
+{
+	xmlNodePtr root;
+	EPlugin *ep = NULL;
+
+	root = xmlDocGetRootElement (pdoc->doc);
+
 	for (root = root->children; root; root = root->next) {
 		if (strcmp ((gchar *) root->name, "e-plugin") == 0) {
 			gchar *plugin_load_level, *is_system_plugin;
@@ -417,12 +439,6 @@ ep_load (const gchar *filename,
 			}
 		}
 	}
-
-	xmlFreeDoc (pdoc->doc);
-	g_free (pdoc->filename);
-	g_free (pdoc);
-
-	return 0;
 }
 
 static void
@@ -484,12 +500,20 @@ gint
 e_plugin_load_plugins (void)
 {
 	GSettings *settings;
+	GPtrArray *pdocs;
+	GTimer *timer = NULL;
+	GDir *dir;
+	const gchar *path = EVOLUTION_PLUGINDIR;
 	gchar **strv;
 	gint i;
+	guint ii;
 
 	if (eph_types != NULL)
 		return 0;
 
+	if (camel_debug ("plugins"))
+		timer = g_timer_new ();
+
 	ep_types = g_hash_table_new (g_str_hash, g_str_equal);
 	eph_types = g_hash_table_new (g_str_hash, g_str_equal);
 	ep_plugins = g_hash_table_new (g_str_hash, g_str_equal);
@@ -511,25 +535,25 @@ e_plugin_load_plugins (void)
 	g_strfreev (strv);
 	g_object_unref (settings);
 
-	for (i = 0; i < 3; i++) {
-		GDir *dir;
-		const gchar *d;
-		const gchar *path = EVOLUTION_PLUGINDIR;
+	/* Each plugin file is parsed only once, then the plugins
+	 * are loaded from it for each of the three load levels. */
+	pdocs = g_ptr_array_new_with_free_func (ep_plugin_doc_free);
 
-		pd (printf ("scanning plugin dir '%s'\n", path));
+	pd (printf ("scanning plugin dir '%s'\n", path));
 
-		dir = g_dir_open (path, 0, NULL);
-		if (dir == NULL) {
-			/*g_warning("Could not find plugin path: %s", path);*/
-			continue;
-		}
+	dir = g_dir_open (path, 0, NULL);
+	if (dir != NULL) {
+		const gchar *d;
 
 		while ((d = g_dir_read_name (dir))) {
 			if (g_str_has_suffix  (d, ".eplug")) {
+				struct _plugin_doc *pdoc;
 				gchar *name;
 
 				name = g_build_filename (path, d, NULL);
-				ep_load (name, i);
+				pdoc = ep_parse (name);
+				if (pdoc != NULL)
+					g_ptr_array_add (pdocs, pdoc);
 				g_free (name);
 			}
 		}
@@ -537,6 +561,30 @@ e_plugin_load_plugins (void)
 		g_dir_close (dir);
 	}
 
+	if (timer) {
+		printf (
+			"%s: parsed %u plugin files in %.3f s\n",
+			G_STRFUNC, pdocs->len, g_timer_elapsed (timer, NULL));
+		g_timer_start (timer);
+	}
+
+	for (i = 0; i < 3; i++) {
+		for (ii = 0; ii < pdocs->len; ii++)
+			ep_load (g_ptr_array_index (pdocs, ii), i);
+
+		if (timer) {
+			printf (
+				"%s: loaded plugins of level %d in %.3f s\n",
+				G_STRFUNC, i, g_timer_elapsed (timer, NULL));
+			g_timer_start (timer);
+		}
+	}
+
+	g_ptr_array_unref (pdocs);
+
+	if (timer)
+		g_timer_destroy (timer);
+
 	return 0;
 }
 
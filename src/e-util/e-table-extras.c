@@ -427,3 +427,37 @@ e_table_extras_get_icon_name (ETableExtras *extras,
 
 	return g_hash_table_lookup (extras->priv->icon_names, id);
 }
+
+/**
+ * e_table_extras_get_compare_key_type:
+ * @compare: a compare function
+ *
+ * Recognizes the compare functions registered by the #ETableExtras
+ * by default, which lets the sorting code extract typed sort keys
+ * instead of calling the @compare for each pair of values.
+ *
+ * Returns: an #ETableSortKeyType for the @compare, which is
+ *    %E_TABLE_SORT_KEY_GENERIC for unknown functions
+ *
+ * Since: 3.38
+ **/
+ETableSortKeyType
+e_table_extras_get_compare_key_type (GCompareDataFunc compare)
+{
+	if (compare == (GCompareDataFunc) e_int_compare)
+		return E_TABLE_SORT_KEY_INT;
+
+	if (compare == (GCompareDataFunc) e_int64ptr_compare)
+		return E_TABLE_SORT_KEY_INT64_POINTER;
+
+	if (compare == (GCompareDataFunc) e_str_compare)
+		return E_TABLE_SORT_KEY_STRING;
+
+	if (compare == (GCompareDataFunc) e_table_collate_compare)
+		return E_TABLE_SORT_KEY_COLLATE;
+
+	if (compare == (GCompareDataFunc) e_table_str_case_compare)
+		return E_TABLE_SORT_KEY_COLLATE_CASEFOLD;
+
+	return E_TABLE_SORT_KEY_GENERIC;
+}
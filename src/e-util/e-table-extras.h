@@ -29,6 +29,7 @@
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <e-util/e-cell.h>
+#include <e-util/e-table-sorting-utils.h>
 
 /* Standard GObject macros */
 #define E_TYPE_TABLE_EXTRAS \
@@ -88,6 +89,9 @@ void		e_table_extras_add_icon_name	(ETableExtras *extras,
 						 const gchar *icon_name);
 const gchar *	e_table_extras_get_icon_name	(ETableExtras *extras,
 						 const gchar *id);
+ETableSortKeyType
+		e_table_extras_get_compare_key_type
+						(GCompareDataFunc compare);
 
 G_END_DECLS
 
@@ -724,6 +724,57 @@ confirm_height_cache (ETableItem *eti)
 	for (i = 0; i < eti->rows; i++) {
 		eti->height_cache[i] = -1;
 	}
+
+	g_free (eti->height_sums);
+	eti->height_sums = g_new0 (gint, eti->rows + 1);
+	eti->height_sums_known = 0;
+}
+
+/*
+ * The height_sums is a Fenwick tree of the row heights, which gives both
+ * the y of a row and the row at a y in O(log n), once the heights of the
+ * rows above are known.  Those are computed on demand, in order, as
+ * tracked by height_sums_known.
+ */
+static void
+height_sums_add (ETableItem *eti,
+                 gint row,
+                 gint delta)
+{
+	for (row++; row <= eti->rows; row += row & -row)
+		eti->height_sums[row] += delta;
+}
+
+/* Sum of the heights of the rows before @row, without the grid lines */
+static gint
+height_sums_prefix (ETableItem *eti,
+                    gint row)
+{
+	gint sum = 0;
+
+	for (; row > 0; row -= row & -row)
+		sum += eti->height_sums[row];
+
+	return sum;
+}
+
+/* Rebuilds the tree from the height_cache, after rows were added or removed */
+static void
+height_sums_rebuild (ETableItem *eti)
+{
+	gint row, parent;
+
+	g_free (eti->height_sums);
+	eti->height_sums = g_new0 (gint, eti->rows + 1);
+
+	for (row = 1; row <= eti->rows; row++) {
+		if (eti->height_cache[row - 1] > 0)
+			eti->height_sums[row] += eti->height_cache[row - 1];
+
+		parent = row + (row & -row);
+		if (parent <= eti->rows)
+			eti->height_sums[parent] += eti->height_sums[row];
+	}
 }
 
 static gboolean
@@ -762,6 +813,10 @@ free_height_cache (ETableItem *eti)
 		eti->height_cache_idle_count = 0;
 		eti->uniform_row_height_cache = -1;
 
+		g_free (eti->height_sums);
+		eti->height_sums = NULL;
+		eti->height_sums_known = 0;
+
 		if (eti->uniform_row_height && eti->height_cache_idle_id != 0) {
 			g_source_remove (eti->height_cache_idle_id);
 			eti->height_cache_idle_id = 0;
@@ -798,6 +853,7 @@ eti_row_height (ETableItem *eti,
 		}
 		if (eti->height_cache[row] == -1) {
 			eti->height_cache[row] = eti_row_height_real (eti, row);
+			height_sums_add (eti, row, eti->height_cache[row]);
 			if (row > 0 &&
 			    eti->length_threshold != -1 &&
 			    eti->rows > eti->length_threshold &&
@@ -810,6 +866,77 @@ eti_row_height (ETableItem *eti,
 	}
 }
 
+/* Makes sure the heights of all the rows before @row are known */
+static void
+height_sums_fill_to_row (ETableItem *eti,
+                         gint row)
+{
+	if (!eti->height_cache)
+		calculate_height_cache (eti);
+
+	row = MIN (row, eti->rows);
+
+	for (; eti->height_sums_known < row; eti->height_sums_known++)
+		ETI_MULTIPLE_ROW_HEIGHT (eti, eti->height_sums_known);
+}
+
+/* Makes sure the heights of the rows are known up to the first one whose
+ * bottom, with the grid lines, is at @y or below, or of all the rows */
+static void
+height_sums_fill_to_y (ETableItem *eti,
+                       gint y)
+{
+	gint height_extra = eti->horizontal_draw_grid ? 1 : 0;
+	gint sum;
+
+	if (!eti->height_cache)
+		calculate_height_cache (eti);
+
+	sum = height_sums_prefix (eti, eti->height_sums_known) +
+		eti->height_sums_known * height_extra;
+
+	for (; eti->height_sums_known < eti->rows && sum < y; eti->height_sums_known++)
+		sum += ETI_MULTIPLE_ROW_HEIGHT (eti, eti->height_sums_known) + height_extra;
+}
+
+/* Distance from the top of the first row to the top of @row, with the grid
+ * lines, but not the one above the first row */
+static gint
+height_sums_row_y (ETableItem *eti,
+                   gint row)
+{
+	gint height_extra = eti->horizontal_draw_grid ? 1 : 0;
+
+	height_sums_fill_to_row (eti, row);
+
+	return height_sums_prefix (eti, row) + row * height_extra;
+}
+
+/* Returns the number of leading rows which, with their grid lines, end
+ * above @y, as measured by height_sums_row_y() */
+static gint
+height_sums_count_above (ETableItem *eti,
+                         gint y)
+{
+	gint height_extra = eti->horizontal_draw_grid ? 1 : 0;
+	gint count = 0, sum = 0, step;
+
+	height_sums_fill_to_y (eti, y);
+
+	for (step = 1; step * 2 <= eti->rows; step *= 2)
+		;
+
+	for (; step > 0; step /= 2) {
+		if (count + step <= eti->rows &&
+		    sum + eti->height_sums[count + step] + step * height_extra < y) {
+			count += step;
+			sum += eti->height_sums[count] + step * height_extra;
+		}
+	}
+
+	return count;
+}
+
 /*
  * eti_get_height:
  *
@@ -841,15 +968,14 @@ eti_get_height (ETableItem *eti)
 			if (rows > eti->length_threshold) {
 				gint row_height = ETI_ROW_HEIGHT (eti, 0);
 				if (eti->height_cache) {
-					height = 0;
-					for (row = 0; row < rows; row++) {
-						if (eti->height_cache[row] == -1) {
-							height += (row_height + height_extra) * (rows - row);
-							break;
-						}
-						else
-							height += eti->height_cache[row] + height_extra;
-					}
+					/* Estimate from the first row of unknown height on */
+					while (eti->height_sums_known < rows &&
+					       eti->height_cache[eti->height_sums_known] != -1)
+						eti->height_sums_known++;
+
+					row = eti->height_sums_known;
+					height = height_sums_row_y (eti, row) +
+						(row_height + height_extra) * (rows - row);
 				} else
 					height = (ETI_ROW_HEIGHT (eti, 0) + height_extra) * rows;
 
@@ -860,11 +986,7 @@ eti_get_height (ETableItem *eti)
 			}
 		}
 
-		height = height_extra;
-		for (row = 0; row < rows; row++)
-			height += ETI_ROW_HEIGHT (eti, row) + height_extra;
-
-		return height;
+		return height_sums_row_y (eti, rows) + height_extra;
 	}
 }
 
@@ -908,12 +1030,10 @@ e_table_item_row_diff (ETableItem *eti,
 	if (eti->uniform_row_height) {
 		return ((end_row - start_row) * (ETI_ROW_HEIGHT (eti, -1) + height_extra));
 	} else {
-		gint row, total;
-		total = 0;
-		for (row = start_row; row < end_row; row++)
-			total += ETI_ROW_HEIGHT (eti, row) + height_extra;
+		if (start_row >= end_row)
+			return 0;
 
-		return total;
+		return height_sums_row_y (eti, end_row) - height_sums_row_y (eti, start_row);
 	}
 }
 
@@ -1313,6 +1433,9 @@ eti_table_model_rows_inserted (ETableModel *table_model,
 		memmove (eti->height_cache + row + count, eti->height_cache + row, (eti->rows - count - row) * sizeof (gint));
 		for (i = row; i < row + count; i++)
 			eti->height_cache[i] = -1;
+
+		height_sums_rebuild (eti);
+		eti->height_sums_known = MIN (eti->height_sums_known, row);
 	}
 
 	eti_unfreeze (eti);
@@ -1344,6 +1467,15 @@ eti_table_model_rows_deleted (ETableModel *table_model,
 		memmove (eti->height_cache + row, eti->height_cache + row + count, (eti->rows - row) * sizeof (gint));
 	}
 
+	if (eti->height_cache) {
+		height_sums_rebuild (eti);
+		if (eti->height_sums_known >= row + count)
+			eti->height_sums_known -= count;
+		else
+			eti->height_sums_known = MIN (eti->height_sums_known, row);
+		eti->height_sums_known = MIN (eti->height_sums_known, eti->rows);
+	}
+
 	eti_unfreeze (eti);
 
 	eti_idle_maybe_show_cursor (eti);
@@ -1598,6 +1730,10 @@ eti_dispose (GObject *object)
 		g_free (eti->height_cache);
 	eti->height_cache = NULL;
 
+	g_free (eti->height_sums);
+	eti->height_sums = NULL;
+	eti->height_sums_known = 0;
+
 	/* Chain up to parent's dispose() method. */
 	G_OBJECT_CLASS (e_table_item_parent_class)->dispose (object);
 }
@@ -1752,6 +1888,9 @@ e_table_item_init (ETableItem *eti)
 	eti->height_cache_idle_id = 0;
 	eti->height_cache_idle_count = 0;
 
+	eti->height_sums = NULL;
+	eti->height_sums_known = 0;
+
 	eti->length_threshold = -1;
 	eti->uniform_row_height = FALSE;
 
@@ -1875,6 +2014,10 @@ eti_unrealize (GnomeCanvasItem *item)
 	eti->height_cache = NULL;
 	eti->height_cache_idle_count = 0;
 
+	g_free (eti->height_sums);
+	eti->height_sums = NULL;
+	eti->height_sums_known = 0;
+
 	eti_unrealize_cell_views (eti);
 
 	eti->height = 0;
@@ -1984,31 +2127,20 @@ eti_draw (GnomeCanvasItem *item,
 		if (last_row > eti->rows)
 			last_row = eti->rows;
 	} else {
-		gint y1, y2;
-
-		y_offset = 0;
-		first_row = -1;
-
-		y1 = y2 = floor (eti_base_y) + height_extra;
-		for (row = 0; row < rows; row++, y1 = y2) {
+		gint y0 = floor (eti_base_y) + height_extra;
 
-			y2 += ETI_ROW_HEIGHT (eti, row) + height_extra;
-
-			if (y1 > y + height)
-				break;
+		/* The rows from the first one ending at y or below,
+		 * up to the first one starting below y + height */
+		first_row = height_sums_count_above (eti, y - y0);
+		if (y + height - y0 < 0)
+			last_row = 0;
+		else
+			last_row = MIN (height_sums_count_above (eti, y + height - y0 + 1) + 1, rows);
 
-			if (y2 < y)
-				continue;
-
-			if (first_row == -1) {
-				y_offset = y1 - y;
-				first_row = row;
-			}
-		}
-		last_row = row;
-
-		if (first_row == -1)
+		if (first_row >= last_row)
 			return;
+
+		y_offset = y0 + height_sums_row_y (eti, first_row) - y;
 	}
 
 	if (first_row == -1)
@@ -2239,7 +2371,7 @@ find_cell (ETableItem *eti,
 {
 	const gint cols = eti->cols;
 	const gint rows = eti->rows;
-	gdouble x1, y1, x2, y2;
+	gdouble x1, y1, x2;
 	gint col, row;
 
 	gint height_extra = eti->horizontal_draw_grid ? 1 : 0;
@@ -2278,18 +2410,14 @@ find_cell (ETableItem *eti,
 		if (row >= eti->rows)
 			return FALSE;
 	} else {
-		y1 = y2 = height_extra;
 		if (y < height_extra)
 			return FALSE;
-		for (row = 0; row < rows; row++, y1 = y2) {
-			y2 += ETI_ROW_HEIGHT (eti, row) + height_extra;
-
-			if (y <= y2)
-				break;
-		}
 
+		row = height_sums_count_above (eti, ceil (y - height_extra));
 		if (row == rows)
 			return FALSE;
+
+		y1 = height_sums_row_y (eti, row) + height_extra;
 	}
 	*view_col_res = col;
 	if (x1_res)
@@ -149,6 +149,14 @@ struct _ETableItem {
 	gint height_cache_idle_id;
 	gint height_cache_idle_count;
 
+	/*
+	 * Fenwick tree over the height_cache, with the rows of unknown
+	 * height counted as zero, and the number of leading rows of
+	 * known height
+	 */
+	gint *height_sums;
+	gint height_sums_known;
+
 	/*
 	 * Lengh Threshold: above this, we stop computing correctly
 	 * the size
@@ -26,6 +26,7 @@
 #include <e-util/e-table-header.h>
 #include <e-util/e-table-model.h>
 #include <e-util/e-table-sort-info.h>
+#include <e-util/e-table-sorting-utils.h>
 #include <e-util/e-table-subset-variable.h>
 
 /* Standard GObject macros */
@@ -66,6 +67,9 @@ struct _ETableSorter {
 	gint *sorted;
 	gint *backsorted;
 
+	/* Sort keys cached between sorts. */
+	ETableSortKeys *sort_keys;
+
 	gulong table_model_changed_id;
 	gulong table_model_row_changed_id;
 	gulong table_model_cell_changed_id;
@@ -27,6 +27,7 @@
 #include <camel/camel.h>
 
 #include "e-misc-utils.h"
+#include "e-table-extras.h"
 
 #define d(x)
 
@@ -135,38 +136,567 @@ e_sort_callback (gconstpointer data1,
 	return comp_val;
 }
 
+/* Flags of a single row in an ETableSortKeyColumn. */
+#define SORT_KEY_VALID	(1 << 0)
+#define SORT_KEY_NULL	(1 << 1)
+
+/* Runs shorter than this are sorted with an insertion sort. */
+#define SORT_KEYS_INSERTION_THRESHOLD 16
+
+typedef struct _ETableSortKeyColumn ETableSortKeyColumn;
+
+struct _ETableSortKeyColumn {
+	gint compare_col;
+	ETableSortKeyType key_type;
+
+	/* Exactly one of these is used, depending on the key_type.
+	 * The 'vals' are model values, which are extracted for
+	 * the E_TABLE_SORT_KEY_GENERIC columns only for the time
+	 * of the sort, all the others are cached between sorts. */
+	gint64 *ints;
+	gchar **strs;
+	gpointer *vals;
+
+	guint8 *flags;
+	gint n_rows;
+	gboolean used;
+};
+
+/* One column can be sorted with compares of different key types,
+ * thus both are part of the key of the ETableSortKeys::columns. */
+#define SORT_KEYS_COLUMN_KEY(_compare_col, _key_type) \
+	GINT_TO_POINTER (((_compare_col) << 3) | (_key_type))
+
+struct _ETableSortKeys {
+	/* SORT_KEYS_COLUMN_KEY (compare_col, key_type) ~> ETableSortKeyColumn * */
+	GHashTable *columns;
+};
+
+typedef struct {
+	ETableSortKeyColumn **columns;
+	GCompareDataFunc *compare;
+	GtkSortType *sort_type;
+	gint n_columns;
+	gpointer cmp_cache;
+} ETableSortKeysClosure;
+
+static void
+sort_key_column_free_strs (ETableSortKeyColumn *column,
+                           gint from_row,
+                           gint count)
+{
+	gint ii;
+
+	if (!column->strs)
+		return;
+
+	for (ii = from_row; ii < from_row + count; ii++) {
+		g_free (column->strs[ii]);
+		column->strs[ii] = NULL;
+	}
+}
+
+static void
+sort_key_column_free (gpointer ptr)
+{
+	ETableSortKeyColumn *column = ptr;
+
+	if (!column)
+		return;
+
+	sort_key_column_free_strs (column, 0, column->n_rows);
+
+	g_free (column->ints);
+	g_free (column->strs);
+	g_free (column->vals);
+	g_free (column->flags);
+	g_free (column);
+}
+
+static ETableSortKeyColumn *
+sort_key_column_new (gint compare_col,
+                     ETableSortKeyType key_type,
+                     gint n_rows)
+{
+	ETableSortKeyColumn *column;
+
+	column = g_new0 (ETableSortKeyColumn, 1);
+	column->compare_col = compare_col;
+	column->key_type = key_type;
+	column->n_rows = n_rows;
+	column->flags = g_new0 (guint8, n_rows);
+
+	switch (key_type) {
+	case E_TABLE_SORT_KEY_INT:
+	case E_TABLE_SORT_KEY_INT64_POINTER:
+		column->ints = g_new0 (gint64, n_rows);
+		break;
+	case E_TABLE_SORT_KEY_STRING:
+	case E_TABLE_SORT_KEY_COLLATE:
+	case E_TABLE_SORT_KEY_COLLATE_CASEFOLD:
+		column->strs = g_new0 (gchar *, n_rows);
+		break;
+	case E_TABLE_SORT_KEY_GENERIC:
+		column->vals = g_new0 (gpointer, n_rows);
+		break;
+	}
+
+	return column;
+}
+
+static void
+sort_key_column_fill_row (ETableSortKeyColumn *column,
+                          ETableModel *source,
+                          gint row)
+{
+	gpointer value;
+	guint8 flags = SORT_KEY_VALID;
+
+	value = e_table_model_value_at (source, column->compare_col, row);
+
+	switch (column->key_type) {
+	case E_TABLE_SORT_KEY_INT:
+		column->ints[row] = GPOINTER_TO_INT (value);
+		break;
+	case E_TABLE_SORT_KEY_INT64_POINTER:
+		if (value)
+			column->ints[row] = *((gint64 *) value);
+		else
+			flags |= SORT_KEY_NULL;
+		break;
+	case E_TABLE_SORT_KEY_STRING:
+	case E_TABLE_SORT_KEY_COLLATE:
+	case E_TABLE_SORT_KEY_COLLATE_CASEFOLD:
+		g_free (column->strs[row]);
+		column->strs[row] = NULL;
+
+		if (!value) {
+			flags |= SORT_KEY_NULL;
+		} else if (column->key_type == E_TABLE_SORT_KEY_STRING) {
+			column->strs[row] = g_strdup (value);
+		} else if (column->key_type == E_TABLE_SORT_KEY_COLLATE) {
+			column->strs[row] = g_utf8_collate_key (value, -1);
+		} else {
+			gchar *tmp = g_utf8_casefold (value, -1);
+			column->strs[row] = g_utf8_collate_key (tmp, -1);
+			g_free (tmp);
+		}
+		break;
+	case E_TABLE_SORT_KEY_GENERIC:
+		/* Freed by the caller once the sort is done. */
+		column->vals[row] = value;
+		column->flags[row] = flags;
+		return;
+	}
+
+	e_table_model_free_value (source, column->compare_col, value);
+
+	column->flags[row] = flags;
+}
+
+static gint
+sort_keys_compare_rows (ETableSortKeysClosure *closure,
+                        gint row1,
+                        gint row2)
+{
+	gint j;
+	gint comp_val = 0;
+	GtkSortType sort_type = GTK_SORT_ASCENDING;
+
+	for (j = 0; j < closure->n_columns; j++) {
+		ETableSortKeyColumn *column = closure->columns[j];
+		gboolean null1, null2;
+
+		null1 = (column->flags[row1] & SORT_KEY_NULL) != 0;
+		null2 = (column->flags[row2] & SORT_KEY_NULL) != 0;
+
+		switch (column->key_type) {
+		case E_TABLE_SORT_KEY_INT:
+		case E_TABLE_SORT_KEY_INT64_POINTER:
+			/* Unset values sort before the set,
+			 * the same as e_int64ptr_compare() does. */
+			if (null1 || null2) {
+				comp_val = (null1 && null2) ? 0 : (null1 ? -1 : 1);
+			} else {
+				gint64 int1 = column->ints[row1];
+				gint64 int2 = column->ints[row2];
+
+				comp_val = (int1 == int2) ? 0 : (int1 < int2) ? -1 : 1;
+			}
+			break;
+		case E_TABLE_SORT_KEY_STRING:
+		case E_TABLE_SORT_KEY_COLLATE:
+		case E_TABLE_SORT_KEY_COLLATE_CASEFOLD:
+			/* NULL strings sort after the others,
+			 * the same as e_str_compare() does. */
+			if (null1 || null2)
+				comp_val = (null1 && null2) ? 0 : (null1 ? 1 : -1);
+			else
+				comp_val = strcmp (column->strs[row1], column->strs[row2]);
+			break;
+		case E_TABLE_SORT_KEY_GENERIC:
+			comp_val = closure->compare[j] (
+				column->vals[row1],
+				column->vals[row2],
+				closure->cmp_cache);
+			break;
+		}
+
+		sort_type = closure->sort_type[j];
+		if (comp_val != 0)
+			break;
+	}
+
+	if (comp_val == 0) {
+		if (row1 < row2)
+			comp_val = -1;
+		if (row1 > row2)
+			comp_val = 1;
+	}
+
+	if (sort_type == GTK_SORT_DESCENDING)
+		comp_val = -comp_val;
+
+	return comp_val;
+}
+
+/* The comparison never returns 0 for two different rows, thus the result
+ * is the same as from g_qsort_with_data(), only with far fewer calls. */
+static void
+sort_keys_merge_sort (ETableSortKeysClosure *closure,
+                      gint *rows,
+                      gint *tmp,
+                      gint n_rows)
+{
+	gint half, ii, jj, kk;
+
+	if (n_rows <= SORT_KEYS_INSERTION_THRESHOLD) {
+		for (ii = 1; ii < n_rows; ii++) {
+			gint row = rows[ii];
+
+			for (jj = ii; jj > 0 && sort_keys_compare_rows (closure, rows[jj - 1], row) > 0; jj--)
+				rows[jj] = rows[jj - 1];
+
+			rows[jj] = row;
+		}
+
+		return;
+	}
+
+	half = n_rows / 2;
+
+	sort_keys_merge_sort (closure, rows, tmp, half);
+	sort_keys_merge_sort (closure, rows + half, tmp + half, n_rows - half);
+
+	/* Already in order, which is common when re-sorting. */
+	if (sort_keys_compare_rows (closure, rows[half - 1], rows[half]) < 0)
+		return;
+
+	memcpy (tmp, rows, sizeof (gint) * half);
+
+	ii = 0;
+	jj = half;
+	kk = 0;
+
+	while (ii < half && jj < n_rows) {
+		if (sort_keys_compare_rows (closure, tmp[ii], rows[jj]) < 0)
+			rows[kk++] = tmp[ii++];
+		else
+			rows[kk++] = rows[jj++];
+	}
+
+	while (ii < half)
+		rows[kk++] = tmp[ii++];
+}
+
+/**
+ * e_table_sort_keys_new:
+ *
+ * Creates a new #ETableSortKeys, a cache of sort keys extracted from
+ * an #ETableModel. The keys of the integer and string columns, as
+ * recognized by e_table_extras_get_compare_key_type(), are kept between
+ * the sorts, thus only the rows reported as changed are extracted again.
+ * The owner is responsible to call e_table_sort_keys_rows_changed(),
+ * e_table_sort_keys_rows_inserted(), e_table_sort_keys_rows_deleted()
+ * and e_table_sort_keys_clear() as the model changes.
+ *
+ * Free the returned structure with e_table_sort_keys_free().
+ *
+ * Returns: (transfer full): a new #ETableSortKeys
+ *
+ * Since: 3.38
+ **/
+ETableSortKeys *
+e_table_sort_keys_new (void)
+{
+	ETableSortKeys *sort_keys;
+
+	sort_keys = g_new0 (ETableSortKeys, 1);
+	sort_keys->columns = g_hash_table_new_full (
+		g_direct_hash, g_direct_equal,
+		NULL, sort_key_column_free);
+
+	return sort_keys;
+}
+
+/**
+ * e_table_sort_keys_free:
+ * @sort_keys: (nullable): an #ETableSortKeys
+ *
+ * Frees the @sort_keys, previously created with e_table_sort_keys_new().
+ *
+ * Since: 3.38
+ **/
 void
-e_table_sorting_utils_sort (ETableModel *source,
-                            ETableSortInfo *sort_info,
-                            ETableHeader *full_header,
-                            gint *map_table,
-                            gint rows)
+e_table_sort_keys_free (ETableSortKeys *sort_keys)
+{
+	if (!sort_keys)
+		return;
+
+	g_hash_table_destroy (sort_keys->columns);
+	g_free (sort_keys);
+}
+
+/**
+ * e_table_sort_keys_clear:
+ * @sort_keys: an #ETableSortKeys
+ *
+ * Drops all the cached keys, thus the next sort extracts them again.
+ *
+ * Since: 3.38
+ **/
+void
+e_table_sort_keys_clear (ETableSortKeys *sort_keys)
+{
+	g_return_if_fail (sort_keys != NULL);
+
+	g_hash_table_remove_all (sort_keys->columns);
+}
+
+/**
+ * e_table_sort_keys_rows_changed:
+ * @sort_keys: an #ETableSortKeys
+ * @row: the first changed row
+ * @count: how many rows changed
+ *
+ * Marks the keys of the given rows as outdated.
+ *
+ * Since: 3.38
+ **/
+void
+e_table_sort_keys_rows_changed (ETableSortKeys *sort_keys,
+                                gint row,
+                                gint count)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail (sort_keys != NULL);
+
+	g_hash_table_iter_init (&iter, sort_keys->columns);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ETableSortKeyColumn *column = value;
+
+		if (row < 0 || row + count > column->n_rows) {
+			g_hash_table_iter_remove (&iter);
+			continue;
+		}
+
+		memset (column->flags + row, 0, count);
+	}
+}
+
+/**
+ * e_table_sort_keys_rows_inserted:
+ * @sort_keys: an #ETableSortKeys
+ * @row: where the rows had been inserted
+ * @count: how many rows had been inserted
+ *
+ * Makes space for the keys of the inserted rows, which
+ * are extracted with the next sort.
+ *
+ * Since: 3.38
+ **/
+void
+e_table_sort_keys_rows_inserted (ETableSortKeys *sort_keys,
+                                 gint row,
+                                 gint count)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail (sort_keys != NULL);
+
+	if (count <= 0)
+		return;
+
+	g_hash_table_iter_init (&iter, sort_keys->columns);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ETableSortKeyColumn *column = value;
+		gint n_rows = column->n_rows + count;
+		gint n_move;
+
+		if (row < 0 || row > column->n_rows) {
+			g_hash_table_iter_remove (&iter);
+			continue;
+		}
+
+		n_move = column->n_rows - row;
+
+		#define make_space(_arr, _type) G_STMT_START { \
+			if (_arr) { \
+				_arr = g_renew (_type, _arr, n_rows); \
+				memmove (_arr + row + count, _arr + row, sizeof (_type) * n_move); \
+				memset (_arr + row, 0, sizeof (_type) * count); \
+			} \
+		} G_STMT_END
+
+		make_space (column->flags, guint8);
+		make_space (column->ints, gint64);
+		make_space (column->strs, gchar *);
+		make_space (column->vals, gpointer);
+
+		#undef make_space
+
+		column->n_rows = n_rows;
+	}
+}
+
+/**
+ * e_table_sort_keys_rows_deleted:
+ * @sort_keys: an #ETableSortKeys
+ * @row: the first deleted row
+ * @count: how many rows had been deleted
+ *
+ * Forgets the keys of the deleted rows.
+ *
+ * Since: 3.38
+ **/
+void
+e_table_sort_keys_rows_deleted (ETableSortKeys *sort_keys,
+                                gint row,
+                                gint count)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail (sort_keys != NULL);
+
+	if (count <= 0)
+		return;
+
+	g_hash_table_iter_init (&iter, sort_keys->columns);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ETableSortKeyColumn *column = value;
+		gint n_move;
+
+		if (row < 0 || row + count > column->n_rows) {
+			g_hash_table_iter_remove (&iter);
+			continue;
+		}
+
+		sort_key_column_free_strs (column, row, count);
+
+		n_move = column->n_rows - row - count;
+
+		#define drop_rows(_arr, _type) G_STMT_START { \
+			if (_arr) \
+				memmove (_arr + row, _arr + row + count, sizeof (_type) * n_move); \
+		} G_STMT_END
+
+		drop_rows (column->flags, guint8);
+		drop_rows (column->ints, gint64);
+		drop_rows (column->strs, gchar *);
+		drop_rows (column->vals, gpointer);
+
+		#undef drop_rows
+
+		column->n_rows -= count;
+	}
+}
+
+static gboolean
+sort_keys_remove_unused_cb (gpointer key,
+                            gpointer value,
+                            gpointer user_data)
 {
+	ETableSortKeyColumn *column = value;
+
+	return !column->used;
+}
+
+/**
+ * e_table_sort_keys_sort:
+ * @sort_keys: an #ETableSortKeys
+ * @source: an #ETableModel
+ * @sort_info: an #ETableSortInfo
+ * @full_header: an #ETableHeader
+ * @with_grouping: whether to sort by the grouping columns first
+ * @map_table: (array length=rows): the model rows to sort
+ * @rows: count of the rows in the @map_table
+ *
+ * Sorts the @map_table by the columns of the @sort_info, the same way
+ * as e_table_sorting_utils_sort() does. Keys of the rows which are
+ * not cached yet are extracted from the @source and kept in the @sort_keys
+ * for the next call. Keys of the columns which are not part of the @sort_info
+ * are dropped.
+ *
+ * The values are read from the columns' compare_col, like
+ * e_table_sorting_utils_sort() always did. It is the same as the model_col,
+ * unless the column specification sets a different compare_col.
+ *
+ * Since: 3.38
+ **/
+void
+e_table_sort_keys_sort (ETableSortKeys *sort_keys,
+                        ETableModel *source,
+                        ETableSortInfo *sort_info,
+                        ETableHeader *full_header,
+                        gboolean with_grouping,
+                        gint *map_table,
+                        gint rows)
+{
+	ETableSortKeysClosure closure;
+	GHashTableIter iter;
+	gpointer value;
 	gint total_rows;
-	gint i;
-	gint j;
-	gint cols;
-	ETableSortClosure closure;
+	gint group_cols;
+	gint i, j;
+	gint *tmp;
 
+	g_return_if_fail (sort_keys != NULL);
 	g_return_if_fail (E_IS_TABLE_MODEL (source));
 	g_return_if_fail (E_IS_TABLE_SORT_INFO (sort_info));
 	g_return_if_fail (E_IS_TABLE_HEADER (full_header));
 
 	total_rows = e_table_model_row_count (source);
-	cols = e_table_sort_info_sorting_get_count (sort_info);
-	closure.cols = cols;
+	group_cols = with_grouping ? e_table_sort_info_grouping_get_count (sort_info) : 0;
 
-	closure.vals = g_new (gpointer, total_rows * cols);
-	closure.sort_type = g_new (GtkSortType, cols);
-	closure.compare = g_new (GCompareDataFunc, cols);
+	closure.n_columns = e_table_sort_info_sorting_get_count (sort_info) + group_cols;
+	closure.columns = g_new0 (ETableSortKeyColumn *, closure.n_columns);
+	closure.compare = g_new (GCompareDataFunc, closure.n_columns);
+	closure.sort_type = g_new (GtkSortType, closure.n_columns);
 	closure.cmp_cache = e_table_sorting_utils_create_cmp_cache ();
 
-	for (j = 0; j < cols; j++) {
+	g_hash_table_iter_init (&iter, sort_keys->columns);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ETableSortKeyColumn *column = value;
+
+		column->used = FALSE;
+	}
+
+	for (j = 0; j < closure.n_columns; j++) {
 		ETableColumnSpecification *spec;
+		ETableSortKeyColumn *column;
+		ETableSortKeyType key_type;
 		ETableCol *col;
 
-		spec = e_table_sort_info_sorting_get_nth (
-			sort_info, j, &closure.sort_type[j]);
+		if (j < group_cols)
+			spec = e_table_sort_info_grouping_get_nth (
+				sort_info, j, &closure.sort_type[j]);
+		else
+			spec = e_table_sort_info_sorting_get_nth (
+				sort_info, j - group_cols, &closure.sort_type[j]);
 
 		col = e_table_header_get_column_by_spec (full_header, spec);
 		if (col == NULL) {
@@ -174,39 +704,87 @@ e_table_sorting_utils_sort (ETableModel *source,
 			col = e_table_header_get_column (full_header, last);
 		}
 
-		for (i = 0; i < rows; i++) {
-			closure.vals[map_table[i] * cols + j] = e_table_model_value_at (source, col->spec->compare_col, map_table[i]);
-		}
 		closure.compare[j] = col->compare;
+		key_type = e_table_extras_get_compare_key_type (col->compare);
+
+		column = g_hash_table_lookup (
+			sort_keys->columns,
+			SORT_KEYS_COLUMN_KEY (col->spec->compare_col, key_type));
+
+		/* A stale column cannot have been used by this sort yet,
+		 * the columns used so far were all made with total_rows. */
+		if (!column || column->n_rows != total_rows) {
+			column = sort_key_column_new (col->spec->compare_col, key_type, total_rows);
+			g_hash_table_insert (
+				sort_keys->columns,
+				SORT_KEYS_COLUMN_KEY (col->spec->compare_col, key_type),
+				column);
+		}
+
+		/* The same column can be used more than once. */
+		if (!column->used) {
+			for (i = 0; i < rows; i++) {
+				gint row = map_table[i];
+
+				if (!(column->flags[row] & SORT_KEY_VALID))
+					sort_key_column_fill_row (column, source, row);
+			}
+
+			column->used = TRUE;
+		}
+
+		closure.columns[j] = column;
 	}
 
-	g_qsort_with_data (
-		map_table, rows, sizeof (gint), e_sort_callback, &closure);
+	g_hash_table_foreach_remove (sort_keys->columns, sort_keys_remove_unused_cb, NULL);
 
-	for (j = 0; j < cols; j++) {
-		ETableColumnSpecification *spec;
-		ETableCol *col;
+	tmp = g_new (gint, rows);
+	sort_keys_merge_sort (&closure, map_table, tmp, rows);
+	g_free (tmp);
 
-		spec = e_table_sort_info_sorting_get_nth (
-			sort_info, j, &closure.sort_type[j]);
+	/* Generic values are not cached, they can reference model data. */
+	g_hash_table_iter_init (&iter, sort_keys->columns);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ETableSortKeyColumn *column = value;
 
-		col = e_table_header_get_column_by_spec (full_header, spec);
-		if (col == NULL) {
-			gint last = e_table_header_count (full_header) - 1;
-			col = e_table_header_get_column (full_header, last);
-		}
+		if (column->key_type != E_TABLE_SORT_KEY_GENERIC)
+			continue;
 
 		for (i = 0; i < rows; i++) {
-			e_table_model_free_value (source, col->spec->compare_col, closure.vals[map_table[i] * cols + j]);
+			gint row = map_table[i];
+
+			if (column->flags[row] & SORT_KEY_VALID) {
+				e_table_model_free_value (source, column->compare_col, column->vals[row]);
+				column->vals[row] = NULL;
+				column->flags[row] = 0;
+			}
 		}
 	}
 
-	g_free (closure.vals);
-	g_free (closure.sort_type);
+	g_free (closure.columns);
 	g_free (closure.compare);
+	g_free (closure.sort_type);
 	e_table_sorting_utils_free_cmp_cache (closure.cmp_cache);
 }
 
+void
+e_table_sorting_utils_sort (ETableModel *source,
+                            ETableSortInfo *sort_info,
+                            ETableHeader *full_header,
+                            gint *map_table,
+                            gint rows)
+{
+	ETableSortKeys *sort_keys;
+
+	g_return_if_fail (E_IS_TABLE_MODEL (source));
+	g_return_if_fail (E_IS_TABLE_SORT_INFO (sort_info));
+	g_return_if_fail (E_IS_TABLE_HEADER (full_header));
+
+	sort_keys = e_table_sort_keys_new ();
+	e_table_sort_keys_sort (sort_keys, source, sort_info, full_header, FALSE, map_table, rows);
+	e_table_sort_keys_free (sort_keys);
+}
+
 gboolean
 e_table_sorting_utils_affects_sort (ETableSortInfo *sort_info,
                                     ETableHeader *full_header,
@@ -312,6 +890,7 @@ etsu_tree_compare (ETreeModel *source,
 	for (j = 0; j < sort_count; j++) {
 		ETableColumnSpecification *spec;
 		ETableCol *col;
+		gpointer value1, value2;
 
 		spec = e_table_sort_info_sorting_get_nth (
 			sort_info, j, &sort_type);
@@ -322,12 +901,16 @@ etsu_tree_compare (ETreeModel *source,
 			col = e_table_header_get_column (full_header, last);
 		}
 
-		comp_val = (*col->compare) (
-			e_tree_model_value_at (
-				source, path1, col->spec->compare_col),
-			e_tree_model_value_at (
-				source, path2, col->spec->compare_col),
-			cmp_cache);
+		/* Use the same values as e_table_sorting_utils_tree_sort(),
+		 * otherwise the found position may not match the sort order. */
+		value1 = e_tree_model_sort_value_at (source, path1, col->spec->compare_col);
+		value2 = e_tree_model_sort_value_at (source, path2, col->spec->compare_col);
+
+		comp_val = (*col->compare) (value1, value2, cmp_cache);
+
+		e_tree_model_free_value (source, col->spec->compare_col, value1);
+		e_tree_model_free_value (source, col->spec->compare_col, value2);
+
 		if (comp_val != 0)
 			break;
 	}
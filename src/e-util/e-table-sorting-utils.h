@@ -33,6 +33,52 @@
 
 G_BEGIN_DECLS
 
+/**
+ * ETableSortKeyType:
+ * @E_TABLE_SORT_KEY_GENERIC: values are compared with the column's compare function
+ * @E_TABLE_SORT_KEY_INT: values are integers stored with GINT_TO_POINTER()
+ * @E_TABLE_SORT_KEY_INT64_POINTER: values are pointers to gint64, or %NULL
+ * @E_TABLE_SORT_KEY_STRING: values are strings compared with strcmp()
+ * @E_TABLE_SORT_KEY_COLLATE: values are strings compared by the locale collation
+ * @E_TABLE_SORT_KEY_COLLATE_CASEFOLD: values are strings compared by the locale
+ *    collation, case-insensitively
+ *
+ * Describes how sort keys of a column can be extracted from its values.
+ *
+ * Since: 3.38
+ **/
+typedef enum {
+	E_TABLE_SORT_KEY_GENERIC,
+	E_TABLE_SORT_KEY_INT,
+	E_TABLE_SORT_KEY_INT64_POINTER,
+	E_TABLE_SORT_KEY_STRING,
+	E_TABLE_SORT_KEY_COLLATE,
+	E_TABLE_SORT_KEY_COLLATE_CASEFOLD
+} ETableSortKeyType;
+
+typedef struct _ETableSortKeys ETableSortKeys;
+
+ETableSortKeys *
+		e_table_sort_keys_new		(void);
+void		e_table_sort_keys_free		(ETableSortKeys *sort_keys);
+void		e_table_sort_keys_clear		(ETableSortKeys *sort_keys);
+void		e_table_sort_keys_rows_changed	(ETableSortKeys *sort_keys,
+						 gint row,
+						 gint count);
+void		e_table_sort_keys_rows_inserted	(ETableSortKeys *sort_keys,
+						 gint row,
+						 gint count);
+void		e_table_sort_keys_rows_deleted	(ETableSortKeys *sort_keys,
+						 gint row,
+						 gint count);
+void		e_table_sort_keys_sort		(ETableSortKeys *sort_keys,
+						 ETableModel *source,
+						 ETableSortInfo *sort_info,
+						 ETableHeader *full_header,
+						 gboolean with_grouping,
+						 gint *map_table,
+						 gint rows);
+
 gboolean	e_table_sorting_utils_affects_sort
 						(ETableSortInfo *sort_info,
 						 ETableHeader *full_header,
@@ -0,0 +1,257 @@
+/*
+ * e-time-index.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * SECTION: e-time-index
+ * @include: e-util/e-util.h
+ * @short_description: Index of time intervals
+ *
+ * #ETimeIndex stores items with a time interval and finds those overlapping
+ * a time range without checking all of them. Items spanning at most
+ * a week, which is the majority of events and their recurrences, are kept
+ * sorted by their start, thus a range query visits only those starting
+ * less than a week before the range start up to the range end. The rest
+ * is kept in a list and checked one by one.
+ **/
+
+#include "evolution-config.h"
+
+#include "e-time-index.h"
+
+/* Longer items are not in the 'by_start' sequence */
+#define SHORT_SPAN (7 * 24 * 60 * 60)
+
+struct _ETimeIndex {
+	GSequence *by_start;	/* ETimeIndexItem *, sorted by start */
+	GQueue long_items;	/* ETimeIndexItem * */
+};
+
+struct _ETimeIndexItem {
+	time_t start;
+	time_t end;
+	gpointer data;
+
+	/* Exactly one of these is set */
+	GSequenceIter *iter;
+	GList *link;
+};
+
+static gint
+time_index_compare_start (gconstpointer ptr1,
+			  gconstpointer ptr2,
+			  gpointer user_data)
+{
+	const ETimeIndexItem *item1 = ptr1, *item2 = ptr2;
+
+	if (item1->start == item2->start)
+		return 0;
+
+	return item1->start < item2->start ? -1 : 1;
+}
+
+static gboolean
+time_index_item_in_range (const ETimeIndexItem *item,
+			  time_t range_start,
+			  time_t range_end)
+{
+	return (item->start < range_end && item->end > range_start) ||
+	       (item->start == item->end && item->end == range_start);
+}
+
+/**
+ * e_time_index_new:
+ *
+ * Creates a new empty #ETimeIndex. Free it with e_time_index_free(),
+ * when no longer needed.
+ *
+ * Returns: (transfer full): a new #ETimeIndex
+ *
+ * Since: 3.38
+ **/
+ETimeIndex *
+e_time_index_new (void)
+{
+	ETimeIndex *index;
+
+	index = g_new0 (ETimeIndex, 1);
+	index->by_start = g_sequence_new (g_free);
+	g_queue_init (&index->long_items);
+
+	return index;
+}
+
+/**
+ * e_time_index_free:
+ * @index: (nullable): an #ETimeIndex
+ *
+ * Frees the @index. Data of the items are not touched.
+ *
+ * Since: 3.38
+ **/
+void
+e_time_index_free (ETimeIndex *index)
+{
+	if (!index)
+		return;
+
+	g_sequence_free (index->by_start);
+	g_queue_foreach (&index->long_items, (GFunc) g_free, NULL);
+	g_queue_clear (&index->long_items);
+	g_free (index);
+}
+
+/**
+ * e_time_index_get_length:
+ * @index: an #ETimeIndex
+ *
+ * Returns: how many items the @index contains
+ *
+ * Since: 3.38
+ **/
+guint
+e_time_index_get_length (ETimeIndex *index)
+{
+	g_return_val_if_fail (index != NULL, 0);
+
+	return g_sequence_get_length (index->by_start) + index->long_items.length;
+}
+
+/**
+ * e_time_index_add:
+ * @index: an #ETimeIndex
+ * @start: start of the interval
+ * @end: end of the interval
+ * @data: data of the item
+ *
+ * Adds a new item into the @index. The same @data can be added
+ * multiple times, each time as a different item.
+ *
+ * Returns: (transfer none): a new item, to be passed
+ *    to e_time_index_remove(); it's owned by the @index
+ *
+ * Since: 3.38
+ **/
+ETimeIndexItem *
+e_time_index_add (ETimeIndex *index,
+		  time_t start,
+		  time_t end,
+		  gpointer data)
+{
+	ETimeIndexItem *item;
+
+	g_return_val_if_fail (index != NULL, NULL);
+
+	item = g_new0 (ETimeIndexItem, 1);
+	item->start = start;
+	item->end = end;
+	item->data = data;
+
+	if (end >= start && end - start <= SHORT_SPAN) {
+		item->iter = g_sequence_insert_sorted (index->by_start, item, time_index_compare_start, NULL);
+	} else {
+		g_queue_push_tail (&index->long_items, item);
+		item->link = index->long_items.tail;
+	}
+
+	return item;
+}
+
+/**
+ * e_time_index_remove:
+ * @index: an #ETimeIndex
+ * @item: an item of the @index, as returned by e_time_index_add()
+ *
+ * Removes the @item from the @index and frees it.
+ *
+ * Since: 3.38
+ **/
+void
+e_time_index_remove (ETimeIndex *index,
+		     ETimeIndexItem *item)
+{
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (item != NULL);
+
+	if (item->iter) {
+		/* Frees the item */
+		g_sequence_remove (item->iter);
+	} else {
+		g_queue_delete_link (&index->long_items, item->link);
+		g_free (item);
+	}
+}
+
+/**
+ * e_time_index_foreach:
+ * @index: an #ETimeIndex
+ * @range_start: start of the time range
+ * @range_end: end of the time range
+ * @func: (scope call): a function to call for each item in the range
+ * @user_data: user data passed to the @func
+ *
+ * Calls @func for each item which overlaps the time range, or which
+ * is of zero length and starts at the @range_start. The short items
+ * are visited in order of their start. The @index cannot be changed
+ * during the traversal.
+ *
+ * Returns: Whether all the items in the range were visited, which is
+ *    %TRUE, unless the @func stopped the traversal
+ *
+ * Since: 3.38
+ **/
+gboolean
+e_time_index_foreach (ETimeIndex *index,
+		      time_t range_start,
+		      time_t range_end,
+		      ETimeIndexForeachFunc func,
+		      gpointer user_data)
+{
+	ETimeIndexItem key;
+	GSequenceIter *iter;
+	GList *link;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	/* Find the first item starting at or after the range_start - SHORT_SPAN,
+	   the items starting earlier cannot reach the range. */
+	key.start = range_start - SHORT_SPAN - 1;
+	iter = g_sequence_search (index->by_start, &key, time_index_compare_start, NULL);
+
+	while (!g_sequence_iter_is_end (iter)) {
+		const ETimeIndexItem *item = g_sequence_get (iter);
+
+		if (item->start > range_end)
+			break;
+
+		if (time_index_item_in_range (item, range_start, range_end) &&
+		    !func (item->start, item->end, item->data, user_data))
+			return FALSE;
+
+		iter = g_sequence_iter_next (iter);
+	}
+
+	for (link = index->long_items.head; link; link = g_list_next (link)) {
+		const ETimeIndexItem *item = link->data;
+
+		if (time_index_item_in_range (item, range_start, range_end) &&
+		    !func (item->start, item->end, item->data, user_data))
+			return FALSE;
+	}
+
+	return TRUE;
+}
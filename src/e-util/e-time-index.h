@@ -0,0 +1,67 @@
+/*
+ * e-time-index.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if !defined (__E_UTIL_H_INSIDE__) && !defined (LIBEUTIL_COMPILATION)
+#error "Only <e-util/e-util.h> should be included directly."
+#endif
+
+#ifndef E_TIME_INDEX_H
+#define E_TIME_INDEX_H
+
+#include <time.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ETimeIndex ETimeIndex;
+typedef struct _ETimeIndexItem ETimeIndexItem;
+
+/**
+ * ETimeIndexForeachFunc:
+ * @start: start of the item's interval
+ * @end: end of the item's interval
+ * @data: data of the item, as passed to e_time_index_add()
+ * @user_data: user data passed to e_time_index_foreach()
+ *
+ * Returns: %TRUE to continue the traversal, %FALSE to stop it
+ *
+ * Since: 3.38
+ **/
+typedef gboolean (* ETimeIndexForeachFunc)	(time_t start,
+						 time_t end,
+						 gpointer data,
+						 gpointer user_data);
+
+ETimeIndex *	e_time_index_new		(void);
+void		e_time_index_free		(ETimeIndex *index);
+guint		e_time_index_get_length		(ETimeIndex *index);
+ETimeIndexItem *
+		e_time_index_add		(ETimeIndex *index,
+						 time_t start,
+						 time_t end,
+						 gpointer data);
+void		e_time_index_remove		(ETimeIndex *index,
+						 ETimeIndexItem *item);
+gboolean	e_time_index_foreach		(ETimeIndex *index,
+						 time_t range_start,
+						 time_t range_end,
+						 ETimeIndexForeachFunc func,
+						 gpointer user_data);
+
+G_END_DECLS
+
+#endif /* E_TIME_INDEX_H */
@@ -42,12 +42,10 @@
 
 #define d(x)
 
-#define INCREMENT_AMOUNT 100
-
 typedef struct {
 	ETreePath path;
 	guint32 num_visible_children;
-	guint32 index;
+	GSequenceIter *iter; /* position in the 'map', NULL when not shown */
 
 	guint expanded : 1;
 	guint expandable : 1;
@@ -70,16 +68,16 @@ struct _ETreeTableAdapterPrivate {
 
 	ETableHeader *header;
 
+	/* The visible rows, in order; each item is a node_t *. The GSequence
+	 * keeps subtree sizes in its nodes, thus both row->node and node->row
+	 * lookups, as well as inserting or removing a range of rows, cost
+	 * O(log n) per row touched, regardless of the total row count. */
+	GSequence *map;
 	gint n_map;
-	gint n_vals_allocated;
-	node_t **map_table;
 	GHashTable *nodes;
 	GNode *root;
 
 	guint root_visible : 1;
-	guint remap_needed : 1;
-
-	gint last_access;
 
 	guint resort_idle_id;
 
@@ -127,54 +125,80 @@ lookup_gnode (ETreeTableAdapter *etta,
 	return gnode;
 }
 
+/* Inserts the rows of 'gnode' subtree in front of 'before', in preorder;
+ * the 'gnode' itself is skipped when 'with_gnode' is FALSE. */
 static void
-resize_map (ETreeTableAdapter *etta,
-            gint size)
+map_insert_subtree (ETreeTableAdapter *etta,
+                    GSequenceIter *before,
+                    GNode *gnode,
+                    gboolean with_gnode)
 {
-	if (size > etta->priv->n_vals_allocated) {
-		etta->priv->n_vals_allocated = MAX (etta->priv->n_vals_allocated + INCREMENT_AMOUNT, size);
-		etta->priv->map_table = g_renew (node_t *, etta->priv->map_table, etta->priv->n_vals_allocated);
+	GNode *p;
+
+	if (with_gnode) {
+		node_t *node = (node_t *) gnode->data;
+
+		node->iter = g_sequence_insert_before (before, node);
+		etta->priv->n_map++;
 	}
 
-	etta->priv->n_map = size;
+	for (p = gnode->children; p; p = p->next)
+		map_insert_subtree (etta, before, p, TRUE);
 }
 
+/* Removes 'count' rows, starting at 'first' */
 static void
-move_map_elements (ETreeTableAdapter *etta,
-                   gint to,
-                   gint from,
-                   gint count)
+map_remove_rows (ETreeTableAdapter *etta,
+                 GSequenceIter *first,
+                 gint count)
 {
-	if (count <= 0 || from >= etta->priv->n_map)
+	if (count <= 0)
 		return;
-	memmove (etta->priv->map_table + to, etta->priv->map_table + from, count * sizeof (node_t *));
-	etta->priv->remap_needed = TRUE;
+
+	g_sequence_remove_range (first, g_sequence_iter_move (first, count));
+	etta->priv->n_map -= count;
 }
 
-static gint
-fill_map (ETreeTableAdapter *etta,
-          gint index,
-          GNode *gnode)
+static void
+map_clear (ETreeTableAdapter *etta)
 {
-	GNode *p;
+	g_sequence_remove_range (
+		g_sequence_get_begin_iter (etta->priv->map),
+		g_sequence_get_end_iter (etta->priv->map));
+	etta->priv->n_map = 0;
+}
 
-	if ((gnode != etta->priv->root) || etta->priv->root_visible)
-		etta->priv->map_table[index++] = gnode->data;
+/* Rebuilds the whole map from the current GNode tree */
+static void
+map_fill (ETreeTableAdapter *etta)
+{
+	map_clear (etta);
 
-	for (p = gnode->children; p; p = p->next)
-		index = fill_map (etta, index, p);
+	if (!etta->priv->root)
+		return;
 
-	etta->priv->remap_needed = TRUE;
-	return index;
+	((node_t *) etta->priv->root->data)->iter = NULL;
+
+	map_insert_subtree (
+		etta, g_sequence_get_end_iter (etta->priv->map),
+		etta->priv->root, etta->priv->root_visible);
 }
 
-static void
-remap_indices (ETreeTableAdapter *etta)
+/* Returns the position of the first row following the rows
+ * of the 'gnode' subtree; the 'gnode' itself does not need
+ * to be in the map yet. */
+static GSequenceIter *
+map_iter_after_subtree (ETreeTableAdapter *etta,
+                        GNode *gnode)
 {
-	gint i;
-	for (i = 0; i < etta->priv->n_map; i++)
-		etta->priv->map_table[i]->index = i;
-	etta->priv->remap_needed = FALSE;
+	while (gnode) {
+		if (gnode->next)
+			return ((node_t *) gnode->next->data)->iter;
+
+		gnode = gnode->parent;
+	}
+
+	return g_sequence_get_end_iter (etta->priv->map);
 }
 
 static node_t *
@@ -189,24 +213,56 @@ get_node (ETreeTableAdapter *etta,
 	return (node_t *) gnode->data;
 }
 
+/* Returns the sort info to be used for the children of 'gnode',
+ * or NULL, when the children are not sorted at all. */
+static ETableSortInfo *
+get_children_sort_info (ETreeTableAdapter *etta,
+                        GNode *gnode)
+{
+	gint i, len;
+
+	if (!etta->priv->sort_info || e_table_sort_info_sorting_get_count (etta->priv->sort_info) <= 0)
+		return NULL;
+
+	if (!etta->priv->sort_children_ascending || !gnode->parent)
+		return etta->priv->sort_info;
+
+	if (!etta->priv->children_sort_info) {
+		etta->priv->children_sort_info = e_table_sort_info_duplicate (etta->priv->sort_info);
+
+		len = e_table_sort_info_sorting_get_count (etta->priv->children_sort_info);
+
+		for (i = 0; i < len; i++) {
+			ETableColumnSpecification *spec;
+			GtkSortType sort_type;
+
+			spec = e_table_sort_info_sorting_get_nth (etta->priv->children_sort_info, i, &sort_type);
+			if (spec) {
+				if (sort_type == GTK_SORT_DESCENDING)
+					e_table_sort_info_sorting_set_nth (etta->priv->children_sort_info, i, spec, GTK_SORT_ASCENDING);
+			}
+		}
+	}
+
+	return etta->priv->children_sort_info;
+}
+
 static void
 resort_node (ETreeTableAdapter *etta,
              GNode *gnode,
              gboolean recurse)
 {
 	node_t *node = (node_t *) gnode->data;
+	ETableSortInfo *use_sort_info;
 	ETreePath *paths, path;
 	GNode *prev, *curr;
 	gint i, count;
-	gboolean sort_needed;
 
 	g_return_if_fail (node != NULL);
 
 	if (node->num_visible_children == 0)
 		return;
 
-	sort_needed = etta->priv->sort_info && e_table_sort_info_sorting_get_count (etta->priv->sort_info) > 0;
-
 	for (i = 0, path = e_tree_model_node_get_first_child (etta->priv->source_model, node->path); path;
 	     path = e_tree_model_node_get_next (etta->priv->source_model, path), i++);
 
@@ -220,36 +276,10 @@ resort_node (ETreeTableAdapter *etta,
 	     path = e_tree_model_node_get_next (etta->priv->source_model, path), i++)
 		paths[i] = path;
 
-	if (count > 1 && sort_needed) {
-		ETableSortInfo *use_sort_info;
-
-		use_sort_info = etta->priv->sort_info;
-
-		if (etta->priv->sort_children_ascending && gnode->parent) {
-			if (!etta->priv->children_sort_info) {
-				gint len;
-
-				etta->priv->children_sort_info = e_table_sort_info_duplicate (etta->priv->sort_info);
-
-				len = e_table_sort_info_sorting_get_count (etta->priv->children_sort_info);
-
-				for (i = 0; i < len; i++) {
-					ETableColumnSpecification *spec;
-					GtkSortType sort_type;
-
-					spec = e_table_sort_info_sorting_get_nth (etta->priv->children_sort_info, i, &sort_type);
-					if (spec) {
-						if (sort_type == GTK_SORT_DESCENDING)
-							e_table_sort_info_sorting_set_nth (etta->priv->children_sort_info, i, spec, GTK_SORT_ASCENDING);
-					}
-				}
-			}
-
-			use_sort_info = etta->priv->children_sort_info;
-		}
+	use_sort_info = get_children_sort_info (etta, gnode);
 
+	if (count > 1 && use_sort_info)
 		e_table_sorting_utils_tree_sort (etta->priv->source_model, use_sort_info, etta->priv->header, paths, count);
-	}
 
 	prev = NULL;
 	for (i = 0; i < count; i++) {
@@ -338,11 +368,11 @@ delete_node (ETreeTableAdapter *etta,
 		return;
 	}
 
-	to_remove += delete_children (etta, gnode);
-	kill_gnode (gnode, etta);
+	to_remove += ((node_t *) gnode->data)->num_visible_children;
+	map_remove_rows (etta, ((node_t *) gnode->data)->iter, to_remove);
 
-	move_map_elements (etta, row, row + to_remove, etta->priv->n_map - row - to_remove);
-	resize_map (etta, etta->priv->n_map - to_remove);
+	delete_children (etta, gnode);
+	kill_gnode (gnode, etta);
 
 	if (parent_gnode != NULL) {
 		node_t *parent_node = parent_gnode->data;
@@ -355,7 +385,8 @@ delete_node (ETreeTableAdapter *etta,
 			e_table_model_row_changed (E_TABLE_MODEL (etta), parent_row);
 		}
 
-		resort_node (etta, parent_gnode, FALSE);
+		/* Removing a node does not change the order of its siblings,
+		 * thus there is no need to resort the parent node here. */
 	}
 
 	e_table_model_rows_deleted (E_TABLE_MODEL (etta), row, to_remove);
@@ -370,7 +401,7 @@ create_gnode (ETreeTableAdapter *etta,
 
 	node = g_new0 (node_t, 1);
 	node->path = path;
-	node->index = -1;
+	node->iter = NULL;
 	node->expanded = etta->priv->force_expanded_state == 0 ? e_tree_model_get_expanded_default (etta->priv->source_model) : etta->priv->force_expanded_state > 0;
 	node->expandable = e_tree_model_node_is_expandable (etta->priv->source_model, path);
 	node->expandable_set = 1;
@@ -409,15 +440,14 @@ generate_tree (ETreeTableAdapter *etta,
 {
 	GNode *gnode;
 	node_t *node;
-	gint size;
 
 	e_table_model_pre_change (E_TABLE_MODEL (etta));
 
 	g_return_if_fail (e_tree_model_node_is_root (etta->priv->source_model, path));
 
+	map_clear (etta);
 	if (etta->priv->root)
 		kill_gnode (etta->priv->root, etta);
-	resize_map (etta, 0);
 
 	gnode = create_gnode (etta, path);
 	node = (node_t *) gnode->data;
@@ -427,12 +457,55 @@ generate_tree (ETreeTableAdapter *etta,
 		resort_node (etta, gnode, TRUE);
 
 	etta->priv->root = gnode;
-	size = etta->priv->root_visible ? node->num_visible_children + 1 : node->num_visible_children;
-	resize_map (etta, size);
-	fill_map (etta, 0, gnode);
+	map_fill (etta);
 	e_table_model_changed (E_TABLE_MODEL (etta));
 }
 
+/* Links a newly created 'gnode' among the children of 'parent_gnode'.
+ * The existing children are already in order, thus only the position
+ * of the new node is looked up, instead of resorting all the siblings,
+ * which is expensive for nodes with many children. */
+static void
+link_gnode_sorted (ETreeTableAdapter *etta,
+                   GNode *parent_gnode,
+                   GNode *gnode)
+{
+	ETableSortInfo *use_sort_info;
+	ETreePath path, tmp;
+	gint position = 0;
+
+	path = ((node_t *) gnode->data)->path;
+	use_sort_info = get_children_sort_info (etta, parent_gnode);
+
+	if (use_sort_info && parent_gnode->children) {
+		ETreePath *paths;
+		GNode *child;
+		gint count;
+
+		count = g_node_n_children (parent_gnode);
+		paths = g_new (ETreePath, count);
+
+		for (position = 0, child = parent_gnode->children; child; child = child->next, position++)
+			paths[position] = ((node_t *) child->data)->path;
+
+		position = e_table_sorting_utils_tree_insert (
+			etta->priv->source_model, use_sort_info,
+			etta->priv->header, paths, count, path);
+
+		g_free (paths);
+	} else if (!use_sort_info) {
+		/* Follow the order of the source model */
+		for (tmp = e_tree_model_node_get_first_child (etta->priv->source_model, ((node_t *) parent_gnode->data)->path);
+		     tmp && tmp != path;
+		     tmp = e_tree_model_node_get_next (etta->priv->source_model, tmp)) {
+			if (lookup_gnode (etta, tmp))
+				position++;
+		}
+	}
+
+	g_node_insert (parent_gnode, position, gnode);
+}
+
 static void
 insert_node (ETreeTableAdapter *etta,
              ETreePath parent,
@@ -441,7 +514,7 @@ insert_node (ETreeTableAdapter *etta,
 	GNode *gnode, *parent_gnode;
 	node_t *node, *parent_node;
 	gboolean expandable;
-	gint size, row;
+	gint size;
 
 	e_table_model_pre_change (E_TABLE_MODEL (etta));
 
@@ -469,7 +542,7 @@ insert_node (ETreeTableAdapter *etta,
 			e_table_model_pre_change (E_TABLE_MODEL (etta));
 			parent_node->expandable = expandable;
 			parent_node->expandable_set = 1;
-			e_table_model_row_changed (E_TABLE_MODEL (etta), parent_node->index);
+			e_table_model_row_changed (E_TABLE_MODEL (etta), e_tree_table_adapter_row_of_node (etta, parent));
 		}
 	}
 
@@ -484,22 +557,13 @@ insert_node (ETreeTableAdapter *etta,
 	if (node->expanded)
 		node->num_visible_children = insert_children (etta, gnode);
 
-	g_node_append (parent_gnode, gnode);
+	link_gnode_sorted (etta, parent_gnode, gnode);
 	update_child_counts (parent_gnode, node->num_visible_children + 1);
-	resort_node (etta, parent_gnode, FALSE);
 	resort_node (etta, gnode, TRUE);
 
 	size = node->num_visible_children + 1;
-	resize_map (etta, etta->priv->n_map + size);
-	if (parent_gnode == etta->priv->root)
-		row = 0;
-	else {
-		gint new_size = parent_node->num_visible_children + 1;
-		gint old_size = new_size - size;
-		row = parent_node->index;
-		move_map_elements (etta, row + new_size, row + old_size, etta->priv->n_map - row - new_size);
-	}
-	fill_map (etta, row, parent_gnode);
+	map_insert_subtree (etta, map_iter_after_subtree (etta, gnode), gnode, TRUE);
+
 	e_table_model_rows_inserted (
 		E_TABLE_MODEL (etta),
 		e_tree_table_adapter_row_of_node (etta, path), size);
@@ -574,7 +638,7 @@ tree_table_adapter_sort_info_changed_cb (ETableSortInfo *sort_info,
 
 	e_table_model_pre_change (E_TABLE_MODEL (etta));
 	resort_node (etta, etta->priv->root, TRUE);
-	fill_map (etta, 0, etta->priv->root);
+	map_fill (etta);
 	e_table_model_changed (E_TABLE_MODEL (etta));
 }
 
@@ -592,6 +656,7 @@ tree_table_adapter_source_model_rebuilt_cb (ETreeModel *source_model,
 	if (!etta->priv->root)
 		return;
 
+	map_clear (etta);
 	kill_gnode (etta->priv->root, etta);
 	etta->priv->root = NULL;
 
@@ -847,7 +912,7 @@ tree_table_adapter_finalize (GObject *object)
 
 	g_hash_table_destroy (priv->nodes);
 
-	g_free (priv->map_table);
+	g_sequence_free (priv->map);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_tree_table_adapter_parent_class)->finalize (object);
@@ -1141,9 +1206,9 @@ e_tree_table_adapter_init (ETreeTableAdapter *etta)
 	etta->priv = E_TREE_TABLE_ADAPTER_GET_PRIVATE (etta);
 
 	etta->priv->nodes = g_hash_table_new (NULL, NULL);
+	etta->priv->map = g_sequence_new (NULL);
 
 	etta->priv->root_visible = TRUE;
-	etta->priv->remap_needed = TRUE;
 }
 
 ETableModel *
@@ -1224,7 +1289,7 @@ e_tree_table_adapter_set_sort_info (ETreeTableAdapter *etta,
 
 	e_table_model_pre_change (E_TABLE_MODEL (etta));
 	resort_node (etta, etta->priv->root, TRUE);
-	fill_map (etta, 0, etta->priv->root);
+	map_fill (etta);
 	e_table_model_changed (E_TABLE_MODEL (etta));
 }
 
@@ -1255,7 +1320,7 @@ e_tree_table_adapter_set_sort_children_ascending (ETreeTableAdapter *etta,
 
 	e_table_model_pre_change (E_TABLE_MODEL (etta));
 	resort_node (etta, etta->priv->root, TRUE);
-	fill_map (etta, 0, etta->priv->root);
+	map_fill (etta);
 	e_table_model_changed (E_TABLE_MODEL (etta));
 }
 
@@ -1469,8 +1534,6 @@ void
 e_tree_table_adapter_root_node_set_visible (ETreeTableAdapter *etta,
                                             gboolean visible)
 {
-	gint size;
-
 	g_return_if_fail (E_IS_TREE_TABLE_ADAPTER (etta));
 
 	if (etta->priv->root_visible == visible)
@@ -1484,10 +1547,7 @@ e_tree_table_adapter_root_node_set_visible (ETreeTableAdapter *etta,
 		if (root)
 			e_tree_table_adapter_node_set_expanded (etta, root, TRUE);
 	}
-	size = (visible ? 1 : 0) + (etta->priv->root ? ((node_t *) etta->priv->root->data)->num_visible_children : 0);
-	resize_map (etta, size);
-	if (etta->priv->root)
-		fill_map (etta, 0, etta->priv->root);
+	map_fill (etta);
 	e_table_model_changed (E_TABLE_MODEL (etta));
 }
 
@@ -1535,22 +1595,20 @@ e_tree_table_adapter_node_set_expanded (ETreeTableAdapter *etta,
 		update_child_counts (gnode, num_children);
 		if (etta->priv->sort_info && e_table_sort_info_sorting_get_count (etta->priv->sort_info) > 0)
 			resort_node (etta, gnode, TRUE);
-		resize_map (etta, etta->priv->n_map + num_children);
-		move_map_elements (etta, row + 1 + num_children, row + 1, etta->priv->n_map - row - 1 - num_children);
-		fill_map (etta, row, gnode);
+		map_insert_subtree (etta, g_sequence_iter_next (node->iter), gnode, FALSE);
 		if (num_children != 0) {
 			e_table_model_rows_inserted (E_TABLE_MODEL (etta), row + 1, num_children);
 		} else
 			e_table_model_no_change (E_TABLE_MODEL (etta));
 	} else {
-		gint num_children = delete_children (etta, gnode);
+		gint num_children = node->num_visible_children;
 		if (num_children == 0) {
 			e_table_model_no_change (E_TABLE_MODEL (etta));
 			return;
 		}
-		move_map_elements (etta, row + 1, row + 1 + num_children, etta->priv->n_map - row - 1 - num_children);
+		map_remove_rows (etta, g_sequence_iter_next (node->iter), num_children);
+		delete_children (etta, gnode);
 		update_child_counts (gnode, - num_children);
-		resize_map (etta, etta->priv->n_map - num_children);
 		e_table_model_rows_deleted (E_TABLE_MODEL (etta), row + 1, num_children);
 	}
 }
@@ -1577,6 +1635,8 @@ ETreePath
 e_tree_table_adapter_node_at_row (ETreeTableAdapter *etta,
                                   gint row)
 {
+	node_t *node;
+
 	g_return_val_if_fail (E_IS_TREE_TABLE_ADAPTER (etta), NULL);
 
 	if (row == -1 && etta->priv->n_map > 0)
@@ -1584,7 +1644,9 @@ e_tree_table_adapter_node_at_row (ETreeTableAdapter *etta,
 	else if (row < 0 || row >= etta->priv->n_map)
 		return NULL;
 
-	return etta->priv->map_table[row]->path;
+	node = g_sequence_get (g_sequence_get_iter_at_pos (etta->priv->map, row));
+
+	return node->path;
 }
 
 gint
@@ -1599,10 +1661,10 @@ e_tree_table_adapter_row_of_node (ETreeTableAdapter *etta,
 	if (node == NULL)
 		return -1;
 
-	if (etta->priv->remap_needed)
-		remap_indices (etta);
+	if (!node->iter)
+		return -1;
 
-	return node->index;
+	return g_sequence_iter_get_position (node->iter);
 }
 
 gboolean
@@ -1665,7 +1727,7 @@ e_tree_table_adapter_clear_nodes_silent (ETreeTableAdapter *etta)
 {
 	g_return_if_fail (E_IS_TREE_TABLE_ADAPTER (etta));
 
+	map_clear (etta);
 	if (etta->priv->root)
 		kill_gnode (etta->priv->root, etta);
-	resize_map (etta, 0);
 }
@@ -251,6 +251,7 @@
 #include <e-util/e-text-model-repos.h>
 #include <e-util/e-text-model.h>
 #include <e-util/e-text.h>
+#include <e-util/e-time-index.h>
 #include <e-util/e-timezone-dialog.h>
 #include <e-util/e-tree-model-generator.h>
 #include <e-util/e-tree-model.h>
@@ -0,0 +1,442 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/* test-cell-text.c - Benchmark for drawing ECellText cells.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include <e-util/e-util.h>
+
+#define WIDTH 800
+#define HEIGHT 600
+
+#define COL_FROM 0
+#define COL_SUBJECT 1
+#define COL_DATE 2
+#define COL_UNREAD 3
+#define N_COLUMNS 4
+
+static const gchar *test_etspec =
+	"<ETableSpecification>\n"
+	"  <ETableColumn model_col=\"0\" _title=\"From\" expansion=\"1.0\" minimum_width=\"32\""
+	" resizable=\"true\" cell=\"string\" compare=\"string\"/>\n"
+	"  <ETableColumn model_col=\"1\" _title=\"Subject\" expansion=\"1.6\" minimum_width=\"32\""
+	" resizable=\"true\" cell=\"string\" compare=\"string\"/>\n"
+	"  <ETableColumn model_col=\"2\" _title=\"Date\" expansion=\"0.4\" minimum_width=\"32\""
+	" resizable=\"true\" cell=\"string\" compare=\"string\"/>\n"
+	"  <ETableState>\n"
+	"    <column source=\"0\"/>\n"
+	"    <column source=\"1\"/>\n"
+	"    <column source=\"2\"/>\n"
+	"    <grouping/>\n"
+	"  </ETableState>\n"
+	"</ETableSpecification>\n";
+
+static gint opt_rows = 10000;
+static gint opt_frames = 200;
+
+static GOptionEntry entries[] = {
+	{ "rows", 'r', 0, G_OPTION_ARG_INT, &opt_rows,
+	  "Number of rows in the table", "N" },
+	{ "frames", 'f', 0, G_OPTION_ARG_INT, &opt_frames,
+	  "Number of frames drawn in each scenario", "N" },
+	{ NULL }
+};
+
+/* A message-list-like model, with every third row unread (bold). */
+
+#define TEST_TYPE_TABLE_MODEL (test_table_model_get_type ())
+
+typedef struct _TestTableModel TestTableModel;
+typedef struct _TestTableModelClass TestTableModelClass;
+
+struct _TestTableModel {
+	GObject parent;
+
+	gint n_rows;
+	gchar **values;		/* n_rows * (N_COLUMNS - 1) strings */
+};
+
+struct _TestTableModelClass {
+	GObjectClass parent_class;
+};
+
+GType test_table_model_get_type (void);
+static void test_table_model_table_model_init (ETableModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (
+	TestTableModel,
+	test_table_model,
+	G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE (
+		E_TYPE_TABLE_MODEL,
+		test_table_model_table_model_init))
+
+static void
+test_table_model_finalize (GObject *object)
+{
+	TestTableModel *model = (TestTableModel *) object;
+
+	g_strfreev (model->values);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (test_table_model_parent_class)->finalize (object);
+}
+
+static gint
+test_table_model_column_count (ETableModel *table_model)
+{
+	return N_COLUMNS;
+}
+
+static gint
+test_table_model_row_count (ETableModel *table_model)
+{
+	return ((TestTableModel *) table_model)->n_rows;
+}
+
+static gpointer
+test_table_model_value_at (ETableModel *table_model,
+                           gint col,
+                           gint row)
+{
+	TestTableModel *model = (TestTableModel *) table_model;
+
+	if (col == COL_UNREAD)
+		return GINT_TO_POINTER (row % 3 == 0);
+
+	return model->values[row * (N_COLUMNS - 1) + col];
+}
+
+static void
+test_table_model_class_init (TestTableModelClass *class)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = test_table_model_finalize;
+}
+
+static void
+test_table_model_table_model_init (ETableModelInterface *iface)
+{
+	iface->column_count = test_table_model_column_count;
+	iface->row_count = test_table_model_row_count;
+	iface->value_at = test_table_model_value_at;
+}
+
+static void
+test_table_model_init (TestTableModel *model)
+{
+}
+
+static TestTableModel *
+test_table_model_new (gint n_rows)
+{
+	static const gchar *names[] = {
+		"Alice Smith", "Bob Jones", "Čeněk Dvořák", "Dana Lee",
+		"Évariste Galois", "Frank Miller", "Gražina Kazlauskienė"
+	};
+	static const gchar *words[] = {
+		"meeting", "report", "invoice", "Re:", "status", "update",
+		"Lunch", "release", "patch", "review", "Évolution", "agenda"
+	};
+	TestTableModel *model;
+	GRand *rand;
+	gint ii;
+
+	model = g_object_new (TEST_TYPE_TABLE_MODEL, NULL);
+	model->n_rows = n_rows;
+	model->values = g_new0 (gchar *, n_rows * (N_COLUMNS - 1) + 1);
+
+	rand = g_rand_new_with_seed (n_rows);
+
+	for (ii = 0; ii < n_rows; ii++) {
+		gchar **values = model->values + ii * (N_COLUMNS - 1);
+
+		values[COL_FROM] = g_strdup (names[g_rand_int_range (rand, 0, G_N_ELEMENTS (names))]);
+		values[COL_SUBJECT] = g_strdup_printf ("%s %s %s %d",
+			words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+			words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+			words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+			g_rand_int_range (rand, 0, 1000));
+		values[COL_DATE] = g_strdup_printf ("%02d.%02d.2020 %02d:%02d",
+			g_rand_int_range (rand, 1, 29),
+			g_rand_int_range (rand, 1, 13),
+			g_rand_int_range (rand, 0, 24),
+			g_rand_int_range (rand, 0, 60));
+	}
+
+	g_rand_free (rand);
+
+	return model;
+}
+
+static ETableSpecification *
+create_specification (void)
+{
+	ETableSpecification *specification;
+	GError *local_error = NULL;
+	gchar *filename = NULL;
+	gint fd;
+
+	fd = g_file_open_tmp ("test-cell-text-XXXXXX.etspec", &filename, &local_error);
+	if (fd == -1) {
+		g_printerr ("Failed to create temporary file: %s\n", local_error->message);
+		g_clear_error (&local_error);
+		return NULL;
+	}
+
+	close (fd);
+
+	if (!g_file_set_contents (filename, test_etspec, -1, &local_error)) {
+		g_printerr ("Failed to write '%s': %s\n", filename, local_error->message);
+		g_clear_error (&local_error);
+		g_unlink (filename);
+		g_free (filename);
+		return NULL;
+	}
+
+	specification = e_table_specification_new (filename, &local_error);
+	if (!specification) {
+		g_printerr ("Failed to load specification: %s\n", local_error->message);
+		g_clear_error (&local_error);
+	}
+
+	g_unlink (filename);
+	g_free (filename);
+
+	return specification;
+}
+
+static void
+process_events (void)
+{
+	while (gtk_events_pending ())
+		gtk_main_iteration ();
+}
+
+static void
+draw_frame (ETable *table,
+            cairo_surface_t *surface)
+{
+	cairo_t *cr;
+
+	cr = cairo_create (surface);
+	gtk_widget_draw (GTK_WIDGET (table->table_canvas), cr);
+	cairo_destroy (cr);
+
+	cairo_surface_flush (surface);
+}
+
+static gboolean
+surfaces_equal (cairo_surface_t *surface1,
+                cairo_surface_t *surface2)
+{
+	return memcmp (
+		cairo_image_surface_get_data (surface1),
+		cairo_image_surface_get_data (surface2),
+		cairo_image_surface_get_stride (surface1) * HEIGHT) == 0;
+}
+
+static GtkWidget *
+create_window (TestTableModel *model,
+               ETableExtras *extras,
+               ETableSpecification *specification,
+               ETable **out_table)
+{
+	GtkWidget *window, *widget;
+
+	window = gtk_offscreen_window_new ();
+	gtk_window_set_default_size (GTK_WINDOW (window), WIDTH, HEIGHT);
+
+	widget = e_table_new (E_TABLE_MODEL (model), extras, specification);
+	gtk_container_add (GTK_CONTAINER (window), widget);
+	gtk_widget_show_all (window);
+	process_events ();
+
+	*out_table = E_TABLE (widget);
+
+	return window;
+}
+
+/* Redraws the benchmarked table and compares it with a new table of the
+ * same model, which has no cached layouts. A stale layout, which was not
+ * dropped after a model change, makes them differ. */
+static gboolean
+check_matches_new_table (ETable *table,
+                         TestTableModel *model,
+                         ETableExtras *extras,
+                         ETableSpecification *specification,
+                         cairo_surface_t *surface,
+                         const gchar *what)
+{
+	ETable *new_table = NULL;
+	GtkWidget *window;
+	cairo_surface_t *expected;
+	gboolean matches;
+
+	expected = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+
+	window = create_window (model, extras, specification, &new_table);
+	draw_frame (new_table, expected);
+	gtk_widget_destroy (window);
+
+	draw_frame (table, surface);
+
+	matches = surfaces_equal (surface, expected);
+	if (!matches)
+		g_printerr ("Stale layouts were drawn after %s\n", what);
+
+	cairo_surface_destroy (expected);
+
+	return matches;
+}
+
+static void
+print_frame_time (const gchar *label,
+                  GTimer *timer,
+                  gint n_frames)
+{
+	g_print ("  %-26s %7.2f ms/frame\n", label, g_timer_elapsed (timer, NULL) * 1000.0 / n_frames);
+}
+
+static gint
+run_benchmark (gint n_rows,
+               gint n_frames)
+{
+	ETableSpecification *specification;
+	ETableExtras *extras;
+	ECell *cell;
+	TestTableModel *model;
+	ETable *table = NULL;
+	GtkWidget *window;
+	GtkAdjustment *adjustment;
+	cairo_surface_t *surface, *reference;
+	GTimer *timer;
+	gdouble page_size, upper;
+	gint ii;
+	gint res = 0;
+
+	specification = create_specification ();
+	if (!specification)
+		return 1;
+
+	extras = e_table_extras_new ();
+
+	/* Draw unread rows in bold, like the message list does */
+	cell = e_table_extras_get_cell (extras, "string");
+	g_object_set (cell, "bold_column", COL_UNREAD, NULL);
+
+	g_print ("Drawing %d rows of a message-list-like table in %dx%d\n", n_rows, WIDTH, HEIGHT);
+
+	model = test_table_model_new (n_rows);
+	window = create_window (model, extras, specification, &table);
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+	reference = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+
+	timer = g_timer_new ();
+
+	/* The first frame shapes all the visible texts */
+	draw_frame (table, reference);
+	print_frame_time ("First frame:", timer, 1);
+
+	g_timer_start (timer);
+	for (ii = 0; ii < n_frames; ii++)
+		draw_frame (table, surface);
+	print_frame_time ("Unchanged:", timer, n_frames);
+
+	if (!surfaces_equal (surface, reference)) {
+		g_printerr ("Redrawn frame differs from the first one\n");
+		res = 1;
+	}
+
+	/* Scroll up and down over the first few pages, like a user
+	 * browsing the recent messages would. */
+	adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (table->table_canvas));
+	page_size = gtk_adjustment_get_page_size (adjustment);
+	upper = MAX (gtk_adjustment_get_upper (adjustment) - page_size, 0);
+
+	g_timer_start (timer);
+	for (ii = 0; ii < n_frames; ii++) {
+		gint step = ii % 40;
+
+		if (step >= 20)
+			step = 40 - step;
+
+		gtk_adjustment_set_value (adjustment, MIN (step * page_size / 4, upper));
+		process_events ();
+		draw_frame (table, surface);
+	}
+	print_frame_time ("Scrolling:", timer, n_frames);
+
+	gtk_adjustment_set_value (adjustment, 0);
+	process_events ();
+
+	/* Change every visible subject; their cached layouts
+	 * have to be dropped and shaped again. */
+	for (ii = 0; ii < n_rows && ii < 100; ii++) {
+		gchar **value = &model->values[ii * (N_COLUMNS - 1) + COL_SUBJECT];
+
+		g_free (*value);
+		*value = g_strdup_printf ("Changed subject %d", ii);
+		e_table_model_cell_changed (E_TABLE_MODEL (model), COL_SUBJECT, ii);
+	}
+	process_events ();
+
+	if (!check_matches_new_table (table, model, extras, specification, surface, "cell changes"))
+		res = 1;
+
+	/* The same for whole rows */
+	for (ii = 0; ii < n_rows && ii < 100; ii++) {
+		gchar **value = &model->values[ii * (N_COLUMNS - 1) + COL_FROM];
+
+		g_free (*value);
+		*value = g_strdup_printf ("Changed sender %d", ii);
+		e_table_model_row_changed (E_TABLE_MODEL (model), ii);
+	}
+	process_events ();
+
+	if (!check_matches_new_table (table, model, extras, specification, surface, "row changes"))
+		res = 1;
+
+	g_timer_destroy (timer);
+	cairo_surface_destroy (reference);
+	cairo_surface_destroy (surface);
+	gtk_widget_destroy (window);
+	g_object_unref (model);
+	g_object_unref (extras);
+	g_object_unref (specification);
+
+	return res;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GError *local_error = NULL;
+
+	if (!gtk_init_with_args (&argc, &argv, NULL, entries, NULL, &local_error)) {
+		g_printerr ("%s\n", local_error ? local_error->message : "Failed to initialize GTK+");
+		g_clear_error (&local_error);
+		return 1;
+	}
+
+	return run_benchmark (MAX (opt_rows, 1), MAX (opt_frames, 1));
+}
@@ -0,0 +1,350 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/* test-table-sorter.c - Benchmark for ETableSorter.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include <e-util/e-util.h>
+
+static const gchar *test_etspec =
+	"<ETableSpecification>\n"
+	"  <ETableColumn model_col=\"0\" _title=\"Date\" expansion=\"0.4\" minimum_width=\"32\""
+	" resizable=\"true\" cell=\"date\" compare=\"pointer-integer64\"/>\n"
+	"  <ETableColumn model_col=\"1\" _title=\"Subject\" expansion=\"1.6\" minimum_width=\"32\""
+	" resizable=\"true\" cell=\"string\" compare=\"stringcase\"/>\n"
+	"</ETableSpecification>\n";
+
+static gint opt_rows = 500000;
+static gint opt_changes = 100;
+
+static GOptionEntry entries[] = {
+	{ "rows", 'r', 0, G_OPTION_ARG_INT, &opt_rows,
+	  "Number of rows to sort", "N" },
+	{ "changes", 'c', 0, G_OPTION_ARG_INT, &opt_changes,
+	  "Number of rows changed before the re-sort", "N" },
+	{ NULL }
+};
+
+/* A simple model with a date and a subject column. */
+
+#define TEST_TYPE_TABLE_MODEL (test_table_model_get_type ())
+
+typedef struct _TestTableModel TestTableModel;
+typedef struct _TestTableModelClass TestTableModelClass;
+
+struct _TestTableModel {
+	GObject parent;
+
+	gint n_rows;
+	gint64 *dates;
+	gchar **subjects;
+};
+
+struct _TestTableModelClass {
+	GObjectClass parent_class;
+};
+
+GType test_table_model_get_type (void);
+static void test_table_model_table_model_init (ETableModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (
+	TestTableModel,
+	test_table_model,
+	G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE (
+		E_TYPE_TABLE_MODEL,
+		test_table_model_table_model_init))
+
+static void
+test_table_model_finalize (GObject *object)
+{
+	TestTableModel *model = (TestTableModel *) object;
+	gint ii;
+
+	for (ii = 0; ii < model->n_rows; ii++)
+		g_free (model->subjects[ii]);
+
+	g_free (model->subjects);
+	g_free (model->dates);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (test_table_model_parent_class)->finalize (object);
+}
+
+static gint
+test_table_model_column_count (ETableModel *table_model)
+{
+	return 2;
+}
+
+static gint
+test_table_model_row_count (ETableModel *table_model)
+{
+	return ((TestTableModel *) table_model)->n_rows;
+}
+
+static gpointer
+test_table_model_value_at (ETableModel *table_model,
+                           gint col,
+                           gint row)
+{
+	TestTableModel *model = (TestTableModel *) table_model;
+
+	if (col == 0)
+		return &model->dates[row];
+
+	return model->subjects[row];
+}
+
+static void
+test_table_model_class_init (TestTableModelClass *class)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = test_table_model_finalize;
+}
+
+static void
+test_table_model_table_model_init (ETableModelInterface *iface)
+{
+	iface->column_count = test_table_model_column_count;
+	iface->row_count = test_table_model_row_count;
+	iface->value_at = test_table_model_value_at;
+}
+
+static void
+test_table_model_init (TestTableModel *model)
+{
+}
+
+static TestTableModel *
+test_table_model_new (gint n_rows)
+{
+	static const gchar *words[] = {
+		"meeting", "report", "invoice", "Re:", "status", "update",
+		"Lunch", "release", "patch", "review", "Évolution", "agenda"
+	};
+	TestTableModel *model;
+	GRand *rand;
+	gint ii;
+
+	model = g_object_new (TEST_TYPE_TABLE_MODEL, NULL);
+	model->n_rows = n_rows;
+	model->dates = g_new (gint64, n_rows);
+	model->subjects = g_new (gchar *, n_rows);
+
+	rand = g_rand_new_with_seed (n_rows);
+
+	for (ii = 0; ii < n_rows; ii++) {
+		/* Plenty of equal dates, to sort by the subject too. */
+		model->dates[ii] = 1500000000 + g_rand_int_range (rand, 0, n_rows / 4 + 1) * 60;
+		model->subjects[ii] = g_strdup_printf ("%s %s %d",
+			words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+			words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+			g_rand_int_range (rand, 0, 1000));
+	}
+
+	g_rand_free (rand);
+
+	return model;
+}
+
+static ETableSpecification *
+create_specification (void)
+{
+	ETableSpecification *specification;
+	GError *local_error = NULL;
+	gchar *filename = NULL;
+	gint fd;
+
+	fd = g_file_open_tmp ("test-table-sorter-XXXXXX.etspec", &filename, &local_error);
+	if (fd == -1) {
+		g_printerr ("Failed to create temporary file: %s\n", local_error->message);
+		g_clear_error (&local_error);
+		return NULL;
+	}
+
+	close (fd);
+
+	if (!g_file_set_contents (filename, test_etspec, -1, &local_error)) {
+		g_printerr ("Failed to write '%s': %s\n", filename, local_error->message);
+		g_clear_error (&local_error);
+		g_unlink (filename);
+		g_free (filename);
+		return NULL;
+	}
+
+	specification = e_table_specification_new (filename, &local_error);
+	if (!specification) {
+		g_printerr ("Failed to load specification: %s\n", local_error->message);
+		g_clear_error (&local_error);
+	}
+
+	g_unlink (filename);
+	g_free (filename);
+
+	return specification;
+}
+
+static gboolean
+check_sorted (TestTableModel *model,
+              gint *sorted)
+{
+	gint ii;
+
+	for (ii = 1; ii < model->n_rows; ii++) {
+		gint row1 = sorted[ii - 1], row2 = sorted[ii];
+
+		/* Date descending, then subject ascending. */
+		if (model->dates[row1] < model->dates[row2])
+			return FALSE;
+
+		if (model->dates[row1] == model->dates[row2] &&
+		    e_str_case_compare (model->subjects[row1], model->subjects[row2]) > 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Prints how long the sort took and how it compares to the full sort */
+static void
+print_sort_time (const gchar *label,
+                 gdouble seconds,
+                 gdouble full_sort_seconds)
+{
+	if (full_sort_seconds > 0.0 && seconds > 0.0)
+		g_print ("  %-30s %9.1f ms  (%5.1fx)\n", label, seconds * 1000.0, full_sort_seconds / seconds);
+	else
+		g_print ("  %-30s %9.1f ms\n", label, seconds * 1000.0);
+}
+
+static gint
+run_benchmark (gint n_rows,
+               gint n_changes)
+{
+	ETableSpecification *specification;
+	ETableExtras *extras;
+	ETableHeader *full_header;
+	ETableSortInfo *sort_info;
+	ETableSorter *sorter;
+	TestTableModel *model;
+	GPtrArray *columns;
+	GTimer *timer;
+	gdouble full_sort;
+	gint *map_table;
+	gint *sorted = NULL;
+	gint ii, count = 0;
+	gint res = 0;
+
+	specification = create_specification ();
+	if (!specification)
+		return 1;
+
+	extras = e_table_extras_new ();
+	full_header = e_table_spec_to_full_header (specification, extras);
+
+	columns = e_table_specification_ref_columns (specification);
+	sort_info = e_table_sort_info_new (specification);
+	e_table_sort_info_sorting_insert (sort_info, 0, g_ptr_array_index (columns, 0), GTK_SORT_DESCENDING);
+	e_table_sort_info_sorting_insert (sort_info, 1, g_ptr_array_index (columns, 1), GTK_SORT_ASCENDING);
+	g_ptr_array_unref (columns);
+
+	model = test_table_model_new (n_rows);
+
+	map_table = g_new (gint, n_rows);
+	for (ii = 0; ii < n_rows; ii++)
+		map_table[ii] = ii;
+
+	g_print ("Sorting %d rows by date, then by subject; times relative to a full sort\n", n_rows);
+
+	timer = g_timer_new ();
+	e_table_sorting_utils_sort (E_TABLE_MODEL (model), sort_info, full_header, map_table, n_rows);
+	full_sort = g_timer_elapsed (timer, NULL);
+	print_sort_time ("e_table_sorting_utils_sort():", full_sort, 0.0);
+
+	if (!check_sorted (model, map_table)) {
+		g_printerr ("e_table_sorting_utils_sort() returned wrong order\n");
+		res = 1;
+	}
+
+	sorter = e_table_sorter_new (E_TABLE_MODEL (model), full_header, sort_info);
+
+	/* The sorter reads all the keys the first time */
+	g_timer_start (timer);
+	e_sorter_get_sorted_to_model_array (E_SORTER (sorter), &sorted, &count);
+	print_sort_time ("ETableSorter, no keys:", g_timer_elapsed (timer, NULL), full_sort);
+
+	if (count != n_rows || memcmp (sorted, map_table, sizeof (gint) * n_rows) != 0) {
+		g_printerr ("ETableSorter and e_table_sorting_utils_sort() disagree\n");
+		res = 1;
+	}
+
+	/* Change a few rows and sort again, only those should be re-read. */
+	for (ii = 0; ii < n_changes && ii < n_rows; ii++) {
+		gint row = (gint) (((gint64) ii * 7919) % n_rows);
+
+		model->dates[row] += 3600;
+		e_table_model_row_changed (E_TABLE_MODEL (model), row);
+	}
+
+	g_timer_start (timer);
+	e_sorter_get_sorted_to_model_array (E_SORTER (sorter), &sorted, &count);
+	print_sort_time ("ETableSorter, rows changed:", g_timer_elapsed (timer, NULL), full_sort);
+
+	if (!check_sorted (model, sorted)) {
+		g_printerr ("ETableSorter returned wrong order after changes\n");
+		res = 1;
+	}
+
+	/* Flip the date order; all the keys are reused. */
+	columns = e_table_specification_ref_columns (specification);
+	e_table_sort_info_sorting_set_nth (sort_info, 0, g_ptr_array_index (columns, 0), GTK_SORT_ASCENDING);
+	g_ptr_array_unref (columns);
+
+	g_timer_start (timer);
+	e_sorter_get_sorted_to_model_array (E_SORTER (sorter), &sorted, &count);
+	print_sort_time ("ETableSorter, order flipped:", g_timer_elapsed (timer, NULL), full_sort);
+
+	g_timer_destroy (timer);
+	g_free (map_table);
+	g_object_unref (sorter);
+	g_object_unref (model);
+	g_object_unref (sort_info);
+	g_object_unref (full_header);
+	g_object_unref (extras);
+	g_object_unref (specification);
+
+	return res;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GError *local_error = NULL;
+
+	if (!gtk_init_with_args (&argc, &argv, NULL, entries, NULL, &local_error)) {
+		g_printerr ("%s\n", local_error ? local_error->message : "Failed to initialize GTK+");
+		g_clear_error (&local_error);
+		return 1;
+	}
+
+	return run_benchmark (MAX (opt_rows, 1), MAX (opt_changes, 0));
+}
@@ -0,0 +1,178 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/* test-time-index.c - Benchmark for ETimeIndex.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <e-util/e-util.h>
+
+#define DAY (24 * 60 * 60)
+#define MONTH (31 * DAY)
+
+static gint opt_instances = 200000;
+static gint opt_months = 120;
+
+static GOptionEntry entries[] = {
+	{ "instances", 'i', 0, G_OPTION_ARG_INT, &opt_instances,
+	  "Number of event instances to index", "N" },
+	{ "months", 'm', 0, G_OPTION_ARG_INT, &opt_months,
+	  "Number of months the instances spread over, one query per month", "N" },
+	{ NULL }
+};
+
+typedef struct _Instance {
+	time_t start;
+	time_t end;
+} Instance;
+
+static gboolean
+count_cb (time_t start,
+          time_t end,
+          gpointer data,
+          gpointer user_data)
+{
+	guint *counter = user_data;
+
+	(*counter)++;
+
+	return TRUE;
+}
+
+static gint
+run_benchmark (guint n_instances,
+               guint n_months)
+{
+	ETimeIndex *index;
+	ETimeIndexItem **items;
+	Instance *instances;
+	GTimer *timer;
+	GRand *rand;
+	time_t base = 1577836800; /* 2020-01-01 */
+	guint ii, month;
+	guint64 n_found_index = 0, n_found_linear = 0;
+	gdouble index_seconds, linear_seconds;
+	gint res = 0;
+
+	instances = g_new (Instance, n_instances);
+	items = g_new (ETimeIndexItem *, n_instances);
+	rand = g_rand_new_with_seed (n_instances);
+
+	for (ii = 0; ii < n_instances; ii++) {
+		instances[ii].start = base + g_rand_int_range (rand, 0, n_months * MONTH / 60) * 60;
+
+		/* Mostly short events, some all-day and multi-day ones,
+		   and a few spanning months or without an end. */
+		switch (g_rand_int_range (rand, 0, 100)) {
+		case 0:
+			instances[ii].end = instances[ii].start + g_rand_int_range (rand, 1, 12) * MONTH;
+			break;
+		case 1:
+			instances[ii].end = instances[ii].start;
+			break;
+		case 2: case 3: case 4: case 5: case 6:
+			instances[ii].end = instances[ii].start + g_rand_int_range (rand, 1, 5) * DAY;
+			break;
+		default:
+			instances[ii].end = instances[ii].start + g_rand_int_range (rand, 1, 16) * 15 * 60;
+			break;
+		}
+	}
+
+	g_print ("%u instances over %u months, one query per month\n", n_instances, n_months);
+
+	timer = g_timer_new ();
+	index = e_time_index_new ();
+	for (ii = 0; ii < n_instances; ii++) {
+		items[ii] = e_time_index_add (index, instances[ii].start, instances[ii].end, &instances[ii]);
+	}
+	g_print ("  Built the index in %.1f ms, %.2f us per instance\n",
+		g_timer_elapsed (timer, NULL) * 1000.0,
+		g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC / n_instances);
+
+	g_timer_start (timer);
+	for (month = 0; month < n_months; month++) {
+		guint found = 0;
+
+		e_time_index_foreach (index, base + month * MONTH, base + (month + 1) * MONTH, count_cb, &found);
+
+		n_found_index += found;
+	}
+	index_seconds = g_timer_elapsed (timer, NULL);
+
+	g_timer_start (timer);
+	for (month = 0; month < n_months; month++) {
+		time_t range_start = base + month * MONTH, range_end = base + (month + 1) * MONTH;
+
+		for (ii = 0; ii < n_instances; ii++) {
+			const Instance *inst = &instances[ii];
+
+			if ((inst->start < range_end && inst->end > range_start) ||
+			    (inst->start == inst->end && inst->end == range_start))
+				n_found_linear++;
+		}
+	}
+	linear_seconds = g_timer_elapsed (timer, NULL);
+
+	g_print ("  A month query takes %.3f ms with the index, %.3f ms with a linear scan (%.0fx)\n",
+		index_seconds * 1000.0 / n_months,
+		linear_seconds * 1000.0 / n_months,
+		index_seconds > 0.0 ? linear_seconds / index_seconds : 0.0);
+
+	if (n_found_index != n_found_linear) {
+		g_printerr ("Index found %" G_GUINT64_FORMAT " instances, the linear scan %" G_GUINT64_FORMAT "\n",
+			n_found_index, n_found_linear);
+		res = 1;
+	}
+
+	g_timer_start (timer);
+	for (ii = 0; ii < n_instances; ii += 2) {
+		e_time_index_remove (index, items[ii]);
+	}
+	g_print ("  Removed half of the instances in %.1f ms\n", g_timer_elapsed (timer, NULL) * 1000.0);
+
+	if (e_time_index_get_length (index) != n_instances / 2) {
+		g_printerr ("Index contains %u items, expected %u\n", e_time_index_get_length (index), n_instances / 2);
+		res = 1;
+	}
+
+	e_time_index_free (index);
+	g_timer_destroy (timer);
+	g_rand_free (rand);
+	g_free (instances);
+	g_free (items);
+
+	return res;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GOptionContext *context;
+	GError *local_error = NULL;
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &local_error)) {
+		g_printerr ("%s\n", local_error->message);
+		g_clear_error (&local_error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	return run_benchmark (MAX (opt_instances, 1), MAX (opt_months, 1));
+}
@@ -0,0 +1,334 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/* test-tree-table-adapter.c - Benchmark for ETreeTableAdapter.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <e-util/e-util.h>
+
+#define THREAD_SIZE 10
+#define N_LOOKUPS 100000
+
+static gint opt_nodes = 500000;
+static gint opt_toggled = 10000;
+
+static GOptionEntry entries[] = {
+	{ "nodes", 'n', 0, G_OPTION_ARG_INT, &opt_nodes,
+	  "Number of nodes in the tree", "N" },
+	{ "toggled", 't', 0, G_OPTION_ARG_INT, &opt_toggled,
+	  "Number of threads to expand and collapse", "N" },
+	{ NULL }
+};
+
+/* A tree model of message-list-like threads, each being a thread root
+ * with (THREAD_SIZE - 1) replies. The ETreePath is the GNode itself. */
+
+#define TEST_TYPE_TREE_MODEL (test_tree_model_get_type ())
+
+typedef struct _TestTreeModel TestTreeModel;
+typedef struct _TestTreeModelClass TestTreeModelClass;
+
+struct _TestTreeModel {
+	GObject parent;
+
+	GNode *root;
+	guint n_nodes;
+};
+
+struct _TestTreeModelClass {
+	GObjectClass parent_class;
+};
+
+GType test_tree_model_get_type (void);
+static void test_tree_model_tree_model_init (ETreeModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (
+	TestTreeModel,
+	test_tree_model,
+	G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE (
+		E_TYPE_TREE_MODEL,
+		test_tree_model_tree_model_init))
+
+static void
+test_tree_model_finalize (GObject *object)
+{
+	TestTreeModel *model = (TestTreeModel *) object;
+
+	g_node_destroy (model->root);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (test_tree_model_parent_class)->finalize (object);
+}
+
+static ETreePath
+test_tree_model_get_root (ETreeModel *tree_model)
+{
+	return ((TestTreeModel *) tree_model)->root;
+}
+
+static ETreePath
+test_tree_model_get_parent (ETreeModel *tree_model,
+                            ETreePath path)
+{
+	return ((GNode *) path)->parent;
+}
+
+static ETreePath
+test_tree_model_get_first_child (ETreeModel *tree_model,
+                                 ETreePath path)
+{
+	return ((GNode *) path)->children;
+}
+
+static ETreePath
+test_tree_model_get_next (ETreeModel *tree_model,
+                          ETreePath path)
+{
+	return ((GNode *) path)->next;
+}
+
+static gboolean
+test_tree_model_is_root (ETreeModel *tree_model,
+                         ETreePath path)
+{
+	return G_NODE_IS_ROOT ((GNode *) path);
+}
+
+static gboolean
+test_tree_model_is_expandable (ETreeModel *tree_model,
+                               ETreePath path)
+{
+	return ((GNode *) path)->children != NULL;
+}
+
+static guint
+test_tree_model_get_n_nodes (ETreeModel *tree_model)
+{
+	return ((TestTreeModel *) tree_model)->n_nodes;
+}
+
+static guint
+test_tree_model_get_n_children (ETreeModel *tree_model,
+                                ETreePath path)
+{
+	return g_node_n_children ((GNode *) path);
+}
+
+static guint
+test_tree_model_depth (ETreeModel *tree_model,
+                       ETreePath path)
+{
+	return g_node_depth ((GNode *) path) - 1;
+}
+
+static gboolean
+test_tree_model_get_expanded_default (ETreeModel *tree_model)
+{
+	return FALSE;
+}
+
+static gint
+test_tree_model_column_count (ETreeModel *tree_model)
+{
+	return 1;
+}
+
+static gpointer
+test_tree_model_value_at (ETreeModel *tree_model,
+                          ETreePath path,
+                          gint col)
+{
+	return ((GNode *) path)->data;
+}
+
+static void
+test_tree_model_class_init (TestTreeModelClass *class)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = test_tree_model_finalize;
+}
+
+static void
+test_tree_model_tree_model_init (ETreeModelInterface *iface)
+{
+	iface->get_root = test_tree_model_get_root;
+	iface->get_parent = test_tree_model_get_parent;
+	iface->get_first_child = test_tree_model_get_first_child;
+	iface->get_next = test_tree_model_get_next;
+	iface->is_root = test_tree_model_is_root;
+	iface->is_expandable = test_tree_model_is_expandable;
+	iface->get_n_nodes = test_tree_model_get_n_nodes;
+	iface->get_n_children = test_tree_model_get_n_children;
+	iface->depth = test_tree_model_depth;
+	iface->get_expanded_default = test_tree_model_get_expanded_default;
+	iface->column_count = test_tree_model_column_count;
+	iface->value_at = test_tree_model_value_at;
+}
+
+static void
+test_tree_model_init (TestTreeModel *model)
+{
+}
+
+static TestTreeModel *
+test_tree_model_new (gint n_threads,
+                     GNode ***out_threads)
+{
+	TestTreeModel *model;
+	GNode **threads;
+	gint ii, jj;
+
+	model = g_object_new (TEST_TYPE_TREE_MODEL, NULL);
+	model->root = g_node_new (NULL);
+	model->n_nodes = 1;
+
+	threads = g_new (GNode *, n_threads);
+
+	/* Build backwards, g_node_append() is O(n) per call */
+	for (ii = n_threads - 1; ii >= 0; ii--) {
+		GNode *thread = g_node_new (GINT_TO_POINTER (ii * THREAD_SIZE + 1));
+
+		for (jj = THREAD_SIZE - 1; jj > 0; jj--)
+			g_node_prepend (thread, g_node_new (GINT_TO_POINTER (ii * THREAD_SIZE + jj + 1)));
+
+		g_node_prepend (model->root, thread);
+		threads[ii] = thread;
+		model->n_nodes += THREAD_SIZE;
+	}
+
+	*out_threads = threads;
+
+	return model;
+}
+
+static gboolean
+check_rows (ETreeTableAdapter *etta,
+            gint expected_rows)
+{
+	ETableModel *table_model = E_TABLE_MODEL (etta);
+	gint ii, n_rows;
+
+	n_rows = e_table_model_row_count (table_model);
+	if (n_rows != expected_rows) {
+		g_printerr ("Expected %d rows, but the adapter has %d\n", expected_rows, n_rows);
+		return FALSE;
+	}
+
+	/* Rows are numbered in preorder, which matches the 'data' order
+	 * of the visible nodes; only verify that it is increasing. */
+	for (ii = 1; ii < n_rows; ii += MAX (1, n_rows / 1000)) {
+		ETreePath prev = e_tree_table_adapter_node_at_row (etta, ii - 1);
+		ETreePath path = e_tree_table_adapter_node_at_row (etta, ii);
+
+		if (GPOINTER_TO_INT (((GNode *) prev)->data) >= GPOINTER_TO_INT (((GNode *) path)->data) ||
+		    e_tree_table_adapter_row_of_node (etta, path) != ii) {
+			g_printerr ("Row %d is out of order\n", ii);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Prints the average time of one of 'n_ops' operations */
+static void
+print_op_time (const gchar *label,
+               GTimer *timer,
+               gint n_ops)
+{
+	g_print ("  %-22s %8.2f us each\n", label, g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC / MAX (n_ops, 1));
+}
+
+static gint
+run_benchmark (gint n_nodes,
+               gint n_toggled)
+{
+	ETreeTableAdapter *etta;
+	TestTreeModel *model;
+	GNode **threads = NULL;
+	GTimer *timer;
+	gint n_threads, ii;
+	gint res = 0;
+
+	n_threads = MAX (n_nodes / THREAD_SIZE, 1);
+	n_toggled = MIN (n_toggled, n_threads);
+
+	model = test_tree_model_new (n_threads, &threads);
+
+	g_print ("%d threads of %d messages; expanding and collapsing %d of them\n", n_threads, THREAD_SIZE, n_toggled);
+
+	timer = g_timer_new ();
+	etta = E_TREE_TABLE_ADAPTER (e_tree_table_adapter_new (E_TREE_MODEL (model), NULL, NULL));
+	e_tree_model_node_inserted (E_TREE_MODEL (model), NULL, model->root);
+	e_tree_table_adapter_root_node_set_visible (etta, FALSE);
+	g_print ("  %-22s %8.1f ms\n", "Populate:", g_timer_elapsed (timer, NULL) * 1000.0);
+
+	if (!check_rows (etta, n_threads))
+		res = 1;
+
+	/* Spread the threads over the whole tree, to move most of the rows */
+	g_timer_start (timer);
+	for (ii = 0; ii < n_toggled; ii++)
+		e_tree_table_adapter_node_set_expanded (etta, threads[(gint) ((gint64) ii * n_threads / n_toggled)], TRUE);
+	print_op_time ("Expand a thread:", timer, n_toggled);
+
+	if (!check_rows (etta, n_threads + n_toggled * (THREAD_SIZE - 1)))
+		res = 1;
+
+	g_timer_start (timer);
+	for (ii = 0; ii < N_LOOKUPS; ii++) {
+		gint row = (gint) (((gint64) ii * 7919) % e_table_model_row_count (E_TABLE_MODEL (etta)));
+		ETreePath path = e_tree_table_adapter_node_at_row (etta, row);
+
+		if (e_tree_table_adapter_row_of_node (etta, path) != row) {
+			g_printerr ("Row %d does not round-trip\n", row);
+			res = 1;
+			break;
+		}
+	}
+	print_op_time ("Row to node and back:", timer, N_LOOKUPS);
+
+	g_timer_start (timer);
+	for (ii = 0; ii < n_toggled; ii++)
+		e_tree_table_adapter_node_set_expanded (etta, threads[(gint) ((gint64) ii * n_threads / n_toggled)], FALSE);
+	print_op_time ("Collapse a thread:", timer, n_toggled);
+
+	if (!check_rows (etta, n_threads))
+		res = 1;
+
+	g_timer_destroy (timer);
+	g_object_unref (etta);
+	g_object_unref (model);
+	g_free (threads);
+
+	return res;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GError *local_error = NULL;
+
+	if (!gtk_init_with_args (&argc, &argv, NULL, entries, NULL, &local_error)) {
+		g_printerr ("%s\n", local_error ? local_error->message : "Failed to initialize GTK+");
+		g_clear_error (&local_error);
+		return 1;
+	}
+
+	return run_benchmark (MAX (opt_nodes, 1), MAX (opt_toggled, 1));
+}
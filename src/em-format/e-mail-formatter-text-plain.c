@@ -43,6 +43,160 @@ static const gchar *formatter_mime_types[] = {
 	NULL
 };
 
+/* Collects at most @limit bytes of the text, then it fails the writes,
+ * thus the decoding and the conversion of the rest of the text stop. */
+typedef struct _TextLimitStream {
+	GOutputStream parent;
+	GByteArray *data;
+	gsize limit;
+} TextLimitStream;
+
+typedef struct _TextLimitStreamClass {
+	GOutputStreamClass parent_class;
+} TextLimitStreamClass;
+
+GType text_limit_stream_get_type (void);
+
+G_DEFINE_TYPE (TextLimitStream, text_limit_stream, G_TYPE_OUTPUT_STREAM)
+
+static gssize
+text_limit_stream_write (GOutputStream *stream,
+                         gconstpointer buffer,
+                         gsize count,
+                         GCancellable *cancellable,
+                         GError **error)
+{
+	TextLimitStream *limit_stream = (TextLimitStream *) stream;
+
+	if (limit_stream->data->len >= limit_stream->limit) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+			"The text limit was reached");
+		return -1;
+	}
+
+	count = MIN (count, limit_stream->limit - limit_stream->data->len);
+	g_byte_array_append (limit_stream->data, buffer, count);
+
+	return count;
+}
+
+static void
+text_limit_stream_finalize (GObject *object)
+{
+	g_byte_array_unref (((TextLimitStream *) object)->data);
+
+	/* Chain up to parent's method. */
+	G_OBJECT_CLASS (text_limit_stream_parent_class)->finalize (object);
+}
+
+static void
+text_limit_stream_class_init (TextLimitStreamClass *class)
+{
+	GObjectClass *object_class;
+	GOutputStreamClass *output_stream_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = text_limit_stream_finalize;
+
+	output_stream_class = G_OUTPUT_STREAM_CLASS (class);
+	output_stream_class->write_fn = text_limit_stream_write;
+}
+
+static void
+text_limit_stream_init (TextLimitStream *limit_stream)
+{
+	limit_stream->data = g_byte_array_new ();
+}
+
+/* Writes at most context->text_limit bytes of the decoded text into
+ * the @stream and returns whether anything was left out. The text
+ * beyond the limit is not decoded at all. */
+static gboolean
+emfe_text_plain_write_limited (EMailFormatter *formatter,
+                               EMailFormatterContext *context,
+                               EMailPart *part,
+                               GOutputStream *stream,
+                               GCancellable *cancellable)
+{
+	TextLimitStream *limit_stream;
+	const gchar *data;
+	gsize size, cut;
+
+	/* One byte more tells whether the text was cut */
+	limit_stream = g_object_new (text_limit_stream_get_type (), NULL);
+	limit_stream->limit = context->text_limit + 1;
+
+	e_mail_formatter_format_text (
+		formatter, part, G_OUTPUT_STREAM (limit_stream), cancellable);
+
+	data = (const gchar *) limit_stream->data->data;
+	size = limit_stream->data->len;
+	cut = size;
+
+	if (size > context->text_limit) {
+		const gchar *eol;
+
+		cut = context->text_limit;
+
+		/* Prefer to stop at the end of a line, otherwise at least
+		 * do not split a UTF-8 character. */
+		eol = g_strrstr_len (data, cut, "\n");
+		if (eol && (gsize) (eol - data) >= cut / 2) {
+			cut = eol - data + 1;
+		} else {
+			while (cut > 0 && (data[cut] & 0xC0) == 0x80)
+				cut--;
+		}
+	}
+
+	g_output_stream_write_all (
+		stream, data, cut, NULL, cancellable, NULL);
+
+	g_object_unref (limit_stream);
+
+	return cut < size;
+}
+
+static void
+emfe_text_plain_write_expander (EMailFormatterContext *context,
+                                EMailPart *part,
+                                GOutputStream *stream,
+                                GCancellable *cancellable)
+{
+	GString *html;
+	const gchar *text;
+
+	text = _("Only the beginning of the text is shown.");
+
+	html = g_string_new (
+		"<div class=\"part-container "
+		"-e-web-view-background-color -e-web-view-text-color\" "
+		"style=\"border: none; padding: 8px; margin: 0;\">");
+
+	e_util_markup_append_escaped (html, "<i>%s</i>", text);
+
+	/* The button replaces the <iframe> source with a request
+	 * for the whole part; see EMailDisplay. */
+	if (context->uri) {
+		gchar *full_uri;
+
+		full_uri = g_strconcat (context->uri, strchr (context->uri, '?') ? "&" : "?", "full_text=1", NULL);
+
+		e_util_markup_append_escaped (html,
+			" <button type=\"button\" class=\"__evo-expand-text\" id=\"%s.expand\" value=\"%s\">%s</button>",
+			e_mail_part_get_id (part), full_uri, _("Show All"));
+
+		g_free (full_uri);
+	}
+
+	g_string_append (html, "</div>\n");
+
+	g_output_stream_write_all (
+		stream, html->str, html->len, NULL, cancellable, NULL);
+
+	g_string_free (html, TRUE);
+}
+
 static gboolean
 emfe_text_plain_format (EMailFormatterExtension *extension,
                         EMailFormatter *formatter,
@@ -65,6 +219,7 @@ emfe_text_plain_format (EMailFormatterExtension *extension,
 		CamelMimeFilterToHTMLFlags flags;
 		CamelMimePart *mime_part;
 		CamelDataWrapper *dw;
+		gboolean left_out = FALSE;
 
 		if (context->mode == E_MAIL_FORMATTER_MODE_RAW) {
 			string = e_mail_formatter_get_sub_html_header (formatter);
@@ -117,8 +272,15 @@ emfe_text_plain_format (EMailFormatterExtension *extension,
 			stream, string, strlen (string),
 			NULL, cancellable, NULL);
 
-		e_mail_formatter_format_text (
-			formatter, part, filtered_stream, cancellable);
+		/* Huge texts take long to lay out; show only the beginning
+		 * of them until the user asks for the rest. */
+		if (context->mode == E_MAIL_FORMATTER_MODE_RAW && context->text_limit > 0) {
+			left_out = emfe_text_plain_write_limited (
+				formatter, context, part, filtered_stream, cancellable);
+		} else {
+			e_mail_formatter_format_text (
+				formatter, part, filtered_stream, cancellable);
+		}
 		g_output_stream_flush (filtered_stream, cancellable, NULL);
 
 		g_object_unref (filtered_stream);
@@ -129,6 +291,9 @@ emfe_text_plain_format (EMailFormatterExtension *extension,
 			stream, string, strlen (string),
 			NULL, cancellable, NULL);
 
+		if (left_out)
+			emfe_text_plain_write_expander (context, part, stream, cancellable);
+
 		if (context->mode == E_MAIL_FORMATTER_MODE_RAW) {
 			string = "</body></html>";
 
@@ -60,6 +60,19 @@ struct _AsyncContext {
 	EMailFormatterMode mode;
 };
 
+/* How long one idle step of e_mail_formatter_format_streamed()
+ * can format parts before it flushes and yields to the main loop. */
+#define STREAM_STEP_BUDGET_USEC (20 * 1000)
+
+typedef struct _StreamData {
+	EMailFormatter *formatter;
+	EMailFormatterContext *context;
+	GOutputStream *stream;
+	GCancellable *cancellable;
+	GQueue queue;
+	GList *link;
+} StreamData;
+
 /* internal formatter extensions */
 GType e_mail_formatter_attachment_get_type (void);
 GType e_mail_formatter_audio_get_type (void);
@@ -379,120 +392,148 @@ e_mail_formatter_constructed (GObject *object)
 	e_extensible_load_extensions (E_EXTENSIBLE (object));
 }
 
-static void
-mail_formatter_run (EMailFormatter *formatter,
-                    EMailFormatterContext *context,
-                    GOutputStream *stream,
-                    GCancellable *cancellable)
+/* Formats the part at *plink, possibly moving *plink further, when
+ * the part covers more than one queued part. Returns FALSE when
+ * there is nothing more to be written. */
+static gboolean
+mail_formatter_run_step (EMailFormatter *formatter,
+                         EMailFormatterContext *context,
+                         GOutputStream *stream,
+                         GList **plink,
+                         GCancellable *cancellable)
 {
-	GQueue queue = G_QUEUE_INIT;
-	GList *head, *link;
-	gchar *hdr;
-	const gchar *string;
+	EMailPart *part = (*plink)->data;
+	const gchar *part_id;
+	gboolean ok;
 
-	hdr = e_mail_formatter_get_html_header (formatter);
-	g_output_stream_write_all (
-		stream, hdr, strlen (hdr), NULL, cancellable, NULL);
-	g_free (hdr);
+	part_id = e_mail_part_get_id (part);
 
-	e_mail_part_list_queue_parts (context->part_list, NULL, &queue);
+	if (g_cancellable_is_cancelled (cancellable))
+		return FALSE;
 
-	head = g_queue_peek_head_link (&queue);
+	if (part->is_hidden && !part->is_error) {
+		if (e_mail_part_id_has_suffix (part, ".rfc822")) {
+			*plink = e_mail_formatter_find_rfc822_end_iter (*plink);
+		}
 
-	for (link = head; link != NULL; link = g_list_next (link)) {
-		EMailPart *part = link->data;
-		const gchar *part_id;
-		gboolean ok;
+		return *plink != NULL;
+	}
 
-		part_id = e_mail_part_get_id (part);
+	if (context->mode == E_MAIL_FORMATTER_MODE_PRINTING &&
+	    !e_mail_part_get_is_printable (part))
+		return TRUE;
 
-		if (g_cancellable_is_cancelled (cancellable))
-			break;
+	/* Force formatting as source if needed */
+	if (context->mode != E_MAIL_FORMATTER_MODE_SOURCE) {
+		const gchar *mime_type;
 
-		if (part->is_hidden && !part->is_error) {
-			if (e_mail_part_id_has_suffix (part, ".rfc822")) {
-				link = e_mail_formatter_find_rfc822_end_iter (link);
-			}
+		mime_type = e_mail_part_get_mime_type (part);
+		if (mime_type == NULL)
+			return TRUE;
 
-			if (link == NULL)
-				break;
+		ok = e_mail_formatter_format_as (
+			formatter, context, part, stream,
+			mime_type, cancellable);
 
-			continue;
-		}
+		/* If the written part was message/rfc822 then
+		 * jump to the end of the message, because content
+		 * of the whole message has been formatted by
+		 * message_rfc822 formatter */
+		if (ok && e_mail_part_id_has_suffix (part, ".rfc822")) {
+			*plink = e_mail_formatter_find_rfc822_end_iter (*plink);
 
-		if (context->mode == E_MAIL_FORMATTER_MODE_PRINTING &&
-		    !e_mail_part_get_is_printable (part))
-			continue;
+			return *plink != NULL;
+		}
 
-		/* Force formatting as source if needed */
-		if (context->mode != E_MAIL_FORMATTER_MODE_SOURCE) {
-			const gchar *mime_type;
+	} else {
+		ok = FALSE;
+	}
 
-			mime_type = e_mail_part_get_mime_type (part);
-			if (mime_type == NULL)
-				continue;
+	if (!ok) {
+		/* We don't want to source these */
+		if (e_mail_part_id_has_suffix (part, ".headers"))
+			return TRUE;
+
+		e_mail_formatter_format_as (
+			formatter, context, part, stream,
+			"application/vnd.evolution.source", cancellable);
+
+		/* .message is the entire message. There's nothing more
+		 * to be written. */
+		if (g_strcmp0 (part_id, ".message") == 0)
+			return FALSE;
+
+		/* If we just wrote source of a rfc822 message, then jump
+		 * behind the message (otherwise source of all parts
+		 * would be rendered twice) */
+		if (e_mail_part_id_has_suffix (part, ".rfc822")) {
+			GList *link = *plink;
+
+			do {
+				part = link->data;
+				if (e_mail_part_id_has_suffix (part, ".rfc822.end"))
+					break;
 
-			ok = e_mail_formatter_format_as (
-				formatter, context, part, stream,
-				mime_type, cancellable);
+				link = g_list_next (link);
+			} while (link != NULL);
 
-			/* If the written part was message/rfc822 then
-			 * jump to the end of the message, because content
-			 * of the whole message has been formatted by
-			 * message_rfc822 formatter */
-			if (ok && e_mail_part_id_has_suffix (part, ".rfc822")) {
-				link = e_mail_formatter_find_rfc822_end_iter (link);
+			*plink = link;
 
-				if (link == NULL)
-					break;
+			if (link == NULL)
+				return FALSE;
+		}
+	}
 
-				continue;
-			}
+	return TRUE;
+}
 
-		} else {
-			ok = FALSE;
-		}
+static void
+mail_formatter_write_html_header (EMailFormatter *formatter,
+                                  GOutputStream *stream,
+                                  GCancellable *cancellable)
+{
+	gchar *hdr;
 
-		if (!ok) {
-			/* We don't want to source these */
-			if (e_mail_part_id_has_suffix (part, ".headers"))
-				continue;
+	hdr = e_mail_formatter_get_html_header (formatter);
+	g_output_stream_write_all (
+		stream, hdr, strlen (hdr), NULL, cancellable, NULL);
+	g_free (hdr);
+}
 
-			e_mail_formatter_format_as (
-				formatter, context, part, stream,
-				"application/vnd.evolution.source", cancellable);
+static void
+mail_formatter_write_html_footer (GOutputStream *stream,
+                                  GCancellable *cancellable)
+{
+	const gchar *string;
 
-			/* .message is the entire message. There's nothing more
-			 * to be written. */
-			if (g_strcmp0 (part_id, ".message") == 0)
-				break;
+	string = "</body></html>";
+	g_output_stream_write_all (
+		stream, string, strlen (string),
+		NULL, cancellable, NULL);
+}
 
-			/* If we just wrote source of a rfc822 message, then jump
-			 * behind the message (otherwise source of all parts
-			 * would be rendered twice) */
-			if (e_mail_part_id_has_suffix (part, ".rfc822")) {
+static void
+mail_formatter_run (EMailFormatter *formatter,
+                    EMailFormatterContext *context,
+                    GOutputStream *stream,
+                    GCancellable *cancellable)
+{
+	GQueue queue = G_QUEUE_INIT;
+	GList *link;
 
-				do {
-					part = link->data;
-					if (e_mail_part_id_has_suffix (part, ".rfc822.end"))
-						break;
+	mail_formatter_write_html_header (formatter, stream, cancellable);
 
-					link = g_list_next (link);
-				} while (link != NULL);
+	e_mail_part_list_queue_parts (context->part_list, NULL, &queue);
 
-				if (link == NULL)
-					break;
-			}
-		}
+	for (link = g_queue_peek_head_link (&queue); link != NULL; link = g_list_next (link)) {
+		if (!mail_formatter_run_step (formatter, context, stream, &link, cancellable))
+			break;
 	}
 
 	while (!g_queue_is_empty (&queue))
 		g_object_unref (g_queue_pop_head (&queue));
 
-	string = "</body></html>";
-	g_output_stream_write_all (
-		stream, string, strlen (string),
-		NULL, cancellable, NULL);
+	mail_formatter_write_html_footer (stream, cancellable);
 }
 
 static void
@@ -958,6 +999,149 @@ e_mail_formatter_format_finish (EMailFormatter *formatter,
 	return !g_simple_async_result_propagate_error (simple, error);
 }
 
+static void
+stream_data_free (gpointer ptr)
+{
+	StreamData *sd = ptr;
+
+	if (sd) {
+		while (!g_queue_is_empty (&sd->queue))
+			g_object_unref (g_queue_pop_head (&sd->queue));
+
+		mail_formatter_free_context (sd->context);
+		g_clear_object (&sd->formatter);
+		g_clear_object (&sd->stream);
+		g_clear_object (&sd->cancellable);
+		g_slice_free (StreamData, sd);
+	}
+}
+
+static gboolean
+mail_formatter_stream_step_cb (gpointer user_data)
+{
+	StreamData *sd = user_data;
+	gint64 deadline;
+	gboolean done = FALSE;
+
+	deadline = g_get_monotonic_time () + STREAM_STEP_BUDGET_USEC;
+
+	while (!done) {
+		if (!sd->link || g_cancellable_is_cancelled (sd->cancellable)) {
+			done = TRUE;
+		} else if (!mail_formatter_run_step (sd->formatter, sd->context, sd->stream, &sd->link, sd->cancellable)) {
+			done = TRUE;
+		} else {
+			sd->link = g_list_next (sd->link);
+
+			if (g_get_monotonic_time () >= deadline)
+				break;
+
+			/* Wait for the reader to catch up */
+			if (G_IS_POLLABLE_OUTPUT_STREAM (sd->stream) &&
+			    !g_pollable_output_stream_is_writable (G_POLLABLE_OUTPUT_STREAM (sd->stream)))
+				break;
+		}
+	}
+
+	/* Hand over what is ready; a failure means nobody reads anymore. */
+	if (!g_output_stream_flush (sd->stream, sd->cancellable, NULL))
+		done = TRUE;
+
+	if (!done)
+		return G_SOURCE_CONTINUE;
+
+	if (!g_cancellable_is_cancelled (sd->cancellable))
+		mail_formatter_write_html_footer (sd->stream, sd->cancellable);
+
+	g_output_stream_close (sd->stream, NULL, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+mail_formatter_stream_writable_cb (GObject *pollable_stream,
+                                   gpointer user_data)
+{
+	return mail_formatter_stream_step_cb (user_data);
+}
+
+/**
+ * e_mail_formatter_format_streamed:
+ * @formatter: an #EMailFormatter
+ * @part_list: an #EMailPartList to format
+ * @stream: a #GOutputStream to write to
+ * @flags: an #EMailFormatterHeaderFlags
+ * @mode: an #EMailFormatterMode
+ * @cancellable: optional #GCancellable object, or %NULL
+ *
+ * Formats the whole @part_list into @stream like e_mail_formatter_format_sync()
+ * does, only in steps run from idle callbacks of the main loop. The @stream is
+ * flushed after each step, thus any reader of the other end of the @stream can
+ * show already formatted parts while the rest is still being formatted.
+ * When the @stream is a #GPollableOutputStream, the steps run only while
+ * it is writable, thus a slow reader does not make the data pile up.
+ * The @stream is closed once everything is written, or the @cancellable
+ * is cancelled, or when flushing the @stream fails.
+ *
+ * Formatters which override the #EMailFormatterClass.run() method are
+ * run at once, before this function returns.
+ *
+ * This can be called only from the main thread.
+ *
+ * Since: 3.38
+ **/
+void
+e_mail_formatter_format_streamed (EMailFormatter *formatter,
+                                  EMailPartList *part_list,
+                                  GOutputStream *stream,
+                                  EMailFormatterHeaderFlags flags,
+                                  EMailFormatterMode mode,
+                                  GCancellable *cancellable)
+{
+	EMailFormatterClass *class;
+	StreamData *sd;
+	GSource *source;
+
+	g_return_if_fail (E_IS_MAIL_FORMATTER (formatter));
+	g_return_if_fail (E_IS_MAIL_PART_LIST (part_list));
+	g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+
+	class = E_MAIL_FORMATTER_GET_CLASS (formatter);
+	g_return_if_fail (class != NULL);
+	g_return_if_fail (class->run != NULL);
+
+	if (class->run != mail_formatter_run) {
+		e_mail_formatter_format_sync (formatter, part_list, stream, flags, mode, cancellable);
+		g_output_stream_close (stream, NULL, NULL);
+		return;
+	}
+
+	sd = g_slice_new0 (StreamData);
+	sd->formatter = g_object_ref (formatter);
+	sd->context = mail_formatter_create_context (formatter, part_list, mode, flags);
+	sd->stream = g_object_ref (stream);
+	sd->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	g_queue_init (&sd->queue);
+
+	mail_formatter_write_html_header (formatter, stream, cancellable);
+
+	e_mail_part_list_queue_parts (part_list, NULL, &sd->queue);
+	sd->link = g_queue_peek_head_link (&sd->queue);
+
+	if (G_IS_POLLABLE_OUTPUT_STREAM (stream) &&
+	    g_pollable_output_stream_can_poll (G_POLLABLE_OUTPUT_STREAM (stream))) {
+		source = g_pollable_output_stream_create_source (G_POLLABLE_OUTPUT_STREAM (stream), NULL);
+		g_source_set_callback (source, (GSourceFunc) mail_formatter_stream_writable_cb, sd, stream_data_free);
+	} else {
+		source = g_idle_source_new ();
+		g_source_set_callback (source, mail_formatter_stream_step_cb, sd, stream_data_free);
+	}
+
+	g_source_set_priority (source, G_PRIORITY_DEFAULT_IDLE);
+	g_source_attach (source, NULL);
+	g_source_unref (source);
+}
+
 /**
  * e_mail_formatter_format_as:
  * @formatter: an #EMailFormatter
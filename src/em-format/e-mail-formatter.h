@@ -56,6 +56,11 @@ struct _EMailFormatterContext {
 	EMailFormatterHeaderFlags flags;
 
 	gchar *uri;
+
+	/* Formatters of text parts may format only this many bytes
+	 * of the part content and offer to show the rest; 0 means
+	 * no limit. Since: 3.38 */
+	gsize text_limit;
 };
 
 struct _EMailFormatter {
@@ -115,6 +120,13 @@ void		e_mail_formatter_format		(EMailFormatter *formatter,
 gboolean	e_mail_formatter_format_finish	(EMailFormatter *formatter,
 						 GAsyncResult *result,
 						 GError **error);
+void		e_mail_formatter_format_streamed
+						(EMailFormatter *formatter,
+						 EMailPartList *part_list,
+						 GOutputStream *stream,
+						 EMailFormatterHeaderFlags flags,
+						 EMailFormatterMode mode,
+						 GCancellable *cancellable);
 
 gboolean	e_mail_formatter_format_as	(EMailFormatter *formatter,
 						 EMailFormatterContext *context,
@@ -17,6 +17,8 @@
 
 #include <camel/camel.h>
 
+#include "e-mail-part-utils.h"
+
 #include "e-mail-part-list.h"
 
 #define E_MAIL_PART_LIST_GET_PRIVATE(obj) \
@@ -41,9 +43,33 @@ enum {
 
 G_DEFINE_TYPE (EMailPartList, e_mail_part_list, G_TYPE_OBJECT)
 
+/* The default memory budget of the parsed part lists cache */
+#define CACHE_DEFAULT_BUDGET (32 * 1024 * 1024)
+
 static CamelObjectBag *registry = NULL;
 G_LOCK_DEFINE_STATIC (registry);
 
+typedef struct _CacheFolder {
+	CamelFolder *folder; /* not referenced, the cached part lists hold it */
+	gulong changed_handler_id;
+	guint n_entries;
+} CacheFolder;
+
+typedef struct _CacheEntry {
+	gchar *mail_uri;
+	EMailPartList *part_list;
+	gsize size;
+	CacheFolder *cache_folder;
+	GList *link; /* in cache_lru */
+} CacheEntry;
+
+/* The cache keeps the part lists alive, thus also in the registry */
+static GHashTable *cache_entries = NULL; /* gchar *mail_uri ~> CacheEntry */
+static GHashTable *cache_folders = NULL; /* CamelFolder * ~> CacheFolder */
+static GQueue cache_lru = G_QUEUE_INIT; /* CacheEntry, the most recent first */
+static EMailPartListCacheStats cache_stats = { 0, 0, CACHE_DEFAULT_BUDGET, 0, 0, 0, 0 };
+G_LOCK_DEFINE_STATIC (cache);
+
 static void
 mail_part_list_set_folder (EMailPartList *part_list,
                            CamelFolder *folder)
@@ -434,3 +460,338 @@ e_mail_part_list_get_registry (void)
 
 	return registry;
 }
+
+static gsize
+mail_part_list_estimate_size (EMailPartList *part_list)
+{
+	CamelFolder *folder;
+	const gchar *message_uid;
+	gsize size = 0;
+	guint n_parts;
+
+	folder = e_mail_part_list_get_folder (part_list);
+	message_uid = e_mail_part_list_get_message_uid (part_list);
+
+	if (folder && message_uid) {
+		CamelMessageInfo *info;
+
+		info = camel_folder_get_message_info (folder, message_uid);
+		if (info) {
+			size = camel_message_info_get_size (info);
+			g_object_unref (info);
+		}
+	}
+
+	if (!size)
+		size = 64 * 1024;
+
+	g_mutex_lock (&part_list->priv->queue_lock);
+	n_parts = g_queue_get_length (&part_list->priv->queue);
+	g_mutex_unlock (&part_list->priv->queue_lock);
+
+	/* The parts keep decoded copies of the message content */
+	return 2 * size + n_parts * 1024;
+}
+
+/* Call with the cache lock held; the part list is added to the 'unref_later' */
+static void
+mail_part_list_cache_remove_entry_locked (CacheEntry *entry,
+					  GSList **unref_later)
+{
+	CacheFolder *cache_folder = entry->cache_folder;
+
+	g_queue_delete_link (&cache_lru, entry->link);
+	cache_stats.size -= entry->size;
+	cache_stats.n_items--;
+
+	if (cache_folder) {
+		cache_folder->n_entries--;
+
+		if (!cache_folder->n_entries) {
+			g_signal_handler_disconnect (cache_folder->folder, cache_folder->changed_handler_id);
+			g_hash_table_remove (cache_folders, cache_folder->folder);
+		}
+	}
+
+	*unref_later = g_slist_prepend (*unref_later, entry->part_list);
+
+	/* Frees the 'entry' */
+	g_hash_table_remove (cache_entries, entry->mail_uri);
+}
+
+static void
+mail_part_list_cache_evict_locked (GSList **unref_later)
+{
+	/* Always keep at least the most recent part list */
+	while (cache_stats.size > cache_stats.budget && cache_lru.length > 1) {
+		mail_part_list_cache_remove_entry_locked (g_queue_peek_tail (&cache_lru), unref_later);
+		cache_stats.evictions++;
+	}
+}
+
+static void
+mail_part_list_cache_folder_changed_cb (CamelFolder *folder,
+					CamelFolderChangeInfo *changes,
+					gpointer user_data)
+{
+	GPtrArray *uids;
+	GSList *unref_later = NULL;
+	guint ii;
+
+	if (!changes)
+		return;
+
+	/* Flag changes do not influence the parsed content,
+	   thus drop only the removed messages */
+	uids = changes->uid_removed;
+	if (!uids || !uids->len)
+		return;
+
+	G_LOCK (cache);
+
+	for (ii = 0; ii < uids->len && cache_entries; ii++) {
+		CacheEntry *entry;
+		gchar *mail_uri;
+
+		mail_uri = e_mail_part_build_uri (folder, g_ptr_array_index (uids, ii), NULL, NULL);
+		entry = g_hash_table_lookup (cache_entries, mail_uri);
+		if (entry) {
+			mail_part_list_cache_remove_entry_locked (entry, &unref_later);
+			cache_stats.invalidations++;
+		}
+		g_free (mail_uri);
+	}
+
+	G_UNLOCK (cache);
+
+	g_slist_free_full (unref_later, g_object_unref);
+}
+
+static void
+mail_part_list_cache_entry_free (gpointer ptr)
+{
+	CacheEntry *entry = ptr;
+
+	if (entry) {
+		g_free (entry->mail_uri);
+		g_slice_free (CacheEntry, entry);
+	}
+}
+
+/**
+ * e_mail_part_list_cache_ref:
+ * @mail_uri: a mail URI, as returned by e_mail_part_build_uri()
+ *
+ * Looks up a parsed #EMailPartList in the cache and marks it as the most
+ * recently used. The cache keeps the part lists alive, thus they can be
+ * also found in the e_mail_part_list_get_registry().
+ *
+ * Returns: (transfer full) (nullable): the cached #EMailPartList, or %NULL.
+ *    Free it with g_object_unref(), when no longer needed.
+ *
+ * Since: 3.38
+ **/
+EMailPartList *
+e_mail_part_list_cache_ref (const gchar *mail_uri)
+{
+	CacheEntry *entry = NULL;
+	EMailPartList *part_list = NULL;
+
+	g_return_val_if_fail (mail_uri != NULL, NULL);
+
+	G_LOCK (cache);
+
+	if (cache_entries)
+		entry = g_hash_table_lookup (cache_entries, mail_uri);
+
+	if (entry) {
+		g_queue_unlink (&cache_lru, entry->link);
+		g_queue_push_head_link (&cache_lru, entry->link);
+
+		part_list = g_object_ref (entry->part_list);
+		cache_stats.hits++;
+	} else {
+		cache_stats.misses++;
+	}
+
+	G_UNLOCK (cache);
+
+	return part_list;
+}
+
+/**
+ * e_mail_part_list_cache_add:
+ * @mail_uri: a mail URI, as returned by e_mail_part_build_uri()
+ * @part_list: an #EMailPartList
+ *
+ * Stores the @part_list in the cache of parsed messages, or marks it as
+ * the most recently used, when it is already there. The least recently
+ * used part lists are dropped, when the cache exceeds its memory budget.
+ * The part lists of messages removed from their folder are dropped too.
+ *
+ * Since: 3.38
+ **/
+void
+e_mail_part_list_cache_add (const gchar *mail_uri,
+			    EMailPartList *part_list)
+{
+	CamelFolder *folder;
+	CacheEntry *entry;
+	GSList *unref_later = NULL;
+	gsize size;
+
+	g_return_if_fail (mail_uri != NULL);
+	g_return_if_fail (E_IS_MAIL_PART_LIST (part_list));
+
+	/* Outside of the lock, it can query the folder summary */
+	size = mail_part_list_estimate_size (part_list);
+	folder = e_mail_part_list_get_folder (part_list);
+
+	G_LOCK (cache);
+
+	if (!cache_entries) {
+		cache_entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, mail_part_list_cache_entry_free);
+		cache_folders = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	}
+
+	entry = g_hash_table_lookup (cache_entries, mail_uri);
+	if (entry && entry->part_list == part_list) {
+		g_queue_unlink (&cache_lru, entry->link);
+		g_queue_push_head_link (&cache_lru, entry->link);
+		G_UNLOCK (cache);
+		return;
+	}
+
+	/* Replaced with a newly parsed part list */
+	if (entry)
+		mail_part_list_cache_remove_entry_locked (entry, &unref_later);
+
+	entry = g_slice_new0 (CacheEntry);
+	entry->mail_uri = g_strdup (mail_uri);
+	entry->part_list = g_object_ref (part_list);
+	entry->size = size;
+
+	if (folder) {
+		CacheFolder *cache_folder;
+
+		cache_folder = g_hash_table_lookup (cache_folders, folder);
+		if (!cache_folder) {
+			cache_folder = g_new0 (CacheFolder, 1);
+			cache_folder->folder = folder;
+			cache_folder->changed_handler_id = g_signal_connect (
+				folder, "changed",
+				G_CALLBACK (mail_part_list_cache_folder_changed_cb), NULL);
+
+			g_hash_table_insert (cache_folders, folder, cache_folder);
+		}
+
+		cache_folder->n_entries++;
+		entry->cache_folder = cache_folder;
+	}
+
+	g_queue_push_head (&cache_lru, entry);
+	entry->link = cache_lru.head;
+	g_hash_table_insert (cache_entries, entry->mail_uri, entry);
+
+	cache_stats.size += entry->size;
+	cache_stats.n_items++;
+
+	mail_part_list_cache_evict_locked (&unref_later);
+
+	G_UNLOCK (cache);
+
+	g_slist_free_full (unref_later, g_object_unref);
+}
+
+/**
+ * e_mail_part_list_cache_remove:
+ * @mail_uri: a mail URI, as returned by e_mail_part_build_uri()
+ *
+ * Drops the part list for the @mail_uri from the cache of parsed messages.
+ *
+ * Since: 3.38
+ **/
+void
+e_mail_part_list_cache_remove (const gchar *mail_uri)
+{
+	CacheEntry *entry = NULL;
+	GSList *unref_later = NULL;
+
+	g_return_if_fail (mail_uri != NULL);
+
+	G_LOCK (cache);
+
+	if (cache_entries)
+		entry = g_hash_table_lookup (cache_entries, mail_uri);
+	if (entry)
+		mail_part_list_cache_remove_entry_locked (entry, &unref_later);
+
+	G_UNLOCK (cache);
+
+	g_slist_free_full (unref_later, g_object_unref);
+}
+
+/**
+ * e_mail_part_list_cache_remove_all:
+ *
+ * Drops all the part lists from the cache of parsed messages, like when
+ * the settings influencing the parsing change.
+ *
+ * Since: 3.38
+ **/
+void
+e_mail_part_list_cache_remove_all (void)
+{
+	GSList *unref_later = NULL;
+
+	G_LOCK (cache);
+
+	while (!g_queue_is_empty (&cache_lru))
+		mail_part_list_cache_remove_entry_locked (g_queue_peek_head (&cache_lru), &unref_later);
+
+	G_UNLOCK (cache);
+
+	g_slist_free_full (unref_later, g_object_unref);
+}
+
+/**
+ * e_mail_part_list_cache_set_budget:
+ * @budget: memory budget, in bytes
+ *
+ * Sets how much memory the cache of parsed messages can use. The sizes
+ * of the part lists are estimated from the sizes of their messages.
+ *
+ * Since: 3.38
+ **/
+void
+e_mail_part_list_cache_set_budget (gsize budget)
+{
+	GSList *unref_later = NULL;
+
+	G_LOCK (cache);
+
+	cache_stats.budget = budget;
+	mail_part_list_cache_evict_locked (&unref_later);
+
+	G_UNLOCK (cache);
+
+	g_slist_free_full (unref_later, g_object_unref);
+}
+
+/**
+ * e_mail_part_list_cache_get_stats:
+ * @out_stats: (out caller-allocates): an #EMailPartListCacheStats to fill
+ *
+ * Fills the current statistics of the cache of parsed messages.
+ *
+ * Since: 3.38
+ **/
+void
+e_mail_part_list_cache_get_stats (EMailPartListCacheStats *out_stats)
+{
+	g_return_if_fail (out_stats != NULL);
+
+	G_LOCK (cache);
+	*out_stats = cache_stats;
+	G_UNLOCK (cache);
+}
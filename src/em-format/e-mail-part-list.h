@@ -45,6 +45,7 @@ G_BEGIN_DECLS
 typedef struct _EMailPartList EMailPartList;
 typedef struct _EMailPartListClass EMailPartListClass;
 typedef struct _EMailPartListPrivate EMailPartListPrivate;
+typedef struct _EMailPartListCacheStats EMailPartListCacheStats;
 
 struct _EMailPartList {
 	GObject parent;
@@ -55,6 +56,28 @@ struct _EMailPartListClass {
 	GObjectClass parent_class;
 };
 
+/**
+ * EMailPartListCacheStats:
+ * @n_items: count of the cached part lists
+ * @size: estimated size of the cached part lists, in bytes
+ * @budget: the memory budget of the cache, in bytes
+ * @hits: how many lookups found the part list in the cache
+ * @misses: how many lookups did not find the part list in the cache
+ * @evictions: how many part lists were dropped to fit into the budget
+ * @invalidations: how many part lists were dropped due to folder changes
+ *
+ * Since: 3.38
+ **/
+struct _EMailPartListCacheStats {
+	guint n_items;
+	gsize size;
+	gsize budget;
+	guint64 hits;
+	guint64 misses;
+	guint64 evictions;
+	guint64 invalidations;
+};
+
 GType		e_mail_part_list_get_type	(void) G_GNUC_CONST;
 EMailPartList *	e_mail_part_list_new		(CamelMimeMessage *message,
 						 const gchar *message_uid,
@@ -76,6 +99,17 @@ gboolean	e_mail_part_list_is_empty	(EMailPartList *part_list);
 CamelObjectBag *
 		e_mail_part_list_get_registry	(void);
 
+EMailPartList *	e_mail_part_list_cache_ref	(const gchar *mail_uri);
+void		e_mail_part_list_cache_add	(const gchar *mail_uri,
+						 EMailPartList *part_list);
+void		e_mail_part_list_cache_remove	(const gchar *mail_uri);
+void		e_mail_part_list_cache_remove_all
+						(void);
+void		e_mail_part_list_cache_set_budget
+						(gsize budget);
+void		e_mail_part_list_cache_get_stats
+						(EMailPartListCacheStats *out_stats);
+
 G_END_DECLS
 
 #endif /* E_MAIL_PART_LIST_H */ 
@@ -19,6 +19,7 @@
 
 #include "e-mail-folder-utils.h"
 
+#include <string.h>
 #include <glib/gi18n-lib.h>
 
 #include <libedataserver/libedataserver.h>
@@ -658,14 +659,121 @@ mail_folder_find_duplicate_messages_thread (GSimpleAsyncResult *simple,
 		g_simple_async_result_take_error (simple, error);
 }
 
+/* Messages hashed by one task of the thread pool */
+#define EMFU_HASH_BATCH_SIZE 32
+
+typedef struct _HashMessagesData {
+	CamelFolder *folder;
+	GPtrArray *message_uids;
+	GCancellable *cancellable;
+	gchar **digests; /* one for each message UID */
+
+	GMutex lock;
+	gboolean failed;
+	GError *error;
+	gint n_done; /* atomic */
+} HashMessagesData;
+
+/* Generates a digest string from the message's content. */
+static gchar *
+emfu_digest_message_content (CamelMimeMessage *message,
+                             GCancellable *cancellable)
+{
+	CamelDataWrapper *content;
+	CamelStream *stream;
+	GByteArray *buffer;
+	gchar *digest = NULL;
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (message));
+	if (content == NULL)
+		return NULL;
+
+	stream = camel_stream_mem_new ();
+
+	if (camel_data_wrapper_decode_to_stream_sync (content, stream, cancellable, NULL) >= 0) {
+		guint data_len;
+
+		/* The CamelStreamMem owns the buffer. */
+		buffer = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (stream));
+		data_len = buffer ? buffer->len : 0;
+
+		/* Strip trailing white-spaces and empty lines */
+		while (data_len > 0 && g_ascii_isspace (buffer->data[data_len - 1]))
+			data_len--;
+
+		if (data_len > 0)
+			digest = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer->data, data_len);
+	}
+
+	g_object_unref (stream);
+
+	return digest;
+}
+
+static void
+emfu_hash_messages_thread (gpointer data,
+                           gpointer user_data)
+{
+	HashMessagesData *hmd = user_data;
+	guint ii, first, last;
+
+	first = GPOINTER_TO_UINT (data) - 1;
+	last = MIN (first + EMFU_HASH_BATCH_SIZE, hmd->message_uids->len);
+
+	for (ii = first; ii < last; ii++) {
+		CamelMimeMessage *message;
+		GError *local_error = NULL;
+		gboolean failed;
+		guint n_done;
+
+		g_mutex_lock (&hmd->lock);
+		failed = hmd->failed;
+		g_mutex_unlock (&hmd->lock);
+
+		if (failed || g_cancellable_is_cancelled (hmd->cancellable))
+			break;
+
+		message = camel_folder_get_message_sync (
+			hmd->folder, g_ptr_array_index (hmd->message_uids, ii),
+			hmd->cancellable, &local_error);
+
+		if (!CAMEL_IS_MIME_MESSAGE (message)) {
+			g_clear_object (&message);
+
+			g_mutex_lock (&hmd->lock);
+			hmd->failed = TRUE;
+			if (!hmd->error && local_error)
+				g_propagate_error (&hmd->error, local_error);
+			else
+				g_clear_error (&local_error);
+			g_mutex_unlock (&hmd->lock);
+			break;
+		}
+
+		hmd->digests[ii] = emfu_digest_message_content (message, hmd->cancellable);
+
+		g_object_unref (message);
+
+		n_done = (guint) g_atomic_int_add (&hmd->n_done, 1) + 1;
+
+		/* Report only when the percentage changes */
+		if ((n_done * 100) / hmd->message_uids->len != ((n_done - 1) * 100) / hmd->message_uids->len)
+			camel_operation_progress (hmd->cancellable, (n_done * 100) / hmd->message_uids->len);
+	}
+}
+
+/* Returns { MessageUID : digest-as-string } for the 'message_uids'.
+ * The messages are retrieved and hashed in batches, by a thread pool.
+ * This is an all or nothing operation, it returns NULL if any message
+ * cannot be retrieved. */
 static GHashTable *
 emfu_get_messages_hash_sync (CamelFolder *folder,
                              GPtrArray *message_uids,
                              GCancellable *cancellable,
                              GError **error)
 {
-	GHashTable *hash_table;
-	CamelMimeMessage *message;
+	HashMessagesData hmd;
+	GHashTable *hash_table = NULL;
 	guint ii;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
@@ -679,75 +787,51 @@ emfu_get_messages_hash_sync (CamelFolder *folder,
 			message_uids->len),
 		message_uids->len);
 
-	hash_table = g_hash_table_new_full (
-		(GHashFunc) g_str_hash,
-		(GEqualFunc) g_str_equal,
-		(GDestroyNotify) g_free,
-		(GDestroyNotify) g_free);
-
-	/* This is an all or nothing operation.  Destroy the
-	 * hash table if we fail to retrieve any message. */
-
-	for (ii = 0; ii < message_uids->len; ii++) {
-		const gchar *uid;
-		gint percent;
-
-		uid = g_ptr_array_index (message_uids, ii);
-		percent = ((ii + 1) * 100) / message_uids->len;
-
-		message = camel_folder_get_message_sync (
-			folder, uid, cancellable, error);
-
-		camel_operation_progress (cancellable, percent);
-
-		if (CAMEL_IS_MIME_MESSAGE (message)) {
-			CamelDataWrapper *content;
-			gchar *digest = NULL;
-
-			/* Generate a digest string from the message's content. */
-			content = camel_medium_get_content (CAMEL_MEDIUM (message));
-
-			if (content != NULL) {
-				CamelStream *stream;
-				GByteArray *buffer;
-				gssize n_bytes;
+	memset (&hmd, 0, sizeof (HashMessagesData));
+	hmd.folder = folder;
+	hmd.message_uids = message_uids;
+	hmd.cancellable = cancellable;
+	hmd.digests = g_new0 (gchar *, message_uids->len + 1);
+	g_mutex_init (&hmd.lock);
 
-				stream = camel_stream_mem_new ();
+	if (message_uids->len > 0) {
+		GThreadPool *pool;
 
-				n_bytes = camel_data_wrapper_decode_to_stream_sync (
-					content, stream, cancellable, error);
+		pool = g_thread_pool_new (
+			emfu_hash_messages_thread, &hmd,
+			CLAMP (g_get_num_processors (), 1, 8),
+			FALSE, NULL);
 
-				if (n_bytes >= 0) {
-					guint data_len;
+		for (ii = 0; ii < message_uids->len; ii += EMFU_HASH_BATCH_SIZE)
+			g_thread_pool_push (pool, GUINT_TO_POINTER (ii + 1), NULL);
 
-					/* The CamelStreamMem owns the buffer. */
-					buffer = camel_stream_mem_get_byte_array (
-						CAMEL_STREAM_MEM (stream));
-					g_return_val_if_fail (buffer != NULL, NULL);
-
-					data_len = buffer->len;
-
-					/* Strip trailing white-spaces and empty lines */
-					while (data_len > 0 && g_ascii_isspace (buffer->data[data_len - 1]))
-						data_len--;
-
-					if (data_len > 0)
-						digest = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer->data, data_len);
-				}
+		/* Waits for all the batches to be processed */
+		g_thread_pool_free (pool, FALSE, TRUE);
+	}
 
-				g_object_unref (stream);
-			}
+	if (hmd.error) {
+		g_propagate_error (error, hmd.error);
+	} else if (!hmd.failed && !g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		hash_table = g_hash_table_new_full (
+			(GHashFunc) g_str_hash,
+			(GEqualFunc) g_str_equal,
+			(GDestroyNotify) g_free,
+			(GDestroyNotify) g_free);
 
+		for (ii = 0; ii < message_uids->len; ii++) {
 			g_hash_table_insert (
-				hash_table, g_strdup (uid), digest);
-			g_object_unref (message);
-		} else {
-			g_hash_table_destroy (hash_table);
-			hash_table = NULL;
-			break;
+				hash_table,
+				g_strdup (g_ptr_array_index (message_uids, ii)),
+				hmd.digests[ii]);
+			hmd.digests[ii] = NULL;
 		}
 	}
 
+	for (ii = 0; ii < message_uids->len; ii++)
+		g_free (hmd.digests[ii]);
+	g_free (hmd.digests);
+	g_mutex_clear (&hmd.lock);
+
 	camel_operation_pop_message (cancellable);
 
 	return hash_table;
@@ -759,92 +843,136 @@ e_mail_folder_find_duplicate_messages_sync (CamelFolder *folder,
                                             GCancellable *cancellable,
                                             GError **error)
 {
-	GQueue trash = G_QUEUE_INIT;
+	GHashTable *buckets;
 	GHashTable *hash_table;
-	GHashTable *unique_ids;
+	GHashTable *duplicates;
+	GHashTable *digests;
+	GPtrArray *candidates;
 	GHashTableIter iter;
-	gpointer key, value;
+	gpointer value;
+	guint ii;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
 	g_return_val_if_fail (message_uids != NULL, NULL);
 
-	/* hash_table = { MessageUID : digest-as-string } */
-	hash_table = emfu_get_messages_hash_sync (
-		folder, message_uids, cancellable, error);
-
-	if (hash_table == NULL)
-		return NULL;
-
 	camel_operation_push_message (
 		cancellable, _("Scanning messages for duplicates"));
 
-	unique_ids = g_hash_table_new_full (
+	/* buckets = { Message-ID : GPtrArray { MessageUID } } */
+	buckets = g_hash_table_new_full (
 		(GHashFunc) g_int64_hash,
 		(GEqualFunc) g_int64_equal,
 		(GDestroyNotify) g_free,
-		(GDestroyNotify) g_free);
-
-	g_hash_table_iter_init (&iter, hash_table);
+		(GDestroyNotify) g_ptr_array_unref);
 
-	while (g_hash_table_iter_next (&iter, &key, &value)) {
+	for (ii = 0; ii < message_uids->len; ii++) {
+		const gchar *uid = g_ptr_array_index (message_uids, ii);
 		CamelSummaryMessageID message_id;
-		CamelMessageFlags flags;
 		CamelMessageInfo *info;
-		gboolean duplicate;
-		const gchar *digest;
+		GPtrArray *bucket;
 
-		info = camel_folder_get_message_info (folder, key);
+		info = camel_folder_get_message_info (folder, uid);
 		if (!info)
 			continue;
 
-		message_id.id.id = camel_message_info_get_message_id (info);
-		flags = camel_message_info_get_flags (info);
-
 		/* Skip messages marked for deletion. */
-		if (flags & CAMEL_MESSAGE_DELETED) {
-			g_queue_push_tail (&trash, key);
+		if ((camel_message_info_get_flags (info) & CAMEL_MESSAGE_DELETED) != 0) {
 			g_clear_object (&info);
 			continue;
 		}
 
-		digest = value;
+		message_id.id.id = camel_message_info_get_message_id (info);
+		g_clear_object (&info);
+
+		bucket = g_hash_table_lookup (buckets, &message_id.id.id);
+		if (!bucket) {
+			gint64 *v_int64;
 
-		if (digest == NULL) {
-			g_queue_push_tail (&trash, key);
-			g_clear_object (&info);
-			continue;
+			v_int64 = g_new0 (gint64, 1);
+			*v_int64 = (gint64) message_id.id.id;
+
+			bucket = g_ptr_array_new ();
+			g_hash_table_insert (buckets, v_int64, bucket);
 		}
 
-		/* Determine if the message a duplicate. */
+		g_ptr_array_add (bucket, (gpointer) uid);
+	}
 
-		value = g_hash_table_lookup (unique_ids, &message_id.id.id);
-		duplicate = (value != NULL) && g_str_equal (digest, value);
+	/* Only messages sharing the Message-ID with another
+	 * message can be duplicates, thus only those are
+	 * retrieved and hashed. The buckets are not split by
+	 * the message size, because the summary size covers the
+	 * headers too, which differ between copies of the same
+	 * message (Received, X-Evolution-Source, ...), while
+	 * only the content is compared. */
+	candidates = g_ptr_array_new ();
 
-		if (!duplicate) {
-			gint64 *v_int64;
+	g_hash_table_iter_init (&iter, buckets);
 
-			/* XXX Might be better to create a GArray
-			 *     of 64-bit integers and have the hash
-			 *     table keys point to array elements. */
-			v_int64 = g_new0 (gint64, 1);
-			*v_int64 = (gint64) message_id.id.id;
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GPtrArray *bucket = value;
 
-			g_hash_table_insert (unique_ids, v_int64, g_strdup (digest));
-			g_queue_push_tail (&trash, key);
+		if (bucket->len > 1) {
+			for (ii = 0; ii < bucket->len; ii++)
+				g_ptr_array_add (candidates, g_ptr_array_index (bucket, ii));
 		}
+	}
 
-		g_clear_object (&info);
+	/* hash_table = { MessageUID : digest-as-string } */
+	hash_table = emfu_get_messages_hash_sync (
+		folder, candidates, cancellable, error);
+
+	g_ptr_array_unref (candidates);
+
+	if (hash_table == NULL) {
+		camel_operation_pop_message (cancellable);
+		g_hash_table_destroy (buckets);
+		return NULL;
 	}
 
-	/* Delete all non-duplicate messages from the hash table. */
-	while ((key = g_queue_pop_head (&trash)) != NULL)
-		g_hash_table_remove (hash_table, key);
+	/* duplicates = { MessageUID : digest-as-string } */
+	duplicates = g_hash_table_new_full (
+		(GHashFunc) g_str_hash,
+		(GEqualFunc) g_str_equal,
+		(GDestroyNotify) g_free,
+		(GDestroyNotify) g_free);
+
+	/* Digests seen in the current bucket */
+	digests = g_hash_table_new (g_str_hash, g_str_equal);
+
+	g_hash_table_iter_init (&iter, buckets);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GPtrArray *bucket = value;
+
+		if (bucket->len <= 1)
+			continue;
+
+		g_hash_table_remove_all (digests);
+
+		/* The first message with each digest is the original one. */
+		for (ii = 0; ii < bucket->len; ii++) {
+			const gchar *uid = g_ptr_array_index (bucket, ii);
+			const gchar *digest;
+
+			digest = g_hash_table_lookup (hash_table, uid);
+			if (digest == NULL)
+				continue;
+
+			if (g_hash_table_contains (digests, digest))
+				g_hash_table_insert (duplicates, g_strdup (uid), g_strdup (digest));
+			else
+				g_hash_table_add (digests, (gpointer) digest);
+		}
+	}
 
 	camel_operation_pop_message (cancellable);
 
-	g_hash_table_destroy (unique_ids);
+	g_hash_table_destroy (digests);
+	g_hash_table_destroy (hash_table);
+	g_hash_table_destroy (buckets);
 
-	return hash_table;
+	return duplicates;
 }
 
 void
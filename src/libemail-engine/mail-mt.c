@@ -30,6 +30,14 @@
 /*#define MALLOC_CHECK*/
 #define d(x)
 
+/* The exec functions mostly block on I/O, thus do not go below
+ * this many threads for the unordered messages on small machines. */
+#define MIN_UNORDERED_THREADS 10
+
+/* Time budget of one dispatch of the done callbacks in the main loop;
+ * the rest is left for the next dispatch, after the redraw. */
+#define DISPATCH_BUDGET_USEC (10 * 1000)
+
 static guint mail_msg_seq; /* sequence number of each message */
 
 /* Table of active messages.  Must hold mail_msg_lock to access. */
@@ -37,6 +45,12 @@ static GHashTable *mail_msg_active_table;
 static GMutex mail_msg_lock;
 static GCond mail_msg_cond;
 
+/* MailMsgInfo ~> MailMsgStats.  Must hold mail_msg_lock to access. */
+static GHashTable *mail_msg_stats;
+
+/* Messages to be freed in the main loop dispatch. */
+static GAsyncQueue *msg_free_queue = NULL;
+
 static MailMsgCreateActivityFunc create_activity = NULL;
 static MailMsgSubmitActivityFunc submit_activity = NULL;
 static MailMsgFreeActivityFunc free_activity = NULL;
@@ -81,14 +95,7 @@ mail_msg_cancelled (CamelOperation *operation,
 	mail_msg_cancel (GPOINTER_TO_UINT (user_data));
 }
 
-static gboolean
-mail_msg_submit (CamelOperation *cancellable)
-{
-
-	if (submit_activity)
-		submit_activity ((GCancellable *) cancellable);
-	return FALSE;
-}
+static void mail_msg_schedule_dispatch (void);
 
 gpointer
 mail_msg_new_with_cancellable (MailMsgInfo *info,
@@ -156,10 +163,10 @@ checkmem (gpointer p)
 }
 #endif
 
-static gboolean
+static void
 mail_msg_free (MailMsg *mail_msg)
 {
-	/* This is an idle callback. */
+	/* Called from the main loop dispatch. */
 
 	if (free_activity)
 		free_activity (mail_msg->cancellable);
@@ -171,8 +178,6 @@ mail_msg_free (MailMsg *mail_msg)
 		g_error_free (mail_msg->error);
 
 	g_slice_free1 (mail_msg->info->size, mail_msg);
-
-	return FALSE;
 }
 
 gpointer
@@ -217,12 +222,10 @@ mail_msg_unref (gpointer msg)
 
 		g_mutex_unlock (&mail_msg_lock);
 
-		/* Destroy the message from an idle callback
-		 * so we know we're in the main loop thread.
-		 * Prioritize ahead of GTK+ redraws. */
-		g_idle_add_full (
-			G_PRIORITY_HIGH_IDLE,
-			(GSourceFunc) mail_msg_free, mail_msg, NULL);
+		/* Destroy the message from the main loop dispatch
+		 * so we know we're in the main loop thread. */
+		g_async_queue_push (msg_free_queue, mail_msg);
+		mail_msg_schedule_dispatch ();
 	}
 }
 
@@ -316,6 +319,7 @@ mail_msg_active (void)
 static guint idle_source_id = 0;
 G_LOCK_DEFINE_STATIC (idle_source_id);
 static GAsyncQueue *main_loop_queue = NULL;
+static GAsyncQueue *msg_submit_queue = NULL;
 static GAsyncQueue *msg_reply_queue = NULL;
 static GThread *main_thread = NULL;
 
@@ -323,24 +327,23 @@ static gboolean
 mail_msg_idle_cb (void)
 {
 	MailMsg *msg;
+	GCancellable *cancellable;
+	gint64 deadline;
 
 	g_return_val_if_fail (main_loop_queue != NULL, FALSE);
 	g_return_val_if_fail (msg_reply_queue != NULL, FALSE);
 
-	G_LOCK (idle_source_id);
-	idle_source_id = 0;
-	G_UNLOCK (idle_source_id);
+	/* The idle_source_id stays set while dispatching, thus the messages
+	 * unreferenced or pushed meanwhile do not schedule another dispatch;
+	 * the queues are checked again below instead. */
+
+	deadline = g_get_monotonic_time () + DISPATCH_BUDGET_USEC;
+
 	/* check the main loop queue */
 	while ((msg = g_async_queue_try_pop (main_loop_queue)) != NULL) {
-		GCancellable *cancellable;
-
 		cancellable = msg->cancellable;
 
-		g_idle_add_full (
-			G_PRIORITY_DEFAULT,
-			(GSourceFunc) mail_msg_submit,
-			g_object_ref (msg->cancellable),
-			(GDestroyNotify) g_object_unref);
+		g_async_queue_push (msg_submit_queue, g_object_ref (msg->cancellable));
 		if (msg->info->exec != NULL)
 			msg->info->exec (msg, cancellable, &msg->error);
 		if (msg->info->done != NULL)
@@ -348,34 +351,103 @@ mail_msg_idle_cb (void)
 		mail_msg_unref (msg);
 	}
 
-	/* check the reply queue */
-	while ((msg = g_async_queue_try_pop (msg_reply_queue)) != NULL) {
+	/* notify about the messages being run */
+	while ((cancellable = g_async_queue_try_pop (msg_submit_queue)) != NULL) {
+		if (submit_activity)
+			submit_activity (cancellable);
+		g_object_unref (cancellable);
+	}
+
+	/* check the reply queue; all the finished messages are handled
+	 * in one dispatch, unless it takes too long */
+	while (g_get_monotonic_time () < deadline &&
+	       (msg = g_async_queue_try_pop (msg_reply_queue)) != NULL) {
 		if (msg->info->done != NULL)
 			msg->info->done (msg);
 		mail_msg_check_error (msg);
 		mail_msg_unref (msg);
 	}
+
+	while ((msg = g_async_queue_try_pop (msg_free_queue)) != NULL)
+		mail_msg_free (msg);
+
+	G_LOCK (idle_source_id);
+	if (g_async_queue_length (msg_reply_queue) > 0 &&
+	    g_get_monotonic_time () >= deadline) {
+		/* Continue after the redraw, at a lower priority. */
+		idle_source_id = g_idle_add_full (
+			G_PRIORITY_DEFAULT_IDLE,
+			(GSourceFunc) mail_msg_idle_cb, NULL, NULL);
+	} else if (g_async_queue_length (main_loop_queue) > 0 ||
+		   g_async_queue_length (msg_submit_queue) > 0 ||
+		   g_async_queue_length (msg_reply_queue) > 0 ||
+		   g_async_queue_length (msg_free_queue) > 0) {
+		/* Prioritize ahead of GTK+ redraws. */
+		idle_source_id = g_idle_add_full (
+			G_PRIORITY_HIGH_IDLE,
+			(GSourceFunc) mail_msg_idle_cb, NULL, NULL);
+	} else {
+		idle_source_id = 0;
+	}
+	G_UNLOCK (idle_source_id);
+
 	return FALSE;
 }
 
+static void
+mail_msg_schedule_dispatch (void)
+{
+	G_LOCK (idle_source_id);
+	if (idle_source_id == 0)
+		/* Prioritize ahead of GTK+ redraws. */
+		idle_source_id = g_idle_add_full (
+			G_PRIORITY_HIGH_IDLE,
+			(GSourceFunc) mail_msg_idle_cb, NULL, NULL);
+	G_UNLOCK (idle_source_id);
+}
+
+static MailMsgStats *
+mail_msg_ref_stats_locked (MailMsgInfo *info)
+{
+	MailMsgStats *info_stats;
+
+	info_stats = g_hash_table_lookup (mail_msg_stats, info);
+	if (!info_stats) {
+		info_stats = g_new0 (MailMsgStats, 1);
+		g_hash_table_insert (mail_msg_stats, info, info_stats);
+	}
+
+	return info_stats;
+}
+
 static void
 mail_msg_proxy (MailMsg *msg)
 {
+	MailMsgInfo *info = msg->info;
+	MailMsgStats *info_stats;
 	GCancellable *cancellable;
+	gint64 started, finished;
 
 	cancellable = msg->cancellable;
 
+	started = g_get_monotonic_time ();
+
+	g_mutex_lock (&mail_msg_lock);
+	info_stats = mail_msg_ref_stats_locked (info);
+	info_stats->queued--;
+	info_stats->running++;
+	info_stats->wait_time += started - msg->queued_time;
+	info_stats->max_wait_time = MAX (info_stats->max_wait_time, started - msg->queued_time);
+	g_mutex_unlock (&mail_msg_lock);
+
 	if (msg->info->desc != NULL) {
 		gchar *text = msg->info->desc (msg);
 		camel_operation_push_message (cancellable, "%s", text);
 		g_free (text);
 	}
 
-	g_idle_add_full (
-		G_PRIORITY_DEFAULT,
-		(GSourceFunc) mail_msg_submit,
-		g_object_ref (msg->cancellable),
-		(GDestroyNotify) g_object_unref);
+	g_async_queue_push (msg_submit_queue, g_object_ref (msg->cancellable));
+	mail_msg_schedule_dispatch ();
 
 	if (msg->info->exec != NULL)
 		msg->info->exec (msg, cancellable, &msg->error);
@@ -383,15 +455,25 @@ mail_msg_proxy (MailMsg *msg)
 	if (msg->info->desc != NULL)
 		camel_operation_pop_message (cancellable);
 
+	finished = g_get_monotonic_time ();
+
+	g_mutex_lock (&mail_msg_lock);
+	info_stats = mail_msg_ref_stats_locked (info);
+	info_stats->running--;
+	info_stats->n_finished++;
+	info_stats->exec_time += finished - started;
+
+	if (camel_debug ("mail-mt"))
+		printf (
+			"[mail-mt] info %p: queued %u, running %u, finished %" G_GUINT64_FORMAT
+			", wait %" G_GINT64_FORMAT " us (max %" G_GINT64_FORMAT " us), exec %" G_GINT64_FORMAT " us\n",
+			info, info_stats->queued, info_stats->running, info_stats->n_finished,
+			started - msg->queued_time, info_stats->max_wait_time, finished - started);
+	g_mutex_unlock (&mail_msg_lock);
+
 	g_async_queue_push (msg_reply_queue, msg);
 
-	G_LOCK (idle_source_id);
-	if (idle_source_id == 0)
-		/* Prioritize ahead of GTK+ redraws. */
-		idle_source_id = g_idle_add_full (
-			G_PRIORITY_HIGH_IDLE,
-			(GSourceFunc) mail_msg_idle_cb, NULL, NULL);
-	G_UNLOCK (idle_source_id);
+	mail_msg_schedule_dispatch ();
 }
 
 void
@@ -401,9 +483,12 @@ mail_msg_init (void)
 	g_cond_init (&mail_msg_cond);
 
 	main_loop_queue = g_async_queue_new ();
+	msg_submit_queue = g_async_queue_new ();
 	msg_reply_queue = g_async_queue_new ();
+	msg_free_queue = g_async_queue_new ();
 
 	mail_msg_active_table = g_hash_table_new (NULL, NULL);
+	mail_msg_stats = g_hash_table_new_full (NULL, NULL, NULL, g_free);
 	main_thread = g_thread_self ();
 }
 
@@ -435,6 +520,18 @@ create_thread_pool (gpointer data)
 	return thread_pool;
 }
 
+static void
+mail_msg_pool_push (GThreadPool *thread_pool,
+                    MailMsg *msg)
+{
+	g_mutex_lock (&mail_msg_lock);
+	mail_msg_ref_stats_locked (msg->info)->queued++;
+	msg->queued_time = g_get_monotonic_time ();
+	g_mutex_unlock (&mail_msg_lock);
+
+	g_thread_pool_push (thread_pool, msg, NULL);
+}
+
 void
 mail_msg_main_loop_push (gpointer msg)
 {
@@ -442,13 +539,7 @@ mail_msg_main_loop_push (gpointer msg)
 		main_loop_queue, msg,
 		(GCompareDataFunc) mail_msg_compare, NULL);
 
-	G_LOCK (idle_source_id);
-	if (idle_source_id == 0)
-		/* Prioritize ahead of GTK+ redraws. */
-		idle_source_id = g_idle_add_full (
-			G_PRIORITY_HIGH_IDLE,
-			(GSourceFunc) mail_msg_idle_cb, NULL, NULL);
-	G_UNLOCK (idle_source_id);
+	mail_msg_schedule_dispatch ();
 }
 
 void
@@ -456,9 +547,10 @@ mail_msg_unordered_push (gpointer msg)
 {
 	static GOnce once = G_ONCE_INIT;
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (10));
+	g_once (&once, (GThreadFunc) create_thread_pool,
+		GINT_TO_POINTER (MAX (g_get_num_processors (), MIN_UNORDERED_THREADS)));
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	mail_msg_pool_push ((GThreadPool *) once.retval, msg);
 }
 
 void
@@ -468,7 +560,7 @@ mail_msg_fast_ordered_push (gpointer msg)
 
 	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	mail_msg_pool_push ((GThreadPool *) once.retval, msg);
 }
 
 void
@@ -478,7 +570,25 @@ mail_msg_slow_ordered_push (gpointer msg)
 
 	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	mail_msg_pool_push ((GThreadPool *) once.retval, msg);
+}
+
+gboolean
+mail_msg_get_stats (const MailMsgInfo *info,
+                    MailMsgStats *out_stats)
+{
+	MailMsgStats *info_stats;
+
+	g_return_val_if_fail (info != NULL, FALSE);
+	g_return_val_if_fail (out_stats != NULL, FALSE);
+
+	g_mutex_lock (&mail_msg_lock);
+	info_stats = g_hash_table_lookup (mail_msg_stats, info);
+	if (info_stats)
+		*out_stats = *info_stats;
+	g_mutex_unlock (&mail_msg_lock);
+
+	return info_stats != NULL;
 }
 
 gboolean
@@ -32,6 +32,7 @@
 
 typedef struct _MailMsg MailMsg;
 typedef struct _MailMsgInfo MailMsgInfo;
+typedef struct _MailMsgStats MailMsgStats;
 
 typedef gchar *	(*MailMsgDescFunc)		(MailMsg *msg);
 typedef void	(*MailMsgExecFunc)		(MailMsg *msg,
@@ -59,6 +60,7 @@ struct _MailMsg {
 	gint priority;			/* priority (default = 0) */
 	GCancellable *cancellable;
 	GError *error;			/* up to the caller to use this */
+	gint64 queued_time;		/* when pushed to a thread pool */
 };
 
 struct _MailMsgInfo {
@@ -69,6 +71,17 @@ struct _MailMsgInfo {
 	MailMsgFreeFunc free;
 };
 
+/* counters of the messages of one MailMsgInfo pushed to threads,
+ * the times are in microseconds */
+struct _MailMsgStats {
+	guint queued;			/* waiting to be run */
+	guint running;
+	guint64 n_finished;
+	gint64 wait_time;		/* total time spent in the queues */
+	gint64 max_wait_time;
+	gint64 exec_time;		/* total time spent running */
+};
+
 /* Just till we move this out to EDS */
 EAlertSink *	mail_msg_get_alert_sink (void);
 
@@ -100,6 +113,9 @@ void mail_msg_unordered_push (gpointer msg);
 void mail_msg_fast_ordered_push (gpointer msg);
 void mail_msg_slow_ordered_push (gpointer msg);
 
+gboolean mail_msg_get_stats (const MailMsgInfo *info,
+			     MailMsgStats *out_stats);
+
 /* Call a function in the GUI thread, wait for it to return, type is
  * the marshaller to use.  FIXME This thing is horrible, please put
  * it out of its misery. */
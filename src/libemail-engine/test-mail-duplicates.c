@@ -0,0 +1,269 @@
+/*
+ * test-mail-duplicates.c - Benchmark for finding duplicate messages.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "evolution-config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include <camel/camel.h>
+
+#include <libemail-engine/libemail-engine.h>
+
+static gint opt_messages = 20000;
+
+static GOptionEntry entries[] = {
+	{ "messages", 'm', 0, G_OPTION_ARG_INT, &opt_messages,
+	  "Number of messages in the folder", "N" },
+	{ NULL }
+};
+
+/* A plain CamelSession, to be able to add a maildir store */
+
+#define TEST_TYPE_SESSION (test_session_get_type ())
+
+typedef struct _TestSession TestSession;
+typedef struct _TestSessionClass TestSessionClass;
+
+struct _TestSession {
+	CamelSession parent;
+};
+
+struct _TestSessionClass {
+	CamelSessionClass parent_class;
+};
+
+GType test_session_get_type (void);
+
+G_DEFINE_TYPE (TestSession, test_session, CAMEL_TYPE_SESSION)
+
+static void
+test_session_class_init (TestSessionClass *class)
+{
+}
+
+static void
+test_session_init (TestSession *session)
+{
+}
+
+static void
+remove_recursively (const gchar *path)
+{
+	if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+		GDir *dir;
+
+		dir = g_dir_open (path, 0, NULL);
+		if (dir) {
+			const gchar *name;
+
+			while ((name = g_dir_read_name (dir)) != NULL) {
+				gchar *filename;
+
+				filename = g_build_filename (path, name, NULL);
+				remove_recursively (filename);
+				g_free (filename);
+			}
+
+			g_dir_close (dir);
+		}
+
+		g_rmdir (path);
+	} else {
+		g_unlink (path);
+	}
+}
+
+/* Every fourth message is a copy of the previous one, and every eighth
+ * reuses the Message-ID of the previous one with a different body. Returns
+ * how many duplicates were stored, or -1 on error. */
+static gint
+fill_folder (CamelFolder *folder,
+             gint n_messages)
+{
+	gint ii, n_duplicates = 0;
+
+	for (ii = 0; ii < n_messages; ii++) {
+		CamelMimeMessage *message;
+		gchar *message_id, *body;
+		gint base = ii;
+		gboolean success;
+		GError *local_error = NULL;
+
+		if (ii % 4 == 3) {
+			base = ii - 1;
+			n_duplicates++;
+		}
+
+		message_id = g_strdup_printf ("bench-%d@example.com", ii % 8 == 5 ? ii - 1 : base);
+		body = g_strdup_printf (
+			"Message number %d of the benchmark.\n"
+			"Some text to make the body a bit longer, like in real messages.\n"
+			"Regards,\n  Evolution\n\n", base);
+
+		message = camel_mime_message_new ();
+		camel_mime_message_set_subject (message, "Benchmark message");
+		camel_mime_message_set_message_id (message, message_id);
+		camel_mime_message_set_date (message, 1500000000 + base * 60, 0);
+		camel_mime_part_set_content (CAMEL_MIME_PART (message), body, strlen (body), "text/plain");
+
+		success = camel_folder_append_message_sync (folder, message, NULL, NULL, NULL, &local_error);
+
+		g_object_unref (message);
+		g_free (message_id);
+		g_free (body);
+
+		if (!success) {
+			g_printerr ("Failed to append message: %s\n", local_error ? local_error->message : "Unknown error");
+			g_clear_error (&local_error);
+			return -1;
+		}
+	}
+
+	return n_duplicates;
+}
+
+static gint
+run_benchmark (gint n_messages)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelSettings *settings;
+	CamelFolder *folder;
+	GHashTable *duplicates;
+	GPtrArray *uids;
+	GTimer *timer;
+	gchar *tmp_dir, *store_dir;
+	gint n_duplicates;
+	gint res = 0;
+	GError *local_error = NULL;
+
+	tmp_dir = g_dir_make_tmp ("test-mail-duplicates-XXXXXX", &local_error);
+	if (!tmp_dir) {
+		g_printerr ("Failed to create temporary directory: %s\n", local_error->message);
+		g_clear_error (&local_error);
+		return 1;
+	}
+
+	camel_init (tmp_dir, FALSE);
+	camel_provider_init ();
+
+	session = g_object_new (
+		TEST_TYPE_SESSION,
+		"user-data-dir", tmp_dir,
+		"user-cache-dir", tmp_dir,
+		NULL);
+
+	service = camel_session_add_service (session, "test-maildir", "maildir", CAMEL_PROVIDER_STORE, &local_error);
+	if (!service) {
+		g_printerr ("Failed to add maildir store: %s\n", local_error->message);
+		g_clear_error (&local_error);
+		g_object_unref (session);
+		remove_recursively (tmp_dir);
+		g_free (tmp_dir);
+		return 1;
+	}
+
+	store_dir = g_build_filename (tmp_dir, "maildir", NULL);
+	g_mkdir_with_parents (store_dir, 0700);
+
+	settings = camel_service_ref_settings (service);
+	camel_local_settings_set_path (CAMEL_LOCAL_SETTINGS (settings), store_dir);
+	g_object_unref (settings);
+
+	folder = camel_store_get_folder_sync (CAMEL_STORE (service), "Duplicates", CAMEL_STORE_FOLDER_CREATE, NULL, &local_error);
+	if (!folder) {
+		g_printerr ("Failed to create folder: %s\n", local_error->message);
+		g_clear_error (&local_error);
+		res = 1;
+		goto exit;
+	}
+
+	g_print ("Finding duplicates among %d messages in a maildir folder\n", n_messages);
+
+	timer = g_timer_new ();
+	n_duplicates = fill_folder (folder, n_messages);
+
+	if (n_duplicates < 0) {
+		res = 1;
+	} else {
+		gdouble seconds;
+
+		g_print ("  Stored %d messages, %d of them duplicates, in %.1f s\n",
+			n_messages, n_duplicates, g_timer_elapsed (timer, NULL));
+
+		uids = camel_folder_get_uids (folder);
+
+		g_timer_start (timer);
+		duplicates = e_mail_folder_find_duplicate_messages_sync (folder, uids, NULL, &local_error);
+		seconds = g_timer_elapsed (timer, NULL);
+
+		g_print ("  Found the duplicates in %.1f ms, %.0f messages per second\n",
+			seconds * 1000.0, seconds > 0.0 ? n_messages / seconds : 0.0);
+
+		if (!duplicates) {
+			g_printerr ("Failed to find duplicates: %s\n", local_error ? local_error->message : "Unknown error");
+			g_clear_error (&local_error);
+			res = 1;
+		} else {
+			if (g_hash_table_size (duplicates) != (guint) n_duplicates) {
+				g_printerr ("Expected %d duplicates, found %u\n", n_duplicates, g_hash_table_size (duplicates));
+				res = 1;
+			}
+
+			g_hash_table_destroy (duplicates);
+		}
+
+		camel_folder_free_uids (folder, uids);
+	}
+
+	g_timer_destroy (timer);
+	g_object_unref (folder);
+
+exit:
+	camel_session_remove_service (session, service);
+	g_object_unref (service);
+	g_object_unref (session);
+
+	remove_recursively (tmp_dir);
+	g_free (store_dir);
+	g_free (tmp_dir);
+
+	return res;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GOptionContext *context;
+	GError *local_error = NULL;
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &local_error)) {
+		g_printerr ("%s\n", local_error->message);
+		g_clear_error (&local_error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	return run_benchmark (MAX (opt_messages, 1));
+}
@@ -331,8 +331,12 @@ gnome_canvas_widget_set_property (GObject *object,
 	if (update)
 		(* GNOME_CANVAS_ITEM_GET_CLASS (item)->update) (item, NULL, 0);
 
-	if (calc_bounds)
+	if (calc_bounds) {
 		recalc_bounds (witem);
+
+		/* Let the parent group know the bounds changed */
+		gnome_canvas_item_request_update (item);
+	}
 }
 
 static void
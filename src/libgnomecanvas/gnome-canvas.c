@@ -95,6 +95,7 @@ static void group_add                   (GnomeCanvasGroup *group,
 					 GnomeCanvasItem  *item);
 static void group_remove                (GnomeCanvasGroup *group,
 					 GnomeCanvasItem  *item);
+static void group_index_invalidate      (GnomeCanvasGroup *group);
 static void add_idle                    (GnomeCanvas      *canvas);
 
 /*** GnomeCanvasItem ***/
@@ -687,6 +688,8 @@ put_item_after (GList *link,
 	else
 		parent->item_list_end = link;
 
+	group_index_invalidate (parent);
+
 	return TRUE;
 }
 
@@ -1231,6 +1234,280 @@ gnome_canvas_item_request_update (GnomeCanvasItem *item)
 
 /*** GnomeCanvasGroup ***/
 
+/* Groups with at least this many children keep a uniform grid of the
+ * children's bounds, thus drawing and picking only look at the children
+ * near the exposed area or the pointer.  The index is built by the group's
+ * update method and used only while the group has no pending update; the
+ * children change their bounds when being updated, which they request
+ * through the group. */
+#define GROUP_INDEX_MIN_ITEMS 32
+
+/* Children spanning more cells than this, or being huge, like the
+ * backgrounds of the calendar views, are checked on every lookup. */
+#define GROUP_INDEX_MAX_ITEM_CELLS 16
+#define GROUP_INDEX_HUGE_SIZE 1e6
+
+struct _GnomeCanvasGroupIndex {
+	/* The children in stacking order, from the bottom */
+	GnomeCanvasItem **items;
+	guint n_items;
+
+	/* The grid; cell (col, row) holds the positions in 'items' of the
+	 * children overlapping it, in ascending order, stored at
+	 * cell_items[cell_starts[cell] .. cell_starts[cell + 1]) */
+	gdouble x0, y0;
+	gdouble cell_width, cell_height;
+	gint n_cols, n_rows;
+	guint *cell_starts;
+	guint *cell_items;
+
+	/* Positions of the children which are not in the grid */
+	GArray *large;
+
+	/* To not report a child twice in group_index_query_rect() */
+	guint *stamps;
+	guint stamp;
+};
+
+static gint
+group_index_col (GnomeCanvasGroupIndex *index,
+                 gdouble x)
+{
+	gdouble col = floor ((x - index->x0) / index->cell_width);
+
+	return (gint) CLAMP (col, 0, index->n_cols - 1);
+}
+
+static gint
+group_index_row (GnomeCanvasGroupIndex *index,
+                 gdouble y)
+{
+	gdouble row = floor ((y - index->y0) / index->cell_height);
+
+	return (gint) CLAMP (row, 0, index->n_rows - 1);
+}
+
+/* Returns whether the child is kept in the grid, and its cells if it is */
+static gboolean
+group_index_get_cells (GnomeCanvasGroupIndex *index,
+                       GnomeCanvasItem *child,
+                       gint *col1,
+                       gint *row1,
+                       gint *col2,
+                       gint *row2)
+{
+	if (child->x2 - child->x1 >= GROUP_INDEX_HUGE_SIZE ||
+	    child->y2 - child->y1 >= GROUP_INDEX_HUGE_SIZE)
+		return FALSE;
+
+	*col1 = group_index_col (index, child->x1);
+	*col2 = group_index_col (index, child->x2);
+	*row1 = group_index_row (index, child->y1);
+	*row2 = group_index_row (index, child->y2);
+
+	return (*col2 - *col1 + 1) * (*row2 - *row1 + 1) <= GROUP_INDEX_MAX_ITEM_CELLS;
+}
+
+static void
+group_index_free (GnomeCanvasGroupIndex *index)
+{
+	if (!index)
+		return;
+
+	g_free (index->items);
+	g_free (index->cell_starts);
+	g_free (index->cell_items);
+	g_free (index->stamps);
+	g_array_unref (index->large);
+	g_slice_free (GnomeCanvasGroupIndex, index);
+}
+
+static GnomeCanvasGroupIndex *
+group_index_new (GnomeCanvasGroup *group,
+                 guint n_items)
+{
+	GnomeCanvasGroupIndex *index;
+	GList *link;
+	gdouble x1, y1, x2, y2, width, height;
+	guint ii, n_cells, n_in_cells;
+
+	index = g_slice_new0 (GnomeCanvasGroupIndex);
+	index->items = g_new (GnomeCanvasItem *, n_items);
+	index->n_items = n_items;
+	index->stamps = g_new0 (guint, n_items);
+	index->large = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	x1 = y1 = G_MAXDOUBLE;
+	x2 = y2 = -G_MAXDOUBLE;
+
+	for (link = group->item_list, ii = 0; link && ii < n_items; link = link->next, ii++) {
+		GnomeCanvasItem *child = link->data;
+
+		index->items[ii] = child;
+
+		if (child->x2 - child->x1 >= GROUP_INDEX_HUGE_SIZE ||
+		    child->y2 - child->y1 >= GROUP_INDEX_HUGE_SIZE)
+			continue;
+
+		x1 = MIN (x1, child->x1);
+		y1 = MIN (y1, child->y1);
+		x2 = MAX (x2, child->x2);
+		y2 = MAX (y2, child->y2);
+	}
+
+	index->n_items = ii;
+
+	if (x1 > x2 || y1 > y2)
+		x1 = y1 = x2 = y2 = 0;
+
+	/* About one cell per child, roughly square */
+	width = x2 - x1;
+	height = y2 - y1;
+	index->n_cols = 1;
+	index->n_rows = 1;
+
+	if (width > 0 && height > 0) {
+		gdouble side = sqrt (width * height / index->n_items);
+
+		index->n_cols = CLAMP ((gint) ceil (width / side), 1, (gint) index->n_items);
+		index->n_rows = CLAMP ((gint) ceil (height / side), 1, (gint) index->n_items);
+	} else if (width > 0) {
+		index->n_cols = index->n_items;
+	} else if (height > 0) {
+		index->n_rows = index->n_items;
+	}
+
+	index->x0 = x1;
+	index->y0 = y1;
+	index->cell_width = width > 0 ? width / index->n_cols : 1.0;
+	index->cell_height = height > 0 ? height / index->n_rows : 1.0;
+
+	n_cells = index->n_cols * index->n_rows;
+	index->cell_starts = g_new0 (guint, n_cells + 1);
+
+	/* Count the children of each cell first, then place them; going
+	 * through the children in order keeps every cell sorted. */
+	n_in_cells = 0;
+	for (ii = 0; ii < index->n_items; ii++) {
+		gint col, row, col1, row1, col2, row2;
+
+		if (!group_index_get_cells (index, index->items[ii], &col1, &row1, &col2, &row2)) {
+			g_array_append_val (index->large, ii);
+			continue;
+		}
+
+		for (row = row1; row <= row2; row++) {
+			for (col = col1; col <= col2; col++) {
+				index->cell_starts[row * index->n_cols + col + 1]++;
+				n_in_cells++;
+			}
+		}
+	}
+
+	for (ii = 0; ii < n_cells; ii++)
+		index->cell_starts[ii + 1] += index->cell_starts[ii];
+
+	index->cell_items = g_new (guint, MAX (n_in_cells, 1));
+
+	for (ii = 0; ii < index->n_items; ii++) {
+		gint col, row, col1, row1, col2, row2;
+
+		if (!group_index_get_cells (index, index->items[ii], &col1, &row1, &col2, &row2))
+			continue;
+
+		/* Uses cell_starts[cell] as the fill position; it ends
+		 * up at the start of the next cell, fixed below. */
+		for (row = row1; row <= row2; row++) {
+			for (col = col1; col <= col2; col++) {
+				guint cell = row * index->n_cols + col;
+
+				index->cell_items[index->cell_starts[cell]++] = ii;
+			}
+		}
+	}
+
+	for (ii = n_cells; ii > 0; ii--)
+		index->cell_starts[ii] = index->cell_starts[ii - 1];
+	index->cell_starts[0] = 0;
+
+	return index;
+}
+
+static gint
+group_index_compare_positions (gconstpointer a,
+                               gconstpointer b)
+{
+	guint pos_a = *((const guint *) a);
+	guint pos_b = *((const guint *) b);
+
+	return pos_a < pos_b ? -1 : pos_a > pos_b ? 1 : 0;
+}
+
+static void
+group_index_invalidate (GnomeCanvasGroup *group)
+{
+	group_index_free (group->index);
+	group->index = NULL;
+}
+
+static GnomeCanvasGroupIndex *
+group_index_get (GnomeCanvasGroup *group)
+{
+	if (group->item.flags & GNOME_CANVAS_ITEM_NEED_UPDATE)
+		return NULL;
+
+	return group->index;
+}
+
+/* Returns the positions of the children which may overlap the rectangle,
+ * in stacking order, from the bottom */
+static GArray *
+group_index_query_rect (GnomeCanvasGroupIndex *index,
+                        gdouble x1,
+                        gdouble y1,
+                        gdouble x2,
+                        gdouble y2)
+{
+	GArray *positions;
+	gint col, row, col1, row1, col2, row2;
+	guint ii;
+
+	index->stamp++;
+	if (!index->stamp) {
+		memset (index->stamps, 0, sizeof (guint) * index->n_items);
+		index->stamp = 1;
+	}
+
+	col1 = group_index_col (index, x1);
+	col2 = group_index_col (index, x2);
+	row1 = group_index_row (index, y1);
+	row2 = group_index_row (index, y2);
+
+	positions = g_array_sized_new (FALSE, FALSE, sizeof (guint), index->large->len + 16);
+	g_array_append_vals (positions, index->large->data, index->large->len);
+
+	for (row = row1; row <= row2; row++) {
+		for (col = col1; col <= col2; col++) {
+			guint cell = row * index->n_cols + col;
+
+			for (ii = index->cell_starts[cell]; ii < index->cell_starts[cell + 1]; ii++) {
+				guint pos = index->cell_items[ii];
+
+				if (index->stamps[pos] != index->stamp) {
+					index->stamps[pos] = index->stamp;
+					g_array_append_val (positions, pos);
+				}
+			}
+		}
+	}
+
+	/* A single cell and no large children is already sorted */
+	if (positions->len > 1 && (index->large->len || col1 != col2 || row1 != row2))
+		g_array_sort (positions, group_index_compare_positions);
+
+	return positions;
+}
+
 enum {
 	GROUP_PROP_0,
 	GROUP_PROP_X,
@@ -1398,6 +1675,8 @@ gnome_canvas_group_dispose (GnomeCanvasItem *object)
 		g_object_run_dispose (G_OBJECT (group->item_list->data));
 	}
 
+	group_index_invalidate (group);
+
 	GNOME_CANVAS_ITEM_CLASS (gnome_canvas_group_parent_class)->
 		dispose (object);
 }
@@ -1412,6 +1691,7 @@ gnome_canvas_group_update (GnomeCanvasItem *item,
 	GList *list;
 	GnomeCanvasItem *i;
 	gdouble x1, y1, x2, y2;
+	guint n_items = 0;
 
 	group = GNOME_CANVAS_GROUP (item);
 
@@ -1432,6 +1712,8 @@ gnome_canvas_group_update (GnomeCanvasItem *item,
 		x2 = MAX (x2, i->x2);
 		y1 = MIN (y1, i->y1);
 		y2 = MAX (y2, i->y2);
+
+		n_items++;
 	}
 	if (x1 >= x2 || y1 >= y2) {
 		item->x1 = item->x2 = item->y1 = item->y2 = 0;
@@ -1441,6 +1723,11 @@ gnome_canvas_group_update (GnomeCanvasItem *item,
 		item->x2 = x2;
 		item->y2 = y2;
 	}
+
+	group_index_invalidate (group);
+
+	if (n_items >= GROUP_INDEX_MIN_ITEMS)
+		group->index = group_index_new (group, n_items);
 }
 
 /* Realize handler for canvas groups */
@@ -1540,6 +1827,31 @@ gnome_canvas_group_unmap (GnomeCanvasItem *item)
 	GNOME_CANVAS_ITEM_CLASS (gnome_canvas_group_parent_class)->unmap (item);
 }
 
+static void
+group_draw_child (GnomeCanvasItem *child,
+                  cairo_t *cr,
+                  gint x,
+                  gint y,
+                  gint width,
+                  gint height)
+{
+	if ((child->flags & GNOME_CANVAS_ITEM_VISIBLE)
+	    && ((child->x1 < (x + width))
+	    && (child->y1 < (y + height))
+	    && (child->x2 > x)
+	    && (child->y2 > y))) {
+		GnomeCanvasItemClass *klass = GNOME_CANVAS_ITEM_GET_CLASS (child);
+
+		if (klass && klass->draw) {
+			cairo_save (cr);
+
+			klass->draw (child, cr, x, y, width, height);
+
+			cairo_restore (cr);
+		}
+	}
+}
+
 /* Draw handler for canvas groups */
 static void
 gnome_canvas_group_draw (GnomeCanvasItem *item,
@@ -1550,30 +1862,54 @@ gnome_canvas_group_draw (GnomeCanvasItem *item,
                          gint height)
 {
 	GnomeCanvasGroup *group;
+	GnomeCanvasGroupIndex *index;
 	GList *list;
 	GnomeCanvasItem *child = NULL;
 
 	group = GNOME_CANVAS_GROUP (item);
+	index = group_index_get (group);
+
+	if (index) {
+		GArray *positions;
+		guint ii;
+
+		positions = group_index_query_rect (index, x, y, x + width, y + height);
+
+		for (ii = 0; ii < positions->len; ii++) {
+			child = index->items[g_array_index (positions, guint, ii)];
+
+			group_draw_child (child, cr, x, y, width, height);
+		}
+
+		g_array_unref (positions);
+
+		return;
+	}
 
 	for (list = group->item_list; list; list = list->next) {
 		child = list->data;
 
-		if ((child->flags & GNOME_CANVAS_ITEM_VISIBLE)
-		    && ((child->x1 < (x + width))
-		    && (child->y1 < (y + height))
-		    && (child->x2 > x)
-		    && (child->y2 > y))) {
-			GnomeCanvasItemClass *klass = GNOME_CANVAS_ITEM_GET_CLASS (child);
+		group_draw_child (child, cr, x, y, width, height);
+	}
+}
 
-			if (klass && klass->draw) {
-				cairo_save (cr);
+static GnomeCanvasItem *
+group_point_child (GnomeCanvasItem *child,
+                   gdouble x,
+                   gdouble y,
+                   gint cx,
+                   gint cy)
+{
+	if ((child->x1 > cx) || (child->y1 > cy))
+		return NULL;
 
-				klass->draw (child, cr, x, y, width, height);
+	if ((child->x2 < cx) || (child->y2 < cy))
+		return NULL;
 
-				cairo_restore (cr);
-			}
-		}
-	}
+	if (!(child->flags & GNOME_CANVAS_ITEM_VISIBLE))
+		return NULL;
+
+	return gnome_canvas_item_invoke_point (child, x, y, cx, cy);
 }
 
 /* Point handler for canvas groups */
@@ -1585,24 +1921,43 @@ gnome_canvas_group_point (GnomeCanvasItem *item,
                           gint cy)
 {
 	GnomeCanvasGroup *group;
+	GnomeCanvasGroupIndex *index;
 	GList *list;
 	GnomeCanvasItem *child, *point_item;
 
 	group = GNOME_CANVAS_GROUP (item);
+	index = group_index_get (group);
+
+	if (index) {
+		const guint *cell_items, *large;
+		guint cell, ii, jj;
+
+		/* Merge the pointer's cell with the large children,
+		 * both are sorted and have no child in common */
+		cell = group_index_row (index, cy) * index->n_cols + group_index_col (index, cx);
+		cell_items = index->cell_items + index->cell_starts[cell];
+		ii = index->cell_starts[cell + 1] - index->cell_starts[cell];
+		large = (const guint *) index->large->data;
+		jj = index->large->len;
+
+		while (ii > 0 || jj > 0) {
+			if (jj == 0 || (ii > 0 && cell_items[ii - 1] > large[jj - 1]))
+				child = index->items[cell_items[--ii]];
+			else
+				child = index->items[large[--jj]];
+
+			point_item = group_point_child (child, x, y, cx, cy);
+			if (point_item)
+				return point_item;
+		}
+
+		return NULL;
+	}
 
 	for (list = g_list_last (group->item_list); list; list = list->prev) {
 		child = list->data;
 
-		if ((child->x1 > cx) || (child->y1 > cy))
-			continue;
-
-		if ((child->x2 < cx) || (child->y2 < cy))
-			continue;
-
-		if (!(child->flags & GNOME_CANVAS_ITEM_VISIBLE))
-			continue;
-
-		point_item = gnome_canvas_item_invoke_point (child, x, y, cx, cy);
+		point_item = group_point_child (child, x, y, cx, cy);
 		if (point_item)
 			return point_item;
 	}
@@ -1688,6 +2043,8 @@ group_add (GnomeCanvasGroup *group,
 {
 	g_object_ref_sink (item);
 
+	group_index_invalidate (group);
+
 	if (!group->item_list) {
 		group->item_list = g_list_append (group->item_list, item);
 		group->item_list_end = group->item_list;
@@ -1723,6 +2080,8 @@ group_remove (GnomeCanvasGroup *group,
 
 	for (children = group->item_list; children; children = children->next)
 		if (children->data == item) {
+			group_index_invalidate (group);
+
 			if (item->flags & GNOME_CANVAS_ITEM_MAPPED) {
 				GnomeCanvasItemClass *klass = GNOME_CANVAS_ITEM_GET_CLASS (item);
 
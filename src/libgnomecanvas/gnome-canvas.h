@@ -62,6 +62,7 @@ typedef struct _GnomeCanvasItem       GnomeCanvasItem;
 typedef struct _GnomeCanvasItemClass  GnomeCanvasItemClass;
 typedef struct _GnomeCanvasGroup      GnomeCanvasGroup;
 typedef struct _GnomeCanvasGroupClass GnomeCanvasGroupClass;
+typedef struct _GnomeCanvasGroupIndex GnomeCanvasGroupIndex;
 
 /* GnomeCanvasItem - base item class for canvas items
  *
@@ -328,6 +329,10 @@ struct _GnomeCanvasGroup {
 	/* Children of the group */
 	GList *item_list;
 	GList *item_list_end;
+
+	/* Spatial index of the children's bounds, for groups with
+	 * many children; private to the group */
+	GnomeCanvasGroupIndex *index;
 };
 
 struct _GnomeCanvasGroupClass {
@@ -1243,6 +1243,36 @@ mail_display_remote_content_clicked_cb (EWebView *web_view,
 	g_signal_emit (web_view, signals[REMOTE_CONTENT_CLICKED], 0, element_position, NULL);
 }
 
+static void
+mail_display_expand_text_clicked_cb (EWebView *web_view,
+				     const gchar *iframe_id,
+				     const gchar *element_id,
+				     const gchar *element_class,
+				     const gchar *element_value,
+				     const GtkAllocation *element_position,
+				     gpointer user_data)
+{
+	gchar *part_id, *frame_id;
+
+	g_return_if_fail (E_IS_MAIL_DISPLAY (web_view));
+	g_return_if_fail (element_id != NULL);
+
+	if (!element_value || !*element_value ||
+	    !g_str_has_suffix (element_id, ".expand"))
+		return;
+
+	/* The text part was cut by the formatter, the value is
+	 * the URI of the whole part; load it into the part's frame. */
+	part_id = g_strndup (element_id, strlen (element_id) - strlen (".expand"));
+	frame_id = g_strconcat (part_id, ".iframe", NULL);
+
+	e_web_view_jsc_set_element_attribute (WEBKIT_WEB_VIEW (web_view), "*", frame_id,
+		NULL, "src", element_value, e_web_view_get_cancellable (web_view));
+
+	g_free (frame_id);
+	g_free (part_id);
+}
+
 static void
 mail_display_load_changed_cb (WebKitWebView *wk_web_view,
 			      WebKitLoadEvent load_event,
@@ -1284,6 +1314,10 @@ mail_display_content_loaded_cb (EWebView *web_view,
 			mail_display_remote_content_clicked_cb, NULL);
 	}
 
+	/* Cut text parts live in their own frames, thus check each of them */
+	e_web_view_register_element_clicked (web_view, "__evo-expand-text",
+		mail_display_expand_text_clicked_cb, NULL);
+
 	if (g_settings_get_boolean (mail_display->priv->settings, "mark-citations")) {
 		GdkRGBA rgba;
 
@@ -2536,6 +2570,15 @@ e_mail_display_get_attachment_view (EMailDisplay *display)
 	return display->priv->attachment_view;
 }
 
+static void
+mail_display_formatter_settings_changed_cb (EMailDisplay *display)
+{
+	/* The cached part lists were prepared for the previous settings */
+	e_mail_part_list_cache_remove_all ();
+
+	e_mail_display_reload (display);
+}
+
 EMailFormatterMode
 e_mail_display_get_mode (EMailDisplay *display)
 {
@@ -2575,27 +2618,27 @@ e_mail_display_set_mode (EMailDisplay *display,
 
 	e_signal_connect_notify_object (
 		formatter, "notify::charset",
-		G_CALLBACK (e_mail_display_reload), display, G_CONNECT_SWAPPED);
+		G_CALLBACK (mail_display_formatter_settings_changed_cb), display, G_CONNECT_SWAPPED);
 
 	e_signal_connect_notify_object (
 		formatter, "notify::image-loading-policy",
-		G_CALLBACK (e_mail_display_reload), display, G_CONNECT_SWAPPED);
+		G_CALLBACK (mail_display_formatter_settings_changed_cb), display, G_CONNECT_SWAPPED);
 
 	e_signal_connect_notify_object (
 		formatter, "notify::mark-citations",
-		G_CALLBACK (e_mail_display_reload), display, G_CONNECT_SWAPPED);
+		G_CALLBACK (mail_display_formatter_settings_changed_cb), display, G_CONNECT_SWAPPED);
 
 	e_signal_connect_notify_object (
 		formatter, "notify::show-sender-photo",
-		G_CALLBACK (e_mail_display_reload), display, G_CONNECT_SWAPPED);
+		G_CALLBACK (mail_display_formatter_settings_changed_cb), display, G_CONNECT_SWAPPED);
 
 	e_signal_connect_notify_object (
 		formatter, "notify::show-real-date",
-		G_CALLBACK (e_mail_display_reload), display, G_CONNECT_SWAPPED);
+		G_CALLBACK (mail_display_formatter_settings_changed_cb), display, G_CONNECT_SWAPPED);
 
 	e_signal_connect_notify_object (
 		formatter, "notify::animate-images",
-		G_CALLBACK (e_mail_display_reload), display, G_CONNECT_SWAPPED);
+		G_CALLBACK (mail_display_formatter_settings_changed_cb), display, G_CONNECT_SWAPPED);
 
 	e_signal_connect_notify_object (
 		formatter, "notify::body-color",
@@ -2620,7 +2663,7 @@ e_mail_display_set_mode (EMailDisplay *display,
 
 	g_signal_connect (formatter, "claim-attachment", G_CALLBACK (e_mail_display_claim_attachment), display);
 
-	e_mail_display_reload (display);
+	mail_display_formatter_settings_changed_cb (display);
 
 	g_object_notify (G_OBJECT (display), "mode");
 }
@@ -84,6 +84,9 @@ struct _EMailReaderPrivate {
 	 * message is selected before the retrieval has completed. */
 	GCancellable *retrieving_message;
 
+	/* Cancels parsing of the adjacent messages in advance. */
+	GCancellable *prefetching_messages;
+
 	/* These flags work to prevent a folder switch from
 	 * automatically marking the message as read. We only want
 	 * that to happen when the -user- selects a message. */
@@ -160,6 +163,11 @@ mail_reader_private_free (EMailReaderPrivate *priv)
 		priv->retrieving_message = NULL;
 	}
 
+	if (priv->prefetching_messages != NULL) {
+		g_cancellable_cancel (priv->prefetching_messages);
+		g_clear_object (&priv->prefetching_messages);
+	}
+
 	g_slice_free (EMailReaderPrivate, priv);
 }
 
@@ -4003,14 +4011,176 @@ set_mail_display_part_list (GObject *object,
 
 	display = e_mail_reader_get_mail_display (reader);
 
+	/* The source mode part list is not a parsed message */
+	if (e_mail_display_get_mode (display) != E_MAIL_FORMATTER_MODE_SOURCE &&
+	    e_mail_part_list_get_folder (part_list) &&
+	    e_mail_part_list_get_message_uid (part_list)) {
+		gchar *mail_uri;
+
+		mail_uri = e_mail_part_build_uri (
+			e_mail_part_list_get_folder (part_list),
+			e_mail_part_list_get_message_uid (part_list), NULL, NULL);
+		e_mail_part_list_cache_add (mail_uri, part_list);
+		g_free (mail_uri);
+	}
+
 	e_mail_display_set_part_list (display, part_list);
 	e_mail_display_load (display, NULL);
 
 	/* Remove the reference added when parts list was
-	 * created, so that only owners are EMailDisplays. */
+	 * created, so that only owners are EMailDisplays
+	 * and the cache of parsed messages. */
 	g_object_unref (part_list);
 }
 
+typedef struct _PrefetchData {
+	EMailSession *session;
+	CamelFolder *folder;
+	gchar *message_uid;
+} PrefetchData;
+
+static void
+prefetch_data_free (gpointer ptr)
+{
+	PrefetchData *pd = ptr;
+
+	if (pd) {
+		g_clear_object (&pd->session);
+		g_clear_object (&pd->folder);
+		g_free (pd->message_uid);
+		g_slice_free (PrefetchData, pd);
+	}
+}
+
+static void
+mail_reader_prefetch_thread (GTask *task,
+                             gpointer source_object,
+                             gpointer task_data,
+                             GCancellable *cancellable)
+{
+	PrefetchData *pd = task_data;
+	CamelObjectBag *registry;
+	EMailPartList *part_list;
+	gchar *mail_uri;
+
+	registry = e_mail_part_list_get_registry ();
+	mail_uri = e_mail_part_build_uri (pd->folder, pd->message_uid, NULL, NULL);
+
+	part_list = camel_object_bag_reserve (registry, mail_uri);
+
+	if (!part_list) {
+		CamelMimeMessage *message;
+
+		/* Prefetch only what is available locally, downloading
+		 * the messages would compete with the one being shown. */
+		message = camel_folder_get_message_cached (pd->folder, pd->message_uid, cancellable);
+
+		/* Do not decrypt nor verify messages the user did not open */
+		if (message) {
+			CamelContentType *content_type;
+
+			content_type = camel_data_wrapper_get_mime_type_field (CAMEL_DATA_WRAPPER (message));
+			if (content_type && (
+			    camel_content_type_is (content_type, "multipart", "encrypted") ||
+			    camel_content_type_is (content_type, "multipart", "signed")))
+				g_clear_object (&message);
+		}
+
+		if (message && !g_cancellable_is_cancelled (cancellable)) {
+			EMailParser *parser;
+
+			parser = e_mail_parser_new (CAMEL_SESSION (pd->session));
+			part_list = e_mail_parser_parse_sync (parser, pd->folder, pd->message_uid, message, cancellable);
+			g_object_unref (parser);
+		}
+
+		g_clear_object (&message);
+
+		if (part_list && !g_cancellable_is_cancelled (cancellable)) {
+			camel_object_bag_add (registry, mail_uri, part_list);
+		} else {
+			camel_object_bag_abort (registry, mail_uri);
+			g_clear_object (&part_list);
+		}
+	}
+
+	if (part_list) {
+		e_mail_part_list_cache_add (mail_uri, part_list);
+		g_object_unref (part_list);
+	}
+
+	g_free (mail_uri);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+mail_reader_prefetch_adjacent_messages (EMailReader *reader,
+                                        CamelFolder *folder)
+{
+	EMailReaderPrivate *priv;
+	EMailBackend *backend;
+	GtkWidget *message_list;
+	MessageListSelectDirection directions[] = {
+		MESSAGE_LIST_SELECT_NEXT,
+		MESSAGE_LIST_SELECT_PREVIOUS
+	};
+	guint ii;
+
+	priv = E_MAIL_READER_GET_PRIVATE (reader);
+
+	if (priv->prefetching_messages != NULL) {
+		g_cancellable_cancel (priv->prefetching_messages);
+		g_clear_object (&priv->prefetching_messages);
+	}
+
+	if (!folder || e_mail_display_get_mode (e_mail_reader_get_mail_display (reader)) == E_MAIL_FORMATTER_MODE_SOURCE)
+		return;
+
+	backend = e_mail_reader_get_backend (reader);
+	message_list = e_mail_reader_get_message_list (reader);
+
+	/* Parse the messages likely to be shown next in advance, when
+	 * they are available locally, thus moving with the arrow keys
+	 * shows them immediately. */
+	for (ii = 0; ii < G_N_ELEMENTS (directions); ii++) {
+		PrefetchData *pd;
+		GTask *task;
+		gchar *message_uid;
+		gchar *mail_uri;
+		EMailPartList *part_list;
+
+		message_uid = message_list_dup_adjacent_uid (MESSAGE_LIST (message_list), directions[ii]);
+		if (!message_uid)
+			continue;
+
+		mail_uri = e_mail_part_build_uri (folder, message_uid, NULL, NULL);
+		part_list = camel_object_bag_peek (e_mail_part_list_get_registry (), mail_uri);
+		g_free (mail_uri);
+
+		if (part_list) {
+			g_object_unref (part_list);
+			g_free (message_uid);
+			continue;
+		}
+
+		if (!priv->prefetching_messages)
+			priv->prefetching_messages = g_cancellable_new ();
+
+		pd = g_slice_new0 (PrefetchData);
+		pd->session = g_object_ref (e_mail_backend_get_session (backend));
+		pd->folder = g_object_ref (folder);
+		pd->message_uid = message_uid;
+
+		task = g_task_new (reader, priv->prefetching_messages, NULL, NULL);
+		g_task_set_source_tag (task, mail_reader_prefetch_adjacent_messages);
+		g_task_set_priority (task, G_PRIORITY_LOW);
+		g_task_set_task_data (task, pd, prefetch_data_free);
+		g_task_run_in_thread (task, mail_reader_prefetch_thread);
+		g_object_unref (task);
+	}
+}
+
 static void
 mail_reader_set_display_formatter_for_message (EMailReader *reader,
                                                EMailDisplay *display,
@@ -4025,8 +4195,11 @@ mail_reader_set_display_formatter_for_message (EMailReader *reader,
 
 	priv = E_MAIL_READER_GET_PRIVATE (reader);
 	mail_uri = e_mail_part_build_uri (folder, message_uid, NULL, NULL);
-	registry = e_mail_part_list_get_registry ();
-	parts = camel_object_bag_peek (registry, mail_uri);
+	parts = e_mail_part_list_cache_ref (mail_uri);
+	if (!parts) {
+		registry = e_mail_part_list_get_registry ();
+		parts = camel_object_bag_peek (registry, mail_uri);
+	}
 	g_free (mail_uri);
 
 	if (parts == NULL) {
@@ -4085,6 +4258,9 @@ mail_reader_message_loaded (EMailReader *reader,
 	mail_reader_set_display_formatter_for_message (
 		reader, display, message_uid, message, folder);
 
+	if (message != NULL)
+		mail_reader_prefetch_adjacent_messages (reader, folder);
+
 	/* Reset the shell view icon. */
 	e_shell_event (shell, "mail-icon", (gpointer) "evolution-mail");
 
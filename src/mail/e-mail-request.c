@@ -36,6 +36,10 @@
 
 #define d(x)
 
+/* Only this many bytes of a huge text part are formatted,
+ * until the user asks for the rest of it. */
+#define MAIL_REQUEST_TEXT_LIMIT (512 * 1024)
+
 struct _EMailRequestPrivate {
 	gint scale_factor;
 };
@@ -50,6 +54,423 @@ static void e_mail_request_content_request_init (EContentRequestInterface *iface
 G_DEFINE_TYPE_WITH_CODE (EMailRequest, e_mail_request, G_TYPE_OBJECT,
 	G_IMPLEMENT_INTERFACE (E_TYPE_CONTENT_REQUEST, e_mail_request_content_request_init))
 
+/* How many bytes can wait in the pipe for the reader, before
+ * the formatter stops writing and waits for the reader. */
+#define MAIL_REQUEST_PIPE_LIMIT (256 * 1024)
+
+/* A pipe between the formatter, which writes into the output end from
+ * callbacks in the main thread, and WebKit, which reads the input end
+ * in a dedicated thread. Writing never blocks, thus the main loop keeps
+ * running while the reader waits for more data. Instead, the output end
+ * is pollable and is not writable while the pipe is full; the sources
+ * created for it get ready once the reader drains the pipe. */
+typedef struct _MailRequestPipe {
+	volatile gint ref_count;
+	GMutex lock;
+	GCond cond;
+	GByteArray *data;
+	guint read_pos;
+	gboolean writer_closed;
+	gboolean reader_closed;
+	GSList *writable_sources; /* GSource * */
+} MailRequestPipe;
+
+static MailRequestPipe *
+mail_request_pipe_new (void)
+{
+	MailRequestPipe *pipe;
+
+	pipe = g_slice_new0 (MailRequestPipe);
+	pipe->ref_count = 1;
+	pipe->data = g_byte_array_new ();
+	g_mutex_init (&pipe->lock);
+	g_cond_init (&pipe->cond);
+
+	return pipe;
+}
+
+static MailRequestPipe *
+mail_request_pipe_ref (MailRequestPipe *pipe)
+{
+	g_atomic_int_inc (&pipe->ref_count);
+
+	return pipe;
+}
+
+static void
+mail_request_pipe_unref (MailRequestPipe *pipe)
+{
+	if (pipe && g_atomic_int_dec_and_test (&pipe->ref_count)) {
+		g_slist_free_full (pipe->writable_sources, (GDestroyNotify) g_source_unref);
+		g_byte_array_unref (pipe->data);
+		g_mutex_clear (&pipe->lock);
+		g_cond_clear (&pipe->cond);
+		g_slice_free (MailRequestPipe, pipe);
+	}
+}
+
+/* Call with the pipe locked */
+static gboolean
+mail_request_pipe_is_writable_locked (MailRequestPipe *pipe)
+{
+	/* Writing to a closed pipe fails at once, thus it does not block */
+	return pipe->reader_closed ||
+		pipe->data->len - pipe->read_pos < MAIL_REQUEST_PIPE_LIMIT;
+}
+
+/* Call with the pipe locked */
+static void
+mail_request_pipe_update_sources_locked (MailRequestPipe *pipe)
+{
+	GSList *link;
+	gint64 ready_time;
+
+	ready_time = mail_request_pipe_is_writable_locked (pipe) ? 0 : -1;
+
+	for (link = pipe->writable_sources; link; link = g_slist_next (link)) {
+		GSource *source = link->data;
+
+		if (!g_source_is_destroyed (source))
+			g_source_set_ready_time (source, ready_time);
+	}
+}
+
+static void
+mail_request_pipe_wake_reader_cb (GCancellable *cancellable,
+				  gpointer user_data)
+{
+	MailRequestPipe *pipe = user_data;
+
+	g_mutex_lock (&pipe->lock);
+	g_cond_broadcast (&pipe->cond);
+	g_mutex_unlock (&pipe->lock);
+}
+
+typedef struct _MailRequestInput {
+	GInputStream parent;
+	MailRequestPipe *pipe;
+} MailRequestInput;
+
+typedef struct _MailRequestInputClass {
+	GInputStreamClass parent_class;
+} MailRequestInputClass;
+
+typedef struct _MailRequestOutput {
+	GOutputStream parent;
+	MailRequestPipe *pipe;
+} MailRequestOutput;
+
+typedef struct _MailRequestOutputClass {
+	GOutputStreamClass parent_class;
+} MailRequestOutputClass;
+
+GType mail_request_input_get_type (void);
+GType mail_request_output_get_type (void);
+
+static void mail_request_output_pollable_init (GPollableOutputStreamInterface *iface);
+
+G_DEFINE_TYPE (MailRequestInput, mail_request_input, G_TYPE_INPUT_STREAM)
+G_DEFINE_TYPE_WITH_CODE (MailRequestOutput, mail_request_output, G_TYPE_OUTPUT_STREAM,
+	G_IMPLEMENT_INTERFACE (G_TYPE_POLLABLE_OUTPUT_STREAM, mail_request_output_pollable_init))
+
+static gssize
+mail_request_input_read (GInputStream *stream,
+			 gpointer buffer,
+			 gsize count,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	MailRequestPipe *pipe = ((MailRequestInput *) stream)->pipe;
+	gulong cancelled_id = 0;
+	gssize n_read = -1;
+
+	/* Connect before locking, the callback is called immediately
+	 * when the cancellable is already cancelled. */
+	if (cancellable)
+		cancelled_id = g_cancellable_connect (cancellable, G_CALLBACK (mail_request_pipe_wake_reader_cb), pipe, NULL);
+
+	g_mutex_lock (&pipe->lock);
+
+	while (pipe->read_pos == pipe->data->len && !pipe->writer_closed &&
+	       !g_cancellable_is_cancelled (cancellable)) {
+		g_cond_wait (&pipe->cond, &pipe->lock);
+	}
+
+	if (!g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		n_read = MIN (count, pipe->data->len - pipe->read_pos);
+
+		if (n_read > 0) {
+			memcpy (buffer, pipe->data->data + pipe->read_pos, n_read);
+			pipe->read_pos += n_read;
+
+			if (pipe->read_pos == pipe->data->len) {
+				g_byte_array_set_size (pipe->data, 0);
+				pipe->read_pos = 0;
+			}
+
+			mail_request_pipe_update_sources_locked (pipe);
+		}
+	}
+
+	g_mutex_unlock (&pipe->lock);
+
+	if (cancelled_id)
+		g_cancellable_disconnect (cancellable, cancelled_id);
+
+	return n_read;
+}
+
+static gboolean
+mail_request_input_close (GInputStream *stream,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	MailRequestPipe *pipe = ((MailRequestInput *) stream)->pipe;
+
+	g_mutex_lock (&pipe->lock);
+	pipe->reader_closed = TRUE;
+	g_byte_array_set_size (pipe->data, 0);
+	pipe->read_pos = 0;
+	mail_request_pipe_update_sources_locked (pipe);
+	g_mutex_unlock (&pipe->lock);
+
+	return TRUE;
+}
+
+static void
+mail_request_input_finalize (GObject *object)
+{
+	mail_request_pipe_unref (((MailRequestInput *) object)->pipe);
+
+	/* Chain up to parent's method. */
+	G_OBJECT_CLASS (mail_request_input_parent_class)->finalize (object);
+}
+
+static void
+mail_request_input_class_init (MailRequestInputClass *class)
+{
+	GObjectClass *object_class;
+	GInputStreamClass *input_stream_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = mail_request_input_finalize;
+
+	input_stream_class = G_INPUT_STREAM_CLASS (class);
+	input_stream_class->read_fn = mail_request_input_read;
+	input_stream_class->close_fn = mail_request_input_close;
+}
+
+static void
+mail_request_input_init (MailRequestInput *stream)
+{
+}
+
+static gboolean
+mail_request_output_check_reader (MailRequestPipe *pipe,
+				  GError **error)
+{
+	if (pipe->reader_closed) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CLOSED,
+			"The reading end of the stream is closed");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gssize
+mail_request_output_write (GOutputStream *stream,
+			   gconstpointer buffer,
+			   gsize count,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	MailRequestPipe *pipe = ((MailRequestOutput *) stream)->pipe;
+	gssize n_written = -1;
+
+	g_mutex_lock (&pipe->lock);
+
+	/* Blocking writes are accepted even when the pipe is full, the writers
+	 * which care about the limit poll the stream before writing. */
+	if (mail_request_output_check_reader (pipe, error)) {
+		g_byte_array_append (pipe->data, buffer, count);
+		n_written = count;
+
+		mail_request_pipe_update_sources_locked (pipe);
+	}
+
+	g_mutex_unlock (&pipe->lock);
+
+	return n_written;
+}
+
+static gboolean
+mail_request_output_flush (GOutputStream *stream,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	MailRequestPipe *pipe = ((MailRequestOutput *) stream)->pipe;
+	gboolean success;
+
+	g_mutex_lock (&pipe->lock);
+
+	success = mail_request_output_check_reader (pipe, error);
+	if (success)
+		g_cond_broadcast (&pipe->cond);
+
+	g_mutex_unlock (&pipe->lock);
+
+	return success;
+}
+
+static gboolean
+mail_request_output_close (GOutputStream *stream,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	MailRequestPipe *pipe = ((MailRequestOutput *) stream)->pipe;
+
+	g_mutex_lock (&pipe->lock);
+	pipe->writer_closed = TRUE;
+	g_cond_broadcast (&pipe->cond);
+	g_mutex_unlock (&pipe->lock);
+
+	return TRUE;
+}
+
+static void
+mail_request_output_finalize (GObject *object)
+{
+	mail_request_pipe_unref (((MailRequestOutput *) object)->pipe);
+
+	/* Chain up to parent's method. */
+	G_OBJECT_CLASS (mail_request_output_parent_class)->finalize (object);
+}
+
+static void
+mail_request_output_class_init (MailRequestOutputClass *class)
+{
+	GObjectClass *object_class;
+	GOutputStreamClass *output_stream_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = mail_request_output_finalize;
+
+	output_stream_class = G_OUTPUT_STREAM_CLASS (class);
+	output_stream_class->write_fn = mail_request_output_write;
+	output_stream_class->flush = mail_request_output_flush;
+	output_stream_class->close_fn = mail_request_output_close;
+}
+
+static void
+mail_request_output_init (MailRequestOutput *stream)
+{
+}
+
+static gboolean
+mail_request_output_is_writable (GPollableOutputStream *stream)
+{
+	MailRequestPipe *pipe = ((MailRequestOutput *) stream)->pipe;
+	gboolean writable;
+
+	g_mutex_lock (&pipe->lock);
+	writable = mail_request_pipe_is_writable_locked (pipe);
+	g_mutex_unlock (&pipe->lock);
+
+	return writable;
+}
+
+static gboolean
+mail_request_output_source_dispatch (GSource *source,
+				     GSourceFunc callback,
+				     gpointer user_data)
+{
+	/* The GPollableSource, the parent of this source, calls the user callback */
+	return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs mail_request_output_source_funcs = {
+	NULL, /* prepare */
+	NULL, /* check */
+	mail_request_output_source_dispatch,
+	NULL, /* finalize */
+	NULL, /* closure_callback */
+	NULL  /* closure_marshal */
+};
+
+static GSource *
+mail_request_output_create_source (GPollableOutputStream *stream,
+				   GCancellable *cancellable)
+{
+	MailRequestPipe *pipe = ((MailRequestOutput *) stream)->pipe;
+	GSource *writable_source, *pollable_source;
+
+	writable_source = g_source_new (&mail_request_output_source_funcs, sizeof (GSource));
+	g_source_set_name (writable_source, "MailRequestOutput");
+
+	g_mutex_lock (&pipe->lock);
+
+	/* Forget the sources of the finished formatting */
+	while (pipe->writable_sources && g_source_is_destroyed (pipe->writable_sources->data)) {
+		g_source_unref (pipe->writable_sources->data);
+		pipe->writable_sources = g_slist_delete_link (pipe->writable_sources, pipe->writable_sources);
+	}
+
+	pipe->writable_sources = g_slist_prepend (pipe->writable_sources, g_source_ref (writable_source));
+	g_source_set_ready_time (writable_source, mail_request_pipe_is_writable_locked (pipe) ? 0 : -1);
+
+	g_mutex_unlock (&pipe->lock);
+
+	pollable_source = g_pollable_source_new_full (stream, writable_source, cancellable);
+
+	g_source_unref (writable_source);
+
+	return pollable_source;
+}
+
+static gssize
+mail_request_output_write_nonblocking (GPollableOutputStream *stream,
+				       const void *buffer,
+				       gsize count,
+				       GError **error)
+{
+	if (!mail_request_output_is_writable (stream)) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK,
+			"The stream is full");
+		return -1;
+	}
+
+	return mail_request_output_write (G_OUTPUT_STREAM (stream), buffer, count, NULL, error);
+}
+
+static void
+mail_request_output_pollable_init (GPollableOutputStreamInterface *iface)
+{
+	iface->is_writable = mail_request_output_is_writable;
+	iface->create_source = mail_request_output_create_source;
+	iface->write_nonblocking = mail_request_output_write_nonblocking;
+}
+
+static void
+mail_request_pipe_create_streams (GInputStream **out_input,
+				  GOutputStream **out_output)
+{
+	MailRequestPipe *pipe;
+	MailRequestInput *input;
+	MailRequestOutput *output;
+
+	pipe = mail_request_pipe_new ();
+
+	input = g_object_new (mail_request_input_get_type (), NULL);
+	input->pipe = mail_request_pipe_ref (pipe);
+
+	output = g_object_new (mail_request_output_get_type (), NULL);
+	output->pipe = pipe;
+
+	*out_input = G_INPUT_STREAM (input);
+	*out_output = G_OUTPUT_STREAM (output);
+}
+
 static gboolean
 e_mail_request_can_process_uri (EContentRequest *request,
 				const gchar *uri)
@@ -94,6 +515,7 @@ mail_request_process_mail_sync (EContentRequest *request,
 				SoupURI *suri,
 				GHashTable *uri_query,
 				GObject *requester,
+				gboolean can_stream,
 				GInputStream **out_stream,
 				gint64 *out_stream_length,
 				gchar **out_mime_type,
@@ -152,6 +574,10 @@ mail_request_process_mail_sync (EContentRequest *request,
 	if (val != NULL)
 		context.mode = atoi (val);
 
+	val = uri_query ? g_hash_table_lookup (uri_query, "full_text") : NULL;
+	if (context.mode == E_MAIL_FORMATTER_MODE_RAW && (val == NULL || atoi (val) != 1))
+		context.text_limit = MAIL_REQUEST_TEXT_LIMIT;
+
 	default_charset = uri_query ? g_hash_table_lookup (uri_query, "formatter_default_charset") : NULL;
 	charset = uri_query ? g_hash_table_lookup (uri_query, "formatter_charset") : NULL;
 
@@ -265,6 +691,28 @@ mail_request_process_mail_sync (EContentRequest *request,
 
 		g_object_unref (part);
 
+	} else if (can_stream && context.mode != E_MAIL_FORMATTER_MODE_PRINTING) {
+		GOutputStream *pipe_output = NULL;
+
+		/* Let WebKit show the parts as soon as they are formatted,
+		 * instead of waiting for the whole, possibly huge, message. */
+		mail_request_pipe_create_streams (out_stream, &pipe_output);
+
+		e_mail_formatter_format_streamed (
+			formatter, part_list, pipe_output,
+			context.flags, context.mode, cancellable);
+
+		*out_stream_length = -1;
+		*out_mime_type = g_strdup ("text/html");
+
+		g_object_unref (pipe_output);
+		g_clear_object (&context.part_list);
+		g_object_unref (output_stream);
+		g_object_unref (part_list);
+		g_object_unref (formatter);
+		g_free (context.uri);
+
+		return TRUE;
 	} else {
 		e_mail_formatter_format_sync (
 			formatter, part_list, output_stream,
@@ -395,6 +843,7 @@ typedef struct _MailIdleData
 	SoupURI *suri;
 	GHashTable *uri_query;
 	GObject *requester;
+	gboolean can_stream;
 	GInputStream **out_stream;
 	gint64 *out_stream_length;
 	gchar **out_mime_type;
@@ -416,7 +865,7 @@ process_mail_request_idle_cb (gpointer user_data)
 	g_return_val_if_fail (mid->flag != NULL, FALSE);
 
 	mid->success = mail_request_process_mail_sync (mid->request,
-		mid->suri, mid->uri_query, mid->requester, mid->out_stream,
+		mid->suri, mid->uri_query, mid->requester, mid->can_stream, mid->out_stream,
 		mid->out_stream_length, mid->out_mime_type,
 		mid->cancellable, mid->error);
 
@@ -464,6 +913,9 @@ e_mail_request_process_sync (EContentRequest *request,
 		mid.suri = suri;
 		mid.uri_query = uri_query;
 		mid.requester = requester;
+		/* The formatted message can be streamed only to a reader
+		 * in another thread, which does not block the main loop. */
+		mid.can_stream = !e_util_is_main_thread (NULL);
 		mid.out_stream = out_stream;
 		mid.out_stream_length = out_stream_length;
 		mid.out_mime_type = out_mime_type;
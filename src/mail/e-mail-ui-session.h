@@ -99,6 +99,12 @@ gboolean	e_mail_ui_session_check_known_address_sync
 						 GCancellable *cancellable,
 						 gboolean *out_known_address,
 						 GError **error);
+void		e_mail_ui_session_get_filter_stats
+						(EMailUISession *session,
+						 guint *out_n_loads,
+						 guint *out_n_compiled,
+						 guint *out_n_drivers,
+						 guint *out_n_rules_added);
 
 G_END_DECLS
 
@@ -102,20 +102,13 @@ decode_mozilla_status (const gchar *tmp)
 	return flags;
 }
 
-static void
-import_mbox_add_message (CamelFolder *folder,
-			 CamelMimeMessage *msg,
-			 GCancellable *cancellable,
-			 GError **error)
+static guint32
+import_mbox_get_message_flags (CamelMimeMessage *msg)
 {
-	CamelMessageInfo *info;
 	CamelMedium *medium;
 	guint32 flags = 0;
 	const gchar *tmp;
 
-	g_return_if_fail (CAMEL_IS_FOLDER (folder));
-	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (msg));
-
 	medium = CAMEL_MEDIUM (msg);
 
 	tmp = camel_medium_get_header (medium, "X-Mozilla-Status");
@@ -128,6 +121,18 @@ import_mbox_add_message (CamelFolder *folder,
 	if (tmp)
 		flags |= decode_status (tmp);
 
+	return flags;
+}
+
+static void
+import_mbox_append_message (CamelFolder *folder,
+			    CamelMimeMessage *msg,
+			    guint32 flags,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	CamelMessageInfo *info;
+
 	info = camel_message_info_new (NULL);
 
 	camel_message_info_set_flags (info, flags, ~0);
@@ -137,15 +142,391 @@ import_mbox_add_message (CamelFolder *folder,
 	g_clear_object (&info);
 }
 
+static void
+import_mbox_add_message (CamelFolder *folder,
+			 CamelMimeMessage *msg,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	g_return_if_fail (CAMEL_IS_FOLDER (folder));
+	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (msg));
+
+	import_mbox_append_message (folder, msg, import_mbox_get_message_flags (msg), cancellable, error);
+}
+
+/* The import engine parses messages from memory-mapped files in a pool
+ * of threads and appends them into the folder in the original order.
+ * Messages are handed to the workers in chunks and only a few chunks
+ * are in flight at once, thus the memory use is bounded. */
+
+#define IMPORT_CHUNK_MESSAGES 64
+#define IMPORT_CHUNK_BYTES (8 * 1024 * 1024)
+#define IMPORT_MAX_THREADS 4
+
+typedef struct _ImportItem {
+	GMappedFile *mapped;
+	gsize offset;
+	gsize length;
+	guint32 flags;
+	CamelMimeMessage *message;
+} ImportItem;
+
+typedef struct _ImportChunk {
+	GPtrArray *items; /* ImportItem * */
+	gsize n_bytes;
+	gboolean done;
+} ImportChunk;
+
+typedef struct _ImportEngine {
+	CamelFolder *folder;
+	GCancellable *cancellable;
+	GThreadPool *pool;
+	guint max_in_flight;
+
+	GMutex lock;
+	GCond cond;
+	GQueue chunks; /* ImportChunk *, being parsed, in the file order */
+	ImportChunk *current;
+
+	GError *error;
+} ImportEngine;
+
+static void
+import_item_free (gpointer ptr)
+{
+	ImportItem *item = ptr;
+
+	if (item) {
+		g_clear_object (&item->message);
+		g_mapped_file_unref (item->mapped);
+		g_slice_free (ImportItem, item);
+	}
+}
+
+static void
+import_chunk_free (ImportChunk *chunk)
+{
+	if (chunk) {
+		g_ptr_array_unref (chunk->items);
+		g_slice_free (ImportChunk, chunk);
+	}
+}
+
+static void
+import_engine_parse_chunk_cb (gpointer data,
+			      gpointer user_data)
+{
+	ImportChunk *chunk = data;
+	ImportEngine *engine = user_data;
+	guint ii;
+
+	for (ii = 0; ii < chunk->items->len && !g_cancellable_is_cancelled (engine->cancellable); ii++) {
+		ImportItem *item = g_ptr_array_index (chunk->items, ii);
+		GInputStream *stream;
+		CamelMimeMessage *msg;
+
+		stream = g_memory_input_stream_new_from_data (
+			g_mapped_file_get_contents (item->mapped) + item->offset,
+			item->length, NULL);
+
+		msg = camel_mime_message_new ();
+
+		if (camel_data_wrapper_construct_from_input_stream_sync (CAMEL_DATA_WRAPPER (msg), stream, NULL, NULL)) {
+			item->flags |= import_mbox_get_message_flags (msg);
+			item->message = msg;
+		} else {
+			g_object_unref (msg);
+		}
+
+		g_object_unref (stream);
+	}
+
+	g_mutex_lock (&engine->lock);
+	chunk->done = TRUE;
+	g_cond_broadcast (&engine->cond);
+	g_mutex_unlock (&engine->lock);
+}
+
+static ImportEngine *
+import_engine_new (CamelFolder *folder,
+		   GCancellable *cancellable)
+{
+	ImportEngine *engine;
+	gint n_threads;
+
+	n_threads = CLAMP (g_get_num_processors (), 1, IMPORT_MAX_THREADS);
+
+	engine = g_slice_new0 (ImportEngine);
+	engine->folder = g_object_ref (folder);
+	engine->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	engine->max_in_flight = 2 * n_threads;
+	engine->pool = g_thread_pool_new (import_engine_parse_chunk_cb, engine, n_threads, FALSE, NULL);
+	g_mutex_init (&engine->lock);
+	g_cond_init (&engine->cond);
+	g_queue_init (&engine->chunks);
+
+	return engine;
+}
+
+/* Waits for the oldest chunk to be parsed and appends its messages */
+static void
+import_engine_append_oldest (ImportEngine *engine)
+{
+	ImportChunk *chunk;
+	guint ii;
+
+	chunk = g_queue_pop_head (&engine->chunks);
+	if (!chunk)
+		return;
+
+	g_mutex_lock (&engine->lock);
+	while (!chunk->done)
+		g_cond_wait (&engine->cond, &engine->lock);
+	g_mutex_unlock (&engine->lock);
+
+	for (ii = 0; ii < chunk->items->len; ii++) {
+		ImportItem *item = g_ptr_array_index (chunk->items, ii);
+
+		if (engine->error || g_cancellable_is_cancelled (engine->cancellable))
+			break;
+
+		if (item->message) {
+			import_mbox_append_message (
+				engine->folder, item->message, item->flags,
+				engine->cancellable, &engine->error);
+		}
+	}
+
+	import_chunk_free (chunk);
+}
+
+static void
+import_engine_dispatch (ImportEngine *engine)
+{
+	if (!engine->current)
+		return;
+
+	g_queue_push_tail (&engine->chunks, engine->current);
+	g_thread_pool_push (engine->pool, engine->current, NULL);
+	engine->current = NULL;
+
+	while (g_queue_get_length (&engine->chunks) > engine->max_in_flight)
+		import_engine_append_oldest (engine);
+}
+
+/* Adds a message at @offset of the @mapped file, with @length bytes,
+ * which is appended into the folder with the @flags. Returns FALSE when
+ * the import failed or had been cancelled and nothing more should be added. */
+static gboolean
+import_engine_add (ImportEngine *engine,
+		   GMappedFile *mapped,
+		   gsize offset,
+		   gsize length,
+		   guint32 flags)
+{
+	ImportItem *item;
+
+	if (engine->error || g_cancellable_is_cancelled (engine->cancellable))
+		return FALSE;
+
+	item = g_slice_new0 (ImportItem);
+	item->mapped = g_mapped_file_ref (mapped);
+	item->offset = offset;
+	item->length = length;
+	item->flags = flags;
+
+	if (!engine->current) {
+		engine->current = g_slice_new0 (ImportChunk);
+		engine->current->items = g_ptr_array_new_with_free_func (import_item_free);
+	}
+
+	g_ptr_array_add (engine->current->items, item);
+	engine->current->n_bytes += length;
+
+	if (engine->current->items->len >= IMPORT_CHUNK_MESSAGES ||
+	    engine->current->n_bytes >= IMPORT_CHUNK_BYTES)
+		import_engine_dispatch (engine);
+
+	return TRUE;
+}
+
+/* Appends all the added messages and frees the @engine */
+static gboolean
+import_engine_finish (ImportEngine *engine,
+		      GError **error)
+{
+	gboolean success;
+
+	import_engine_dispatch (engine);
+
+	while (!g_queue_is_empty (&engine->chunks))
+		import_engine_append_oldest (engine);
+
+	g_thread_pool_free (engine->pool, FALSE, TRUE);
+
+	success = !engine->error;
+
+	if (engine->error)
+		g_propagate_error (error, engine->error);
+
+	g_mutex_clear (&engine->lock);
+	g_cond_clear (&engine->cond);
+	g_clear_object (&engine->cancellable);
+	g_object_unref (engine->folder);
+	g_slice_free (ImportEngine, engine);
+
+	return success;
+}
+
+/* Returns offset of the next "From " line at or after @from, or @size */
+static gsize
+import_mbox_find_from_line (const gchar *data,
+			    gsize from,
+			    gsize size)
+{
+	const gchar *nl;
+
+	if (from == 0 && size >= 5 && memcmp (data, "From ", 5) == 0)
+		return 0;
+
+	/* memchr() is vectorized by the C library, which makes
+	 * the boundary scan run at nearly the memory speed. */
+	while (from < size && (nl = memchr (data + from, '\n', size - from)) != NULL) {
+		from = nl - data + 1;
+
+		if (size - from >= 5 && memcmp (data + from, "From ", 5) == 0)
+			return from;
+	}
+
+	return size;
+}
+
+/* Returns whether any message had been found in the @mapped file */
+static gboolean
+import_mbox_mapped_sync (CamelFolder *folder,
+			 GMappedFile *mapped,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	ImportEngine *engine;
+	const gchar *data;
+	gsize size, pos;
+	gboolean any_read = FALSE;
+	gint last_pc = -1;
+
+	data = g_mapped_file_get_contents (mapped);
+	size = g_mapped_file_get_length (mapped);
+
+	if (!data || !size)
+		return FALSE;
+
+	engine = import_engine_new (folder, cancellable);
+
+	for (pos = import_mbox_find_from_line (data, 0, size); pos < size;) {
+		const gchar *eol;
+		gsize msg_start, next;
+		gint pc;
+
+		/* Skip the "From " line itself */
+		eol = memchr (data + pos, '\n', size - pos);
+		if (!eol)
+			break;
+
+		msg_start = eol - data + 1;
+		next = import_mbox_find_from_line (data, msg_start - 1, size);
+
+		any_read = TRUE;
+
+		if (!import_engine_add (engine, mapped, msg_start, next - msg_start, 0))
+			break;
+
+		pc = (gint) (100.0 * ((gdouble) next / (gdouble) size));
+		if (pc != last_pc) {
+			camel_operation_progress (cancellable, pc);
+			last_pc = pc;
+		}
+
+		pos = next;
+	}
+
+	import_engine_finish (engine, error);
+
+	return any_read;
+}
+
+/* Returns whether any message had been read by the parser */
+static gboolean
+import_mbox_parser_sync (CamelFolder *folder,
+			 const gchar *path,
+			 gsize size,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	CamelMimeParser *mp;
+	gboolean any_read = FALSE;
+	gint fd;
+
+	fd = g_open (path, O_RDONLY | O_BINARY, 0);
+	if (fd == -1) {
+		g_warning (
+			"cannot find source file to import '%s': %s",
+			path, g_strerror (errno));
+		return FALSE;
+	}
+
+	mp = camel_mime_parser_new ();
+	camel_mime_parser_scan_from (mp, TRUE);
+	if (camel_mime_parser_init_with_fd (mp, fd) == -1) {
+		/* will never happen - 0 is unconditionally returned */
+		g_object_unref (mp);
+		return FALSE;
+	}
+
+	while (camel_mime_parser_step (mp, NULL, NULL) == CAMEL_MIME_PARSER_STATE_FROM &&
+	       !g_cancellable_is_cancelled (cancellable)) {
+
+		CamelMimeMessage *msg;
+		gint pc = 0;
+
+		any_read = TRUE;
+
+		if (size > 0)
+			pc = (gint) (100.0 * ((gdouble)
+				camel_mime_parser_tell (mp) /
+				(gdouble) size));
+		camel_operation_progress (cancellable, pc);
+
+		msg = camel_mime_message_new ();
+		if (!camel_mime_part_construct_from_parser_sync (
+			(CamelMimePart *) msg, mp, NULL, NULL)) {
+			/* set exception? */
+			g_object_unref (msg);
+			break;
+		}
+
+		import_mbox_add_message (folder, msg, cancellable, error);
+
+		g_object_unref (msg);
+
+		if (error && *error != NULL)
+			break;
+
+		camel_mime_parser_step (mp, NULL, NULL);
+	}
+
+	/* 'fd' is freed together with 'mp' */
+	g_object_unref (mp);
+
+	return any_read;
+}
+
 static void
 import_mbox_exec (struct _import_mbox_msg *m,
                   GCancellable *cancellable,
                   GError **error)
 {
 	CamelFolder *folder;
-	CamelMimeParser *mp = NULL;
 	struct stat st;
-	gint fd;
 
 	if (g_stat (m->path, &st) == -1) {
 		g_warning (
@@ -169,57 +550,22 @@ import_mbox_exec (struct _import_mbox_msg *m,
 		return;
 
 	if (S_ISREG (st.st_mode)) {
-		gboolean any_read = FALSE;
-
-		fd = g_open (m->path, O_RDONLY | O_BINARY, 0);
-		if (fd == -1) {
-			g_warning (
-				"cannot find source file to import '%s': %s",
-				m->path, g_strerror (errno));
-			goto fail1;
-		}
-
-		mp = camel_mime_parser_new ();
-		camel_mime_parser_scan_from (mp, TRUE);
-		if (camel_mime_parser_init_with_fd (mp, fd) == -1) {
-			/* will never happen - 0 is unconditionally returned */
-			goto fail2;
-		}
+		GMappedFile *mapped;
+		gboolean any_read;
 
 		camel_operation_push_message (
 			cancellable, _("Importing “%s”"),
 			camel_folder_get_display_name (folder));
 		camel_folder_freeze (folder);
-		while (camel_mime_parser_step (mp, NULL, NULL) == CAMEL_MIME_PARSER_STATE_FROM &&
-		       !g_cancellable_is_cancelled (cancellable)) {
-
-			CamelMimeMessage *msg;
-			gint pc = 0;
-
-			any_read = TRUE;
-
-			if (st.st_size > 0)
-				pc = (gint) (100.0 * ((gdouble)
-					camel_mime_parser_tell (mp) /
-					(gdouble) st.st_size));
-			camel_operation_progress (cancellable, pc);
-
-			msg = camel_mime_message_new ();
-			if (!camel_mime_part_construct_from_parser_sync (
-				(CamelMimePart *) msg, mp, NULL, NULL)) {
-				/* set exception? */
-				g_object_unref (msg);
-				break;
-			}
-
-			import_mbox_add_message (folder, msg, cancellable, error);
 
-			g_object_unref (msg);
-
-			if (error && *error != NULL)
-				break;
-
-			camel_mime_parser_step (mp, NULL, NULL);
+		/* Files, which cannot be mapped, like too large
+		 * ones on 32-bit systems, are read by the parser. */
+		mapped = g_mapped_file_new (m->path, FALSE, NULL);
+		if (mapped) {
+			any_read = import_mbox_mapped_sync (folder, mapped, cancellable, error);
+			g_mapped_file_unref (mapped);
+		} else {
+			any_read = import_mbox_parser_sync (folder, m->path, st.st_size, cancellable, error);
 		}
 
 		if (!any_read && !g_cancellable_is_cancelled (cancellable)) {
@@ -242,15 +588,11 @@ import_mbox_exec (struct _import_mbox_msg *m,
 		camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
 		camel_folder_thaw (folder);
 		camel_operation_pop_message (cancellable);
-	fail2:
-		g_object_unref (mp);
 	}
-fail1:
+
 	/* Not passing a GCancellable or GError here. */
 	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
 	g_object_unref (folder);
-	/* 'fd' is freed together with 'mp' */
-	/* coverity[leaked_handle] */
 }
 
 static void
@@ -278,10 +620,7 @@ import_kmail_folder (struct _import_mbox_msg *m,
 	gchar *special_path;
 	const CamelStore *store;
 	CamelFolder *folder;
-	CamelMimeParser *mp = NULL;
-	CamelMessageInfo *info;
-	CamelMimeMessage *msg;
-	guint32 flags = 0;
+	ImportEngine *engine;
 
 	gchar *e_uri, *e_path;
 	gchar *k_path;
@@ -289,7 +628,7 @@ import_kmail_folder (struct _import_mbox_msg *m,
 	gchar *mail_url;
 	GDir *dir;
 	struct stat st;
-	gint fd, i;
+	gint i;
 
 	e_uri = kuri_to_euri (k_path_in);
 	/* we need to drop some folders, like: Trash */
@@ -316,63 +655,62 @@ import_kmail_folder (struct _import_mbox_msg *m,
 			camel_folder_get_display_name (folder));
 	camel_folder_freeze (folder);
 
+	engine = import_engine_new (folder, cancellable);
+
 	for (i = 0; special_folders [i]; i++) {
+		guint32 flags = 0;
+
+		if (strcmp (special_folders[i], "cur") == 0) {
+			flags = CAMEL_MESSAGE_SEEN;
+		} else if (strcmp (special_folders[i], "tmp") == 0) {
+			flags = CAMEL_MESSAGE_DELETED; /* Mark the 'tmp' mails as 'deleted' */
+		}
+
 		camel_operation_progress (cancellable, 100*i/3);
 		special_path = g_build_filename (k_path, special_folders[i], NULL);
 		dir = g_dir_open (special_path, 0, NULL);
-		while ((d = g_dir_read_name (dir))) {
+		while (dir && (d = g_dir_read_name (dir))) {
+			GMappedFile *mapped;
+
 			if ((strcmp (d, ".") == 0) || (strcmp (d, "..") == 0)) {
 				continue;
 			}
 			mail_url = g_build_filename (special_path, d, NULL);
-			if (g_stat (mail_url, &st) == -1) {
+			if (g_stat (mail_url, &st) == -1 || !S_ISREG (st.st_mode)) {
 				g_free (mail_url);
 				continue;
 			}
-			if (S_ISREG (st.st_mode)) {
-				fd = g_open (mail_url, O_RDONLY | O_BINARY, 0);
-				g_free (mail_url);
-				if (fd == -1) {
-					continue;
-				}
-				mp = camel_mime_parser_new ();
-				camel_mime_parser_scan_from (mp, FALSE);
-				if (camel_mime_parser_init_with_fd (mp, fd) == -1) {
-					/* will never happen - 0 is unconditionally returned */
-					g_object_unref (mp);
-					continue;
-				}
-				msg = camel_mime_message_new ();
-				if (!camel_mime_part_construct_from_parser_sync (
-						(CamelMimePart *) msg, mp, NULL, NULL)) {
-					/* set exception? */
-					g_object_unref (mp);
-					g_object_unref (msg);
-					continue;
-				}
-				info = camel_message_info_new (NULL);
-				if (strcmp (special_folders[i], "cur") == 0) {
-					flags |= CAMEL_MESSAGE_SEEN;
-				} else if (strcmp (special_folders[i], "tmp") == 0) {
-					flags |= CAMEL_MESSAGE_DELETED; /* Mark the 'tmp' mails as 'deleted' */
-				}
-				camel_message_info_set_flags (info, flags, ~0);
-				camel_folder_append_message_sync (
-					folder, msg, info, NULL,
-					cancellable, error);
-				g_clear_object (&info);
-				g_object_unref (msg);
-				g_object_unref (mp);
-			} else {
-				g_free (mail_url);
+
+			/* Each file is one message */
+			mapped = g_mapped_file_new (mail_url, FALSE, NULL);
+			g_free (mail_url);
+
+			if (!mapped)
+				continue;
+
+			if (g_mapped_file_get_length (mapped) > 0 &&
+			    !import_engine_add (engine, mapped, 0, g_mapped_file_get_length (mapped), flags)) {
+				g_mapped_file_unref (mapped);
+				break;
 			}
+
+			g_mapped_file_unref (mapped);
 		}
+
+		if (dir)
+			g_dir_close (dir);
+		g_free (special_path);
 	}
+
+	import_engine_finish (engine, error);
+
 	camel_operation_progress (cancellable, 100);
 	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
 	camel_folder_thaw (folder);
 	camel_operation_pop_message (cancellable);
 
+	g_object_unref (folder);
+	g_free (e_uri);
 	g_free (k_path);
 }
 
@@ -1410,6 +1410,71 @@ get_folders (CamelStore *store,
 	}
 }
 
+/* Returns a set of URIs of the folders shown in the mail views.
+ * This can be called only from the main thread. */
+static GHashTable *
+refresh_folders_dup_viewed_uris (void)
+{
+	GHashTable *viewed;
+	EShell *shell;
+	GList *link;
+
+	viewed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	shell = e_shell_get_default ();
+	if (!shell)
+		return viewed;
+
+	for (link = gtk_application_get_windows (GTK_APPLICATION (shell)); link; link = g_list_next (link)) {
+		EShellView *shell_view;
+		EShellContent *shell_content;
+		CamelFolder *folder;
+
+		if (!E_IS_SHELL_WINDOW (link->data))
+			continue;
+
+		shell_view = e_shell_window_peek_shell_view (E_SHELL_WINDOW (link->data), "mail");
+		if (!shell_view)
+			continue;
+
+		shell_content = e_shell_view_get_shell_content (shell_view);
+		folder = e_mail_reader_ref_folder (E_MAIL_READER (shell_content));
+
+		if (folder) {
+			gchar *folder_uri;
+
+			folder_uri = e_mail_folder_uri_from_folder (folder);
+			if (folder_uri)
+				g_hash_table_add (viewed, folder_uri);
+
+			g_object_unref (folder);
+		}
+	}
+
+	return viewed;
+}
+
+/* How many folders of the 'store' can be refreshed at once */
+static guint
+refresh_folders_get_max_concurrent (CamelStore *store)
+{
+	CamelSettings *settings;
+	guint max_concurrent = 1;
+
+	settings = camel_service_ref_settings (CAMEL_SERVICE (store));
+
+	/* Stores with more connections to the server, like IMAP, can
+	 * serve more folders in parallel; the rest is done one by one. */
+	if (settings && g_object_class_find_property (G_OBJECT_GET_CLASS (settings), "concurrent-connections")) {
+		g_object_get (settings, "concurrent-connections", &max_concurrent, NULL);
+		max_concurrent = CLAMP (max_concurrent, 1, 8);
+	}
+
+	g_clear_object (&settings);
+
+	return max_concurrent;
+}
+
 static void
 main_op_cancelled_cb (GCancellable *main_op,
                       GCancellable *refresh_op)
@@ -1421,11 +1486,24 @@ struct _refresh_folders_msg {
 	MailMsg base;
 
 	struct _send_info *info;
-	GPtrArray *folders;
+	GPtrArray *folders; /* gchar *, folder URI */
+	GHashTable *viewed_uris;
 	CamelStore *store;
 	CamelFolderInfo *finfo;
 };
 
+typedef struct _RefreshFoldersData {
+	struct _refresh_folders_msg *m;
+	GCancellable *cancellable;
+	EMailBackend *mail_backend;
+	gboolean expunge;
+
+	GMutex lock;
+	GHashTable *known_errors;
+	gboolean abort;
+	guint n_done;
+} RefreshFoldersData;
+
 static gchar *
 refresh_folders_desc (struct _refresh_folders_msg *m)
 {
@@ -1434,17 +1512,99 @@ refresh_folders_desc (struct _refresh_folders_msg *m)
 		camel_service_get_display_name (CAMEL_SERVICE (m->store)));
 }
 
+static gboolean
+refresh_folders_is_cancelled (RefreshFoldersData *rfd)
+{
+	return g_cancellable_is_cancelled (rfd->m->info->cancellable) ||
+		g_cancellable_is_cancelled (rfd->cancellable);
+}
+
+/* Runs in a thread of the refresh pool */
+static void
+refresh_folders_thread (gpointer data,
+			gpointer user_data)
+{
+	const gchar *folder_uri = data;
+	RefreshFoldersData *rfd = user_data;
+	struct _refresh_folders_msg *m = rfd->m;
+	CamelFolder *folder;
+	gboolean skip;
+	GError *local_error = NULL;
+
+	g_mutex_lock (&rfd->lock);
+	skip = rfd->abort;
+	g_mutex_unlock (&rfd->lock);
+
+	if (skip || refresh_folders_is_cancelled (rfd))
+		goto done;
+
+	folder = e_mail_session_uri_to_folder_sync (
+		E_MAIL_SESSION (m->info->session),
+		folder_uri, 0,
+		rfd->cancellable, &local_error);
+	if (folder && camel_folder_synchronize_sync (folder, rfd->expunge, rfd->cancellable, &local_error))
+		camel_folder_refresh_info_sync (folder, rfd->cancellable, &local_error);
+
+	if (folder && !local_error && rfd->mail_backend) {
+		em_utils_process_autoarchive_sync (rfd->mail_backend, folder, folder_uri, rfd->cancellable, &local_error);
+	}
+
+	if (local_error != NULL) {
+		const gchar *error_message = local_error->message ? local_error->message : _("Unknown error");
+
+		g_mutex_lock (&rfd->lock);
+
+		if (g_hash_table_contains (rfd->known_errors, error_message)) {
+			/* Received the same error message multiple times; there can be some
+			   connection issue probably, thus skip the rest folder updates for now */
+			rfd->abort = TRUE;
+		} else if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			CamelStore *store;
+			const gchar *full_name;
+
+			if (folder) {
+				store = camel_folder_get_parent_store (folder);
+				full_name = camel_folder_get_full_name (folder);
+			} else {
+				store = m->store;
+				full_name = folder_uri;
+			}
+
+			report_error_to_ui (CAMEL_SERVICE (store), full_name, local_error, NULL);
+
+			/* To not report one error for multiple folders multiple times */
+			g_hash_table_insert (rfd->known_errors, g_strdup (error_message), GINT_TO_POINTER (1));
+		}
+
+		g_mutex_unlock (&rfd->lock);
+
+		g_clear_error (&local_error);
+	}
+
+	g_clear_object (&folder);
+
+done:
+	g_mutex_lock (&rfd->lock);
+
+	rfd->n_done++;
+
+	if (m->info->state != SEND_CANCELLED && !refresh_folders_is_cancelled (rfd))
+		camel_operation_progress (
+			m->info->cancellable, 100 * rfd->n_done / m->folders->len);
+
+	g_mutex_unlock (&rfd->lock);
+}
+
 static void
 refresh_folders_exec (struct _refresh_folders_msg *m,
                       GCancellable *cancellable,
                       GError **error)
 {
-	CamelFolder *folder;
-	gint i;
+	RefreshFoldersData rfd;
+	GThreadPool *pool;
+	gint i, n_viewed = 0;
 	gboolean success;
 	gboolean delete_junk = FALSE, expunge = FALSE;
-	GHashTable *known_errors;
-	EMailBackend *mail_backend;
 	GError *local_error = NULL;
 	gulong handler_id = 0;
 
@@ -1473,66 +1633,39 @@ refresh_folders_exec (struct _refresh_folders_msg *m,
 		goto exit;
 	}
 
-	mail_backend = E_MAIL_BACKEND (e_shell_get_backend_by_name (e_shell_get_default (), "mail"));
+	/* The folders the user looks at go first */
+	for (i = 0; i < m->folders->len && m->viewed_uris; i++) {
+		gchar *folder_uri = m->folders->pdata[i];
 
-	known_errors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-
-	for (i = 0; i < m->folders->len; i++) {
-		folder = e_mail_session_uri_to_folder_sync (
-			E_MAIL_SESSION (m->info->session),
-			m->folders->pdata[i], 0,
-			cancellable, &local_error);
-		if (folder && camel_folder_synchronize_sync (folder, expunge, cancellable, &local_error))
-			camel_folder_refresh_info_sync (folder, cancellable, &local_error);
-
-		if (folder && !local_error && mail_backend) {
-			em_utils_process_autoarchive_sync (mail_backend, folder, m->folders->pdata[i], cancellable, &local_error);
+		if (g_hash_table_contains (m->viewed_uris, folder_uri)) {
+			m->folders->pdata[i] = m->folders->pdata[n_viewed];
+			m->folders->pdata[n_viewed] = folder_uri;
+			n_viewed++;
 		}
+	}
 
-		if (local_error != NULL) {
-			const gchar *error_message = local_error->message ? local_error->message : _("Unknown error");
-
-			if (g_hash_table_contains (known_errors, error_message)) {
-				/* Received the same error message multiple times; there can be some
-				   connection issue probably, thus skip the rest folder updates for now */
-				g_clear_object (&folder);
-				g_clear_error (&local_error);
-				break;
-			} else if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-				CamelStore *store;
-				const gchar *full_name;
-
-				if (folder) {
-					store = camel_folder_get_parent_store (folder);
-					full_name = camel_folder_get_full_name (folder);
-				} else {
-					store = m->store;
-					full_name = (const gchar *) m->folders->pdata[i];
-				}
-
-				report_error_to_ui (CAMEL_SERVICE (store), full_name, local_error, NULL);
-
-				/* To not report one error for multiple folders multiple times */
-				g_hash_table_insert (known_errors, g_strdup (error_message), GINT_TO_POINTER (1));
-			}
-
-			g_clear_error (&local_error);
-		}
+	memset (&rfd, 0, sizeof (RefreshFoldersData));
+	rfd.m = m;
+	rfd.cancellable = cancellable;
+	rfd.mail_backend = E_MAIL_BACKEND (e_shell_get_backend_by_name (e_shell_get_default (), "mail"));
+	rfd.expunge = expunge;
+	rfd.known_errors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_mutex_init (&rfd.lock);
 
-		if (folder)
-			g_object_unref (folder);
+	pool = g_thread_pool_new (
+		refresh_folders_thread, &rfd,
+		refresh_folders_get_max_concurrent (m->store),
+		FALSE, NULL);
 
-		if (g_cancellable_is_cancelled (m->info->cancellable) ||
-		    g_cancellable_is_cancelled (cancellable))
-			break;
+	for (i = 0; i < m->folders->len; i++)
+		g_thread_pool_push (pool, m->folders->pdata[i], NULL);
 
-		if (m->info->state != SEND_CANCELLED)
-			camel_operation_progress (
-				m->info->cancellable, 100 * i / m->folders->len);
-	}
+	/* Waits for all the pushed folders to be processed */
+	g_thread_pool_free (pool, FALSE, TRUE);
 
 	camel_operation_pop_message (m->info->cancellable);
-	g_hash_table_destroy (known_errors);
+	g_hash_table_destroy (rfd.known_errors);
+	g_mutex_clear (&rfd.lock);
 
 exit:
 	if (handler_id > 0)
@@ -1548,11 +1681,10 @@ refresh_folders_done (struct _refresh_folders_msg *m)
 static void
 refresh_folders_free (struct _refresh_folders_msg *m)
 {
-	gint i;
+	g_ptr_array_unref (m->folders);
 
-	for (i = 0; i < m->folders->len; i++)
-		g_free (m->folders->pdata[i]);
-	g_ptr_array_free (m->folders, TRUE);
+	if (m->viewed_uris)
+		g_hash_table_destroy (m->viewed_uris);
 
 	camel_folder_info_free (m->finfo);
 	g_object_unref (m->store);
@@ -1596,12 +1728,13 @@ receive_update_got_folderinfo (GObject *source_object,
 
 	/* CamelFolderInfo may be NULL even if no error occurred. */
 	} else if (info != NULL) {
-		GPtrArray *folders = g_ptr_array_new ();
+		GPtrArray *folders = g_ptr_array_new_with_free_func (g_free);
 		struct _refresh_folders_msg *m;
 
 		m = mail_msg_new (&refresh_folders_info);
 		m->store = g_object_ref (send_info->service);
 		m->folders = folders;
+		m->viewed_uris = refresh_folders_dup_viewed_uris ();
 		m->info = send_info;
 		m->finfo = info;  /* takes ownership */
 
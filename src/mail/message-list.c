@@ -71,6 +71,11 @@
 #define EXCLUDE_DELETED_MESSAGES_EXPR	"(not (system-flag \"deleted\"))"
 #define EXCLUDE_JUNK_MESSAGES_EXPR	"(not (system-flag \"junk\"))"
 
+/* Up to this many changed messages are spliced into the view one by one
+ * on "folder-changed", more than that are applied in one batch, with the
+ * tree model frozen. */
+#define INCREMENTAL_REGEN_SPLICE_LIMIT	50
+
 typedef struct _ExtendedGNode ExtendedGNode;
 typedef struct _RegenData RegenData;
 
@@ -96,6 +101,7 @@ struct _MessageListPrivate {
 
 	GMutex thread_tree_lock;
 	CamelFolderThread *thread_tree;
+	GPtrArray *thread_uids; /* camel_pstring uids the thread_tree is built from */
 
 	struct _MLSelection clipboard;
 	gboolean destroyed;
@@ -159,12 +165,20 @@ struct _RegenData {
 	gboolean select_unread;
 
 	CamelFolderThread *thread_tree;
+	GPtrArray *thread_uids; /* camel_pstring uids the thread_tree is built from */
 
 	/* This indicates we're regenerating the message list because
 	 * we received a "folder-changed" signal from our CamelFolder. */
 	gboolean folder_changed;
 	GHashTable *removed_uids; /* gchar *~>NULL */
 
+	/* When set, only the 'changes' are applied on the current
+	 * content, instead of rebuilding the whole message list. */
+	gboolean incremental;
+	CamelFolderChangeInfo *changes;
+	GPtrArray *show_infos; /* CamelMessageInfo * */
+	GPtrArray *hide_uids; /* camel_pstring uids */
+
 	CamelFolder *folder;
 	GPtrArray *summary;
 
@@ -544,6 +558,18 @@ regen_data_unref (RegenData *regen_data)
 			camel_folder_thread_messages_unref (
 				regen_data->thread_tree);
 
+		if (regen_data->thread_uids != NULL)
+			g_ptr_array_unref (regen_data->thread_uids);
+
+		if (regen_data->changes != NULL)
+			camel_folder_change_info_free (regen_data->changes);
+
+		if (regen_data->show_infos != NULL)
+			g_ptr_array_unref (regen_data->show_infos);
+
+		if (regen_data->hide_uids != NULL)
+			g_ptr_array_unref (regen_data->hide_uids);
+
 		if (regen_data->summary != NULL) {
 			guint ii, length;
 
@@ -571,7 +597,8 @@ regen_data_unref (RegenData *regen_data)
 
 static void
 message_list_set_thread_tree (MessageList *message_list,
-                              CamelFolderThread *thread_tree)
+                              CamelFolderThread *thread_tree,
+                              GPtrArray *thread_uids)
 {
 	g_return_if_fail (IS_MESSAGE_LIST (message_list));
 
@@ -586,9 +613,38 @@ message_list_set_thread_tree (MessageList *message_list,
 
 	message_list->priv->thread_tree = thread_tree;
 
+	/* The UIDs are meaningful only together with the thread tree. */
+	if (thread_tree != NULL && thread_uids != NULL)
+		g_ptr_array_ref (thread_uids);
+	else
+		thread_uids = NULL;
+
+	if (message_list->priv->thread_uids != NULL)
+		g_ptr_array_unref (message_list->priv->thread_uids);
+
+	message_list->priv->thread_uids = thread_uids;
+
 	g_mutex_unlock (&message_list->priv->thread_tree_lock);
 }
 
+/* Returns a reference to the UIDs the current thread tree had been
+ * built from, or NULL, when the thread tree had been invalidated. */
+static GPtrArray *
+message_list_ref_thread_uids (MessageList *message_list)
+{
+	GPtrArray *thread_uids = NULL;
+
+	g_mutex_lock (&message_list->priv->thread_tree_lock);
+
+	if (message_list->priv->thread_tree != NULL &&
+	    message_list->priv->thread_uids != NULL)
+		thread_uids = g_ptr_array_ref (message_list->priv->thread_uids);
+
+	g_mutex_unlock (&message_list->priv->thread_tree_lock);
+
+	return thread_uids;
+}
+
 static RegenData *
 message_list_ref_regen_data (MessageList *message_list)
 {
@@ -1145,6 +1201,34 @@ message_list_select (MessageList *message_list,
 		return FALSE;
 }
 
+/**
+ * message_list_dup_adjacent_uid:
+ * @message_list: a #MessageList
+ * @direction: the direction to search in
+ *
+ * Finds the message, which would be selected by message_list_select()
+ * in the @direction with no flags, without changing the selection.
+ *
+ * Returns: (transfer full) (nullable): UID of the adjacent message, or %NULL,
+ *    when there is none. Free it with g_free(), when no longer needed.
+ *
+ * Since: 3.38
+ **/
+gchar *
+message_list_dup_adjacent_uid (MessageList *message_list,
+                               MessageListSelectDirection direction)
+{
+	GNode *node;
+
+	g_return_val_if_fail (IS_MESSAGE_LIST (message_list), NULL);
+
+	node = ml_search_path (message_list, direction, 0, 0);
+	if (!node)
+		return NULL;
+
+	return g_strdup (get_message_uid (message_list, node));
+}
+
 /**
  * message_list_can_select:
  * @message_list:
@@ -2910,7 +2994,7 @@ ml_tree_sorting_changed (ETreeTableAdapter *adapter,
 	if (group_by_threads && message_list->frozen == 0) {
 
 		/* Invalidate the thread tree. */
-		message_list_set_thread_tree (message_list, NULL);
+		message_list_set_thread_tree (message_list, NULL, NULL);
 
 		mail_regen_list (message_list, NULL, NULL);
 
@@ -3263,6 +3347,9 @@ message_list_finalize (GObject *object)
 		camel_folder_thread_messages_unref (
 			message_list->priv->thread_tree);
 
+	if (message_list->priv->thread_uids != NULL)
+		g_ptr_array_unref (message_list->priv->thread_uids);
+
 	g_free (message_list->search);
 	g_free (message_list->frozen_search);
 	g_free (message_list->cursor_uid);
@@ -4681,8 +4768,9 @@ add_node_diff (MessageList *message_list,
 	/* XXX Casting away constness. */
 	info = (CamelMessageInfo *) c->message;
 
-	/* we just update the hashtable key */
-	ml_uid_nodemap_remove (message_list, info);
+	/* The UID can still map to its old node, when the message moved
+	 * within the tree; the new node takes over the mapping and the old
+	 * node is removed later, without touching the mapping. */
 	new_node = ml_uid_nodemap_insert (message_list, info, parent, myrow);
 	(*row)++;
 
@@ -4700,6 +4788,7 @@ remove_node_diff (MessageList *message_list,
 {
 	ETreePath cp, cn;
 	CamelMessageInfo *info;
+	gboolean is_mapped;
 
 	t (printf ("Removing node: %s\n", (gchar *) node->data));
 
@@ -4713,13 +4802,18 @@ remove_node_diff (MessageList *message_list,
 
 	/* and the rowid entry - if and only if it is referencing this node */
 	info = node->data;
+	g_return_if_fail (info);
+
+	is_mapped = g_hash_table_lookup (message_list->uid_nodemap, camel_message_info_get_uid (info)) == node;
 
 	/* and only at the toplevel, remove the node (etree should optimise this remove somewhat) */
 	if (depth == 0)
 		message_list_tree_model_remove (message_list, node);
 
-	g_return_if_fail (info);
-	ml_uid_nodemap_remove (message_list, info);
+	if (is_mapped)
+		ml_uid_nodemap_remove (message_list, info);
+	else
+		g_object_unref (info);
 }
 
 /* applies a new tree structure to an existing tree, but only by changing things
@@ -4824,6 +4918,150 @@ build_subtree_diff (MessageList *message_list,
 	}
 }
 
+/* compares a shown thread with a thread tree node, including their children */
+static gboolean
+thread_subtree_equal (ETreeModel *etm,
+                      GNode *node,
+                      CamelFolderThreadNode *c)
+{
+	GNode *ap;
+	CamelFolderThreadNode *bp;
+
+	if (!node_equal (etm, node, c))
+		return FALSE;
+
+	ap = g_node_first_child (node);
+	bp = c->child;
+
+	while (ap || bp) {
+		/* phantom nodes are not shown, see build_subtree() */
+		if (bp && !bp->message) {
+			bp = bp->next;
+			continue;
+		}
+
+		if (!ap || !bp || !thread_subtree_equal (etm, ap, bp))
+			return FALSE;
+
+		ap = g_node_next_sibling (ap);
+		bp = bp->next;
+	}
+
+	return TRUE;
+}
+
+static void
+thread_save_expanded (ETreeTableAdapter *adapter,
+                      GNode *node,
+                      GHashTable *expanded)
+{
+	GNode *child;
+
+	if (!g_node_first_child (node))
+		return;
+
+	g_hash_table_insert (
+		expanded,
+		(gpointer) camel_pstring_strdup (camel_message_info_get_uid (node->data)),
+		GINT_TO_POINTER (e_tree_table_adapter_node_is_expanded (adapter, node) ? 1 : -1));
+
+	for (child = g_node_first_child (node); child; child = g_node_next_sibling (child))
+		thread_save_expanded (adapter, child, expanded);
+}
+
+static void
+thread_load_expanded (ETreeTableAdapter *adapter,
+                      GNode *node,
+                      GHashTable *expanded)
+{
+	GNode *child;
+	gint state;
+
+	if (!g_node_first_child (node))
+		return;
+
+	state = GPOINTER_TO_INT (g_hash_table_lookup (expanded, camel_message_info_get_uid (node->data)));
+	if (state != 0)
+		e_tree_table_adapter_node_set_expanded (adapter, node, state > 0);
+
+	for (child = g_node_first_child (node); child; child = g_node_next_sibling (child))
+		thread_load_expanded (adapter, child, expanded);
+}
+
+/* Applies a new thread tree on the shown threads, without freezing the tree
+ * model.  Threads equal to the shown ones are left untouched; the others are
+ * removed and added again as a whole, thus the tree table adapter puts each
+ * changed thread to its sorted position.  The expanded state of the messages
+ * in the changed threads is preserved. */
+static void
+splice_threads (MessageList *message_list,
+                CamelFolderThread *thread)
+{
+	ETreeModel *tree_model;
+	ETreeTableAdapter *adapter;
+	GHashTable *shown; /* uid of the thread root ~> GNode */
+	GHashTable *kept;
+	GHashTable *expanded;
+	GPtrArray *added;
+	CamelFolderThreadNode *c;
+	GNode *root, *node, *next;
+	gint row = 0;
+	guint ii;
+
+	tree_model = E_TREE_MODEL (message_list);
+	adapter = e_tree_get_table_adapter (E_TREE (message_list));
+	root = message_list->priv->tree_model_root;
+
+	shown = g_hash_table_new (g_str_hash, g_str_equal);
+	kept = g_hash_table_new (g_direct_hash, g_direct_equal);
+	expanded = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+	added = g_ptr_array_new ();
+
+	for (node = g_node_first_child (root); node; node = g_node_next_sibling (node))
+		g_hash_table_insert (shown, (gpointer) camel_message_info_get_uid (node->data), node);
+
+	for (c = thread ? thread->tree : NULL; c; c = c->next) {
+		/* phantom nodes no longer allowed */
+		if (!c->message)
+			continue;
+
+		node = g_hash_table_lookup (shown, camel_message_info_get_uid (c->message));
+
+		if (node && thread_subtree_equal (tree_model, node, c))
+			g_hash_table_add (kept, node);
+		else
+			g_ptr_array_add (added, c);
+	}
+
+	/* Remove first, thus the UIDs moving to another thread
+	 * are mapped to their new nodes only. */
+	for (node = g_node_first_child (root); node; node = next) {
+		next = g_node_next_sibling (node);
+
+		if (!g_hash_table_contains (kept, node)) {
+			thread_save_expanded (adapter, node, expanded);
+			remove_node_diff (message_list, node, 0);
+		}
+	}
+
+	for (ii = 0; ii < added->len; ii++) {
+		c = added->pdata[ii];
+
+		add_node_diff (message_list, root, NULL, c, &row, -1);
+
+		if (g_hash_table_size (expanded) > 0) {
+			node = g_hash_table_lookup (message_list->uid_nodemap, camel_message_info_get_uid (c->message));
+			if (node)
+				thread_load_expanded (adapter, node, expanded);
+		}
+	}
+
+	g_ptr_array_free (added, TRUE);
+	g_hash_table_destroy (expanded);
+	g_hash_table_destroy (kept);
+	g_hash_table_destroy (shown);
+}
+
 static void
 build_flat (MessageList *message_list,
             GPtrArray *summary,
@@ -5203,7 +5441,7 @@ message_list_set_folder (MessageList *message_list,
 	}
 
 	/* Invalidate the thread tree. */
-	message_list_set_thread_tree (message_list, NULL);
+	message_list_set_thread_tree (message_list, NULL, NULL);
 
 	g_free (message_list->cursor_uid);
 	message_list->cursor_uid = NULL;
@@ -5347,7 +5585,7 @@ message_list_set_show_deleted (MessageList *message_list,
 	g_object_notify (G_OBJECT (message_list), "show-deleted");
 
 	/* Invalidate the thread tree. */
-	message_list_set_thread_tree (message_list, NULL);
+	message_list_set_thread_tree (message_list, NULL, NULL);
 
 	/* Changing this property triggers a message list regen. */
 	if (message_list->frozen == 0)
@@ -5378,7 +5616,7 @@ message_list_set_show_junk (MessageList *message_list,
 	g_object_notify (G_OBJECT (message_list), "show-junk");
 
 	/* Invalidate the thread tree. */
-	message_list_set_thread_tree (message_list, NULL);
+	message_list_set_thread_tree (message_list, NULL, NULL);
 
 	/* Changing this property triggers a message list regen. */
 	if (message_list->frozen == 0)
@@ -5467,6 +5705,9 @@ message_list_set_thread_subject (MessageList *message_list,
 
 	message_list->priv->thread_subject = thread_subject;
 
+	/* Invalidate the thread tree. */
+	message_list_set_thread_tree (message_list, NULL, NULL);
+
 	g_object_notify (G_OBJECT (message_list), "thread-subject");
 }
 
@@ -5991,7 +6232,7 @@ message_list_set_search (MessageList *message_list,
 		regen_data_unref (current_regen_data);
 
 	/* Invalidate the thread tree. */
-	message_list_set_thread_tree (message_list, NULL);
+	message_list_set_thread_tree (message_list, NULL, NULL);
 
 	if (message_list->frozen == 0)
 		mail_regen_list (message_list, search ? search : "", NULL);
@@ -6063,6 +6304,150 @@ message_list_regen_tweak_search_results (MessageList *message_list,
 	g_clear_object (&info);
 }
 
+/* Evaluates the search expression only for the messages mentioned in
+ * the regen_data->changes and splits them into messages to be shown and
+ * messages to be hidden.  When grouping by threads, a new thread tree is
+ * built from the UIDs of the current thread tree, updated by the changes,
+ * which avoids searching and sorting the whole folder again. */
+static void
+message_list_regen_thread_incremental (MessageList *message_list,
+                                       RegenData *regen_data,
+                                       CamelFolder *folder,
+                                       const gchar *expr,
+                                       gboolean hide_deleted,
+                                       gboolean hide_junk,
+                                       GCancellable *cancellable,
+                                       GError **error)
+{
+	CamelFolderChangeInfo *changes;
+	GPtrArray *uids, *matches = NULL;
+	GHashTable *matched;
+	guint ii;
+
+	changes = regen_data->changes;
+
+	uids = g_ptr_array_sized_new (changes->uid_added->len + changes->uid_changed->len);
+
+	for (ii = 0; ii < changes->uid_added->len; ii++)
+		g_ptr_array_add (uids, changes->uid_added->pdata[ii]);
+
+	for (ii = 0; ii < changes->uid_changed->len; ii++)
+		g_ptr_array_add (uids, changes->uid_changed->pdata[ii]);
+
+	if (uids->len > 0 && expr && *expr) {
+		GError *local_error = NULL;
+
+		matches = camel_folder_search_by_uids (
+			folder, expr, uids, cancellable, &local_error);
+
+		if (local_error != NULL) {
+			if (matches != NULL)
+				camel_folder_search_free (folder, matches);
+			g_propagate_error (error, local_error);
+			g_ptr_array_free (uids, TRUE);
+			return;
+		}
+
+		if (matches != NULL)
+			message_list_regen_tweak_search_results (
+				message_list,
+				matches, folder, TRUE,
+				!hide_deleted,
+				!hide_junk);
+	}
+
+	matched = g_hash_table_new (g_str_hash, g_str_equal);
+
+	if (matches != NULL) {
+		for (ii = 0; ii < matches->len; ii++)
+			g_hash_table_add (matched, matches->pdata[ii]);
+	} else if (!expr || !*expr) {
+		for (ii = 0; ii < uids->len; ii++)
+			g_hash_table_add (matched, uids->pdata[ii]);
+	}
+
+	regen_data->show_infos = g_ptr_array_new_with_free_func (g_object_unref);
+	regen_data->hide_uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+
+	for (ii = 0; ii < changes->uid_removed->len; ii++)
+		g_ptr_array_add (
+			regen_data->hide_uids,
+			(gpointer) camel_pstring_strdup (changes->uid_removed->pdata[ii]));
+
+	for (ii = 0; ii < uids->len; ii++) {
+		const gchar *uid = uids->pdata[ii];
+		CamelMessageInfo *info = NULL;
+
+		if (g_hash_table_contains (matched, uid))
+			info = camel_folder_get_message_info (folder, uid);
+
+		if (info != NULL)
+			g_ptr_array_add (regen_data->show_infos, info);
+		else
+			g_ptr_array_add (regen_data->hide_uids, (gpointer) camel_pstring_strdup (uid));
+	}
+
+	if (regen_data->group_by_threads && regen_data->thread_uids != NULL) {
+		GPtrArray *thread_uids, *appended;
+		GHashTable *known, *hidden;
+
+		known = g_hash_table_new (g_str_hash, g_str_equal);
+		hidden = g_hash_table_new (g_str_hash, g_str_equal);
+
+		for (ii = 0; ii < regen_data->hide_uids->len; ii++)
+			g_hash_table_add (hidden, regen_data->hide_uids->pdata[ii]);
+
+		thread_uids = g_ptr_array_new_full (
+			regen_data->thread_uids->len + regen_data->show_infos->len,
+			(GDestroyNotify) camel_pstring_free);
+
+		/* Keep the order of the already threaded messages, thus
+		 * the new thread tree differs only in the changed parts. */
+		for (ii = 0; ii < regen_data->thread_uids->len; ii++) {
+			const gchar *uid = regen_data->thread_uids->pdata[ii];
+
+			g_hash_table_add (known, (gpointer) uid);
+
+			if (!g_hash_table_contains (hidden, uid))
+				g_ptr_array_add (thread_uids, (gpointer) camel_pstring_strdup (uid));
+		}
+
+		appended = g_ptr_array_new ();
+
+		for (ii = 0; ii < regen_data->show_infos->len; ii++) {
+			const gchar *uid;
+
+			uid = camel_message_info_get_uid (regen_data->show_infos->pdata[ii]);
+
+			if (!g_hash_table_contains (known, uid))
+				g_ptr_array_add (appended, (gpointer) uid);
+		}
+
+		if (appended->len > 1)
+			camel_folder_sort_uids (folder, appended);
+
+		for (ii = 0; ii < appended->len; ii++)
+			g_ptr_array_add (thread_uids, (gpointer) camel_pstring_strdup (appended->pdata[ii]));
+
+		regen_data->thread_tree = camel_folder_thread_messages_new (
+			folder, thread_uids, regen_data->thread_subject);
+
+		g_ptr_array_unref (regen_data->thread_uids);
+		regen_data->thread_uids = thread_uids;
+
+		g_ptr_array_free (appended, TRUE);
+		g_hash_table_destroy (hidden);
+		g_hash_table_destroy (known);
+	}
+
+	g_hash_table_destroy (matched);
+
+	if (matches != NULL)
+		camel_folder_search_free (folder, matches);
+
+	g_ptr_array_free (uids, TRUE);
+}
+
 static void
 message_list_regen_thread (GSimpleAsyncResult *simple,
                            GObject *source_object,
@@ -6129,6 +6514,25 @@ message_list_regen_thread (GSimpleAsyncResult *simple,
 		}
 	}
 
+	if (regen_data->incremental) {
+		message_list_regen_thread_incremental (
+			message_list, regen_data, folder, expr->str,
+			hide_deleted, hide_junk, cancellable, &local_error);
+
+		/* coverity[unchecked_value] */
+		if (local_error == NULL && g_cancellable_set_error_if_cancelled (cancellable, &local_error)) {
+			;
+		}
+
+		if (local_error != NULL)
+			g_simple_async_result_take_error (simple, local_error);
+
+		g_string_free (expr, TRUE);
+		g_object_unref (folder);
+
+		return;
+	}
+
 	/* Execute the search. */
 
 	if (expr->len == 0) {
@@ -6191,6 +6595,14 @@ message_list_regen_thread (GSimpleAsyncResult *simple,
 	/* update/build a new tree */
 	if (regen_data->group_by_threads) {
 		CamelFolderThread *thread_tree;
+		guint ii;
+
+		/* Remember the UIDs, to be able to build an updated thread tree
+		 * from them when only a few messages change in the folder. */
+		regen_data->thread_uids = g_ptr_array_new_full (uids->len, (GDestroyNotify) camel_pstring_free);
+
+		for (ii = 0; ii < uids->len; ii++)
+			g_ptr_array_add (regen_data->thread_uids, (gpointer) camel_pstring_strdup (uids->pdata[ii]));
 
 		/* Always build a new thread_tree, to avoid race condition
 		   when accessing it here and in the build_tree() call
@@ -6339,6 +6751,201 @@ message_list_correct_row_for_remove_in_selection (MessageList *message_list,
 	return best_row;
 }
 
+static void
+message_list_update_info_message (MessageList *message_list,
+                                  gint row_count)
+{
+	const gchar *info_message;
+	gboolean have_search_expr;
+
+	if (!gtk_widget_get_visible (GTK_WIDGET (message_list)))
+		return;
+
+	/* space is used to indicate no search too */
+	have_search_expr =
+		(message_list->search != NULL) &&
+		(*message_list->search != '\0') &&
+		(strcmp (message_list->search, " ") != 0);
+
+	if (row_count > 0) {
+		info_message = NULL;
+	} else if (have_search_expr) {
+		info_message =
+			_("No message satisfies your search criteria. "
+			"Change search criteria by selecting a new "
+			"Show message filter from the drop down list "
+			"above or by running a new search either by "
+			"clearing it with Search→Clear menu item or "
+			"by changing the query above.");
+	} else {
+		info_message =
+			_("There are no messages in this folder.");
+	}
+
+	e_tree_set_info_message (E_TREE (message_list), info_message);
+}
+
+/* Applies the result of message_list_regen_thread_incremental() on the
+ * current content of the message list.  Nodes of the messages which did
+ * not change are left untouched, thus also their selection and expanded
+ * state is preserved. */
+static void
+message_list_regen_apply_changes (MessageList *message_list,
+                                  RegenData *regen_data)
+{
+	ETree *tree;
+	ETreeModel *tree_model;
+	ETreeTableAdapter *adapter;
+	ETableItem *table_item;
+	GHashTable *hidden;
+	GPtrArray *selected;
+	GNode *node;
+	xmlDoc *expand_state = NULL;
+	gchar *next_uid = NULL;
+	gboolean cursor_hidden = FALSE;
+	gboolean batch;
+	guint ii;
+
+	tree = E_TREE (message_list);
+	tree_model = E_TREE_MODEL (message_list);
+	adapter = e_tree_get_table_adapter (tree);
+	table_item = e_tree_get_item (tree);
+
+	/* The uids are from the camel string pool, the same as the removed_uids */
+	hidden = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (ii = 0; ii < regen_data->hide_uids->len; ii++)
+		g_hash_table_add (hidden, regen_data->hide_uids->pdata[ii]);
+
+	/* Find where to move the cursor, in case its message disappears. */
+	node = message_list->cursor_uid ? g_hash_table_lookup (message_list->uid_nodemap, message_list->cursor_uid) : NULL;
+	if (node && g_hash_table_contains (hidden, get_message_uid (message_list, node))) {
+		gint row;
+
+		cursor_hidden = TRUE;
+
+		row = e_tree_table_adapter_row_of_node (adapter, node);
+		if (row != -1) {
+			row = message_list_correct_row_for_remove (message_list, row, hidden);
+			node = row != -1 ? e_tree_table_adapter_node_at_row (adapter, row) : NULL;
+
+			if (node && !g_hash_table_contains (hidden, get_message_uid (message_list, node)))
+				next_uid = g_strdup (get_message_uid (message_list, node));
+		}
+	}
+
+	selected = message_list_get_selected (message_list);
+
+	/* Many changes are applied in a batch, with the tree model frozen. */
+	batch = regen_data->show_infos->len + regen_data->hide_uids->len > INCREMENTAL_REGEN_SPLICE_LIMIT;
+
+	if (table_item)
+		e_table_item_freeze (table_item);
+
+	if (batch) {
+		/* The tree table adapter recreates its nodes on thaw */
+		expand_state = e_tree_table_adapter_save_expanded_state_xml (adapter);
+		message_list_tree_model_freeze (message_list);
+	}
+
+	if (regen_data->group_by_threads) {
+		if (batch) {
+			gint row = 0;
+
+			build_subtree_diff (
+				message_list,
+				message_list->priv->tree_model_root,
+				g_node_first_child (message_list->priv->tree_model_root),
+				regen_data->thread_tree ? regen_data->thread_tree->tree : NULL,
+				&row);
+		} else {
+			/* Only the changed threads are replaced */
+			splice_threads (message_list, regen_data->thread_tree);
+		}
+
+		message_list_set_thread_tree (
+			message_list, regen_data->thread_tree,
+			regen_data->thread_uids);
+	} else {
+		for (ii = 0; ii < regen_data->hide_uids->len; ii++) {
+			node = g_hash_table_lookup (message_list->uid_nodemap, regen_data->hide_uids->pdata[ii]);
+			if (node)
+				remove_node_diff (message_list, node, 0);
+		}
+
+		for (ii = 0; ii < regen_data->show_infos->len; ii++) {
+			CamelMessageInfo *info = regen_data->show_infos->pdata[ii];
+
+			if (!g_hash_table_contains (message_list->uid_nodemap, camel_message_info_get_uid (info)))
+				ml_uid_nodemap_insert (message_list, info, NULL, -1);
+		}
+	}
+
+	if (batch) {
+		/* The adapter was not notified about the node changes,
+		 * thus let it forget the nodes, instead of reusing them. */
+		e_tree_table_adapter_clear_nodes_silent (adapter);
+		message_list_tree_model_thaw (message_list);
+
+		if (expand_state) {
+			e_tree_table_adapter_load_expanded_state_xml (adapter, expand_state);
+			xmlFreeDoc (expand_state);
+		}
+	} else {
+		CamelFolderChangeInfo *changes = regen_data->changes;
+
+		/* Redraw rows of the changed messages, which were shown already */
+		for (ii = 0; ii < changes->uid_changed->len; ii++) {
+			node = g_hash_table_lookup (message_list->uid_nodemap, changes->uid_changed->pdata[ii]);
+			if (node) {
+				e_tree_model_pre_change (tree_model);
+				e_tree_model_node_data_changed (tree_model, node);
+			}
+		}
+	}
+
+	if (table_item) {
+		/* Do not scroll to the cursor, the change came from the folder */
+		table_item->queue_show_cursor = FALSE;
+		e_table_item_thaw (table_item);
+	}
+
+	message_list_set_selected (message_list, selected);
+	g_ptr_array_unref (selected);
+
+	if (regen_data->select_all) {
+		message_list_select_all (message_list);
+	} else if (regen_data->select_uid != NULL) {
+		message_list_select_uid (
+			message_list,
+			regen_data->select_uid,
+			regen_data->select_use_fallback);
+	} else if (cursor_hidden && message_list_selected_count (message_list) <= 1) {
+		node = next_uid ? g_hash_table_lookup (message_list->uid_nodemap, next_uid) : NULL;
+
+		if (node) {
+			select_node (message_list, node);
+		} else {
+			g_free (message_list->cursor_uid);
+			message_list->cursor_uid = NULL;
+			g_signal_emit (
+				message_list,
+				signals[MESSAGE_SELECTED], 0, NULL);
+		}
+	}
+
+	message_list_update_info_message (
+		message_list,
+		e_table_model_row_count (E_TABLE_MODEL (adapter)));
+
+	g_signal_emit (
+		message_list,
+		signals[MESSAGE_LIST_BUILT], 0);
+
+	g_hash_table_destroy (hidden);
+	g_free (next_uid);
+}
+
 static void
 message_list_regen_done_cb (GObject *source_object,
                             GAsyncResult *result,
@@ -6385,6 +6992,11 @@ message_list_regen_done_cb (GObject *source_object,
 
 	e_activity_set_state (activity, E_ACTIVITY_COMPLETED);
 
+	if (regen_data->incremental) {
+		message_list_regen_apply_changes (message_list, regen_data);
+		return;
+	}
+
 	tree = E_TREE (message_list);
 	adapter = e_tree_get_table_adapter (tree);
 
@@ -6477,7 +7089,8 @@ message_list_regen_done_cb (GObject *source_object,
 			regen_data->folder_changed);
 
 		message_list_set_thread_tree (
-			message_list, regen_data->thread_tree);
+			message_list, regen_data->thread_tree,
+			regen_data->thread_uids);
 
 		if (forcing_expand_state) {
 			if (message_list->priv->folder != NULL && tree != NULL)
@@ -6691,33 +7304,7 @@ message_list_regen_done_cb (GObject *source_object,
 	if (last_row_uid)
 		camel_pstring_free (last_row_uid);
 
-	if (gtk_widget_get_visible (GTK_WIDGET (message_list))) {
-		const gchar *info_message;
-		gboolean have_search_expr;
-
-		/* space is used to indicate no search too */
-		have_search_expr =
-			(message_list->search != NULL) &&
-			(*message_list->search != '\0') &&
-			(strcmp (message_list->search, " ") != 0);
-
-		if (row_count > 0) {
-			info_message = NULL;
-		} else if (have_search_expr) {
-			info_message =
-				_("No message satisfies your search criteria. "
-				"Change search criteria by selecting a new "
-				"Show message filter from the drop down list "
-				"above or by running a new search either by "
-				"clearing it with Search→Clear menu item or "
-				"by changing the query above.");
-		} else {
-			info_message =
-				_("There are no messages in this folder.");
-		}
-
-		e_tree_set_info_message (tree, info_message);
-	}
+	message_list_update_info_message (message_list, row_count);
 
 	g_signal_handlers_unblock_by_func (
 		adapter, ml_tree_sorting_changed, message_list);
@@ -6782,12 +7369,26 @@ message_list_regen_idle_cb (gpointer user_data)
 	if (regen_data->select_unread)
 		message_list_set_regen_selects_unread (message_list, FALSE);
 
+	if (regen_data->incremental) {
+		/* The thread tree is invalidated when any setting which
+		 * influences it changes, thus reuse it only when it's set. */
+		if (regen_data->select_unread)
+			regen_data->incremental = FALSE;
+		else if (regen_data->group_by_threads)
+			regen_data->thread_uids = message_list_ref_thread_uids (message_list);
+
+		if (regen_data->group_by_threads && !regen_data->thread_uids)
+			regen_data->incremental = FALSE;
+	}
+
 	searching = message_list_is_searching (message_list);
 
 	adapter = e_tree_get_table_adapter (E_TREE (message_list));
 	row_count = e_table_model_row_count (E_TABLE_MODEL (adapter));
 
-	if (row_count <= 0) {
+	if (regen_data->incremental) {
+		/* Nothing to remember, the content is updated in place. */
+	} else if (row_count <= 0) {
 		if (gtk_widget_get_visible (GTK_WIDGET (message_list)))
 			e_tree_set_info_message (E_TREE (message_list), _("Generating message list…"));
 	} else if (regen_data->group_by_threads &&
@@ -6850,6 +7451,38 @@ mail_regen_cancel (MessageList *message_list)
 	}
 }
 
+/* Whether it's enough to apply only the 'folder_changes' on the current
+ * content, instead of searching, sorting and threading the whole folder.
+ * This is not the case when the content is not up to date with the settings
+ * of the message list, which is taken care of by the callers, which change
+ * the settings and schedule a full regen. */
+static gboolean
+message_list_can_regen_incrementally (MessageList *message_list,
+                                      const gchar *search,
+                                      CamelFolderChangeInfo *folder_changes)
+{
+	guint n_changes;
+
+	if (!folder_changes ||
+	    message_list->just_set_folder ||
+	    message_list->expand_all ||
+	    message_list->collapse_all ||
+	    message_list->priv->thaw_needs_regen ||
+	    message_list->priv->tree_model_root == NULL)
+		return FALSE;
+
+	if (g_strcmp0 (search, message_list->search) != 0)
+		return FALSE;
+
+	n_changes =
+		folder_changes->uid_added->len +
+		folder_changes->uid_removed->len +
+		folder_changes->uid_changed->len;
+
+	/* Rebuilding is cheaper when most of the folder changed. */
+	return n_changes <= g_hash_table_size (message_list->uid_nodemap) / 2;
+}
+
 static void
 mail_regen_list (MessageList *message_list,
                  const gchar *search,
@@ -6916,6 +7549,14 @@ mail_regen_list (MessageList *message_list,
 	if (message_list->priv->regen_idle_id > 0) {
 		g_return_if_fail (old_regen_data != NULL);
 
+		/* Merge the changes, or do the full regen, when anything else changed. */
+		if (old_regen_data->incremental) {
+			if (folder_changes && g_strcmp0 (search, old_regen_data->search) == 0)
+				camel_folder_change_info_cat (old_regen_data->changes, folder_changes);
+			else
+				old_regen_data->incremental = FALSE;
+		}
+
 		if (g_strcmp0 (search, old_regen_data->search) != 0) {
 			g_free (old_regen_data->search);
 			old_regen_data->search = g_strdup (search);
@@ -6951,6 +7592,18 @@ mail_regen_list (MessageList *message_list,
 	new_regen_data->search = g_strdup (search);
 	/* Make sure the folder_changes won't reset currently running regen, which would scroll to the selection in the UI */
 	new_regen_data->folder_changed = folder_changes != NULL && (!old_regen_data || old_regen_data->folder_changed);
+	/* A running incremental regen is cancelled below, thus take over its changes. */
+	new_regen_data->incremental = (!old_regen_data || old_regen_data->incremental) &&
+		message_list_can_regen_incrementally (message_list, search, folder_changes);
+
+	if (new_regen_data->incremental) {
+		new_regen_data->changes = camel_folder_change_info_new ();
+
+		if (old_regen_data)
+			camel_folder_change_info_cat (new_regen_data->changes, old_regen_data->changes);
+
+		camel_folder_change_info_cat (new_regen_data->changes, folder_changes);
+	}
 
 	if (folder_changes && folder_changes->uid_removed && new_regen_data->folder_changed) {
 		guint ii;
@@ -206,6 +206,8 @@ gboolean	message_list_select		(MessageList *message_list,
 						 MessageListSelectDirection direction,
 						 guint32 flags,
 						 guint32 mask);
+gchar *		message_list_dup_adjacent_uid	(MessageList *message_list,
+						 MessageListSelectDirection direction);
 gboolean	message_list_can_select		(MessageList *message_list,
 						 MessageListSelectDirection direction,
 						 guint32 flags,
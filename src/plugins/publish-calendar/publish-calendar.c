@@ -52,7 +52,7 @@ static void  error_queue_add (gchar *descriptions, GError *error);
 
 gint          e_plugin_lib_enable (EPlugin *ep, gint enable);
 GtkWidget   *publish_calendar_locations (EPlugin *epl, EConfigHookItemFactoryData *data);
-static void  update_timestamp (EPublishUri *uri);
+static void  update_timestamp (EPublishUri *uri, const gchar *digest);
 static void publish (EPublishUri *uri, gboolean can_report_success);
 
 static GtkStatusIcon *status_icon = NULL;
@@ -189,20 +189,101 @@ publish_uri_async (EPublishUri *uri)
 	}
 }
 
+static gchar *
+publish_compute_digest (EPublishUri *uri,
+                        GInputStream *input,
+                        GError **error)
+{
+	GChecksum *checksum;
+	gchar buffer[16384];
+	gchar *digest = NULL;
+	gssize n_read;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+	/* Include the location, to publish again when it changes */
+	g_checksum_update (checksum, (const guchar *) uri->location, -1);
+	g_checksum_update (checksum, (const guchar *) "\n", 1);
+
+	while (n_read = g_input_stream_read (input, buffer, sizeof (buffer), NULL, error), n_read > 0)
+		g_checksum_update (checksum, (const guchar *) buffer, n_read);
+
+	if (n_read == 0)
+		digest = g_strdup (g_checksum_get_string (checksum));
+
+	g_checksum_free (checksum);
+
+	return digest;
+}
+
 static void
 publish_online (EPublishUri *uri,
                 GFile *file,
                 GError **perror,
                 gboolean can_report_success)
 {
+	GFileIOStream *tmp_stream = NULL;
 	GOutputStream *stream;
+	GFile *tmp_file;
+	gchar *digest = NULL;
 	GError *error = NULL;
 
+	/* Write the calendars into a temporary file first, thus the published
+	 * file is not replaced when nothing changed since the last publish. */
+	tmp_file = g_file_new_tmp ("evolution-publish-XXXXXX", &tmp_stream, &error);
+	if (tmp_file == NULL) {
+		error_queue_add (
+			g_strdup_printf (
+				_("There was an error while publishing to %s:"),
+				uri->location),
+			error);
+		return;
+	}
+
+	stream = g_io_stream_get_output_stream (G_IO_STREAM (tmp_stream));
+
+	switch (uri->publish_format) {
+		case URI_PUBLISH_AS_ICAL:
+			publish_calendar_as_ical (stream, uri, &error);
+			break;
+		case URI_PUBLISH_AS_FB:
+		case URI_PUBLISH_AS_FB_WITH_DETAILS:
+			publish_calendar_as_fb (stream, uri, &error);
+			break;
+	}
+
+	if (error == NULL &&
+	    g_seekable_seek (G_SEEKABLE (tmp_stream), 0, G_SEEK_SET, NULL, &error))
+		digest = publish_compute_digest (uri, g_io_stream_get_input_stream (G_IO_STREAM (tmp_stream)), &error);
+
+	if (error != NULL) {
+		error_queue_add (
+			g_strdup_printf (
+				_("There was an error while publishing to %s:"),
+				uri->location),
+			error);
+		update_timestamp (uri, NULL);
+		goto exit;
+	}
+
+	if (g_strcmp0 (digest, uri->last_pub_digest) == 0) {
+		/* Nothing changed, do not upload the same content again */
+		if (can_report_success)
+			error_queue_add (
+				g_strdup_printf (
+					_("Publishing to %s finished successfully"),
+					uri->location),
+				NULL);
+
+		update_timestamp (uri, digest);
+		goto exit;
+	}
+
 	stream = G_OUTPUT_STREAM (g_file_replace (
 		file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error));
 
 	/* Sanity check. */
-	g_return_if_fail (
+	g_warn_if_fail (
 		((stream != NULL) && (error == NULL)) ||
 		((stream == NULL) && (error != NULL)));
 
@@ -216,18 +297,13 @@ publish_online (EPublishUri *uri,
 					uri->location),
 				error);
 		}
-		return;
+		goto exit;
 	}
 
-	switch (uri->publish_format) {
-		case URI_PUBLISH_AS_ICAL:
-			publish_calendar_as_ical (stream, uri, &error);
-			break;
-		case URI_PUBLISH_AS_FB:
-		case URI_PUBLISH_AS_FB_WITH_DETAILS:
-			publish_calendar_as_fb (stream, uri, &error);
-			break;
-	}
+	if (g_seekable_seek (G_SEEKABLE (tmp_stream), 0, G_SEEK_SET, NULL, &error))
+		g_output_stream_splice (
+			stream, g_io_stream_get_input_stream (G_IO_STREAM (tmp_stream)),
+			G_OUTPUT_STREAM_SPLICE_NONE, NULL, &error);
 
 	if (error != NULL)
 		error_queue_add (
@@ -242,10 +318,18 @@ publish_online (EPublishUri *uri,
 				uri->location),
 			NULL);
 
-	update_timestamp (uri);
+	/* Forget the digest on failure, to publish again the next time */
+	update_timestamp (uri, error ? NULL : digest);
 
 	g_output_stream_close (stream, NULL, NULL);
 	g_object_unref (stream);
+
+exit:
+	g_io_stream_close (G_IO_STREAM (tmp_stream), NULL, NULL);
+	g_file_delete (tmp_file, NULL, NULL);
+	g_object_unref (tmp_stream);
+	g_object_unref (tmp_file);
+	g_free (digest);
 }
 
 static void
@@ -521,7 +605,8 @@ add_timeout (EPublishUri *uri)
 }
 
 static void
-update_timestamp (EPublishUri *uri)
+update_timestamp (EPublishUri *uri,
+                  const gchar *digest)
 {
 	GSettings *settings;
 	gchar **set_uris;
@@ -545,6 +630,9 @@ update_timestamp (EPublishUri *uri)
 		g_free (uri->last_pub_time);
 	uri->last_pub_time = g_strdup_printf ("%d", (gint) time (NULL));
 
+	g_free (uri->last_pub_digest);
+	uri->last_pub_digest = g_strdup (digest);
+
 	uris_array = g_ptr_array_new_full (3, g_free);
 	settings = e_util_ref_settings (PC_SETTINGS_ID);
 	set_uris = g_settings_get_strv (settings, PC_SETTINGS_URIS);
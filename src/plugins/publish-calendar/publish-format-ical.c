@@ -25,52 +25,10 @@
 #include <glib/gi18n.h>
 
 #include <shell/e-shell.h>
+#include <calendar/gui/comp-util.h>
 
 #include "publish-format-ical.h"
 
-typedef struct {
-	GHashTable *zones;
-	ECalClient *client;
-} CompTzData;
-
- static void
-insert_tz_comps (ICalParameter *param,
-                 gpointer cb_data)
-{
-	const gchar *tzid;
-	CompTzData *tdata = cb_data;
-	ICalTimezone *zone = NULL;
-	ICalComponent *tzcomp;
-	GError *error = NULL;
-
-	tzid = i_cal_parameter_get_tzid (param);
-
-	if (g_hash_table_lookup (tdata->zones, tzid))
-		return;
-
-	if (!e_cal_client_get_timezone_sync (tdata->client, tzid, &zone, NULL, &error))
-		zone = NULL;
-
-	if (error != NULL) {
-		g_warning (
-			"Could not get the timezone information for %s: %s",
-			tzid, error->message);
-		g_error_free (error);
-		return;
-	}
-
-	tzcomp = i_cal_component_clone (i_cal_timezone_get_component (zone));
-	g_hash_table_insert (tdata->zones, (gpointer) tzid, (gpointer) tzcomp);
-}
-
-static void
-append_tz_to_comp (gpointer key,
-		   gpointer value,
-		   ICalComponent *toplevel)
-{
-	i_cal_component_take_component (toplevel, (ICalComponent *) value);
-}
-
 static gboolean
 write_calendar (const gchar *uid,
                 GOutputStream *stream,
@@ -81,7 +39,6 @@ write_calendar (const gchar *uid,
 	ESourceRegistry *registry;
 	EClient *client = NULL;
 	GSList *objects = NULL;
-	ICalComponent *top_level;
 	gboolean res = FALSE;
 
 	shell = e_shell_get_default ();
@@ -105,38 +62,12 @@ write_calendar (const gchar *uid,
 	if (client == NULL)
 		return FALSE;
 
-	top_level = e_cal_util_new_top_level ();
-
-	e_cal_client_get_object_list_sync (
-		E_CAL_CLIENT (client), "#t", &objects, NULL, error);
-
-	if (objects != NULL) {
-		GSList *iter;
-		gchar *ical_string;
-		CompTzData tdata;
-
-		tdata.zones = g_hash_table_new (g_str_hash, g_str_equal);
-		tdata.client = E_CAL_CLIENT (client);
-
-		for (iter = objects; iter; iter = iter->next) {
-			ICalComponent *icomp = i_cal_component_clone (iter->data);
-			i_cal_component_foreach_tzid (icomp, insert_tz_comps, &tdata);
-			i_cal_component_take_component (top_level, icomp);
-		}
-
-		g_hash_table_foreach (tdata.zones, (GHFunc) append_tz_to_comp, top_level);
-
-		g_hash_table_destroy (tdata.zones);
-		tdata.zones = NULL;
-
-		ical_string = i_cal_component_as_ical_string (top_level);
-		res = g_output_stream_write_all (stream, ical_string, strlen (ical_string), NULL, NULL, error);
-		g_free (ical_string);
+	if (e_cal_client_get_object_list_sync (E_CAL_CLIENT (client), "#t", &objects, NULL, error)) {
+		res = cal_comp_util_write_vcalendar_sync (E_CAL_CLIENT (client), objects, stream, NULL, error);
 		e_util_free_nullable_object_slist (objects);
 	}
 
 	g_object_unref (client);
-	g_object_unref (top_level);
 
 	return res;
 }
@@ -134,7 +134,7 @@ e_publish_uri_from_xml (const gchar *xml)
 	xmlDocPtr doc;
 	xmlNodePtr root, p;
 	xmlChar *location, *enabled, *frequency, *fb_duration_value, *fb_duration_type;
-	xmlChar *publish_time, *format, *username = NULL;
+	xmlChar *publish_time, *publish_digest, *format, *username = NULL;
 	GSList *events = NULL;
 	EPublishUri *uri;
 
@@ -159,6 +159,7 @@ e_publish_uri_from_xml (const gchar *xml)
 	frequency = xmlGetProp (root, (const guchar *)"frequency");
 	format = xmlGetProp (root, (const guchar *)"format");
 	publish_time = xmlGetProp (root, (const guchar *)"publish_time");
+	publish_digest = xmlGetProp (root, (const guchar *)"publish_digest");
 	fb_duration_value = xmlGetProp (root, (xmlChar *)"fb_duration_value");
 	fb_duration_type = xmlGetProp (root, (xmlChar *)"fb_duration_type");
 
@@ -172,6 +173,8 @@ e_publish_uri_from_xml (const gchar *xml)
 		uri->publish_format = atoi ((gchar *) format);
 	if (publish_time != NULL)
 		uri->last_pub_time = (gchar *) publish_time;
+	if (publish_digest != NULL)
+		uri->last_pub_digest = g_strdup ((gchar *) publish_digest);
 
 	if (fb_duration_value)
 		uri->fb_duration_value = atoi ((gchar *) fb_duration_value);
@@ -205,6 +208,7 @@ e_publish_uri_from_xml (const gchar *xml)
 	xmlFree (enabled);
 	xmlFree (frequency);
 	xmlFree (format);
+	xmlFree (publish_digest);
 	xmlFree (fb_duration_value);
 	xmlFree (fb_duration_type);
 	xmlFreeDoc (doc);
@@ -237,6 +241,8 @@ e_publish_uri_to_xml (EPublishUri *uri)
 	xmlSetProp (root, (const guchar *)"frequency", (guchar *) frequency);
 	xmlSetProp (root, (const guchar *)"format", (guchar *) format);
 	xmlSetProp (root, (const guchar *)"publish_time", (guchar *) uri->last_pub_time);
+	if (uri->last_pub_digest)
+		xmlSetProp (root, (const guchar *)"publish_digest", (guchar *) uri->last_pub_digest);
 
 	g_free (format);
 	format = g_strdup_printf ("%d", uri->fb_duration_value);
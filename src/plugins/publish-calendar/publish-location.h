@@ -57,6 +57,7 @@ struct _EPublishUri {
 	gchar *password;
 	GSList *events;
 	gchar *last_pub_time;
+	gchar *last_pub_digest; /* of the last published content, or NULL */
 	gint fb_duration_value;
 	gint fb_duration_type;
 
@@ -25,6 +25,8 @@
 #include <string.h>
 #include <glib/gi18n.h>
 
+#include <calendar/gui/comp-util.h>
+
 #include "format-handler.h"
 
 static void
@@ -41,49 +43,6 @@ display_error_message (GtkWidget *parent,
 	gtk_widget_destroy (dialog);
 }
 
-typedef struct {
-	GHashTable *zones;
-	ECalClient *client;
-} CompTzData;
-
-static void
-insert_tz_comps (ICalParameter *param,
-                 gpointer cb_data)
-{
-	const gchar *tzid;
-	CompTzData *tdata = cb_data;
-	ICalTimezone *zone = NULL;
-	ICalComponent *tzcomp;
-	GError *error = NULL;
-
-	tzid = i_cal_parameter_get_tzid (param);
-
-	if (g_hash_table_lookup (tdata->zones, tzid))
-		return;
-
-	if (!e_cal_client_get_timezone_sync (tdata->client, tzid, &zone, NULL, &error))
-		zone = NULL;
-
-	if (error != NULL) {
-		g_warning (
-			"Could not get the timezone information for %s: %s",
-			tzid, error->message);
-		g_error_free (error);
-		return;
-	}
-
-	tzcomp = i_cal_component_clone (i_cal_timezone_get_component (zone));
-	g_hash_table_insert (tdata->zones, (gpointer) tzid, (gpointer) tzcomp);
-}
-
-static void
-append_tz_to_comp (gpointer key,
-		   gpointer value,
-		   ICalComponent *toplevel)
-{
-	i_cal_component_add_component (toplevel, (ICalComponent *) value);
-}
-
 static void
 do_save_calendar_ical (FormatHandler *handler,
                        ESourceSelector *selector,
@@ -94,7 +53,6 @@ do_save_calendar_ical (FormatHandler *handler,
 	EClient *source_client;
 	GError *error = NULL;
 	GSList *objects = NULL;
-	ICalComponent *top_level = NULL;
 
 	if (!dest_uri)
 		return;
@@ -118,43 +76,20 @@ do_save_calendar_ical (FormatHandler *handler,
 		return;
 	}
 
-	/* create destination file */
-	top_level = e_cal_util_new_top_level ();
-
 	e_cal_client_get_object_list_sync (
 		E_CAL_CLIENT (source_client), "#t", &objects, NULL, &error);
 
 	if (objects != NULL) {
-		CompTzData tdata;
 		GOutputStream *stream;
-		GSList *iter;
-
-		tdata.zones = g_hash_table_new (g_str_hash, g_str_equal);
-		tdata.client = E_CAL_CLIENT (source_client);
-
-		for (iter = objects; iter; iter = iter->next) {
-			ICalComponent *icomp = i_cal_component_clone (iter->data);
-
-			i_cal_component_foreach_tzid (icomp, insert_tz_comps, &tdata);
-			i_cal_component_take_component (top_level, icomp);
-		}
-
-		g_hash_table_foreach (tdata.zones, (GHFunc) append_tz_to_comp, top_level);
-
-		g_hash_table_destroy (tdata.zones);
-		tdata.zones = NULL;
 
 		/* save the file */
 		stream = open_for_writing (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (selector))), dest_uri, &error);
 
 		if (stream) {
-			gchar *ical_str = i_cal_component_as_ical_string (top_level);
-
-			g_output_stream_write_all (stream, ical_str, strlen (ical_str), NULL, NULL, &error);
+			cal_comp_util_write_vcalendar_sync (E_CAL_CLIENT (source_client), objects, stream, NULL, &error);
 			g_output_stream_close (stream, NULL, NULL);
 
 			g_object_unref (stream);
-			g_free (ical_str);
 		}
 
 		e_util_free_nullable_object_slist (objects);
@@ -169,7 +104,6 @@ do_save_calendar_ical (FormatHandler *handler,
 
 	/* terminate */
 	g_object_unref (source_client);
-	g_object_unref (top_level);
 }
 
 FormatHandler *